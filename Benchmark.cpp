@@ -0,0 +1,933 @@
+/* Console executable that measures the performance of the Minesweeper engine (built by CMakeLists.txt as Benchmark).
+
+Every measure is taken on a sweep of board sizes and mine densities, always with the same seed, so two runs can be compared:
+- Reset phases: SetBoardInit, SetUserBoardInit, SetUserVisitedBoardInit, SetNearbyMinesBoardInit and the whole Reset, and a first click
+  safe Reset with its first click (mines placed on the click, nearby mines counted only on the rows of the displayed cells).
+- Reveal: a single cell with mines nearby (SetCellUserBoard + SetCellUserVisitedBoard), the areas opened by clicking on cells
+  without mines nearby, and the worst case flood fill (a board without mines, where one click opens every cell).
+- SetGameStatus.
+- Flags and chords: every mine flagged, then a chord on every number, checking no chord displays a mine.
+- Undo and redo (GameHistory.h) of every move of a game, one by one, and jumps between its start and its end, checking the end state
+  is reached again.
+- Snapshots: saving and loading a game in the middle (GameSnapshot.h), checking the loaded cells are the same.
+- Nearby mines: the cell by cell reference and each kernel supported by the CPU, checking they all give the same cells.
+- Mine placement: one thread and every core, checking that both give the same board for the same seed.
+- Strips (BoardStrips.h), on the boards of STRIPS_MIN_CELLS cells or more: nearby mines and the whole board opened by one click, on
+  1, 2, 4... threads up to the number of cores, checking every number of threads gives the same cells as one thread.
+- No guess boards of each difficulty, with and without repairs: time to the first valid board and candidates tried per second.
+- Infinite boards (InfiniteBoard.h): reveals on random cells far from each other, so each one creates and counts new tiles,
+  with the memory used for each explored tile.
+- Whole games of each difficulty, with a first click safe or not, with the kernels specialized for its size (FixedBoardKernels.h)
+  and with the generic code: median time per move of alternated runs (Reset included), checking both end on the same boards.
+- Mine probabilities (MineProbability.h) of each difficulty and of intermediate and expert boards, on every position of solver games where no safe cell is known: time per
+  position, with the slowest one and the positions that could not be counted exactly.
+- Sampled mine probabilities (MineSampler.h) of expert games, on the same positions: mean error against the exact ones after a fixed
+  time, and the positions that converged.
+Results are printed and, with --json, also written as JSON (- as file name writes them to the standard output, and the text to the error output).
+Pin it to one core (taskset -c 0 Benchmark on Linux) so the numbers of two runs can be compared.
+
+Usage: Benchmark [--json FILE] [--large]         --large adds 10000x10000 boards to the sweep
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Minesweeper.h"
+#include "MineGenerator.h"
+#include "NoGuessGenerator.h"
+#include "GameSnapshot.h"
+#include "GameHistory.h"
+#include "FixedBoardKernels.h"
+#include "InfiniteBoard.h"
+#include "BoardStrips.h"
+#include "MineProbability.h"
+#include "MineSampler.h"
+#include "Solver.h"
+#include "Random.h"
+
+#define BENCHMARK_SEED 2019         // Fixed seed, so every run measures the same boards
+#define MIN_MEASURE_SECONDS 0.05    // Each measure is repeated until it takes at least this long
+#define MAX_SINGLE_REVEALS 100000   // Cells revealed one by one on each round of the single reveal measure
+#define KERNEL_DENSITY 0.2          // Fraction of cells with a mine on the nearby mines and mine placement measures
+#define NOGUESS_BENCHMARK_DIFFICULTIES 5    // Difficulties of FMineSweeper::SetGameParams measured by the no guess generator
+#define NOGUESS_BENCHMARK_BOARDS 10         // No guess boards generated of each difficulty
+#define NOGUESS_BENCHMARK_SECONDS 2.0       // Time limit of each of those boards
+#define INFINITE_BENCHMARK_SPREAD (1 << 20)     // Reveals of the infinite board measure are on cells in (-SPREAD, SPREAD)
+#define FIXED_BENCHMARK_GAMES 1000          // Games of each difficulty played on each run of the specialized kernels measure
+#define FIXED_BENCHMARK_RUNS 15             // Runs of that measure, alternating the kernels and the generic code
+#define PROBABILITY_BENCHMARK_GAMES 200     // Games of each board size whose guesses are measured by the mine probabilities
+#define SAMPLER_BENCHMARK_GAMES 20          // Expert games whose guesses are sampled
+#define SAMPLER_BENCHMARK_MILLISECONDS 100  // Time the sampler runs on each of those positions
+
+/// Access to the private Reset phases of FMineSweeper, which is a friend of this struct
+struct FBenchmarkAccess
+{
+    static bool SetBoardInit(FMineSweeper& Game) { return Game.SetBoardInit(); }
+    static bool SetUserBoardInit(FMineSweeper& Game) { return Game.SetUserBoardInit(); }
+    static bool SetUserVisitedBoardInit(FMineSweeper& Game) { return Game.SetUserVisitedBoardInit(); }
+    static bool SetNearbyMinesBoardInit(FMineSweeper& Game) { return Game.SetNearbyMinesBoardInit(); }
+    static bool SetNearbyMinesBoardInitPerCell(FMineSweeper& Game) { return Game.SetNearbyMinesBoardInitPerCell(); }
+    static void SetSeed(FMineSweeper& Game, uint64_t Seed) { Game.Seed = Seed; }
+    static const uint8_t* GetCells(const FMineSweeper& Game) { return Game.Cells.GetData(); }
+    static const FFixedBoardKernels* GetFixedKernels(const FMineSweeper& Game) { return Game.FixedKernels; }
+    static void SetFixedKernels(FMineSweeper& Game, const FFixedBoardKernels* Kernels) { Game.FixedKernels = Kernels; }
+};
+
+/// One measure of the sweep
+struct FBenchmarkResult
+{
+    std::string Name;
+    int Width = 0;
+    int Height = 0;
+    int Mines = 0;
+    uint64_t Operations = 0;        // Times the measured operation was run
+    uint64_t Cells = 0;             // Cells processed by all those operations
+    double Seconds = 0.0;
+    std::string Check;              // Result of the consistency check, empty if the measure has none
+};
+
+/// Board size of the sweep
+struct FBoardSize
+{
+    int Width;
+    int Height;
+};
+
+typedef std::chrono::steady_clock FClock;
+
+/// Function prototypes
+bool ParseOptions(int, char*[], std::string&, bool&);
+void BenchmarkBoard(int, int, double);
+void BenchmarkResetPhases(FMineSweeper&);
+void BenchmarkSingleReveal(FMineSweeper&);
+void BenchmarkFloodFill(FMineSweeper&, const char*);
+void BenchmarkGameStatus(FMineSweeper&);
+void BenchmarkChord(FMineSweeper&);
+void BenchmarkHistory(FMineSweeper&);
+void BenchmarkSnapshot(FMineSweeper&);
+void BenchmarkNearbyMines(int, int);
+void BenchmarkMinePlacement(int, int);
+void BenchmarkStrips(int, int);
+void BenchmarkNoGuess(int);
+void BenchmarkFixedBoards(int, bool);
+void BenchmarkProbability(int, int, int);
+void BenchmarkSampler();
+void BenchmarkInfinite(double);
+template <typename FBody> uint64_t RepeatFor(double&, FBody);
+uint64_t HashCells(const FMineSweeper&);
+double GetSeconds(FClock::time_point, FClock::time_point);
+void Record(const std::string&, const FMineSweeper&, uint64_t, uint64_t, double, const std::string&);
+bool WriteJson(const std::string&);
+
+std::vector<FBenchmarkResult> Results;
+std::ostream* Log = &std::cout;
+
+/// Main loop
+int main(int argc, char* argv[])
+{
+    std::string JsonPath;
+    bool bLarge = false;
+    if (!ParseOptions(argc, argv, JsonPath, bLarge))
+    {
+        std::cout << "Usage: Benchmark [--json FILE] [--large]\n";
+        return 1;
+    }
+    if (JsonPath == "-")
+    {
+        Log = &std::cerr;           // Keep the standard output for the JSON
+    }
+
+    std::vector<FBoardSize> Sizes = { {9, 9}, {30, 16}, {256, 256}, {1000, 1000}, {4000, 4000} };
+    if (bLarge)
+    {
+        Sizes.push_back({10000, 10000});
+    }
+    const double Densities[] = { 0.05, 0.15, 0.25 };
+
+    *Log << "Benchmark (seed " << BENCHMARK_SEED << ", nearby mines kernel " << GetSimdLevelName(GetBestSimdLevel()) << ")\n";
+    for (const FBoardSize& Size : Sizes)
+    {
+        *Log << "\n";
+        for (double Density : Densities)
+        {
+            BenchmarkBoard(Size.Width, Size.Height, Density);
+        }
+        FMineSweeper EmptyBoard(Size.Width, Size.Height, 0);
+        BenchmarkFloodFill(EmptyBoard, "reveal.flood_worst");
+        BenchmarkNearbyMines(Size.Width, Size.Height);
+        BenchmarkMinePlacement(Size.Width, Size.Height);
+        BenchmarkStrips(Size.Width, Size.Height);
+    }
+    *Log << "\n";
+    for (int Difficulty = 1; Difficulty <= NOGUESS_BENCHMARK_DIFFICULTIES; Difficulty++)
+    {
+        BenchmarkNoGuess(Difficulty);
+    }
+    *Log << "\n";
+    for (int Difficulty = 1; Difficulty <= NOGUESS_BENCHMARK_DIFFICULTIES; Difficulty++)
+    {
+        BenchmarkFixedBoards(Difficulty, false);
+        BenchmarkFixedBoards(Difficulty, true);
+    }
+    *Log << "\n";
+    for (int Difficulty = 1; Difficulty <= NOGUESS_BENCHMARK_DIFFICULTIES; Difficulty++)
+    {
+        FMineSweeper Game;
+        Game.SetGameParams(Difficulty);
+        BenchmarkProbability(Game.GetBoardWidth(), Game.GetBoardHeight(), Game.GetNumMines());
+    }
+    BenchmarkProbability(16, 16, 40);               // Intermediate
+    BenchmarkProbability(30, 16, 99);               // Expert, where the frontier areas are the biggest
+    BenchmarkSampler();
+    *Log << "\n";
+    for (double Density : Densities)
+    {
+        BenchmarkInfinite(Density);
+    }
+
+    if (!JsonPath.empty() && !WriteJson(JsonPath))
+    {
+        std::cerr << "Error writing " << JsonPath << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+/// Read the command line
+bool ParseOptions(int argc, char* argv[], std::string& JsonPath, bool& bLarge)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            JsonPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--large") == 0)
+        {
+            bLarge = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Every measure that depends on the density of mines, on one board
+void BenchmarkBoard(int Width, int Height, double Density)
+{
+    FMineSweeper Game(Width, Height, (int) (Density * Width * Height));
+    BenchmarkResetPhases(Game);
+    BenchmarkSingleReveal(Game);
+    BenchmarkFloodFill(Game, "reveal.flood");
+    BenchmarkGameStatus(Game);
+    BenchmarkChord(Game);
+    BenchmarkHistory(Game);
+    BenchmarkSnapshot(Game);
+}
+
+/// Time each phase of Reset on its own, and the whole Reset
+void BenchmarkResetPhases(FMineSweeper& Game)
+{
+    uint64_t Size = Game.GetBoardSize();
+    double Seconds = 0.0;
+    FBenchmarkAccess::SetSeed(Game, BENCHMARK_SEED);
+
+    uint64_t Operations = RepeatFor(Seconds, [&]()     // SetBoardInit takes the board from the pool, so returning the previous one is part of the measure
+    {
+        Game.EraseMemory();
+        FBenchmarkAccess::SetBoardInit(Game);
+    });
+    Record("reset.SetBoardInit", Game, Operations, Operations * Size, Seconds, "");
+
+    Operations = RepeatFor(Seconds, [&]() { FBenchmarkAccess::SetUserBoardInit(Game); });
+    Record("reset.SetUserBoardInit", Game, Operations, Operations * Size, Seconds, "");
+
+    Operations = RepeatFor(Seconds, [&]() { FBenchmarkAccess::SetUserVisitedBoardInit(Game); });
+    Record("reset.SetUserVisitedBoardInit", Game, Operations, Operations * Size, Seconds, "");
+
+    Operations = RepeatFor(Seconds, [&]() { FBenchmarkAccess::SetNearbyMinesBoardInit(Game); });
+    Record("reset.SetNearbyMinesBoardInit", Game, Operations, Operations * Size, Seconds, "");
+
+    uint64_t Misses = GetBoardPoolStats().Misses;
+    Operations = RepeatFor(Seconds, [&]()
+    {
+        Game.EraseMemory();
+        Game.Reset(BENCHMARK_SEED);
+    });
+    Misses = GetBoardPoolStats().Misses - Misses;       // Boards of a size already seen must come from the pool
+    Record("reset.total", Game, Operations, Operations * Size, Seconds, Misses == 0 ? "no allocation" : "ALLOCATED");
+
+    Game.SetFirstClickSafe(true);                       // Reset and first click, with the mines placed on the click and lazy counts
+    Operations = RepeatFor(Seconds, [&]()
+    {
+        Game.Reset(BENCHMARK_SEED);
+        Game.SetCellUserBoard((int) Size / 2);
+        Game.SetCellUserVisitedBoard((int) Size / 2);
+    });
+    Game.SetFirstClickSafe(false);
+    Record("reset.first_click_safe", Game, Operations, Operations * Size, Seconds, "");
+    Game.EraseMemory();
+}
+
+/// Reveal cells with mines nearby one by one: each move shows a single cell and never floods
+void BenchmarkSingleReveal(FMineSweeper& Game)
+{
+    std::vector<int> Targets;
+    Game.Reset(BENCHMARK_SEED);
+    FBoardView NearbyMines = Game.GetNearbyMinesBoard();
+    for (int i = 0; i < Game.GetBoardSize() && (int) Targets.size() < MAX_SINGLE_REVEALS; i++)
+    {
+        if (NearbyMines[i] > '0' && NearbyMines[i] <= '8')
+        {
+            Targets.push_back(i);
+        }
+    }
+    if (Targets.empty())
+    {
+        Game.EraseMemory();
+        return;
+    }
+
+    double Seconds = 0.0;
+    uint64_t Rounds = 0;
+    while (Seconds < MIN_MEASURE_SECONDS)       // A new board each round, revealed cells can not be revealed again
+    {
+        Game.EraseMemory();
+        Game.Reset(BENCHMARK_SEED);
+        FClock::time_point Start = FClock::now();
+        for (int Index : Targets)
+        {
+            Game.SetCellUserBoard(Index);
+            Game.SetCellUserVisitedBoard(Index);
+        }
+        Seconds += GetSeconds(Start, FClock::now());
+        Rounds++;
+    }
+    Record("reveal.single", Game, Rounds * Targets.size(), Rounds * Targets.size(), Seconds, "");
+    Game.EraseMemory();
+}
+
+/// Click on every area of cells without mines nearby, one click per area, and time the cells they open
+void BenchmarkFloodFill(FMineSweeper& Game, const char* Name)
+{
+    std::vector<int> EmptyCells;
+    Game.Reset(BENCHMARK_SEED);
+    FBoardView NearbyMines = Game.GetNearbyMinesBoard();
+    for (int i = 0; i < Game.GetBoardSize(); i++)
+    {
+        if (NearbyMines[i] == '0')
+        {
+            EmptyCells.push_back(i);
+        }
+    }
+    if (EmptyCells.empty())
+    {
+        Game.EraseMemory();
+        return;
+    }
+
+    double Seconds = 0.0;
+    uint64_t Clicks = 0, Revealed = 0;
+    while (Seconds < MIN_MEASURE_SECONDS)       // A new board each round, so small areas do not need a Reset each
+    {
+        Game.EraseMemory();
+        Game.Reset(BENCHMARK_SEED);
+        FBoardView User = Game.GetUserBoard();
+        FClock::time_point Start = FClock::now();
+        for (int Index : EmptyCells)
+        {
+            if (User[Index] == '-')             // Not opened yet by the click on another cell of its area
+            {
+                Game.SetCellUserBoard(Index);
+                Revealed += Game.SetCellUserVisitedBoard(Index).size();
+                Clicks++;
+            }
+        }
+        Seconds += GetSeconds(Start, FClock::now());
+    }
+    Record(Name, Game, Clicks, Revealed, Seconds, "");
+    Game.EraseMemory();
+}
+
+/// SetGameStatus on every cell, in turn, of a board in the middle of a game
+void BenchmarkGameStatus(FMineSweeper& Game)
+{
+    Game.Reset(BENCHMARK_SEED);
+    int Size = Game.GetBoardSize();
+    int Index = 0;
+    double Seconds = 0.0;
+    uint64_t Operations = RepeatFor(Seconds, [&]()
+    {
+        Game.SetGameStatus(Index);
+        Index = (Index + 1 < Size) ? Index + 1 : 0;
+    });
+    Record("status.SetGameStatus", Game, Operations, Operations, Seconds, "");
+    Game.EraseMemory();
+}
+
+/// Flag every mine, show the cells with mines nearby (not timed), and chord on each of them: the first chord around an area opens it
+void BenchmarkChord(FMineSweeper& Game)
+{
+    std::vector<int> Mines, Numbers;
+    Game.Reset(BENCHMARK_SEED);
+    FBoardView NearbyMines = Game.GetNearbyMinesBoard();
+    for (int i = 0; i < Game.GetBoardSize(); i++)
+    {
+        if (NearbyMines[i] == 'X')
+        {
+            Mines.push_back(i);
+        }
+        else if (NearbyMines[i] > '0' && (int) Numbers.size() < MAX_SINGLE_REVEALS)
+        {
+            Numbers.push_back(i);
+        }
+    }
+    if (Numbers.empty())
+    {
+        Game.EraseMemory();
+        return;
+    }
+
+    double FlagSeconds = 0.0, ChordSeconds = 0.0;
+    uint64_t Rounds = 0, Revealed = 0;
+    bool bHitMine = false;
+    while (ChordSeconds < MIN_MEASURE_SECONDS)  // A new board each round, opened cells can not be opened again
+    {
+        Game.EraseMemory();
+        Game.Reset(BENCHMARK_SEED);
+        FClock::time_point Start = FClock::now();
+        for (int Index : Mines)
+        {
+            Game.SetCellFlag(Index, true);
+        }
+        FlagSeconds += GetSeconds(Start, FClock::now());
+        for (int Index : Numbers)
+        {
+            Game.SetCellUserBoard(Index);
+            Game.SetCellUserVisitedBoard(Index);
+        }
+        Start = FClock::now();
+        for (int Index : Numbers)
+        {
+            Revealed += Game.ChordCell(Index).size();
+        }
+        ChordSeconds += GetSeconds(Start, FClock::now());
+        Game.SetGameStatus(Numbers[0]);
+        bHitMine = bHitMine || Game.GetGameStatus() == EGameStatus::GameLost;
+        Rounds++;
+    }
+    Record("flag.set", Game, Rounds * Mines.size(), Rounds * Mines.size(), FlagSeconds, "");
+    Record("reveal.chord", Game, Rounds * Numbers.size(), Revealed, ChordSeconds, bHitMine ? "MINE DISPLAYED" : "no mine");
+    Game.EraseMemory();
+}
+
+/// Click on the cells without mine in order (up to MAX_SINGLE_REVEALS clicks) with a history, then undo every move and redo it, one by one,
+/// and jump from the end to the start and back
+void BenchmarkHistory(FMineSweeper& Game)
+{
+    FGameHistory History;
+    Game.SetHistory(&History);
+    Game.Reset(BENCHMARK_SEED);
+    FBoardView NearbyMines = Game.GetNearbyMinesBoard();
+    FBoardView User = Game.GetUserBoard();
+    for (int i = 0; i < Game.GetBoardSize() && History.GetNumMoves() < MAX_SINGLE_REVEALS; i++)
+    {
+        if (NearbyMines[i] != 'X' && User[i] == '-')
+        {
+            Game.SetCellUserBoard(i);
+            Game.SetCellUserVisitedBoard(i);
+            Game.SetGameStatus(i);
+        }
+    }
+    int NumMoves = History.GetNumMoves();
+    if (NumMoves == 0)
+    {
+        Game.SetHistory(nullptr);
+        Game.EraseMemory();
+        return;
+    }
+    uint64_t Hash = Game.GetStateHash();
+    uint64_t Flipped = 0;                       // Cells of every move
+    for (int Move = 1; Move <= NumMoves; Move++)
+    {
+        size_t NumCells = 0;
+        History.GetMoveCells(Move, NumCells);
+        Flipped += NumCells;
+    }
+
+    double UndoSeconds = 0.0, RedoSeconds = 0.0;
+    uint64_t Rounds = 0;
+    while (UndoSeconds < MIN_MEASURE_SECONDS)
+    {
+        FClock::time_point Start = FClock::now();
+        while (Game.UndoMove()) { }
+        UndoSeconds += GetSeconds(Start, FClock::now());
+        Start = FClock::now();
+        while (Game.RedoMove()) { }
+        RedoSeconds += GetSeconds(Start, FClock::now());
+        Rounds++;
+    }
+    std::string Check = Game.GetStateHash() == Hash ? "same state" : "DIFFERENT STATE";
+    Record("history.undo", Game, Rounds * NumMoves, Rounds * Flipped, UndoSeconds, Check);
+    Record("history.redo", Game, Rounds * NumMoves, Rounds * Flipped, RedoSeconds, Check);
+
+    double Seconds = 0.0;
+    uint64_t Operations = RepeatFor(Seconds, [&]()
+    {
+        Game.GoToMove(0);
+        Game.GoToMove(NumMoves);
+    });
+    Check = Game.GetStateHash() == Hash ? "same state" : "DIFFERENT STATE";
+    Record("history.jump", Game, Operations * 2, Operations * 2 * Flipped, Seconds,
+           Check + ", " + std::to_string(History.GetMemoryBytes() / 1024) + " KiB");
+    Game.SetHistory(nullptr);
+    Game.EraseMemory();
+}
+
+/// Save and load a game in the middle: the areas without mines nearby of the first half of the board opened, and some cells flagged
+void BenchmarkSnapshot(FMineSweeper& Game)
+{
+    Game.Reset(BENCHMARK_SEED);
+    FBoardView NearbyMines = Game.GetNearbyMinesBoard();
+    for (int i = 0; i < Game.GetBoardSize() / 2; i++)
+    {
+        if (NearbyMines[i] == '0')
+        {
+            Game.SetCellUserBoard(i);
+            Game.SetCellUserVisitedBoard(i);
+        }
+        else if (NearbyMines[i] == 'X' && i % 4 == 0)
+        {
+            Game.SetCellFlag(i, true);
+        }
+    }
+    uint64_t Size = Game.GetBoardSize();
+    uint64_t Hash = HashCells(Game);
+    std::vector<uint8_t> Snapshot;
+    double Seconds = 0.0;
+    uint64_t Operations = RepeatFor(Seconds, [&]()
+    {
+        Snapshot.clear();
+        SaveGameSnapshot(Game, Snapshot);
+    });
+    Record("snapshot.save", Game, Operations, Operations * Size, Seconds, std::to_string(Snapshot.size()) + " bytes");
+
+    FMineSweeper Loaded;
+    Operations = RepeatFor(Seconds, [&]() { LoadGameSnapshot(Loaded, Snapshot.data(), Snapshot.size()); });
+    Record("snapshot.load", Loaded, Operations, Operations * Size, Seconds, HashCells(Loaded) == Hash ? "same cells" : "DIFFERENT CELLS");
+    Game.EraseMemory();
+}
+
+/// Nearby mines pass with the cell by cell reference and with each kernel supported by the CPU
+void BenchmarkNearbyMines(int Width, int Height)
+{
+    FMineSweeper Game(Width, Height, (int) (KERNEL_DENSITY * Width * Height));
+    uint64_t Size = Game.GetBoardSize();
+    double Seconds = 0.0;
+    Game.Reset(BENCHMARK_SEED);
+
+    uint64_t Operations = RepeatFor(Seconds, [&]() { FBenchmarkAccess::SetNearbyMinesBoardInitPerCell(Game); });
+    uint64_t ReferenceHash = HashCells(Game);
+    Record("nearby_mines.per_cell", Game, Operations, Operations * Size, Seconds, "");
+
+    const ESimdLevel Levels[] = { ESimdLevel::Scalar, ESimdLevel::SSE2, ESimdLevel::AVX2 };
+    for (ESimdLevel Level : Levels)
+    {
+        if (!Game.SetSimdLevel(Level))
+        {
+            continue;
+        }
+        Operations = RepeatFor(Seconds, [&]() { FBenchmarkAccess::SetNearbyMinesBoardInit(Game); });
+        Record(std::string("nearby_mines.") + GetSimdLevelName(Level), Game, Operations, Operations * Size, Seconds,
+               HashCells(Game) == ReferenceHash ? "same cells" : "DIFFERENT CELLS");
+    }
+    Game.EraseMemory();
+}
+
+/// Mine placement with one thread and with every core. The cells of the measure are the mines placed.
+void BenchmarkMinePlacement(int Width, int Height)
+{
+    FMineSweeper Game(Width, Height, (int) (KERNEL_DENSITY * Width * Height));
+    int Size = Game.GetBoardSize();
+    int NumMines = Game.GetNumMines();
+    int NumCores = (int) std::thread::hardware_concurrency();
+    NumCores = NumCores < 1 ? 1 : NumCores;
+    std::vector<uint8_t> OneThread(Size), AllThreads(Size);
+    double Seconds = 0.0;
+
+    uint64_t Operations = RepeatFor(Seconds, [&]()
+    {
+        memset(OneThread.data(), 0, Size);
+        PlaceMines(OneThread.data(), Size, NumMines, BENCHMARK_SEED, 1);
+    });
+    Record("place_mines.one_thread", Game, Operations, Operations * NumMines, Seconds, "");
+
+    Operations = RepeatFor(Seconds, [&]()
+    {
+        memset(AllThreads.data(), 0, Size);
+        PlaceMines(AllThreads.data(), Size, NumMines, BENCHMARK_SEED, NumCores);
+    });
+    Record("place_mines.all_cores", Game, Operations, Operations * NumMines, Seconds,
+           OneThread == AllThreads ? "same board" : "DIFFERENT BOARD");
+}
+
+/// Nearby mines and the flood fill of a board without mines on strips, with a growing number of threads up to the number of cores
+void BenchmarkStrips(int Width, int Height)
+{
+    if ((int64_t) Width * Height < STRIPS_MIN_CELLS)
+    {
+        return;
+    }
+    int NumCores = (int) std::thread::hardware_concurrency();
+    NumCores = NumCores < 1 ? 1 : NumCores;
+    std::vector<int> ThreadCounts;
+    for (int Threads = 1; Threads < NumCores; Threads *= 2)
+    {
+        ThreadCounts.push_back(Threads);
+    }
+    ThreadCounts.push_back(NumCores);
+
+    FMineSweeper Game(Width, Height, (int) (KERNEL_DENSITY * Width * Height));
+    FMineSweeper EmptyBoard(Width, Height, 0);
+    int Centre = Height / 2 * Width + Width / 2;
+    uint64_t CountHash = 0, RevealHash = 0;
+    for (int Threads : ThreadCounts)
+    {
+        std::string Suffix = "strips_" + std::to_string(Threads);
+        double Seconds = 0.0;
+        Game.Reset(BENCHMARK_SEED);
+        Game.SetGenerationThreads(Threads);
+        uint64_t Operations = RepeatFor(Seconds, [&]() { FBenchmarkAccess::SetNearbyMinesBoardInit(Game); });
+        CountHash = (Threads == 1) ? HashCells(Game) : CountHash;
+        Record("nearby_mines." + Suffix, Game, Operations, Operations * Game.GetBoardSize(), Seconds,
+               HashCells(Game) == CountHash ? "same cells" : "DIFFERENT CELLS");
+
+        EmptyBoard.SetRevealThreads(Threads);
+        uint64_t Revealed = 0;
+        Operations = 0;
+        Seconds = 0.0;
+        while (Seconds < MIN_MEASURE_SECONDS)   // Each round needs a new board, so it is not timed with RepeatFor
+        {
+            EmptyBoard.Reset(BENCHMARK_SEED);
+            FClock::time_point Start = FClock::now();
+            Revealed += EmptyBoard.SetCellUserVisitedBoard(Centre).size();
+            Seconds += GetSeconds(Start, FClock::now());
+            Operations++;
+        }
+        RevealHash = (Threads == 1) ? HashCells(EmptyBoard) : RevealHash;
+        Record("reveal." + Suffix, EmptyBoard, Operations, Revealed, Seconds,
+               HashCells(EmptyBoard) == RevealHash ? "same cells" : "DIFFERENT CELLS");
+    }
+    Game.EraseMemory();
+    EmptyBoard.EraseMemory();
+}
+
+/// Run Body in batches of growing size until MIN_MEASURE_SECONDS have passed. Returns the number of runs, and their time on Seconds.
+template <typename FBody>
+uint64_t RepeatFor(double& Seconds, FBody Body)
+{
+    uint64_t Runs = 0, Batch = 1;
+    Seconds = 0.0;
+    while (Seconds < MIN_MEASURE_SECONDS)
+    {
+        FClock::time_point Start = FClock::now();
+        for (uint64_t i = 0; i < Batch; i++)
+        {
+            Body();
+        }
+        Seconds += GetSeconds(Start, FClock::now());
+        Runs += Batch;
+        Batch *= 2;
+    }
+    return Runs;
+}
+
+/// Generate no guess boards of a difficulty on every core, with and without repairs. The time per operation is the time to the first valid board.
+void BenchmarkNoGuess(int Difficulty)
+{
+    FMineSweeper Game;
+    Game.SetGameParams(Difficulty);
+    int FirstClick = Game.GetBoardWidth() / 2 + Game.GetBoardHeight() / 2 * Game.GetBoardWidth();
+    for (bool bRepair : { true, false })
+    {
+        FNoGuessOptions Options;
+        Options.bRepair = bRepair;
+        Options.TimeLimit = NOGUESS_BENCHMARK_SECONDS;
+        uint64_t Found = 0, Candidates = 0;
+        double Seconds = 0.0;
+        for (int i = 0; i < NOGUESS_BENCHMARK_BOARDS; i++)
+        {
+            FNoGuessStats Stats;
+            Options.Seed = BENCHMARK_SEED + i;
+            Found += GenerateNoGuessBoard(Game, FirstClick, Options, Stats) ? 1 : 0;
+            Candidates += Stats.Candidates;
+            Seconds += Stats.Seconds;
+        }
+        std::string Check = std::to_string((uint64_t) (Candidates / Seconds)) + " candidates/s, " + std::to_string(Found) + " of "
+                          + std::to_string(NOGUESS_BENCHMARK_BOARDS) + " found";
+        Record(bRepair ? "no_guess.repair" : "no_guess.no_repair", Game, NOGUESS_BENCHMARK_BOARDS, Candidates * Game.GetBoardSize(), Seconds, Check);
+    }
+}
+
+/// Play whole games of a difficulty, clicking the hidden cells in order until each game ends, with the kernels of its size and
+/// with the generic code. Both play the same boards, so they must end on the same cells. The runs of both alternate, so a slow moment
+/// of the machine hits both, and the median run of each is recorded with the range of its runs. On first click safe games the kernels
+/// count the whole board on the first click, where the generic code counts each row when it is first displayed.
+void BenchmarkFixedBoards(int Difficulty, bool bSafe)
+{
+    FMineSweeper Game;
+    Game.SetGameParams(Difficulty);
+    Game.SetFirstClickSafe(bSafe);
+    const FFixedBoardKernels* Kernels = FBenchmarkAccess::GetFixedKernels(Game);
+    uint64_t Hashes[2] = { 0, 0 };
+    uint64_t Moves = 0;
+    std::vector<double> Runs[2];
+    for (int Run = 0; Run < FIXED_BENCHMARK_RUNS; Run++)
+    {
+        for (int Pass = 0; Pass < 2; Pass++)
+        {
+            FBenchmarkAccess::SetFixedKernels(Game, Pass == 0 ? Kernels : nullptr);
+            Hashes[Pass] = 0;
+            Moves = 0;
+            FClock::time_point Start = FClock::now();
+            for (int g = 0; g < FIXED_BENCHMARK_GAMES; g++)
+            {
+                Game.Reset(BENCHMARK_SEED + g);
+                FBoardView User = Game.GetUserBoard();
+                for (int i = 0; i < Game.GetBoardSize() && Game.GetGameStatus() == EGameStatus::KeepPlaying; i++)
+                {
+                    if (User[i] == '-')
+                    {
+                        Game.SetCellUserBoard(i);
+                        Game.SetCellUserVisitedBoard(i);
+                        Game.SetGameStatus(i);
+                        Moves++;
+                    }
+                }
+                Hashes[Pass] ^= HashCells(Game) + g;
+            }
+            Runs[Pass].push_back(GetSeconds(Start, FClock::now()));
+        }
+    }
+    for (int Pass = 0; Pass < 2; Pass++)
+    {
+        std::sort(Runs[Pass].begin(), Runs[Pass].end());
+        std::string Check = "median of " + std::to_string(FIXED_BENCHMARK_RUNS) + " runs, "
+                          + std::to_string((int) (Runs[Pass].front() * 1e9 / Moves)) + " to "
+                          + std::to_string((int) (Runs[Pass].back() * 1e9 / Moves)) + " ns/op";
+        Check += Pass == 0 ? (Kernels != nullptr ? "" : ", no kernels for this size") : (Hashes[0] == Hashes[1] ? ", same boards" : ", DIFFERENT BOARDS");
+        std::string Name = std::string(bSafe ? "move_safe" : "move") + (Pass == 0 ? ".fixed_size" : ".generic");
+        Record(Name, Game, Moves, Moves, Runs[Pass][FIXED_BENCHMARK_RUNS / 2], Check);
+    }
+    Game.EraseMemory();
+}
+
+/// Play games of a board size with the solver, guessing the safest cell each time it knows no safe one, and measure the mine
+/// probabilities of those positions, the ones a live overlay or a bot needs. The cells per operation are the cells of the board.
+void BenchmarkProbability(int Width, int Height, int Mines)
+{
+    FMineSweeper Game(Width, Height, Mines);
+    Game.SetFirstClickSafe(true);
+    FMineSolver Solver;
+    FMineProbability Probability;
+    uint64_t Positions = 0, Estimated = 0;
+    double Seconds = 0.0, Slowest = 0.0;
+    for (int g = 0; g < PROBABILITY_BENCHMARK_GAMES; g++)
+    {
+        Game.Reset(BENCHMARK_SEED + g);
+        Solver.StartGame(Game);
+        int Cell = Game.GetBoardWidth() / 2 + Game.GetBoardHeight() / 2 * Game.GetBoardWidth();
+        while (Cell >= 0)
+        {
+            Game.SetCellUserBoard(Cell);
+            const std::vector<int>& Revealed = Game.SetCellUserVisitedBoard(Cell);
+            Game.SetGameStatus(Cell);
+            if (Game.GetGameStatus() != EGameStatus::KeepPlaying)
+            {
+                break;
+            }
+            Solver.Update(Game, Revealed);
+            Cell = Solver.GetHint();
+            if (Cell < 0)
+            {
+                FClock::time_point Start = FClock::now();
+                Probability.Compute(Game);
+                double Elapsed = GetSeconds(Start, FClock::now());
+                Seconds += Elapsed;
+                Slowest = std::max(Slowest, Elapsed);
+                Positions++;
+                Estimated += Probability.IsExact() ? 0 : 1;
+                Cell = Probability.GetSafestCell();
+            }
+        }
+    }
+    std::string Check = "slowest " + std::to_string(Slowest * 1000.0) + " ms, " + std::to_string(Estimated) + " estimated";
+    Record("probability", Game, Positions, Positions * Game.GetBoardSize(), Seconds, Check);
+    Game.EraseMemory();
+}
+
+/// Play expert games with the solver and sample the mine probabilities of every position where no safe cell is known, for a fixed
+/// time, against the exact ones. The cells per operation are the cells of the board.
+void BenchmarkSampler()
+{
+    FMineSweeper Game(30, 16, 99);
+    Game.SetFirstClickSafe(true);
+    FMineSolver Solver;
+    FMineProbability Probability;
+    FMineSampler Sampler;
+    uint64_t Positions = 0, Converged = 0, Cells = 0;
+    double Seconds = 0.0, Error = 0.0;
+    for (int g = 0; g < SAMPLER_BENCHMARK_GAMES; g++)
+    {
+        Game.Reset(BENCHMARK_SEED + g);
+        Solver.StartGame(Game);
+        int Cell = Game.GetBoardWidth() / 2 + Game.GetBoardHeight() / 2 * Game.GetBoardWidth();
+        while (Cell >= 0)
+        {
+            Game.SetCellUserBoard(Cell);
+            const std::vector<int>& Revealed = Game.SetCellUserVisitedBoard(Cell);
+            Game.SetGameStatus(Cell);
+            if (Game.GetGameStatus() != EGameStatus::KeepPlaying)
+            {
+                break;
+            }
+            Solver.Update(Game, Revealed);
+            Cell = Solver.GetHint();
+            if (Cell < 0)
+            {
+                Probability.Compute(Game);
+                FClock::time_point Start = FClock::now();
+                Sampler.Start(Game, BENCHMARK_SEED + Positions);
+                Sampler.Run(SAMPLER_BENCHMARK_MILLISECONDS);
+                Seconds += GetSeconds(Start, FClock::now());
+                Positions++;
+                Converged += Sampler.IsConverged() ? 1 : 0;
+                FBoardView Board = Game.GetUserBoard();
+                for (int i = 0; i < Game.GetBoardSize(); i++)
+                {
+                    if (Board[i] == '-' || Board[i] == 'F')
+                    {
+                        Error += std::abs(Sampler.GetProbability(i) - Probability.GetProbability(i));
+                        Cells++;
+                    }
+                }
+                Cell = Probability.GetSafestCell();
+            }
+        }
+    }
+    std::string Check = "mean error " + std::to_string(Cells > 0 ? Error / Cells : 0.0) + ", " + std::to_string(Converged) + " of "
+                      + std::to_string(Positions) + " converged";
+    Record("sampler", Game, Positions, Positions * Game.GetBoardSize(), Seconds, Check);
+    Game.EraseMemory();
+}
+
+/// Reveal random cells of infinite boards until each game is lost. The cells per operation are the cells displayed.
+void BenchmarkInfinite(double Density)
+{
+    FInfiniteBoard Board;
+    int Mines = (int) (Density * INFINITE_TILE_CELLS);
+    Board.SetGameParams(Mines);
+    FCounterRng Rng(BENCHMARK_SEED, 0);
+    uint64_t Reveals = 0, Shown = 0, Bytes = 0, CountedTiles = 0;
+    double Seconds = 0.0;
+    while (Seconds < MIN_MEASURE_SECONDS)
+    {
+        Board.Reset(BENCHMARK_SEED + Reveals);
+        FClock::time_point Start = FClock::now();
+        while (Board.GetGameStatus() == EGameStatus::KeepPlaying)
+        {
+            int X = (int) Rng.NextBelow(2 * INFINITE_BENCHMARK_SPREAD) - INFINITE_BENCHMARK_SPREAD;
+            int Y = (int) Rng.NextBelow(2 * INFINITE_BENCHMARK_SPREAD) - INFINITE_BENCHMARK_SPREAD;
+            Shown += Board.Reveal(X, Y).size();
+            Reveals++;
+        }
+        Seconds += GetSeconds(Start, FClock::now());
+        Bytes += Board.GetStats().Bytes;
+        CountedTiles += Board.GetStats().CountedTiles;
+    }
+    FMineSweeper Tile(INFINITE_TILE_SIDE, INFINITE_TILE_SIDE, Mines);     // Only names the measure
+    Record("infinite.reveal_far", Tile, Reveals, Shown, Seconds, std::to_string(Bytes / (CountedTiles > 0 ? CountedTiles : 1)) + " bytes per explored tile");
+}
+
+/// FNV-1a hash of every cell, to check that two passes give the same board
+uint64_t HashCells(const FMineSweeper& Game)
+{
+    const uint8_t* Cells = FBenchmarkAccess::GetCells(Game);
+    uint64_t Hash = 14695981039346656037ULL;
+    for (int i = 0; i < Game.GetBoardSize(); i++)
+    {
+        Hash = (Hash ^ Cells[i]) * 1099511628211ULL;
+    }
+    return Hash;
+}
+
+double GetSeconds(FClock::time_point Start, FClock::time_point End)
+{
+    return std::chrono::duration<double>(End - Start).count();
+}
+
+/// Store a measure and print it
+void Record(const std::string& Name, const FMineSweeper& Game, uint64_t Operations, uint64_t Cells, double Seconds, const std::string& Check)
+{
+    FBenchmarkResult Result;
+    Result.Name = Name;
+    Result.Width = Game.GetBoardWidth();
+    Result.Height = Game.GetBoardHeight();
+    Result.Mines = Game.GetNumMines();
+    Result.Operations = Operations;
+    Result.Cells = Cells;
+    Result.Seconds = Seconds;
+    Result.Check = Check;
+    Results.push_back(Result);
+
+    *Log << Name << " " << Result.Width << "x" << Result.Height << " (" << Result.Mines << " mines): "
+    << Seconds * 1e9 / Operations << " ns/op, " << Seconds * 1e9 / (Cells ? Cells : 1) << " ns/cell";
+    if (!Check.empty())
+    {
+        *Log << ", " << Check;
+    }
+    *Log << "\n";
+}
+
+/// Write every measure as JSON, to a file or to the standard output if the path is -
+bool WriteJson(const std::string& Path)
+{
+    std::ofstream File;
+    if (Path != "-")
+    {
+        File.open(Path);
+        if (!File)
+        {
+            return false;
+        }
+    }
+    std::ostream& Out = (Path == "-") ? std::cout : File;
+
+    Out << "{\n  \"seed\": " << BENCHMARK_SEED << ",\n  \"simd\": \"" << GetSimdLevelName(GetBestSimdLevel()) << "\",\n"
+    << "  \"cores\": " << std::thread::hardware_concurrency() << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < Results.size(); i++)
+    {
+        const FBenchmarkResult& Result = Results[i];
+        Out << "    {\"name\": \"" << Result.Name << "\", \"width\": " << Result.Width << ", \"height\": " << Result.Height
+        << ", \"mines\": " << Result.Mines << ", \"operations\": " << Result.Operations << ", \"cells\": " << Result.Cells
+        << ", \"seconds\": " << Result.Seconds << ", \"ns_per_op\": " << Result.Seconds * 1e9 / Result.Operations
+        << ", \"ns_per_cell\": " << Result.Seconds * 1e9 / (Result.Cells ? Result.Cells : 1);
+        if (!Result.Check.empty())
+        {
+            Out << ", \"check\": \"" << Result.Check << "\"";
+        }
+        Out << "}" << (i + 1 < Results.size() ? "," : "") << "\n";
+    }
+    Out << "  ]\n}\n";
+    return (bool) Out;
+}
@@ -0,0 +1,288 @@
+/* Low level loops that work on whole rows of packed cells, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "BoardKernels.h"
+#include "Minesweeper.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BOARD_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(BOARD_KERNELS_X86) && defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))     // Functions can use instructions the rest of the program is not compiled for
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+#define MINE_MASK CELL_MINE                                 // Only the mine bit is added
+#define LOW_BITS_MASK ((1 << CELL_COUNT_SHIFT) - 1)         // Bits of the cell that are not the number of nearby mines
+#define BYTE_LOW_BITS 0x0101010101010101ULL                 // Bit 0 of each byte of a 64 bit word
+#define GATHER_BITS 0x0102040810204080ULL                   // Multiplying BYTE_LOW_BITS values by this gathers their 8 bits on the top byte
+#define MINE_BIT 0                                          // Position of CELL_MINE, CELL_SHOWN and CELL_FLAG
+#define SHOWN_BIT 1
+#define FLAG_BIT 3
+
+/// Detect the best instruction set supported by the CPU
+static ESimdLevel DetectSimdLevel()
+{
+#if defined(BOARD_KERNELS_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return ESimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return ESimdLevel::SSE2;
+    }
+#elif defined(BOARD_KERNELS_X86) && defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 0);
+    int MaxLeaf = Info[0];
+    __cpuid(Info, 1);
+    bool bSSE2 = (Info[3] & (1 << 26)) != 0;
+    bool bOSXSave = (Info[2] & (1 << 27)) != 0;     // The OS saves the AVX registers
+    if (MaxLeaf >= 7 && bOSXSave && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(Info, 7, 0);
+        if (Info[1] & (1 << 5))
+        {
+            return ESimdLevel::AVX2;
+        }
+    }
+    if (bSSE2)
+    {
+        return ESimdLevel::SSE2;
+    }
+#endif
+    return ESimdLevel::Scalar;
+}
+
+ESimdLevel GetBestSimdLevel()
+{
+    static const ESimdLevel BestLevel = DetectSimdLevel();     // Thread safe initialization, done on the first call
+    return BestLevel;
+}
+
+bool IsSimdLevelSupported(ESimdLevel Level)
+{
+    return (int) Level <= (int) GetBestSimdLevel();
+}
+
+const char* GetSimdLevelName(ESimdLevel Level)
+{
+    switch (Level)
+    {
+        case ESimdLevel::SSE2:
+            return "SSE2";
+        case ESimdLevel::AVX2:
+            return "AVX2";
+        default:
+            return "Scalar";
+    }
+}
+
+/// Scalar version, also used for the last cells of the row that do not fill a vector. Starts at column First.
+static void CountNearbyMinesRowScalar(const uint8_t* Up, uint8_t* Mid, const uint8_t* Down, uint8_t* ColumnSums, int First, int Width)
+{
+    for (int x = First; x < Width; x++)             // Column sums, shifted one position because of the ghost cell
+    {
+        ColumnSums[x + 1] = (Up[x] & MINE_MASK) + (Mid[x] & MINE_MASK) + (Down[x] & MINE_MASK);
+    }
+    for (int x = First; x < Width; x++)             // Box sums, without the mine of the cell itself
+    {
+        int Count = ColumnSums[x] + ColumnSums[x + 1] + ColumnSums[x + 2] - (Mid[x] & MINE_MASK);
+        Mid[x] = (uint8_t) ((Mid[x] & LOW_BITS_MASK) | (Count << CELL_COUNT_SHIFT));
+    }
+}
+
+#if defined(BOARD_KERNELS_X86)
+/// SSE2 version, 16 cells per instruction
+TARGET_SSE2 static void CountNearbyMinesRowSSE2(const uint8_t* Up, uint8_t* Mid, const uint8_t* Down, uint8_t* ColumnSums, int Width)
+{
+    const __m128i Mine = _mm_set1_epi8(MINE_MASK);
+    const __m128i LowBits = _mm_set1_epi8(LOW_BITS_MASK);
+    const __m128i HighBits = _mm_set1_epi8((char) ~LOW_BITS_MASK);
+    int VectorEnd = Width - Width % 16;
+    int x = 0;
+
+    for (x = 0; x < VectorEnd; x += 16)
+    {
+        __m128i U = _mm_and_si128(_mm_loadu_si128((const __m128i*) (Up + x)), Mine);
+        __m128i M = _mm_and_si128(_mm_loadu_si128((const __m128i*) (Mid + x)), Mine);
+        __m128i D = _mm_and_si128(_mm_loadu_si128((const __m128i*) (Down + x)), Mine);
+        _mm_storeu_si128((__m128i*) (ColumnSums + x + 1), _mm_add_epi8(_mm_add_epi8(U, M), D));
+    }
+    CountNearbyMinesRowScalar(Up, Mid, Down, ColumnSums, VectorEnd, Width);    // Column sums of the tail are needed by the last vector
+
+    for (x = 0; x < VectorEnd; x += 16)
+    {
+        __m128i Left = _mm_loadu_si128((const __m128i*) (ColumnSums + x));
+        __m128i Centre = _mm_loadu_si128((const __m128i*) (ColumnSums + x + 1));
+        __m128i Right = _mm_loadu_si128((const __m128i*) (ColumnSums + x + 2));
+        __m128i Cell = _mm_loadu_si128((const __m128i*) (Mid + x));
+        __m128i Count = _mm_sub_epi8(_mm_add_epi8(_mm_add_epi8(Left, Centre), Right), _mm_and_si128(Cell, Mine));
+        Count = _mm_and_si128(_mm_slli_epi16(Count, CELL_COUNT_SHIFT), HighBits);  // No 8 bit shifts, so shift 16 bits and drop what crossed bytes
+        _mm_storeu_si128((__m128i*) (Mid + x), _mm_or_si128(_mm_and_si128(Cell, LowBits), Count));
+    }
+}
+
+/// AVX2 version, 32 cells per instruction
+TARGET_AVX2 static void CountNearbyMinesRowAVX2(const uint8_t* Up, uint8_t* Mid, const uint8_t* Down, uint8_t* ColumnSums, int Width)
+{
+    const __m256i Mine = _mm256_set1_epi8(MINE_MASK);
+    const __m256i LowBits = _mm256_set1_epi8(LOW_BITS_MASK);
+    const __m256i HighBits = _mm256_set1_epi8((char) ~LOW_BITS_MASK);
+    int VectorEnd = Width - Width % 32;
+    int x = 0;
+
+    for (x = 0; x < VectorEnd; x += 32)
+    {
+        __m256i U = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (Up + x)), Mine);
+        __m256i M = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (Mid + x)), Mine);
+        __m256i D = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (Down + x)), Mine);
+        _mm256_storeu_si256((__m256i*) (ColumnSums + x + 1), _mm256_add_epi8(_mm256_add_epi8(U, M), D));
+    }
+    CountNearbyMinesRowScalar(Up, Mid, Down, ColumnSums, VectorEnd, Width);
+
+    for (x = 0; x < VectorEnd; x += 32)
+    {
+        __m256i Left = _mm256_loadu_si256((const __m256i*) (ColumnSums + x));
+        __m256i Centre = _mm256_loadu_si256((const __m256i*) (ColumnSums + x + 1));
+        __m256i Right = _mm256_loadu_si256((const __m256i*) (ColumnSums + x + 2));
+        __m256i Cell = _mm256_loadu_si256((const __m256i*) (Mid + x));
+        __m256i Count = _mm256_sub_epi8(_mm256_add_epi8(_mm256_add_epi8(Left, Centre), Right), _mm256_and_si256(Cell, Mine));
+        Count = _mm256_and_si256(_mm256_slli_epi16(Count, CELL_COUNT_SHIFT), HighBits);
+        _mm256_storeu_si256((__m256i*) (Mid + x), _mm256_or_si256(_mm256_and_si256(Cell, LowBits), Count));
+    }
+}
+#endif
+
+void CountNearbyMinesRow(ESimdLevel Level, const uint8_t* Up, uint8_t* Mid, const uint8_t* Down, uint8_t* ColumnSums, int Width)
+{
+#if defined(BOARD_KERNELS_X86)
+    switch (Level)
+    {
+        case ESimdLevel::AVX2:
+            CountNearbyMinesRowAVX2(Up, Mid, Down, ColumnSums, Width);
+            return;
+        case ESimdLevel::SSE2:
+            CountNearbyMinesRowSSE2(Up, Mid, Down, ColumnSums, Width);
+            return;
+        default:
+            break;
+    }
+#endif
+    CountNearbyMinesRowScalar(Up, Mid, Down, ColumnSums, 0, Width);
+}
+
+/// Scalar version, 8 cells per 64 bit word, also used for the last cells that do not fill a vector. Starts at cell First, a multiple of 8.
+static void PackCellPlanesScalar(const uint8_t* Cells, size_t First, size_t Count, uint8_t* Mines, uint8_t* Shown, uint8_t* Flags)
+{
+    size_t i = First;
+    for (; i + 8 <= Count; i += 8)
+    {
+        uint64_t Word;
+        memcpy(&Word, Cells + i, 8);
+        if (Mines != nullptr)
+        {
+            Mines[i / 8] = (uint8_t) ((((Word >> MINE_BIT) & BYTE_LOW_BITS) * GATHER_BITS) >> 56);
+        }
+        if (Shown != nullptr)
+        {
+            Shown[i / 8] = (uint8_t) ((((Word >> SHOWN_BIT) & BYTE_LOW_BITS) * GATHER_BITS) >> 56);
+        }
+        Flags[i / 8] = (uint8_t) ((((Word >> FLAG_BIT) & BYTE_LOW_BITS) * GATHER_BITS) >> 56);
+    }
+    for (; i < Count; i++)
+    {
+        uint8_t Bit = (uint8_t) (1 << (i % 8));
+        if (Mines != nullptr && (Cells[i] & CELL_MINE))
+        {
+            Mines[i / 8] |= Bit;
+        }
+        if (Shown != nullptr && (Cells[i] & CELL_SHOWN))
+        {
+            Shown[i / 8] |= Bit;
+        }
+        if (Cells[i] & CELL_FLAG)
+        {
+            Flags[i / 8] |= Bit;
+        }
+    }
+}
+
+#if defined(BOARD_KERNELS_X86)
+/// SSE2 version, 16 cells per instruction: each bit is shifted to the top of its byte and gathered with movemask
+TARGET_SSE2 static void PackCellPlanesSSE2(const uint8_t* Cells, size_t Count, uint8_t* Mines, uint8_t* Shown, uint8_t* Flags)
+{
+    size_t VectorEnd = Count - Count % 16;
+    for (size_t i = 0; i < VectorEnd; i += 16)
+    {
+        __m128i Cell = _mm_loadu_si128((const __m128i*) (Cells + i));    // 64 bit shifts: bits that cross bytes are never read
+        if (Mines != nullptr)
+        {
+            uint16_t Bits = (uint16_t) _mm_movemask_epi8(_mm_slli_epi64(Cell, 7 - MINE_BIT));
+            memcpy(Mines + i / 8, &Bits, sizeof(Bits));
+        }
+        if (Shown != nullptr)
+        {
+            uint16_t Bits = (uint16_t) _mm_movemask_epi8(_mm_slli_epi64(Cell, 7 - SHOWN_BIT));
+            memcpy(Shown + i / 8, &Bits, sizeof(Bits));
+        }
+        uint16_t Bits = (uint16_t) _mm_movemask_epi8(_mm_slli_epi64(Cell, 7 - FLAG_BIT));
+        memcpy(Flags + i / 8, &Bits, sizeof(Bits));
+    }
+    PackCellPlanesScalar(Cells, VectorEnd, Count, Mines, Shown, Flags);
+}
+
+/// AVX2 version, 32 cells per instruction
+TARGET_AVX2 static void PackCellPlanesAVX2(const uint8_t* Cells, size_t Count, uint8_t* Mines, uint8_t* Shown, uint8_t* Flags)
+{
+    size_t VectorEnd = Count - Count % 32;
+    for (size_t i = 0; i < VectorEnd; i += 32)
+    {
+        __m256i Cell = _mm256_loadu_si256((const __m256i*) (Cells + i));
+        if (Mines != nullptr)
+        {
+            uint32_t Bits = (uint32_t) _mm256_movemask_epi8(_mm256_slli_epi64(Cell, 7 - MINE_BIT));
+            memcpy(Mines + i / 8, &Bits, sizeof(Bits));
+        }
+        if (Shown != nullptr)
+        {
+            uint32_t Bits = (uint32_t) _mm256_movemask_epi8(_mm256_slli_epi64(Cell, 7 - SHOWN_BIT));
+            memcpy(Shown + i / 8, &Bits, sizeof(Bits));
+        }
+        uint32_t Bits = (uint32_t) _mm256_movemask_epi8(_mm256_slli_epi64(Cell, 7 - FLAG_BIT));
+        memcpy(Flags + i / 8, &Bits, sizeof(Bits));
+    }
+    PackCellPlanesScalar(Cells, VectorEnd, Count, Mines, Shown, Flags);
+}
+#endif
+
+void PackCellPlanes(ESimdLevel Level, const uint8_t* Cells, size_t Count, uint8_t* Mines, uint8_t* Shown, uint8_t* Flags)
+{
+#if defined(BOARD_KERNELS_X86)
+    switch (Level)
+    {
+        case ESimdLevel::AVX2:
+            PackCellPlanesAVX2(Cells, Count, Mines, Shown, Flags);
+            return;
+        case ESimdLevel::SSE2:
+            PackCellPlanesSSE2(Cells, Count, Mines, Shown, Flags);
+            return;
+        default:
+            break;
+    }
+#endif
+    PackCellPlanesScalar(Cells, 0, Count, Mines, Shown, Flags);
+}
@@ -0,0 +1,42 @@
+/* Low level loops that work on whole rows of packed cells.
+
+The number of nearby mines of a row is a 3x3 box sum of the mine bits, computed in two passes:
+1. Column sums: mines of the row above, the row itself and the row below for each column.
+2. Row sums: the column sums of the left, own and right columns, minus the cell's own mine.
+The column sums are stored with one ghost cell at each side and the rows outside the board are read from a row of zeros,
+so no cell needs a special case for corners or borders and the loops can be vectorized.
+The bit planes of a snapshot (GameSnapshot.h) are packed by taking one bit of each cell, 8 cells per byte.
+
+Each kernel has a scalar, SSE2 and AVX2 version. The best one supported by the CPU is selected at runtime.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/// Instruction set used by the kernels
+enum class ESimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+/// Best instruction set supported by this CPU. It is detected only once.
+ESimdLevel GetBestSimdLevel();
+
+/// Whether the given instruction set can be used on this CPU
+bool IsSimdLevelSupported(ESimdLevel);
+
+/// Name of the instruction set, to be displayed
+const char* GetSimdLevelName(ESimdLevel);
+
+/// Store the number of nearby mines of every cell of the row Mid. Up and Down are the rows above and below (a row of zeros outside the board).
+/// ColumnSums is a scratch buffer of Width + 2 bytes whose first and last bytes (the ghost cells) must be 0.
+void CountNearbyMinesRow(ESimdLevel, const uint8_t* Up, uint8_t* Mid, const uint8_t* Down, uint8_t* ColumnSums, int Width);
+
+/// Pack the mine, displayed and flag bits of Count cells into one bit per cell on each plane (bit i % 8 of byte i / 8).
+/// The planes must be 0. Mines and Shown may be nullptr to skip them.
+void PackCellPlanes(ESimdLevel, const uint8_t* Cells, size_t Count, uint8_t* Mines, uint8_t* Shown, uint8_t* Flags);
@@ -0,0 +1,125 @@
+/* Background generation of boards, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "BoardPipeline.h"
+#include "MineGenerator.h"
+#include <chrono>
+
+FBoardPipeline::FBoardPipeline(int InNumThreads, int InDepth)
+    : NumThreads(InNumThreads > 0 ? InNumThreads : 1), Depth(InDepth > 0 ? InDepth : PIPELINE_DEFAULT_DEPTH) { }
+
+FBoardPipeline::~FBoardPipeline()
+{
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        bStopping = true;
+    }
+    BoardTaken.notify_all();
+    for (std::thread& Producer : Producers)
+    {
+        Producer.join();
+    }
+}
+
+/// Getters
+std::vector<FBoardPipelineStats> FBoardPipeline::GetStats() const
+{
+    std::vector<FBoardPipelineStats> Stats;
+    for (const std::unique_ptr<FBoardQueue>& Queue : Queues)
+    {
+        FBoardPipelineStats Size;
+        Size.Width = Queue->Width;
+        Size.Height = Queue->Height;
+        Size.Mines = Queue->Mines;
+        Size.Hits = Queue->Hits.load(std::memory_order_relaxed);
+        Size.Misses = Queue->Misses.load(std::memory_order_relaxed);
+        Size.Generated = Queue->Generated.load(std::memory_order_relaxed);
+        Size.Depth = Queue->Boards.GetSize();
+        Stats.push_back(Size);
+    }
+    return Stats;
+}
+
+/// Rest of functions
+bool FBoardPipeline::AddBoardSize(int Width, int Height, int Mines)
+{
+    if (!Producers.empty() || !FMineSweeper().SetGameParams(Width, Height, Mines))
+    {
+        return false;
+    }
+    for (const std::unique_ptr<FBoardQueue>& Queue : Queues)
+    {
+        if (Queue->Width == Width && Queue->Height == Height && Queue->Mines == Mines)
+        {
+            return true;
+        }
+    }
+    Queues.push_back(std::unique_ptr<FBoardQueue>(new FBoardQueue(Width, Height, Mines, Depth)));
+    return true;
+}
+
+void FBoardPipeline::Start()
+{
+    for (int i = 0; i < NumThreads && Producers.empty() && !Queues.empty(); i++)
+    {
+        Producers.emplace_back(&FBoardPipeline::ProducerLoop, this, i);
+    }
+}
+
+/// Called by the games on every Reset, it never waits: an empty queue is a miss and the game generates its own board
+bool FBoardPipeline::Pop(int Width, int Height, int Mines, FReadyBoard& Board)
+{
+    for (const std::unique_ptr<FBoardQueue>& Queue : Queues)       // Only a few sizes, a linear search is enough
+    {
+        if (Queue->Width == Width && Queue->Height == Height && Queue->Mines == Mines)
+        {
+            if (!Queue->Boards.Pop(Board))
+            {
+                Queue->Misses.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            Queue->Hits.fetch_add(1, std::memory_order_relaxed);
+            BoardsTaken.fetch_add(1);               // Without SleepMutex: a producer that misses the wake up sleeps one timeout at most
+            BoardTaken.notify_one();
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Keep every queue filled up to Depth, starting on a different size on each producer. Sleep while they are all full.
+void FBoardPipeline::ProducerLoop(int Producer)
+{
+    FMineSweeper Game;
+    while (!bStopping)
+    {
+        uint64_t Taken = BoardsTaken.load();    // Before looking at the queues, so no board taken after is missed
+        bool bGenerated = false;
+        for (size_t i = 0; i < Queues.size() && !bStopping; i++)
+        {
+            FBoardQueue& Queue = *Queues[(Producer + i) % Queues.size()];
+            if (Queue.Boards.GetSize() >= (size_t) Depth)
+            {
+                continue;
+            }
+            Game.SetGameParams(Queue.Width, Queue.Height, Queue.Mines);
+            FReadyBoard Board;
+            if (!Game.Reset(MakeRandomSeed()) || !Game.TakeBoard(Board))
+            {
+                continue;                           // Out of memory, the games will generate their own boards
+            }
+            if (Queue.Boards.Push(std::move(Board)))    // Another producer may have filled it meanwhile, then the board goes back to the pool
+            {
+                Queue.Generated.fetch_add(1, std::memory_order_relaxed);
+                bGenerated = true;
+            }
+        }
+        if (!bGenerated)
+        {
+            std::unique_lock<std::mutex> Lock(SleepMutex);
+            BoardTaken.wait_for(Lock, std::chrono::milliseconds(PIPELINE_IDLE_MILLISECONDS), [this, Taken]() { return bStopping.load() || BoardsTaken != Taken; });
+        }
+    }
+}
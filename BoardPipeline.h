@@ -0,0 +1,78 @@
+/* Background generation of boards, so starting a game on a big board does not wait for the mines and the nearby mines counts.
+
+Producer threads generate random boards of the configured sizes ahead of time and keep up to Depth of each size ready on a bounded
+lock-free queue (BoundedQueue.h). FMineSweeper::Reset() on a game with a pipeline takes a ready board of its size, and only generates
+it inline when there is none (a miss). Boards with a given seed are always generated inline, since they have to be that board.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Minesweeper.h"
+#include "BoundedQueue.h"
+
+#define PIPELINE_DEFAULT_DEPTH 8        // Boards kept ready of each size
+#define PIPELINE_IDLE_MILLISECONDS 5    // Producers with every queue full look again after this time, if no board is taken before
+
+/// Counters of one board size, to choose the depth and the number of producers
+struct FBoardPipelineStats
+{
+    int Width = 0;
+    int Height = 0;
+    int Mines = 0;
+    uint64_t Hits = 0;              // Games started on a ready board
+    uint64_t Misses = 0;            // Games that found the queue empty and generated their board inline
+    uint64_t Generated = 0;         // Boards generated by the producers
+    size_t Depth = 0;               // Boards ready now
+};
+
+/// Producer threads and a queue of ready boards for each configured size. Sizes are added before Start.
+class FBoardPipeline
+{
+    public:
+        FBoardPipeline(int NumThreads = 1, int InDepth = PIPELINE_DEFAULT_DEPTH);
+        ~FBoardPipeline();          // Stops the producers, the boards left are freed
+        FBoardPipeline(const FBoardPipeline&) = delete;
+        FBoardPipeline& operator=(const FBoardPipeline&) = delete;
+
+        /// Getters
+        std::vector<FBoardPipelineStats> GetStats() const;
+
+        /// Rest of functions
+        bool AddBoardSize(int, int, int);       // Width, height and mines. Returns false if the board is not valid or the pipeline already started.
+        void Start();
+        bool Pop(int, int, int, FReadyBoard&);  // Takes a ready board of the size. Returns false (a miss) if there is none.
+
+    private:
+        /// Ready boards of one size
+        struct FBoardQueue
+        {
+            int Width;
+            int Height;
+            int Mines;
+            FBoundedQueue<FReadyBoard> Boards;
+            std::atomic<uint64_t> Hits{0};
+            std::atomic<uint64_t> Misses{0};
+            std::atomic<uint64_t> Generated{0};
+
+            FBoardQueue(int InWidth, int InHeight, int InMines, int Depth) : Width(InWidth), Height(InHeight), Mines(InMines), Boards(Depth) { }
+        };
+
+        std::vector<std::unique_ptr<FBoardQueue>> Queues;
+        std::vector<std::thread> Producers;
+        int NumThreads;
+        int Depth;
+        std::atomic<bool> bStopping{false};
+        std::mutex SleepMutex;
+        std::condition_variable BoardTaken;
+        std::atomic<uint64_t> BoardsTaken{0};   // Boards popped, a producer sleeps until it changes (or PIPELINE_IDLE_MILLISECONDS)
+
+        void ProducerLoop(int);
+};
@@ -0,0 +1,154 @@
+/* Pool of board buffers, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "BoardPool.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define BOARD_POOL_NUM_CLASSES 104      // Enough classes for any size up to 2^32 bytes
+
+/// Free buffers of one thread, by size class
+struct FBoardPool
+{
+    std::vector<uint8_t*> FreeBuffers[BOARD_POOL_NUM_CLASSES];
+    FBoardPoolStats Stats;
+
+    ~FBoardPool();
+};
+
+/// Set when the pool of the thread is destroyed, so buffers released later (global games) are freed instead
+static thread_local bool bPoolDestroyed = false;
+static thread_local FBoardPool Pool;
+
+FBoardPool::~FBoardPool()
+{
+    for (std::vector<uint8_t*>& Buffers : FreeBuffers)
+    {
+        for (uint8_t* Buffer : Buffers)
+        {
+            free(Buffer);
+        }
+    }
+    bPoolDestroyed = true;
+}
+
+/// Size class of a buffer of Size bytes, and the bytes of the buffers of that class.
+/// Sizes up to BOARD_POOL_MIN_BYTES are class 0, the rest are rounded up to 4 steps per power of two: 80, 96, 112, 128, 160...
+static int GetSizeClass(size_t Size, size_t& Capacity)
+{
+    if (Size <= BOARD_POOL_MIN_BYTES)
+    {
+        Capacity = BOARD_POOL_MIN_BYTES;
+        return 0;
+    }
+    int HighBit = 0;                // Highest bit set of Size - 1, at least 6 since Size > 64
+    while (((Size - 1) >> (HighBit + 1)) != 0)
+    {
+        HighBit++;
+    }
+    size_t Step = (size_t) 1 << (HighBit - 2);
+    size_t Quarter = (Size - 1) / Step;             // 4 to 7
+    Capacity = (Quarter + 1) * Step;
+    return 1 + (HighBit - 6) * 4 + (int) (Quarter - 4);
+}
+
+FBoardBuffer::~FBoardBuffer()
+{
+    Release();
+}
+
+FBoardBuffer::FBoardBuffer(FBoardBuffer&& Other) noexcept : Data(Other.Data), Capacity(Other.Capacity)
+{
+    Other.Data = nullptr;
+    Other.Capacity = 0;
+}
+
+FBoardBuffer& FBoardBuffer::operator=(FBoardBuffer&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        Release();
+        Data = Other.Data;
+        Capacity = Other.Capacity;
+        Other.Data = nullptr;
+        Other.Capacity = 0;
+    }
+    return *this;
+}
+
+/// Get a buffer of at least Size bytes with the first Size set to 0: the current one if it is of the same class,
+/// else one of the pool, else a new one. Returns false if there is no memory, leaving the buffer empty.
+bool FBoardBuffer::Reset(size_t Size)
+{
+    size_t ClassCapacity = 0;
+    int Class = GetSizeClass(Size, ClassCapacity);
+    if (Data != nullptr && Capacity == ClassCapacity)
+    {
+        memset(Data, 0, Size);
+        if (!bPoolDestroyed)
+        {
+            Pool.Stats.Hits++;
+        }
+        return true;
+    }
+
+    Release();
+    if (!bPoolDestroyed && !Pool.FreeBuffers[Class].empty())
+    {
+        Data = Pool.FreeBuffers[Class].back();
+        Pool.FreeBuffers[Class].pop_back();
+        Pool.Stats.RetainedBytes -= ClassCapacity;
+        Pool.Stats.Hits++;
+        memset(Data, 0, Size);
+    }
+    else
+    {
+        Data = (uint8_t*) calloc(1, ClassCapacity);     // New memory comes cleared from the system, no need to memset it
+        if (Data == nullptr)
+        {
+            return false;
+        }
+        if (!bPoolDestroyed)
+        {
+            Pool.Stats.Misses++;
+            Pool.Stats.AllocatedBytes += ClassCapacity;
+        }
+    }
+    Capacity = ClassCapacity;
+    return true;
+}
+
+/// Keep the buffer for the next board of its class, unless the pool already has enough of them
+void FBoardBuffer::Release()
+{
+    if (Data == nullptr)
+    {
+        return;
+    }
+    size_t ClassCapacity = 0;
+    int Class = GetSizeClass(Capacity, ClassCapacity);
+    if (!bPoolDestroyed && Pool.FreeBuffers[Class].size() < BOARD_POOL_MAX_PER_CLASS
+        && Pool.Stats.RetainedBytes + Capacity <= BOARD_POOL_MAX_RETAINED)
+    {
+        if (Pool.FreeBuffers[Class].capacity() == 0)
+        {
+            Pool.FreeBuffers[Class].reserve(BOARD_POOL_MAX_PER_CLASS);     // The only allocation of the pool itself
+        }
+        Pool.FreeBuffers[Class].push_back(Data);
+        Pool.Stats.RetainedBytes += Capacity;
+    }
+    else
+    {
+        free(Data);
+    }
+    Data = nullptr;
+    Capacity = 0;
+}
+
+FBoardPoolStats GetBoardPoolStats()
+{
+    return bPoolDestroyed ? FBoardPoolStats() : Pool.Stats;
+}
@@ -0,0 +1,54 @@
+/* Pool of board buffers, so starting a game on an already seen board size does not allocate memory.
+
+Freed buffers are kept by size class (4 classes per power of two, so at most 25 % of a buffer is wasted) and handed out again,
+cleared with a single memset. Each thread has its own pool, no locks are needed: a buffer freed on another thread just goes to
+the pool of that thread. Buffers are owned through FBoardBuffer, which returns them to the pool when it is destroyed.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#define BOARD_POOL_MIN_BYTES 64                 // Smallest size class
+#define BOARD_POOL_MAX_PER_CLASS 4              // Free buffers kept of each size class
+#define BOARD_POOL_MAX_RETAINED (256u << 20)    // Free bytes kept by the pool of each thread, the rest are freed
+
+/// Counters of the pool of the calling thread
+struct FBoardPoolStats
+{
+    uint64_t Hits = 0;              // Buffers taken from the pool
+    uint64_t Misses = 0;            // Buffers allocated because the pool had none of their class
+    uint64_t AllocatedBytes = 0;    // Bytes of those buffers
+    size_t RetainedBytes = 0;       // Free bytes kept by the pool
+};
+
+/// Board memory taken from the pool of the thread, owned by a single object. It can be moved but not copied.
+class FBoardBuffer
+{
+    public:
+        FBoardBuffer() { }
+        ~FBoardBuffer();
+        FBoardBuffer(FBoardBuffer&&) noexcept;
+        FBoardBuffer& operator=(FBoardBuffer&&) noexcept;
+        FBoardBuffer(const FBoardBuffer&) = delete;
+        FBoardBuffer& operator=(const FBoardBuffer&) = delete;
+
+        /// Getters
+        uint8_t* GetData() const { return Data; }
+        size_t GetCapacity() const { return Capacity; }
+        uint8_t& operator[](size_t Index) const { return Data[Index]; }
+        explicit operator bool() const { return Data != nullptr; }
+
+        /// Rest of functions
+        bool Reset(size_t);         // At least the given bytes, all set to 0. Reuses the current buffer if it is of the same class.
+        void Release();             // Returns the buffer to the pool
+
+    private:
+        uint8_t* Data = nullptr;
+        size_t Capacity = 0;        // Size of the class of the buffer
+};
+
+/// Counters of the pool of the calling thread
+FBoardPoolStats GetBoardPoolStats();
@@ -0,0 +1,259 @@
+/* Parallel versions of the nearby mines count and of the flood fill, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "BoardStrips.h"
+#include "Minesweeper.h"
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+/// Rows of one strip, the copies of the rows around it and the buffers of its thread. Aligned to a cache line, so the threads
+/// growing their vectors do not share one.
+struct alignas(64) FBoardStrip
+{
+    int FirstRow = 0;
+    int LastRow = 0;                        // One past the last row of the strip
+    std::vector<uint8_t> HaloUp;            // Row above the strip, zeros on the first strip
+    std::vector<uint8_t> HaloDown;          // Row below the strip, zeros on the last strip
+    std::vector<uint8_t> ColumnSums;        // Scratch buffer of CountNearbyMinesRow
+
+    /// Flood fill
+    std::vector<int> Inbox;                 // Cells sent by the strips around and not checked yet, guarded by FStripFill::Mutex
+    std::vector<int> Stack;                 // Cells marked as visited and not displayed yet
+    std::vector<int> Revealed;
+};
+
+/// Board shared by the strips
+struct FStripBoard
+{
+    ESimdLevel Level;
+    uint8_t* Cells;
+    int Width;
+    int Height;
+    uint8_t* CountedRows;                   // nullptr if every count is stored
+};
+
+/// Flood fill state shared by the strips
+struct FStripFill
+{
+    std::mutex Mutex;
+    std::condition_variable Wake;           // Cells were sent to a strip, or the fill is over
+    int Pending = 0;                        // Strips working plus strips with cells on their inbox. The fill is over at 0.
+};
+
+/// Function prototypes
+static int GetNumStrips(int, int);
+static void MakeStrips(const FStripBoard&, int, std::vector<FBoardStrip>&);
+static void CountStripRow(const FStripBoard&, FBoardStrip&, int);
+static void FillStrip(const FStripBoard&, FBoardStrip&, std::vector<int>&, std::vector<int>&);
+static void RunFillStrip(const FStripBoard&, std::vector<FBoardStrip>&, int, FStripFill&);
+static void SendCells(std::vector<FBoardStrip>&, int, std::vector<int>&, FStripFill&);
+template <typename FBody> static void RunOnStrips(int, FBody);
+
+void CountNearbyMinesStrips(ESimdLevel Level, uint8_t* Cells, int Width, int Height, int NumThreads)
+{
+    FStripBoard Board = { Level, Cells, Width, Height, nullptr };
+    std::vector<FBoardStrip> Strips;
+    MakeStrips(Board, GetNumStrips(Height, NumThreads), Strips);
+    RunOnStrips((int) Strips.size(), [&](int s)
+    {
+        for (int y = Strips[s].FirstRow; y < Strips[s].LastRow; y++)
+        {
+            CountStripRow(Board, Strips[s], y);
+        }
+    });
+}
+
+int FloodFillStrips(ESimdLevel Level, uint8_t* Cells, int Width, int Height, uint8_t* CountedRows, std::vector<int>& Stack, int NumThreads,
+                    std::vector<int>& Revealed)
+{
+    FStripBoard Board = { Level, Cells, Width, Height, CountedRows };
+    std::vector<FBoardStrip> Strips;
+    int NumStrips = GetNumStrips(Height, NumThreads);
+    MakeStrips(Board, NumStrips, Strips);
+    for (int Cell : Stack)                          // Each cell goes to the stack of the strip of its row
+    {
+        int y = Cell / Width;
+        int s = (int) ((int64_t) y * NumStrips / Height);
+        while (y < Strips[s].FirstRow)
+        {
+            s--;
+        }
+        while (y >= Strips[s].LastRow)
+        {
+            s++;
+        }
+        Strips[s].Stack.push_back(Cell);
+    }
+    Stack.clear();
+
+    FStripFill Fill;
+    Fill.Pending = NumStrips;                       // Every strip starts working on its own stack
+    RunOnStrips(NumStrips, [&](int s) { RunFillStrip(Board, Strips, s, Fill); });
+
+    size_t First = Revealed.size();
+    for (const FBoardStrip& Strip : Strips)
+    {
+        Revealed.insert(Revealed.end(), Strip.Revealed.begin(), Strip.Revealed.end());
+    }
+    return (int) (Revealed.size() - First);
+}
+
+/// One strip per thread, with STRIP_MIN_ROWS rows at least
+static int GetNumStrips(int Height, int NumThreads)
+{
+    int MaxStrips = Height / STRIP_MIN_ROWS;
+    int NumStrips = NumThreads < MaxStrips ? NumThreads : MaxStrips;
+    return NumStrips < 1 ? 1 : NumStrips;
+}
+
+/// Split the rows in NumStrips strips of the same size, and copy the halo rows of each one before any thread writes them
+static void MakeStrips(const FStripBoard& Board, int NumStrips, std::vector<FBoardStrip>& Strips)
+{
+    Strips.resize(NumStrips);
+    for (int s = 0; s < NumStrips; s++)
+    {
+        FBoardStrip& Strip = Strips[s];
+        Strip.FirstRow = (int) ((int64_t) Board.Height * s / NumStrips);
+        Strip.LastRow = (int) ((int64_t) Board.Height * (s + 1) / NumStrips);
+        Strip.HaloUp.assign(Board.Width, 0);
+        Strip.HaloDown.assign(Board.Width, 0);
+        Strip.ColumnSums.assign(Board.Width + 2, 0);       // Ghost cells at both sides stay 0
+        if (Strip.FirstRow > 0)
+        {
+            memcpy(Strip.HaloUp.data(), Board.Cells + (size_t) (Strip.FirstRow - 1) * Board.Width, Board.Width);
+        }
+        if (Strip.LastRow < Board.Height)
+        {
+            memcpy(Strip.HaloDown.data(), Board.Cells + (size_t) Strip.LastRow * Board.Width, Board.Width);
+        }
+    }
+}
+
+/// Count the nearby mines of row y, reading the halo rows instead of the rows of the strips around. Only their mine bits are read,
+/// and mines do not move while the strips run.
+static void CountStripRow(const FStripBoard& Board, FBoardStrip& Strip, int y)
+{
+    uint8_t* Row = Board.Cells + (size_t) y * Board.Width;
+    const uint8_t* Up = (y == Strip.FirstRow) ? Strip.HaloUp.data() : Row - Board.Width;
+    const uint8_t* Down = (y == Strip.LastRow - 1) ? Strip.HaloDown.data() : Row + Board.Width;
+    CountNearbyMinesRow(Board.Level, Up, Row, Down, Strip.ColumnSums.data(), Board.Width);
+}
+
+/// Same flood fill as FMineSweeper::SetCellUserVisitedBoard, from the cells of Strip.Stack. The neighbours on the strips above and
+/// below are not read: they are added to ToUp and ToDown, for the strip that owns them.
+static void FillStrip(const FStripBoard& Board, FBoardStrip& Strip, std::vector<int>& ToUp, std::vector<int>& ToDown)
+{
+    uint8_t* Cells = Board.Cells;
+    int Width = Board.Width;
+    while (!Strip.Stack.empty())
+    {
+        int Cell = Strip.Stack.back();
+        Strip.Stack.pop_back();
+        int y = Cell / Width;
+        if (Board.CountedRows != nullptr && !Board.CountedRows[y])     // As FMineSweeper::ShowCell, only this strip writes its rows
+        {
+            CountStripRow(Board, Strip, y);
+            Board.CountedRows[y] = 1;
+        }
+        Cells[Cell] |= CELL_SHOWN;
+        Strip.Revealed.push_back(Cell);
+        if ((Cells[Cell] >> CELL_COUNT_SHIFT) != 0)
+        {
+            continue;
+        }
+        int x = Cell - y * Width;
+        int FirstX = (x > 0) ? x - 1 : x;
+        int LastX = (x < Width - 1) ? x + 1 : x;
+        for (int ny = y - 1; ny <= y + 1; ny++)
+        {
+            if (ny < 0 || ny >= Board.Height)
+            {
+                continue;
+            }
+            std::vector<int>* Outbox = (ny < Strip.FirstRow) ? &ToUp : (ny >= Strip.LastRow ? &ToDown : nullptr);
+            for (int nx = FirstX; nx <= LastX; nx++)
+            {
+                int Neighbour = ny * Width + nx;
+                if (Outbox != nullptr)
+                {
+                    Outbox->push_back(Neighbour);
+                }
+                else if ((Cells[Neighbour] & (CELL_VISITED | CELL_FLAG)) == 0)     // The cell itself is already visited
+                {
+                    Cells[Neighbour] |= CELL_VISITED;
+                    Strip.Stack.push_back(Neighbour);
+                }
+            }
+        }
+    }
+}
+
+/// Thread of strip s: fill from its stack, send the cells of the other strips and wait for cells sent to it, until the fill is over
+static void RunFillStrip(const FStripBoard& Board, std::vector<FBoardStrip>& Strips, int s, FStripFill& Fill)
+{
+    FBoardStrip& Strip = Strips[s];
+    std::vector<int> Batch, ToUp, ToDown;
+    std::unique_lock<std::mutex> Lock(Fill.Mutex, std::defer_lock);
+    while (true)
+    {
+        for (int Cell : Batch)                      // Cells sent by other strips, the ones already visited or flagged are skipped
+        {
+            if ((Board.Cells[Cell] & (CELL_VISITED | CELL_FLAG)) == 0)
+            {
+                Board.Cells[Cell] |= CELL_VISITED;
+                Strip.Stack.push_back(Cell);
+            }
+        }
+        Batch.clear();
+        FillStrip(Board, Strip, ToUp, ToDown);
+
+        Lock.lock();
+        SendCells(Strips, s - 1, ToUp, Fill);
+        SendCells(Strips, s + 1, ToDown, Fill);
+        Fill.Pending--;
+        Fill.Wake.notify_all();
+        Fill.Wake.wait(Lock, [&]() { return !Strip.Inbox.empty() || Fill.Pending == 0; });
+        if (Strip.Inbox.empty())
+        {
+            return;
+        }
+        Batch.swap(Strip.Inbox);                    // The strip is working again instead of having cells waiting, Pending is the same
+        Lock.unlock();
+    }
+}
+
+/// Add the cells to the inbox of strip s. Fill.Mutex must be locked.
+static void SendCells(std::vector<FBoardStrip>& Strips, int s, std::vector<int>& Cells, FStripFill& Fill)
+{
+    if (Cells.empty())
+    {
+        return;
+    }
+    std::vector<int>& Inbox = Strips[s].Inbox;
+    if (Inbox.empty())
+    {
+        Fill.Pending++;
+    }
+    Inbox.insert(Inbox.end(), Cells.begin(), Cells.end());
+    Cells.clear();
+}
+
+/// Run Body(s) for every strip s, each one on its own thread. The first strip runs on the calling thread.
+template <typename FBody>
+static void RunOnStrips(int NumStrips, FBody Body)
+{
+    std::vector<std::thread> Threads;
+    for (int s = 1; s < NumStrips; s++)
+    {
+        Threads.emplace_back(Body, s);
+    }
+    Body(0);
+    for (std::thread& Thread : Threads)
+    {
+        Thread.join();
+    }
+}
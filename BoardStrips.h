@@ -0,0 +1,34 @@
+/* Parallel versions of the nearby mines count and of the flood fill, for very big boards.
+
+The board is split in strips of whole rows, one per thread, and each thread only reads and writes the cells of its own strip:
+1. Nearby mines: the row above and the row below each strip (its halo rows) are copied before the threads start, so counting the
+   first and last rows of a strip never reads a row that another thread is writing.
+2. Flood fill: each strip opens its part of the area as FMineSweeper::SetCellUserVisitedBoard does. A cell without mines nearby
+   whose neighbours are on another strip does not read them: it sends them to the inbox of that strip, whose thread checks them
+   and goes on from there. The fill ends when every inbox is empty and no strip is working.
+Each cell is opened by the same rules whatever strip opens it, so the cells end exactly as with one thread. Only the order of the
+revealed cells changes: they are listed strip by strip.
+
+FMineSweeper counts on strips the boards of at least STRIPS_MIN_CELLS cells (SetGenerationThreads), and moves a reveal to the strips
+once it has opened STRIPS_REVEAL_MIN_CELLS cells on one thread (SetRevealThreads), so small areas never pay for the threads.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "BoardKernels.h"
+
+#define STRIPS_MIN_CELLS (1 << 20)              // Smaller boards are counted on one thread
+#define STRIPS_REVEAL_MIN_CELLS (1 << 16)       // Cells opened on one thread before a reveal moves to the strips
+#define STRIP_MIN_ROWS 16                       // Rows of each strip at least, so a strip is not only its borders
+
+/// Store the number of nearby mines of every cell of the Width x Height board, on NumThreads strips. Every mine must be placed.
+void CountNearbyMinesStrips(ESimdLevel, uint8_t* Cells, int Width, int Height, int NumThreads);
+
+/// Go on with the flood fill of FMineSweeper::SetCellUserVisitedBoard on NumThreads strips. Stack has the cells already marked as
+/// visited and not displayed yet, and is left empty. CountedRows is nullptr if every count is stored, or the rows whose counts are
+/// stored (the others are counted when one of their cells is displayed, and marked). Returns the number of cells added to Revealed.
+int FloodFillStrips(ESimdLevel, uint8_t* Cells, int Width, int Height, uint8_t* CountedRows, std::vector<int>& Stack, int NumThreads,
+                    std::vector<int>& Revealed);
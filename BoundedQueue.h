@@ -0,0 +1,108 @@
+/* Bounded lock-free queue for many producers and many consumers (Dmitry Vyukov's design).
+
+The queue is a ring of slots, each with a sequence number that tells whether the slot is ready to be written or to be read on the
+current turn of the ring. Producers and consumers claim positions with a compare and swap on Tail and Head, so no thread ever waits
+for a lock: Push fails when the queue is full and Pop fails when it is empty.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#define QUEUE_CACHE_LINE 64         // Head and Tail are kept on different cache lines, so producers and consumers do not share one
+
+/// Queue of at most GetCapacity() values. T must be default constructible and movable.
+template <typename T>
+class FBoundedQueue
+{
+    public:
+        explicit FBoundedQueue(size_t MinCapacity)      // The capacity is rounded up to a power of two
+        {
+            while (Capacity < MinCapacity)
+            {
+                Capacity *= 2;
+            }
+            Slots.reset(new FSlot[Capacity]);
+            for (size_t i = 0; i < Capacity; i++)
+            {
+                Slots[i].Sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+        FBoundedQueue(const FBoundedQueue&) = delete;
+        FBoundedQueue& operator=(const FBoundedQueue&) = delete;
+
+        /// Getters
+        size_t GetCapacity() const { return Capacity; }
+        size_t GetSize() const      // Values in the queue. Only a hint while other threads use it.
+        {
+            size_t Pushed = Tail.load(std::memory_order_relaxed);
+            size_t Popped = Head.load(std::memory_order_relaxed);
+            return Pushed > Popped ? Pushed - Popped : 0;
+        }
+
+        /// Rest of functions
+        bool Push(T&& Value)        // Returns false if the queue is full, Value is not moved then
+        {
+            size_t Position = Tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                FSlot& Slot = Slots[Position & (Capacity - 1)];
+                intptr_t Turn = (intptr_t) Slot.Sequence.load(std::memory_order_acquire) - (intptr_t) Position;
+                if (Turn == 0 && Tail.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+                {
+                    Slot.Value = std::move(Value);
+                    Slot.Sequence.store(Position + 1, std::memory_order_release);
+                    return true;
+                }
+                if (Turn < 0)       // The slot still has the value of the previous turn: the queue is full
+                {
+                    return false;
+                }
+                if (Turn > 0)       // Another producer took the position
+                {
+                    Position = Tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool Pop(T& Value)          // Returns false if the queue is empty
+        {
+            size_t Position = Head.load(std::memory_order_relaxed);
+            while (true)
+            {
+                FSlot& Slot = Slots[Position & (Capacity - 1)];
+                intptr_t Turn = (intptr_t) Slot.Sequence.load(std::memory_order_acquire) - (intptr_t) (Position + 1);
+                if (Turn == 0 && Head.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+                {
+                    Value = std::move(Slot.Value);
+                    Slot.Sequence.store(Position + Capacity, std::memory_order_release);
+                    return true;
+                }
+                if (Turn < 0)       // The slot has not been written on this turn: the queue is empty
+                {
+                    return false;
+                }
+                if (Turn > 0)       // Another consumer took the position
+                {
+                    Position = Head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct FSlot
+        {
+            std::atomic<size_t> Sequence;
+            T Value;
+        };
+
+        std::unique_ptr<FSlot[]> Slots;
+        size_t Capacity = 2;
+        alignas(QUEUE_CACHE_LINE) std::atomic<size_t> Head{0};     // Next position to read
+        alignas(QUEUE_CACHE_LINE) std::atomic<size_t> Tail{0};     // Next position to write
+};
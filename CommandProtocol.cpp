@@ -0,0 +1,812 @@
+/* Line oriented command protocol, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "CommandProtocol.h"
+#include "NoGuessGenerator.h"
+#include "GameSnapshot.h"
+#include "MineGenerator.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#define read _read
+#define write _write
+#else
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/// Tokenizer
+
+bool FCommandTokenizer::NextWord(const char*& Word, int& Length)
+{
+    while (Cursor < LineEnd && (*Cursor == ' ' || *Cursor == '\t' || *Cursor == '\r'))
+    {
+        Cursor++;
+    }
+    Word = Cursor;
+    while (Cursor < LineEnd && *Cursor != ' ' && *Cursor != '\t' && *Cursor != '\r')
+    {
+        Cursor++;
+    }
+    Length = (int) (Cursor - Word);
+    return Length > 0;
+}
+
+bool FCommandTokenizer::NextInt(int& Value)
+{
+    uint64_t Number = 0;
+    if (!NextUInt64(Number) || Number > (uint64_t) MAX_BOARD_SIZE)
+    {
+        return false;
+    }
+    Value = (int) Number;
+    return true;
+}
+
+bool FCommandTokenizer::NextSignedInt(int& Value)
+{
+    const char* Word = nullptr;
+    int Length = 0;
+    if (!NextWord(Word, Length))
+    {
+        return false;
+    }
+    bool bNegative = Word[0] == '-';
+    FCommandTokenizer Digits(Word + (bNegative ? 1 : 0), Word + Length);
+    uint64_t Number = 0;
+    if (!Digits.NextUInt64(Number) || Number > (uint64_t) INT32_MAX)
+    {
+        return false;
+    }
+    Value = bNegative ? -(int) Number : (int) Number;
+    return true;
+}
+
+bool FCommandTokenizer::NextUInt64(uint64_t& Value)
+{
+    const char* Word = nullptr;
+    int Length = 0;
+    if (!NextWord(Word, Length) || Length > 20)
+    {
+        return false;
+    }
+    uint64_t Number = 0;
+    for (int i = 0; i < Length; i++)
+    {
+        if (Word[i] < '0' || Word[i] > '9')
+        {
+            return false;
+        }
+        uint64_t Digit = (uint64_t) (Word[i] - '0');
+        if (Number > (UINT64_MAX - Digit) / 10)     // It does not fit on 64 bits
+        {
+            return false;
+        }
+        Number = Number * 10 + Digit;
+    }
+    Value = Number;
+    return true;
+}
+
+/// Check whether the word is the given text
+bool FCommandTokenizer::IsWord(const char* Word, int Length, const char* Text) const
+{
+    return (int) strlen(Text) == Length && memcmp(Word, Text, Length) == 0;
+}
+
+/// Session
+
+FCommandSession::~FCommandSession()
+{
+    if (!HibernatedPath.empty())
+    {
+        std::remove(HibernatedPath.c_str());
+    }
+}
+
+bool FCommandSession::RunCommand(const char* Begin, const char* End, std::string& Reply)
+{
+    FCommandTokenizer Tokenizer(Begin, End);
+    const char* Command = nullptr;
+    int Length = 0;
+    if (!Tokenizer.NextWord(Command, Length) || Command[0] == '#')     // Empty line or comment
+    {
+        return true;
+    }
+    if (!HibernatedPath.empty())
+    {
+        Wake();
+    }
+
+    if (Tokenizer.IsWord(Command, Length, "reveal"))                  // Most common command first
+    {
+        Reveal(Tokenizer, Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "flag"))
+    {
+        Flag(Tokenizer, Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "chord"))
+    {
+        Chord(Tokenizer, Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "undo"))
+    {
+        Undo(true, Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "redo"))
+    {
+        Undo(false, Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "new"))
+    {
+        NewGame(Tokenizer, Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "state"))
+    {
+        AppendState(Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "board") && bInfinite)
+    {
+        AppendInfiniteBoard(Tokenizer, Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "board"))
+    {
+        AppendBoard(Reply);
+    }
+    else if (Tokenizer.IsWord(Command, Length, "quit"))
+    {
+        Reply += "ok quit\n";
+        return false;
+    }
+    else
+    {
+        Reply += "err command\n";
+    }
+    return true;
+}
+
+/// Run the complete lines of [Begin, End) until they are over, quit is found or the replies reach COMMAND_WRITE_BYTES.
+/// Returns the bytes of the lines that were run, the rest has to be passed again (with the end of the incomplete line, if any).
+size_t FCommandSession::RunCommands(const char* Begin, const char* End, std::string& Reply, bool& bQuit)
+{
+    const char* Line = Begin;
+    const char* NewLine = nullptr;
+    bQuit = false;
+    while (Reply.size() < COMMAND_WRITE_BYTES && (NewLine = (const char*) memchr(Line, '\n', End - Line)) != nullptr)
+    {
+        bQuit = !RunCommand(Line, NewLine, Reply);
+        Line = NewLine + 1;
+        if (bQuit)
+        {
+            break;
+        }
+    }
+    return (size_t) (Line - Begin);
+}
+
+void FCommandSession::SetBoardPipeline(FBoardPipeline* Pipeline)
+{
+    Game.SetBoardPipeline(Pipeline);
+}
+
+void FCommandSession::SetJournal(FGameJournal* Journal)
+{
+    Game.SetJournal(Journal);
+}
+
+void FCommandSession::SetMetrics(FGameMetrics* Metrics)
+{
+    Game.SetMetrics(Metrics);
+}
+
+/// Save the game to Path and free its board until the next command. The board goes back to the pool of this thread, for other sessions.
+bool FCommandSession::Hibernate(const std::string& Path)
+{
+    if (!bHasGame || bInfinite || !HibernatedPath.empty() || !SaveGameFile(Game, Path.c_str()))
+    {
+        return false;
+    }
+    Game.EraseMemory();
+    HibernatedPath = Path;
+    return true;
+}
+
+/// Load the hibernated game again, with the moves to undo and redo it had. If its file is lost the session goes on without game,
+/// and the commands reply err nogame.
+void FCommandSession::Wake()
+{
+    Game.SetHistory(nullptr);                   // Loading would start the history again, but the file holds its current move
+    bHasGame = LoadGameFile(Game, HibernatedPath.c_str());
+    if (bHasGame && History)
+    {
+        Game.ResumeHistory(History.get());
+    }
+    else if (History)
+    {
+        Game.SetHistory(History.get());
+    }
+    std::remove(HibernatedPath.c_str());
+    HibernatedPath.clear();
+}
+
+/// new W H M [SEED] [safe | noguess]: without a seed the board is random, with safe the first reveal never finds a mine,
+/// with noguess the board is solved without guessing from its centre cell (searched on this thread, the session is not shared)
+void FCommandSession::NewGame(FCommandTokenizer& Tokenizer, std::string& Reply)
+{
+    FCommandTokenizer AfterNew = Tokenizer;
+    const char* Word = nullptr;
+    int Length = 0;
+    if (AfterNew.NextWord(Word, Length) && AfterNew.IsWord(Word, Length, "infinite"))
+    {
+        NewInfiniteGame(AfterNew, Reply);
+        return;
+    }
+    int Width = 0, Height = 0, Mines = 0;
+    uint64_t Seed = 0;
+    if (!Tokenizer.NextInt(Width) || !Tokenizer.NextInt(Height) || !Tokenizer.NextInt(Mines))
+    {
+        Reply += "err arguments\n";
+        return;
+    }
+    FCommandTokenizer AfterMines = Tokenizer;
+    bool bHasSeed = Tokenizer.NextUInt64(Seed);
+    if (!bHasSeed)
+    {
+        Tokenizer = AfterMines;                     // The word was not a seed, read it again
+    }
+    bool bHasMode = Tokenizer.NextWord(Word, Length);
+    bool bNoGuess = bHasMode && Tokenizer.IsWord(Word, Length, "noguess");
+    if (!Game.SetGameParams(Width, Height, Mines))  // Keeps the game being played, and its mode, as they were
+    {
+        Reply += "err board\n";
+        return;
+    }
+    Game.SetFirstClickSafe(bHasMode && Tokenizer.IsWord(Word, Length, "safe"));
+    Game.EraseMemory();
+    if (bInfinite)
+    {
+        Infinite->EraseMemory();
+        bInfinite = false;
+    }
+    if (!History)
+    {
+        History = std::unique_ptr<FGameHistory>(new FGameHistory());
+        Game.SetHistory(History.get());
+    }
+    if (bNoGuess)
+    {
+        FNoGuessOptions Options;
+        FNoGuessStats Stats;
+        Options.NumThreads = 1;
+        Options.Seed = bHasSeed ? Seed : 0;
+        bHasGame = GenerateNoGuessBoard(Game, Width / 2 + Height / 2 * Width, Options, Stats);
+        if (!bHasGame)
+        {
+            Reply += "err noguess\n";
+            return;
+        }
+    }
+    else
+    {
+        bHasGame = bHasSeed ? Game.Reset(Seed) : Game.Reset();
+    }
+    if (!bHasGame)
+    {
+        Game.EraseMemory();
+        Reply += "err memory\n";
+        return;
+    }
+    Reply += "ok new ";
+    AppendNumber(Reply, Width);
+    Reply += ' ';
+    AppendNumber(Reply, Height);
+    Reply += ' ';
+    AppendNumber(Reply, Mines);
+    Reply += ' ';
+    AppendNumber(Reply, Game.GetSeed());
+    Reply += '\n';
+}
+
+/// reveal X Y: replies with the status and every cell the move displayed
+void FCommandSession::Reveal(FCommandTokenizer& Tokenizer, std::string& Reply)
+{
+    if (bInfinite)
+    {
+        RevealInfinite(Tokenizer, Reply);
+        return;
+    }
+    int Index = 0;
+    if (!ReadCell(Tokenizer, Index, Reply))
+    {
+        return;
+    }
+    char Cell = Game.GetUserBoard()[Index];
+    if (Cell != '-')
+    {
+        Reply += (Cell == 'F') ? "err flagged\n" : "err repeated\n";
+        return;
+    }
+
+    Game.SetCellUserBoard(Index);
+    const std::vector<int>& Revealed = Game.SetCellUserVisitedBoard(Index);
+    Game.SetGameStatus(Index);
+
+    bool bHitMine = Revealed.empty();               // Mines are already visited, so the only cell displayed is the selected one
+    size_t NumCells = bHitMine ? 1 : Revealed.size();
+    AppendStatus(Reply);
+    AppendNumber(Reply, NumCells);
+    if (bHitMine)
+    {
+        AppendCell(Index, Reply);
+    }
+    for (int RevealedCell : Revealed)
+    {
+        AppendCell(RevealedCell, Reply);
+    }
+    Reply += '\n';
+}
+
+/// flag X Y: toggles the flag of a cell that is not displayed
+void FCommandSession::Flag(FCommandTokenizer& Tokenizer, std::string& Reply)
+{
+    if (bInfinite)
+    {
+        FlagInfinite(Tokenizer, Reply);
+        return;
+    }
+    int Index = 0;
+    if (!ReadCell(Tokenizer, Index, Reply))
+    {
+        return;
+    }
+    if (!Game.SetCellFlag(Index, Game.GetUserBoard()[Index] != 'F'))
+    {
+        Reply += "err shown\n";
+        return;
+    }
+    Reply += "ok flag";
+    AppendCell(Index, Reply);
+    Reply += '\n';
+}
+
+/// chord X Y: replies with the status and every cell the chord displayed, mines next to wrong flags included
+void FCommandSession::Chord(FCommandTokenizer& Tokenizer, std::string& Reply)
+{
+    if (bInfinite)
+    {
+        Reply += "err infinite\n";
+        return;
+    }
+    int Index = 0;
+    if (!ReadCell(Tokenizer, Index, Reply))
+    {
+        return;
+    }
+    char Cell = Game.GetUserBoard()[Index];
+    if (Cell < '1' || Cell > '8')
+    {
+        Reply += (Cell == '-' || Cell == 'F') ? "err hidden\n" : "err nonumber\n";
+        return;
+    }
+
+    const std::vector<int>& Revealed = Game.ChordCell(Index);
+    Game.SetGameStatus(Index);
+
+    AppendStatus(Reply);
+    AppendNumber(Reply, Revealed.size());
+    for (int RevealedCell : Revealed)
+    {
+        AppendCell(RevealedCell, Reply);
+    }
+    Reply += '\n';
+}
+
+/// undo and redo (bUndo false): replies with the status and the cells the move changed, also after the game is over
+void FCommandSession::Undo(bool bUndo, std::string& Reply)
+{
+    if (!bHasGame || bInfinite)
+    {
+        Reply += bInfinite ? "err infinite\n" : "err nogame\n";
+        return;
+    }
+    int Move = bUndo ? History->GetCurrentMove() : History->GetCurrentMove() + 1;
+    if (!(bUndo ? Game.UndoMove() : Game.RedoMove()))
+    {
+        Reply += "err nomove\n";
+        return;
+    }
+
+    size_t NumCells = 0, NumDistinct = 0;
+    const int* Cells = History->GetMoveCells(Move, NumCells);
+    for (size_t i = 0; i < NumCells; i++)          // A cell shown and then visited by the same move comes twice in a row
+    {
+        NumDistinct += (i == 0 || Cells[i] != Cells[i - 1]);
+    }
+    AppendStatus(Reply);
+    AppendNumber(Reply, NumDistinct);
+    for (size_t i = 0; i < NumCells; i++)
+    {
+        if (i == 0 || Cells[i] != Cells[i - 1])
+        {
+            AppendCell(Cells[i], Reply);
+        }
+    }
+    Reply += '\n';
+}
+
+/// ok STATUS W H MINES SPACES_LEFT SEED
+void FCommandSession::AppendState(std::string& Reply) const
+{
+    if (!bHasGame)
+    {
+        Reply += "err nogame\n";
+        return;
+    }
+    if (bInfinite)
+    {
+        AppendInfiniteState(Reply);
+        return;
+    }
+    AppendStatus(Reply);
+    AppendNumber(Reply, Game.GetBoardWidth());
+    Reply += ' ';
+    AppendNumber(Reply, Game.GetBoardHeight());
+    Reply += ' ';
+    AppendNumber(Reply, Game.GetNumMines());
+    Reply += ' ';
+    AppendNumber(Reply, Game.GetResults().NumSpacesLeft);
+    Reply += ' ';
+    AppendNumber(Reply, Game.GetSeed());
+    Reply += '\n';
+}
+
+/// "ok STATUS " of the current game
+void FCommandSession::AppendStatus(std::string& Reply) const
+{
+    switch (bInfinite ? Infinite->GetGameStatus() : Game.GetGameStatus())
+    {
+        case EGameStatus::GameWon:
+            Reply += "ok won ";
+            break;
+        case EGameStatus::GameLost:
+            Reply += "ok lost ";
+            break;
+        default:
+            Reply += "ok play ";
+            break;
+    }
+}
+
+/// ok board H, followed by every row of the User board
+void FCommandSession::AppendBoard(std::string& Reply) const
+{
+    if (!bHasGame)
+    {
+        Reply += "err nogame\n";
+        return;
+    }
+    FBoardView Board = Game.GetUserBoard();
+    Reply += "ok board ";
+    AppendNumber(Reply, Game.GetBoardHeight());
+    Reply += '\n';
+    for (int y = 0; y < Game.GetBoardHeight(); y++)
+    {
+        for (int x = 0; x < Game.GetBoardWidth(); x++)
+        {
+            Reply += Board[y * Game.GetBoardWidth() + x];
+        }
+        Reply += '\n';
+    }
+}
+
+/// " X,Y,C" of a cell
+void FCommandSession::AppendCell(int Index, std::string& Reply) const
+{
+    Reply += ' ';
+    AppendNumber(Reply, Index % Game.GetBoardWidth());
+    Reply += ',';
+    AppendNumber(Reply, Index / Game.GetBoardWidth());
+    Reply += ',';
+    Reply += Game.GetUserBoard()[Index];
+}
+
+/// Read the X Y arguments of a move. Replies with the error and returns false if there is no game or the cell is not valid.
+bool FCommandSession::ReadCell(FCommandTokenizer& Tokenizer, int& Index, std::string& Reply) const
+{
+    int X = 0, Y = 0;
+    if (!bHasGame)
+    {
+        Reply += "err nogame\n";
+        return false;
+    }
+    if (Game.GetGameStatus() != EGameStatus::KeepPlaying)
+    {
+        Reply += "err over\n";
+        return false;
+    }
+    if (!Tokenizer.NextInt(X) || !Tokenizer.NextInt(Y))
+    {
+        Reply += "err arguments\n";
+        return false;
+    }
+    if (X >= Game.GetBoardWidth() || Y >= Game.GetBoardHeight())
+    {
+        Reply += "err range\n";
+        return false;
+    }
+    Index = X + Game.GetBoardWidth() * Y;
+    return true;
+}
+
+/// Infinite games
+
+/// Appends a number that may be negative
+static void AppendSignedNumber(std::string& Out, int Value)
+{
+    if (Value < 0)
+    {
+        Out += '-';
+    }
+    AppendNumber(Out, (uint64_t) (Value < 0 ? -(int64_t) Value : Value));
+}
+
+/// new infinite M [SEED]: M mines on each tile, without a seed the world is random
+void FCommandSession::NewInfiniteGame(FCommandTokenizer& Tokenizer, std::string& Reply)
+{
+    int Mines = 0;
+    uint64_t Seed = 0;
+    if (!Tokenizer.NextInt(Mines))
+    {
+        Reply += "err arguments\n";
+        return;
+    }
+    if (!Tokenizer.NextUInt64(Seed))
+    {
+        Seed = MakeRandomSeed();
+    }
+    if (!Infinite)
+    {
+        Infinite.reset(new FInfiniteBoard());
+    }
+    if (!Infinite->SetGameParams(Mines))
+    {
+        Reply += "err board\n";
+        return;
+    }
+    Game.EraseMemory();
+    Infinite->Reset(Seed);
+    bHasGame = true;
+    bInfinite = true;
+    Reply += "ok new infinite ";
+    AppendNumber(Reply, Mines);
+    Reply += ' ';
+    AppendNumber(Reply, Seed);
+    Reply += '\n';
+}
+
+void FCommandSession::RevealInfinite(FCommandTokenizer& Tokenizer, std::string& Reply)
+{
+    int X = 0, Y = 0;
+    if (!ReadInfiniteCell(Tokenizer, X, Y, Reply))
+    {
+        return;
+    }
+    char Cell = Infinite->GetUserCell(X, Y);
+    if (Cell != '-')
+    {
+        Reply += (Cell == 'F') ? "err flagged\n" : "err repeated\n";
+        return;
+    }
+    const std::vector<FInfiniteCell>& Revealed = Infinite->Reveal(X, Y);
+    AppendStatus(Reply);
+    AppendNumber(Reply, Revealed.size());
+    for (const FInfiniteCell& RevealedCell : Revealed)
+    {
+        AppendInfiniteCell(RevealedCell.X, RevealedCell.Y, Reply);
+    }
+    Reply += Infinite->IsRevealComplete() ? "\n" : " partial\n";
+}
+
+void FCommandSession::FlagInfinite(FCommandTokenizer& Tokenizer, std::string& Reply)
+{
+    int X = 0, Y = 0;
+    if (!ReadInfiniteCell(Tokenizer, X, Y, Reply))
+    {
+        return;
+    }
+    if (!Infinite->SetCellFlag(X, Y, Infinite->GetUserCell(X, Y) != 'F'))
+    {
+        Reply += "err shown\n";
+        return;
+    }
+    Reply += "ok flag";
+    AppendInfiniteCell(X, Y, Reply);
+    Reply += '\n';
+}
+
+/// ok STATUS infinite M TILES SHOWN SEED
+void FCommandSession::AppendInfiniteState(std::string& Reply) const
+{
+    FInfiniteStats Stats = Infinite->GetStats();
+    AppendStatus(Reply);
+    Reply += "infinite ";
+    AppendNumber(Reply, Infinite->GetMinesPerTile());
+    Reply += ' ';
+    AppendNumber(Reply, Stats.CountedTiles);
+    Reply += ' ';
+    AppendNumber(Reply, Stats.CellsShown);
+    Reply += ' ';
+    AppendNumber(Reply, Infinite->GetSeed());
+    Reply += '\n';
+}
+
+/// board X Y W H: ok board H, followed by every row of the window. Cells that were never explored are not created.
+void FCommandSession::AppendInfiniteBoard(FCommandTokenizer& Tokenizer, std::string& Reply) const
+{
+    int X = 0, Y = 0, Width = 0, Height = 0;
+    if (!Tokenizer.NextSignedInt(X) || !Tokenizer.NextSignedInt(Y) || !Tokenizer.NextInt(Width) || !Tokenizer.NextInt(Height))
+    {
+        Reply += "err arguments\n";
+        return;
+    }
+    if (Width == 0 || Height == 0 || (int64_t) Width * Height > COMMAND_MAX_WINDOW_CELLS
+        || !FInfiniteBoard::IsCellValid(X, Y) || !FInfiniteBoard::IsCellValid((int64_t) X + Width - 1, (int64_t) Y + Height - 1))
+    {
+        Reply += "err range\n";
+        return;
+    }
+    Reply += "ok board ";
+    AppendNumber(Reply, Height);
+    Reply += '\n';
+    for (int y = Y; y < Y + Height; y++)
+    {
+        for (int x = X; x < X + Width; x++)
+        {
+            Reply += Infinite->GetUserCell(x, y);
+        }
+        Reply += '\n';
+    }
+}
+
+/// " X,Y,C" of a cell of the infinite game
+void FCommandSession::AppendInfiniteCell(int X, int Y, std::string& Reply) const
+{
+    Reply += ' ';
+    AppendSignedNumber(Reply, X);
+    Reply += ',';
+    AppendSignedNumber(Reply, Y);
+    Reply += ',';
+    Reply += Infinite->GetUserCell(X, Y);
+}
+
+/// Same as ReadCell, with coordinates that may be negative
+bool FCommandSession::ReadInfiniteCell(FCommandTokenizer& Tokenizer, int& X, int& Y, std::string& Reply) const
+{
+    if (Infinite->GetGameStatus() != EGameStatus::KeepPlaying)
+    {
+        Reply += "err over\n";
+        return false;
+    }
+    if (!Tokenizer.NextSignedInt(X) || !Tokenizer.NextSignedInt(Y))
+    {
+        Reply += "err arguments\n";
+        return false;
+    }
+    if (!FInfiniteBoard::IsCellValid(X, Y))
+    {
+        Reply += "err range\n";
+        return false;
+    }
+    return true;
+}
+
+/// Stream
+
+/// Write the whole buffer, retrying on partial writes
+static bool WriteAll(int OutputFile, std::string& Buffer)
+{
+    const char* Data = Buffer.data();
+    size_t Left = Buffer.size();
+    while (Left > 0)
+    {
+        long Written = (long) write(OutputFile, Data, (unsigned) Left);
+        if (Written <= 0)
+        {
+#ifndef _WIN32
+            if (Written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+#endif
+            return false;
+        }
+        Data += Written;
+        Left -= (size_t) Written;
+    }
+    Buffer.clear();
+    return true;
+}
+
+/// Read as much input as is available, run every complete line and send the replies before waiting for more input,
+/// so a bot that waits for each reply is never blocked while scripts still get big batches.
+bool RunCommandStream(int InputFile, int OutputFile, FGameJournal* Journal, FGameMetrics* Metrics)
+{
+    FCommandSession Session;
+    Session.SetJournal(Journal);
+    Session.SetMetrics(Metrics);
+    std::vector<char> Input(COMMAND_READ_BYTES);
+    std::string Replies;
+    Replies.reserve(2 * COMMAND_WRITE_BYTES);
+    size_t Pending = 0;                 // Bytes of an incomplete line kept at the start of Input
+
+    while (true)
+    {
+        if (Pending == Input.size())    // A line longer than the buffer (up to COMMAND_MAX_LINE), make room for it
+        {
+            Input.resize(Input.size() * 2);
+        }
+        long Count = (long) read(InputFile, Input.data() + Pending, (unsigned) (Input.size() - Pending));
+        if (Count < 0)
+        {
+#ifndef _WIN32
+            if (errno == EINTR)
+            {
+                continue;
+            }
+#endif
+            return false;
+        }
+        if (Count == 0)                 // End of the input: run the last line even without its end
+        {
+            if (Pending > 0)
+            {
+                Session.RunCommand(Input.data(), Input.data() + Pending, Replies);
+            }
+            return WriteAll(OutputFile, Replies);
+        }
+
+        const char* Line = Input.data();
+        const char* End = Input.data() + Pending + Count;
+        bool bQuit = false;
+        do                              // Replies are sent each time they fill a batch
+        {
+            Line += Session.RunCommands(Line, End, Replies, bQuit);
+            if (!WriteAll(OutputFile, Replies))
+            {
+                return false;
+            }
+        } while (!bQuit && memchr(Line, '\n', End - Line) != nullptr);
+        if (bQuit)
+        {
+            return true;
+        }
+        Pending = End - Line;
+        if (Pending > COMMAND_MAX_LINE) // Never ending line: stop there, so it can not fill the memory
+        {
+            Replies += "err line\n";
+            return WriteAll(OutputFile, Replies);
+        }
+        memmove(Input.data(), Line, Pending);
+    }
+}
+
+void AppendNumber(std::string& Out, uint64_t Value)
+{
+    char Digits[20];
+    int Count = 0;
+    do
+    {
+        Digits[Count++] = (char) ('0' + Value % 10);
+        Value /= 10;
+    } while (Value > 0);
+    while (Count > 0)
+    {
+        Out += Digits[--Count];
+    }
+}
@@ -0,0 +1,110 @@
+/* Line oriented command protocol, to play without prompts from scripts, bots and test harnesses.
+
+Each line is a command of words separated by spaces, and gets a reply of one line (board adds the rows of the board after it).
+Empty lines and lines starting with # are skipped without reply.
+    new W H M [SEED] [safe | noguess]   Starts a game on a W x H board with M mines   ok new W H M SEED
+                        (with safe, the mines are placed on the first reveal, away from it. With noguess, revealing the
+                        centre cell W/2, H/2 first, the board can be cleared without guessing: err noguess if none is found)
+    new infinite M [SEED]   Starts an infinite game (InfiniteBoard.h) with M mines on each tile      ok new infinite M SEED
+    reveal X Y          Reveals a cell                                       ok STATUS N X,Y,C ... (the N cells that changed)
+    flag X Y            Flags the cell, or unflags it if it was flagged      ok flag X,Y,C
+    chord X Y           Reveals the hidden neighbours of a number whose      ok STATUS N X,Y,C ... (N is 0 if its flags
+                        flags are all placed (not on infinite games)         are not as many as its number)
+    undo                Takes back the last move (not on infinite games)     ok STATUS N X,Y,C ... (the cells it changed)
+    redo                Plays again the last move undone                     ok STATUS N X,Y,C ...
+    state               Status of the game                                   ok STATUS W H MINES SPACES_LEFT SEED
+    board               User board                                           ok board H, and H lines of W chars
+On an infinite game X and Y may be negative, and a reveal opens INFINITE_MAX_REVEAL cells at most: a reveal that stops there ends its
+reply with partial, and a reveal of a hidden cell on the edge of the area goes on from it. state replies
+ok STATUS infinite M TILES SHOWN SEED (tiles counted and cells displayed), and board needs the window to print:
+    board X Y W H       The W x H cells from X, Y                            ok board H, and H lines of W chars
+    quit                Stops reading commands                               ok quit
+STATUS is play, won or lost, and C is the char of the cell on the User board. Errors are replied as "err REASON".
+A session can be hibernated between commands (Hibernate): its game is saved to a file (GameSnapshot.h) and its board freed, and the
+next command loads it again first, so the client does not notice. The moves to undo and redo stay in memory.
+Commands are read and replies are written in big batches, the parser does not allocate memory.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <string>
+#include <cstdint>
+#include <memory>
+#include "Minesweeper.h"
+#include "InfiniteBoard.h"
+#include "GameHistory.h"
+
+#define COMMAND_READ_BYTES 65536    // Bytes read from the input at once
+#define COMMAND_WRITE_BYTES 65536   // Replies are sent when they reach this size, or when the input has to wait
+#define COMMAND_MAX_WINDOW_CELLS 65536  // Cells of the window printed by board on an infinite game
+#define COMMAND_MAX_LINE 65536      // Longest line accepted: a longer one gets "err line" and ends the input
+
+/// Splits a line into words, pointing into the line instead of copying them
+class FCommandTokenizer
+{
+    public:
+        FCommandTokenizer(const char* Begin, const char* End) : Cursor(Begin), LineEnd(End) { }
+
+        /// Rest of functions
+        bool NextWord(const char*&, int&);      // Start and length of the next word. Returns false at the end of the line.
+        bool NextInt(int&);                     // Next word as a non negative int. Returns false if it is not one.
+        bool NextSignedInt(int&);               // Same, but it may be negative
+        bool NextUInt64(uint64_t&);
+        bool IsWord(const char*, int, const char*) const;
+
+    private:
+        const char* Cursor;
+        const char* LineEnd;
+};
+
+/// A game driven by commands. Each session has its own game, so sessions can run on different threads.
+class FCommandSession
+{
+    public:
+        ~FCommandSession();         // Removes the file of a hibernated game
+
+        /// Rest of functions
+        bool RunCommand(const char*, const char*, std::string&);   // Runs the line [Begin, End) and appends its reply. Returns false on quit.
+        size_t RunCommands(const char*, const char*, std::string&, bool&);   // Every complete line, see CommandProtocol.cpp
+        void SetBoardPipeline(FBoardPipeline*);                     // new without a seed takes its board from the pipeline
+        void SetJournal(FGameJournal*);                             // Records the games of the session (check GameJournal.h)
+        void SetMetrics(FGameMetrics*);                             // Times and counts the games of the session (check GameMetrics.h)
+        bool Hibernate(const std::string&);     // Saves the game to the file and frees the board. Returns false if there is no game
+                                                // or it is infinite.
+
+    private:
+        FMineSweeper Game;
+        bool bHasGame = false;
+        std::unique_ptr<FInfiniteBoard> Infinite;   // Only created by the first infinite game of the session
+        bool bInfinite = false;                 // The current game is the infinite one, the commands go to it
+        std::string HibernatedPath;             // File of the game while the session is hibernated, empty otherwise
+        std::unique_ptr<FGameHistory> History;  // Moves of the game to undo, created by the first game of the session
+
+        /// Rest of functions
+        void Wake();
+        void NewGame(FCommandTokenizer&, std::string&);
+        void Reveal(FCommandTokenizer&, std::string&);
+        void Flag(FCommandTokenizer&, std::string&);
+        void Chord(FCommandTokenizer&, std::string&);
+        void Undo(bool, std::string&);
+        void NewInfiniteGame(FCommandTokenizer&, std::string&);
+        void RevealInfinite(FCommandTokenizer&, std::string&);
+        void FlagInfinite(FCommandTokenizer&, std::string&);
+        void AppendInfiniteState(std::string&) const;
+        void AppendInfiniteBoard(FCommandTokenizer&, std::string&) const;
+        void AppendInfiniteCell(int, int, std::string&) const;
+        bool ReadInfiniteCell(FCommandTokenizer&, int&, int&, std::string&) const;
+        void AppendStatus(std::string&) const;
+        void AppendState(std::string&) const;
+        void AppendBoard(std::string&) const;
+        void AppendCell(int, std::string&) const;
+        bool ReadCell(FCommandTokenizer&, int&, std::string&) const;
+};
+
+/// Runs every command read from InputFile, writing the replies to OutputFile (file descriptors), recording the games on the journal
+/// and on the metrics if there are. Returns false on a read or write error.
+bool RunCommandStream(int, int, FGameJournal* = nullptr, FGameMetrics* = nullptr);
+
+/// Appends a non negative number as text, without allocating if Out has room
+void AppendNumber(std::string&, uint64_t);
@@ -0,0 +1,122 @@
+/* Kernels specialized at compile time for the board sizes of the difficulties, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "FixedBoardKernels.h"
+#include "Minesweeper.h"
+#include <array>
+
+#define NEIGHBOUR_COUNT 8
+
+/// Bit k of the mask of a cell is set if its neighbour k exists. Neighbours are numbered row by row: up left, up, up right,
+/// left, right, down left, down, down right.
+template <int Width, int Height>
+constexpr std::array<uint8_t, Width * Height> MakeBorderMasks()
+{
+    std::array<uint8_t, Width * Height> Masks{};
+    for (int y = 0; y < Height; y++)
+    {
+        for (int x = 0; x < Width; x++)
+        {
+            bool bUp = y > 0, bDown = y < Height - 1, bLeft = x > 0, bRight = x < Width - 1;
+            Masks[x + y * Width] = (uint8_t) ((bUp && bLeft) << 0 | bUp << 1 | (bUp && bRight) << 2 | bLeft << 3 | bRight << 4
+                                              | (bDown && bLeft) << 5 | bDown << 6 | (bDown && bRight) << 7);
+        }
+    }
+    return Masks;
+}
+
+/// Constants of a Width x Height board
+template <int Width, int Height>
+struct FFixedBoard
+{
+    static constexpr int Size = Width * Height;
+    static constexpr int PaddedWidth = Width + 2;       // Mine bits with a border of empty cells, so no cell is on a border
+    static constexpr int Offsets[NEIGHBOUR_COUNT] = { -Width - 1, -Width, -Width + 1, -1, 1, Width - 1, Width, Width + 1 };
+    static constexpr std::array<uint8_t, Width * Height> BorderMasks = MakeBorderMasks<Width, Height>();
+};
+
+/// 3x3 box sum of the mine bits, on a copy of the mines with an empty border around the board
+template <int Width, int Height>
+static void CountNearbyMinesFixed(uint8_t* Cells)
+{
+    typedef FFixedBoard<Width, Height> FBoard;
+    uint8_t Padded[(Height + 2) * FBoard::PaddedWidth] = {};
+    for (int y = 0; y < Height; y++)
+    {
+        for (int x = 0; x < Width; x++)
+        {
+            Padded[(y + 1) * FBoard::PaddedWidth + x + 1] = Cells[x + y * Width] & CELL_MINE;
+        }
+    }
+    for (int y = 0; y < Height; y++)
+    {
+        for (int x = 0; x < Width; x++)
+        {
+            const uint8_t* Up = Padded + y * FBoard::PaddedWidth + x;
+            const uint8_t* Mid = Up + FBoard::PaddedWidth;
+            const uint8_t* Down = Mid + FBoard::PaddedWidth;
+            int Count = Up[0] + Up[1] + Up[2] + Mid[0] + Mid[2] + Down[0] + Down[1] + Down[2];
+            uint8_t& Cell = Cells[x + y * Width];
+            Cell = (uint8_t) ((Cell & ((1 << CELL_COUNT_SHIFT) - 1)) | (Count << CELL_COUNT_SHIFT));
+        }
+    }
+}
+
+/// Same flood fill as FMineSweeper::SetCellUserVisitedBoard. The neighbours of a cell without mines nearby have no mine,
+/// so only the visited and flagged ones are skipped. Each cell is pushed once, so the stack fits on the board size.
+template <int Width, int Height>
+static int FloodFillFixed(uint8_t* Cells, int Index, std::vector<int>& Revealed)
+{
+    typedef FFixedBoard<Width, Height> FBoard;
+    int Stack[FBoard::Size];
+    int Top = 0;
+    size_t First = Revealed.size();
+    Cells[Index] |= CELL_VISITED;
+    Stack[Top++] = Index;
+    while (Top > 0)
+    {
+        int Cell = Stack[--Top];
+        Cells[Cell] |= CELL_SHOWN;
+        Revealed.push_back(Cell);
+        if ((Cells[Cell] >> CELL_COUNT_SHIFT) != 0)
+        {
+            continue;
+        }
+        uint8_t Mask = FBoard::BorderMasks[Cell];
+        for (int k = 0; k < NEIGHBOUR_COUNT; k++)
+        {
+            int Neighbour = Cell + FBoard::Offsets[k];
+            if (((Mask >> k) & 1) && (Cells[Neighbour] & (CELL_VISITED | CELL_FLAG)) == 0)
+            {
+                Cells[Neighbour] |= CELL_VISITED;
+                Stack[Top++] = Neighbour;
+            }
+        }
+    }
+    return (int) (Revealed.size() - First);
+}
+
+#define FIXED_BOARD(Width, Height) { Width, Height, CountNearbyMinesFixed<Width, Height>, FloodFillFixed<Width, Height> }
+
+/// Sizes of the difficulties of FMineSweeper::SetGameParams(int)
+static const FFixedBoardKernels FixedBoards[] =
+{
+    FIXED_BOARD(4, 4),
+    FIXED_BOARD(5, 5),
+    FIXED_BOARD(7, 7),
+    FIXED_BOARD(9, 9)
+};
+
+const FFixedBoardKernels* FindFixedBoardKernels(int Width, int Height)
+{
+    for (const FFixedBoardKernels& Kernels : FixedBoards)
+    {
+        if (Kernels.Width == Width && Kernels.Height == Height)
+        {
+            return &Kernels;
+        }
+    }
+    return nullptr;
+}
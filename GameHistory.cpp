@@ -0,0 +1,150 @@
+/* Undo and redo of the moves of an FMineSweeper, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "GameHistory.h"
+
+/// Getters
+int FGameHistory::GetNumMoves() const { return Moves.empty() ? 0 : (int) Moves.size() - 1; }
+int FGameHistory::GetCurrentMove() const { return CurrentMove; }
+
+const int* FGameHistory::GetMoveCells(int Move, size_t& NumCells) const
+{
+    NumCells = 0;
+    if (Move < 1 || Move > GetNumMoves())
+    {
+        return nullptr;
+    }
+    NumCells = Moves[Move].EndCell - Moves[Move - 1].EndCell;
+    return CellIndices.data() + Moves[Move - 1].EndCell;
+}
+
+size_t FGameHistory::GetMemoryBytes() const
+{
+    size_t Bytes = Moves.capacity() * sizeof(FHistoryMove) + CellIndices.capacity() * sizeof(int) + CellMasks.capacity();
+    for (const FHistoryCheckpoint& Checkpoint : Checkpoints)
+    {
+        Bytes += Checkpoint.Cells.capacity();
+    }
+    return Bytes;
+}
+
+/// Rest of functions
+
+/// The memory of the log is kept for the next game
+void FGameHistory::Clear(int InBoardSize, const FGameStats& Results, EGameStatus Status, bool bMineShown)
+{
+    BoardSize = InBoardSize;
+    CurrentMove = 0;
+    CellIndices.clear();
+    CellMasks.clear();
+    Checkpoints.clear();
+    MinesMove = 0;
+    MinesCell = -1;
+    Moves.resize(1);
+    Moves[0].EndCell = 0;
+    Moves[0].Results = Results;
+    Moves[0].Status = Status;
+    Moves[0].bMineShown = bMineShown;
+}
+
+void FGameHistory::AddCell(int Index, uint8_t Mask)
+{
+    if (Mask == 0)
+    {
+        return;
+    }
+    DropRedo();
+    CellIndices.push_back(Index);
+    CellMasks.push_back(Mask);
+}
+
+/// A checkpoint is taken when the cells changed since the previous one (or since the start) reach the board size
+void FGameHistory::EndMove(const uint8_t* Cells, const FGameStats& Results, EGameStatus Status, bool bMineShown)
+{
+    if (Moves.empty())
+    {
+        return;
+    }
+    const FHistoryMove& Last = Moves[CurrentMove];
+    bool bNoCells = CellIndices.size() == Moves.back().EndCell;     // AddCell drops the moves to redo before adding a cell
+    if (bNoCells && Results.NumSpacesLeft == Last.Results.NumSpacesLeft
+        && Results.NumMinesLeft == Last.Results.NumMinesLeft && Results.NumFlags == Last.Results.NumFlags
+        && Status == Last.Status && bMineShown == Last.bMineShown)
+    {
+        return;
+    }
+    DropRedo();                         // Only a move that changed something drops the moves to redo
+    FHistoryMove Move;
+    Move.EndCell = CellIndices.size();
+    Move.Results = Results;
+    Move.Status = Status;
+    Move.bMineShown = bMineShown;
+    Moves.push_back(Move);
+    CurrentMove++;
+
+    size_t CheckpointCell = Checkpoints.empty() ? 0 : Moves[Checkpoints.back().Move].EndCell;
+    if (Move.EndCell - CheckpointCell >= (size_t) BoardSize)
+    {
+        Checkpoints.emplace_back();
+        FHistoryCheckpoint& Checkpoint = Checkpoints.back();
+        Checkpoint.Move = CurrentMove;
+        Checkpoint.Cells.resize(BoardSize);
+        for (int i = 0; i < BoardSize; i++)
+        {
+            Checkpoint.Cells[i] = Cells[i] & HISTORY_CELL_BITS;
+        }
+    }
+}
+
+/// Restoring a checkpoint costs the board size, plus the cells from its move to the one wanted
+int FGameHistory::FindCheckpoint(int Move) const
+{
+    size_t BestCost = GetCellsBetween(CurrentMove, Move);
+    int Best = -1;
+    for (int i = 0; i < (int) Checkpoints.size(); i++)
+    {
+        size_t Cost = (size_t) BoardSize + GetCellsBetween(Checkpoints[i].Move, Move);
+        if (Cost < BestCost)
+        {
+            BestCost = Cost;
+            Best = i;
+        }
+    }
+    return Best;
+}
+
+/// Dropping the moves to redo first, as the move that places the mines is being played
+void FGameHistory::SetMinesPlaced(int Cell)
+{
+    DropRedo();
+    MinesMove = CurrentMove + 1;
+    MinesCell = Cell;
+}
+
+/// The moves after the current one can not be redone once another move is played
+void FGameHistory::DropRedo()
+{
+    if (CurrentMove + 1 >= (int) Moves.size())
+    {
+        return;
+    }
+    Moves.resize(CurrentMove + 1);
+    CellIndices.resize(Moves.back().EndCell);
+    CellMasks.resize(Moves.back().EndCell);
+    while (!Checkpoints.empty() && Checkpoints.back().Move > CurrentMove)
+    {
+        Checkpoints.pop_back();
+    }
+    if (MinesMove > CurrentMove)        // The mines are not placed at the current move, the next first click places them again
+    {
+        MinesMove = 0;
+        MinesCell = -1;
+    }
+}
+
+size_t FGameHistory::GetCellsBetween(int From, int To) const
+{
+    return (From < To) ? Moves[To].EndCell - Moves[From].EndCell : Moves[From].EndCell - Moves[To].EndCell;
+}
@@ -0,0 +1,80 @@
+/* Undo and redo of the moves of an FMineSweeper, on a log of what each move changed.
+
+A game with a history (FMineSweeper::SetHistory) adds to it, on every move, each cell whose state bits (HISTORY_CELL_BITS) the move
+flipped, as the cell and a mask of those bits, and after the move its results and status. Undoing or redoing a move flips the same
+bits again, so it costs the cells the move changed and not the size of the board. The nearby mines counts are never undone: once
+a row is counted its counts stay right.
+A move ends on SetGameStatus or SetCellFlag, so a reveal (SetCellUserBoard, SetCellUserVisitedBoard, SetGameStatus) or a chord is a
+single move. A move played after an undo drops the moves that could be redone.
+Each time the cells changed since the last checkpoint reach the board size, the state bits of every cell are copied as a checkpoint
+(so checkpoints take less memory than the log). A jump to any move (FMineSweeper::GoToMove) starts from the checkpoint or the current
+move with the fewest cells to flip, so it never costs much more than twice the board size, however many moves it jumps.
+Reset, Restart, MoveMine and loading a snapshot start the history again (FMineSweeper::ResumeHistory keeps it when the game loaded is
+the one saved, as a hibernated session does). Undoing the first click of a first click safe game removes the
+mines it placed, so the next first click is safe again, and redoing it places the same mines (they depend on the seed and the cell).
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Minesweeper.h"
+
+#define HISTORY_CELL_BITS (CELL_SHOWN | CELL_VISITED | CELL_FLAG)   // Bits of a cell that a move may change
+
+/// State of the game after a move
+struct FHistoryMove
+{
+    size_t EndCell = 0;             // End of the cells it changed on the log, they start at the end of the previous move
+    FGameStats Results;
+    EGameStatus Status = EGameStatus::KeepPlaying;
+    bool bMineShown = false;
+};
+
+/// State bits of every cell after a move
+struct FHistoryCheckpoint
+{
+    int Move = 0;
+    std::vector<uint8_t> Cells;
+};
+
+/// Log of the moves of the current game of one FMineSweeper. It must outlive the games that record on it.
+class FGameHistory
+{
+    public:
+        FGameHistory() { }
+        FGameHistory(const FGameHistory&) = delete;
+        FGameHistory& operator=(const FGameHistory&) = delete;
+
+        /// Getters
+        int GetNumMoves() const;            // Moves recorded, the undone ones included
+        int GetCurrentMove() const;         // Moves played (and not undone) since the start of the game
+        const int* GetMoveCells(int, size_t&) const;    // Cells changed by a move (1 to GetNumMoves), one entry per step that
+                                                        // changed them, and their number
+        size_t GetMemoryBytes() const;      // Of the log and the checkpoints
+
+        /// Rest of functions
+        void Clear(int, const FGameStats&, EGameStatus, bool);     // Start again, on a game of that board size in the given state
+        void AddCell(int, uint8_t);         // Bits of a cell flipped by the move being played
+        void EndMove(const uint8_t*, const FGameStats&, EGameStatus, bool);    // The move ends with the cells and the state given.
+                                                                               // A move that changed nothing is not recorded.
+        int FindCheckpoint(int) const;      // Checkpoint to restore to reach a move, -1 if flipping from the current move is cheaper
+        void SetMinesPlaced(int);           // The move being played placed the mines of a first click safe game, on its click on a cell
+
+    private:
+        int BoardSize = 0;
+        int CurrentMove = 0;
+        std::vector<FHistoryMove> Moves;                // Moves[0] is the state at the start of the game
+        std::vector<int> CellIndices;                   // Cells changed by every move, in order
+        std::vector<uint8_t> CellMasks;                 // Bits flipped on each of them
+        std::vector<FHistoryCheckpoint> Checkpoints;    // In order of their move
+        int MinesMove = 0;                              // Move that placed the mines of a first click safe game, 0 if they were
+        int MinesCell = -1;                             // placed before the history started, and the cell of its first click
+
+        void DropRedo();
+        size_t GetCellsBetween(int, int) const;
+
+        friend class FMineSweeper;          // Flips the cells of the moves and restores the checkpoints
+};
@@ -0,0 +1,300 @@
+/* Append-only journal of the games played on an FMineSweeper, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "GameJournal.h"
+#include "GameSnapshot.h"
+#include <chrono>
+#include <cstring>
+
+#define JOURNAL_HEADER_BYTES 5          // Magic and version byte
+#define JOURNAL_TYPE_MASK 0x7F          // Bits of the type of a record, without JOURNAL_SAME_CELL
+
+FGameJournal::~FGameJournal()
+{
+    Close();
+}
+
+/// Getters
+bool FGameJournal::IsOpen() const { return File != nullptr; }
+
+bool FGameJournal::IsChecksumDue(bool bGameOver) const
+{
+    return MovesSinceChecksum > 0 && (bGameOver || (ChecksumInterval > 0 && MovesSinceChecksum >= ChecksumInterval));
+}
+
+///Setters
+void FGameJournal::SetChecksumInterval(int Moves) { ChecksumInterval = Moves > 0 ? Moves : 0; }
+
+/// Rest of functions
+
+/// A new file starts with the magic and the version, an existing one gets the new records at its end
+bool FGameJournal::Open(const char* Path)
+{
+    Close();
+    File = fopen(Path, "ab");
+    if (File == nullptr)
+    {
+        return false;
+    }
+    fseek(File, 0, SEEK_END);
+    if (ftell(File) == 0)
+    {
+        Buffer.insert(Buffer.end(), JOURNAL_MAGIC, JOURNAL_MAGIC + 4);
+        Buffer.push_back(JOURNAL_VERSION);
+    }
+    LastCell = -1;
+    MovesSinceChecksum = 0;
+    return true;
+}
+
+bool FGameJournal::Flush()
+{
+    if (File == nullptr || Buffer.empty())
+    {
+        return true;
+    }
+    bool bWritten = fwrite(Buffer.data(), 1, Buffer.size(), File) == Buffer.size() && fflush(File) == 0;
+    Buffer.clear();
+    return bWritten;
+}
+
+void FGameJournal::Close()
+{
+    if (File != nullptr)
+    {
+        Flush();
+        fclose(File);
+        File = nullptr;
+    }
+    Buffer.clear();
+}
+
+void FGameJournal::RecordStart(const FMineSweeper& Game, bool bMinesOnFirstClick, int SafeIndex)
+{
+    if (File == nullptr)
+    {
+        return;
+    }
+    LastTime = GetTime();
+    Buffer.push_back((uint8_t) EJournalRecord::Start);
+    AppendNumber((uint64_t) LastTime);
+    AppendNumber((uint64_t) Game.GetBoardWidth());
+    AppendNumber((uint64_t) Game.GetBoardHeight());
+    AppendNumber((uint64_t) Game.GetNumMines());
+    AppendNumber(bMinesOnFirstClick ? JOURNAL_START_FIRST_CLICK_SAFE : 0);
+    AppendNumber(Game.GetSeed());
+    AppendNumber((uint64_t) (SafeIndex + 1));
+    LastCell = -1;
+    MovesSinceChecksum = 0;
+    if (Buffer.size() >= JOURNAL_FLUSH_BYTES)
+    {
+        Flush();
+    }
+}
+
+void FGameJournal::RecordSnapshot(const FMineSweeper& Game)
+{
+    SnapshotBuffer.clear();
+    if (File == nullptr || !SaveGameSnapshot(Game, SnapshotBuffer))
+    {
+        return;
+    }
+    LastTime = GetTime();
+    Buffer.push_back((uint8_t) EJournalRecord::Snapshot);
+    AppendNumber((uint64_t) LastTime);
+    AppendNumber(SnapshotBuffer.size());
+    Buffer.insert(Buffer.end(), SnapshotBuffer.begin(), SnapshotBuffer.end());
+    LastCell = -1;
+    MovesSinceChecksum = 0;
+    if (Buffer.size() >= JOURNAL_FLUSH_BYTES)
+    {
+        Flush();
+    }
+}
+
+/// Restart has no cell. The cell of a move on the same cell as the previous one (show, visit and status of each click) is left out.
+void FGameJournal::RecordMove(EJournalRecord Type, int Cell, int Target)
+{
+    if (File == nullptr)
+    {
+        return;
+    }
+    int64_t Now = GetTime();
+    bool bSameCell = Type == EJournalRecord::Restart || Cell == LastCell;
+    Buffer.push_back((uint8_t) ((uint8_t) Type | (bSameCell ? JOURNAL_SAME_CELL : 0)));
+    if (!bSameCell)
+    {
+        AppendNumber((uint64_t) Cell);
+        LastCell = Cell;
+    }
+    AppendNumber((uint64_t) (Now > LastTime ? Now - LastTime : 0));
+    LastTime = Now > LastTime ? Now : LastTime;
+    if (Type == EJournalRecord::MoveMine)
+    {
+        AppendNumber((uint64_t) Target);
+    }
+    MovesSinceChecksum++;
+    if (Buffer.size() >= JOURNAL_FLUSH_BYTES)
+    {
+        Flush();
+    }
+}
+
+void FGameJournal::RecordChecksum(uint64_t Hash)
+{
+    if (File == nullptr)
+    {
+        return;
+    }
+    Buffer.push_back((uint8_t) EJournalRecord::Checksum);
+    AppendNumber(Hash);
+    MovesSinceChecksum = 0;
+}
+
+/// LEB128: 7 bits per byte, lowest first, the high bit set on every byte but the last
+void FGameJournal::AppendNumber(uint64_t Number)
+{
+    while (Number >= 0x80)
+    {
+        Buffer.push_back((uint8_t) (Number | 0x80));
+        Number >>= 7;
+    }
+    Buffer.push_back((uint8_t) Number);
+}
+
+int64_t FGameJournal::GetTime() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/// Reads the numbers of the records, failing on a truncated journal
+struct FJournalReader
+{
+    const uint8_t* Data;
+    size_t Size;
+    size_t Position;
+
+    bool ReadNumber(uint64_t& Number)
+    {
+        Number = 0;
+        for (int Shift = 0; Shift < 64 && Position < Size; Shift += 7)
+        {
+            uint8_t Byte = Data[Position++];
+            Number |= (uint64_t) (Byte & 0x7F) << Shift;
+            if ((Byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/// Replay the moves on a game without journal, so nothing is written. The times are skipped: the moves are played as fast as possible.
+bool ReplayJournal(const uint8_t* Data, size_t Size, FReplayStats& Stats)
+{
+    if (Size < JOURNAL_HEADER_BYTES || memcmp(Data, JOURNAL_MAGIC, 4) != 0 || Data[4] != JOURNAL_VERSION)
+    {
+        Stats.Error = "not a journal of this version";
+        return false;
+    }
+    FJournalReader Reader{Data, Size, JOURNAL_HEADER_BYTES};
+    FMineSweeper Game;
+    bool bHasGame = false;
+    bool bMatches = true;
+    uint64_t Games = 0, Moves = 0;                  // Of this journal, to locate the errors
+    int LastCell = -1;
+    while (Reader.Position < Size)
+    {
+        uint8_t TypeByte = Data[Reader.Position++];
+        EJournalRecord Type = (EJournalRecord) (TypeByte & JOURNAL_TYPE_MASK);
+        uint64_t Time, Number[6];
+        bool bValid = true;
+        if (Type == EJournalRecord::Start)
+        {
+            bValid = Reader.ReadNumber(Time);
+            for (int i = 0; i < 6 && bValid; i++)               // Width, height, mines, flags, seed and safe cell + 1
+            {
+                bValid = Reader.ReadNumber(Number[i]);
+            }
+            bValid = bValid && Number[0] <= INT32_MAX && Number[1] <= INT32_MAX && Number[2] <= INT32_MAX && Number[5] <= INT32_MAX;
+            bValid = bValid && Game.SetGameParams((int) Number[0], (int) Number[1], (int) Number[2]);
+            if (bValid)
+            {
+                Game.SetFirstClickSafe((Number[3] & JOURNAL_START_FIRST_CLICK_SAFE) != 0);
+                bValid = Number[5] == 0 ? Game.Reset(Number[4]) : Game.Reset(Number[4], (int) Number[5] - 1);
+            }
+            bHasGame = bValid;
+            LastCell = -1;
+            Games++, Stats.Games++;
+        }
+        else if (Type == EJournalRecord::Snapshot)
+        {
+            bValid = Reader.ReadNumber(Time) && Reader.ReadNumber(Number[0]) && Number[0] <= Size - Reader.Position;
+            bValid = bValid && LoadGameSnapshot(Game, Data + Reader.Position, (size_t) Number[0]);
+            Reader.Position += bValid ? (size_t) Number[0] : 0;
+            bHasGame = bValid;
+            LastCell = -1;
+            Games++, Stats.Games++;
+        }
+        else if (Type == EJournalRecord::Checksum)
+        {
+            bValid = Reader.ReadNumber(Number[0]) && bHasGame;
+            Stats.Checksums += bValid;
+            if (bValid && Number[0] != Game.GetStateHash())
+            {
+                Stats.Mismatches++;
+                if (bMatches && Stats.Error.empty())
+                {
+                    Stats.Error = "game " + std::to_string(Games) + ", move " + std::to_string(Moves) + ": the state does not match";
+                }
+                bMatches = false;
+            }
+        }
+        else if ((Type >= EJournalRecord::ShowCell && Type <= EJournalRecord::Restart) || Type == EJournalRecord::Chord)
+        {
+            uint64_t Cell = (uint64_t) LastCell;
+            if ((TypeByte & JOURNAL_SAME_CELL) == 0)
+            {
+                bValid = Reader.ReadNumber(Cell);
+            }
+            bValid = bValid && Reader.ReadNumber(Time);
+            Number[0] = 0;
+            if (Type == EJournalRecord::MoveMine)
+            {
+                bValid = bValid && Reader.ReadNumber(Number[0]) && Number[0] < (uint64_t) Game.GetBoardSize();
+            }
+            bValid = bValid && bHasGame && (Type == EJournalRecord::Restart || Cell < (uint64_t) Game.GetBoardSize());
+            if (bValid)
+            {
+                int Index = (int) Cell;
+                switch (Type)
+                {
+                    case EJournalRecord::ShowCell:  Game.SetCellUserBoard(Index); break;
+                    case EJournalRecord::VisitCell: Game.SetCellUserVisitedBoard(Index); break;
+                    case EJournalRecord::GameStatus: Game.SetGameStatus(Index); break;
+                    case EJournalRecord::Flag:      Game.SetCellFlag(Index, true); break;
+                    case EJournalRecord::Unflag:    Game.SetCellFlag(Index, false); break;
+                    case EJournalRecord::MoveMine:  Game.MoveMine(Index, (int) Number[0]); break;
+                    case EJournalRecord::Chord:     Game.ChordCell(Index); break;
+                    default:                        Game.Restart(); break;
+                }
+                LastCell = Type == EJournalRecord::Restart ? LastCell : Index;
+            }
+            Moves++, Stats.Moves++;
+        }
+        else
+        {
+            bValid = false;
+        }
+        if (!bValid)
+        {
+            Stats.Error = "game " + std::to_string(Games) + ", move " + std::to_string(Moves) + ": record not valid at byte "
+                          + std::to_string(Reader.Position);
+            return false;
+        }
+    }
+    return bMatches;
+}
@@ -0,0 +1,104 @@
+/* Append-only journal of the games played on an FMineSweeper, and its replay.
+
+A game with a journal (FMineSweeper::SetJournal) records every call that changes it: the start of each game (board, seed and
+first click mode, or a snapshot of GameSnapshot.h when the board can not be generated again from its seed), and every move
+(SetCellUserBoard, SetCellUserVisitedBoard, SetGameStatus, SetCellFlag, MoveMine, Restart, ChordCell) with its time. When a game ends
+the hash of its state (FMineSweeper::GetStateHash) is recorded too, so a replay can check it reaches the same state.
+Records are buffered and appended to the file in blocks, so a journal costs a few bytes and no system call per move.
+
+Each record is a byte with its type, followed by its numbers as LEB128 varints (7 bits per byte, lowest first):
+    Start       time, width, height, mines, flags (JOURNAL_START_ bits), seed, safe cell + 1 (0 if none)
+    Snapshot    time, size, and the snapshot bytes
+    moves       cell (left out if JOURNAL_SAME_CELL is set on the type: the cell of the previous move, and on Restart, which has none),
+                time, target cell (only MoveMine)
+    Checksum    state hash
+The time of Start and Snapshot is in microseconds since 1970, the time of a move in microseconds since the previous record.
+ReplayJournal plays a journal again without output, checking every hash. Replay.cpp runs it on many journals at once.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class FMineSweeper;
+
+#define JOURNAL_MAGIC "MSWJ"            // First bytes of every journal, followed by the version byte
+#define JOURNAL_VERSION 1
+#define JOURNAL_FLUSH_BYTES 65536       // Records are written to the file when they reach this size
+#define JOURNAL_SAME_CELL 0x80          // Bit of the type of a move whose cell is the cell of the previous move
+
+/// Bits of the flags of a Start record
+#define JOURNAL_START_FIRST_CLICK_SAFE 0x01
+
+/// Type of each record
+enum class EJournalRecord : uint8_t
+{
+    Start = 1,
+    Snapshot,
+    ShowCell,                           // SetCellUserBoard
+    VisitCell,                          // SetCellUserVisitedBoard
+    GameStatus,                         // SetGameStatus
+    Flag,                               // SetCellFlag(Cell, true)
+    Unflag,
+    MoveMine,
+    Restart,
+    Checksum,
+    Chord                               // ChordCell, after Checksum so the types of the older journals do not change
+};
+
+/// Journal file of the games of one FMineSweeper. It must outlive the games that record on it.
+class FGameJournal
+{
+    public:
+        FGameJournal() { }
+        ~FGameJournal();            // Writes the records left and closes the file
+        FGameJournal(const FGameJournal&) = delete;
+        FGameJournal& operator=(const FGameJournal&) = delete;
+
+        /// Getters
+        bool IsOpen() const;
+        bool IsChecksumDue(bool) const;     // Whether the state has to be hashed now, at the end of a game (true) or after a move
+
+        ///Setters
+        void SetChecksumInterval(int);      // Also hash the state every that many moves (0, by default, only at the end of each game)
+
+        /// Rest of functions
+        bool Open(const char*);             // Appends to the file, creating it if needed. Returns false if it can not be opened.
+        bool Flush();                       // Writes the buffered records. Returns false on a write error.
+        void Close();
+        void RecordStart(const FMineSweeper&, bool, int);   // Game started from its seed, placing its mines on the first click
+                                                            // (true) or away from the given safe cell (-1 for none)
+        void RecordSnapshot(const FMineSweeper&);       // Game started from its current cells
+        void RecordMove(EJournalRecord, int, int = -1); // Move on a cell, and the target cell of MoveMine
+        void RecordChecksum(uint64_t);
+
+    private:
+        FILE* File = nullptr;
+        std::vector<uint8_t> Buffer;
+        std::vector<uint8_t> SnapshotBuffer;
+        int64_t LastTime = 0;               // Microseconds since 1970 of the last record
+        int LastCell = -1;
+        int ChecksumInterval = 0;
+        int MovesSinceChecksum = 0;
+
+        void AppendNumber(uint64_t);
+        int64_t GetTime() const;
+};
+
+/// Results of replaying journals
+struct FReplayStats
+{
+    uint64_t Games = 0;
+    uint64_t Moves = 0;
+    uint64_t Checksums = 0;             // Hashes compared
+    uint64_t Mismatches = 0;            // Hashes that were different
+    std::string Error;                  // First mismatch or the reason the journal is not valid, empty if none
+};
+
+/// Play the journal of Size bytes at Data on a new game, adding to Stats. Returns false if a hash does not match or it is not valid.
+bool ReplayJournal(const uint8_t* Data, size_t Size, FReplayStats& Stats);
@@ -0,0 +1,188 @@
+/* Instrumentation of the games, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "GameMetrics.h"
+#include <cstdio>
+
+#define METRICS_PREFIX "minesweeper_"
+#define SECONDS_PER_NANOSECOND 1e-9                 // Scale of the times on the Prometheus text
+
+/// Quantiles of each histogram. 1 is the maximum.
+static const double Quantiles[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+static const char* QuantileNames[] = { "p50", "p90", "p99", "p999", "max" };
+
+/// Function prototypes
+static void AppendValue(std::string&, double);
+static void AppendPrometheusHeader(std::string&, const char*, const char*, const char*);
+static void AppendPrometheusCounter(std::string&, const char*, const char*, uint64_t);
+static void AppendPrometheusSummary(std::string&, const char*, const std::string&, const FHistogram&, double);
+static void AppendJsonHistogram(std::string&, const char*, const char*, const FHistogram&, const char*);
+static uint64_t GetQuantile(const FHistogram&, double);
+
+void FGameMetrics::Merge(const FGameMetrics& Other)
+{
+    Games += Other.Games;
+    Wins += Other.Wins;
+    Losses += Other.Losses;
+    Moves += Other.Moves;
+    BytesAllocated += Other.BytesAllocated;
+    for (int i = 0; i < (int) EGamePhase::Count; i++)
+    {
+        PhaseNanoseconds[i].Merge(Other.PhaseNanoseconds[i]);
+    }
+    MoveNanoseconds.Merge(Other.MoveNanoseconds);
+    FloodCells.Merge(Other.FloodCells);
+    FloodStackPeak.Merge(Other.FloodStackPeak);
+    WinNanoseconds.Merge(Other.WinNanoseconds);
+}
+
+void FGameMetrics::Clear()
+{
+    *this = FGameMetrics();
+}
+
+const char* GetGamePhaseName(EGamePhase Phase)
+{
+    switch (Phase)
+    {
+        case EGamePhase::SetBoardInit:
+            return "SetBoardInit";
+        case EGamePhase::SetUserBoardInit:
+            return "SetUserBoardInit";
+        case EGamePhase::SetUserVisitedBoardInit:
+            return "SetUserVisitedBoardInit";
+        case EGamePhase::SetNearbyMinesBoardInit:
+            return "SetNearbyMinesBoardInit";
+        case EGamePhase::PlaceMinesOnFirstClick:
+            return "PlaceMinesOnFirstClick";
+        default:
+            return "Reset";
+    }
+}
+
+std::string FormatMetrics(const FGameMetrics& Metrics, EMetricsFormat Format)
+{
+    std::string Out;
+    if (Format == EMetricsFormat::Prometheus)
+    {
+        AppendPrometheusCounter(Out, "games_total", "Games started.", Metrics.Games);
+        AppendPrometheusCounter(Out, "games_won_total", "Games won.", Metrics.Wins);
+        AppendPrometheusCounter(Out, "games_lost_total", "Games lost.", Metrics.Losses);
+        AppendPrometheusCounter(Out, "moves_total", "Moves played.", Metrics.Moves);
+        AppendPrometheusCounter(Out, "board_allocated_bytes_total", "Board memory allocated, boards reused from the pool are not counted.",
+                                Metrics.BytesAllocated);
+        AppendPrometheusHeader(Out, "generation_seconds", "Time of each phase of the generation of a board.", "summary");
+        for (int i = 0; i < (int) EGamePhase::Count; i++)
+        {
+            std::string Labels = std::string("phase=\"") + GetGamePhaseName((EGamePhase) i) + "\",";
+            AppendPrometheusSummary(Out, "generation_seconds", Labels, Metrics.PhaseNanoseconds[i], SECONDS_PER_NANOSECOND);
+        }
+        AppendPrometheusHeader(Out, "move_seconds", "Time of each move.", "summary");
+        AppendPrometheusSummary(Out, "move_seconds", "", Metrics.MoveNanoseconds, SECONDS_PER_NANOSECOND);
+        AppendPrometheusHeader(Out, "flood_cells", "Cells opened by each move that opened any.", "summary");
+        AppendPrometheusSummary(Out, "flood_cells", "", Metrics.FloodCells, 1.0);
+        AppendPrometheusHeader(Out, "flood_stack_peak", "Largest stack of each flood fill.", "summary");
+        AppendPrometheusSummary(Out, "flood_stack_peak", "", Metrics.FloodStackPeak, 1.0);
+        AppendPrometheusHeader(Out, "win_seconds", "Time from the start of a game to its win.", "summary");
+        AppendPrometheusSummary(Out, "win_seconds", "", Metrics.WinNanoseconds, SECONDS_PER_NANOSECOND);
+        return Out;
+    }
+
+    Out += "{\n  \"games\": " + std::to_string(Metrics.Games) + ",\n  \"wins\": " + std::to_string(Metrics.Wins)
+         + ",\n  \"losses\": " + std::to_string(Metrics.Losses) + ",\n  \"moves\": " + std::to_string(Metrics.Moves)
+         + ",\n  \"board_allocated_bytes\": " + std::to_string(Metrics.BytesAllocated) + ",\n  \"generation_ns\": {\n";
+    for (int i = 0; i < (int) EGamePhase::Count; i++)
+    {
+        AppendJsonHistogram(Out, "    ", GetGamePhaseName((EGamePhase) i), Metrics.PhaseNanoseconds[i], i + 1 < (int) EGamePhase::Count ? ",\n" : "\n");
+    }
+    Out += "  },\n";
+    AppendJsonHistogram(Out, "  ", "move_ns", Metrics.MoveNanoseconds, ",\n");
+    AppendJsonHistogram(Out, "  ", "flood_cells", Metrics.FloodCells, ",\n");
+    AppendJsonHistogram(Out, "  ", "flood_stack_peak", Metrics.FloodStackPeak, ",\n");
+    AppendJsonHistogram(Out, "  ", "win_ns", Metrics.WinNanoseconds, "\n");
+    Out += "}\n";
+    return Out;
+}
+
+EMetricsFormat GetMetricsFormat(const std::string& Path)
+{
+    const std::string Extension = ".json";
+    bool bJson = Path.size() >= Extension.size() && Path.compare(Path.size() - Extension.size(), Extension.size(), Extension) == 0;
+    return bJson ? EMetricsFormat::Json : EMetricsFormat::Prometheus;
+}
+
+bool WriteMetrics(const FGameMetrics& Metrics, EMetricsFormat Format, const std::string& Path)
+{
+    std::string Text = FormatMetrics(Metrics, Format);
+    std::string TemporaryPath = Path + ".tmp";
+    FILE* File = fopen(TemporaryPath.c_str(), "wb");
+    if (File == nullptr)
+    {
+        return false;
+    }
+    bool bOk = fwrite(Text.data(), 1, Text.size(), File) == Text.size();
+    bOk = (fclose(File) == 0) && bOk;
+    if (bOk && rename(TemporaryPath.c_str(), Path.c_str()) != 0)
+    {
+        remove(Path.c_str());                       // Some systems do not rename over an existing file
+        bOk = rename(TemporaryPath.c_str(), Path.c_str()) == 0;
+    }
+    if (!bOk)
+    {
+        remove(TemporaryPath.c_str());
+    }
+    return bOk;
+}
+
+static void AppendValue(std::string& Out, double Value)
+{
+    char Text[32];
+    snprintf(Text, sizeof(Text), "%.9g", Value);
+    Out += Text;
+}
+
+static void AppendPrometheusHeader(std::string& Out, const char* Name, const char* Help, const char* Type)
+{
+    Out += std::string("# HELP " METRICS_PREFIX) + Name + " " + Help + "\n# TYPE " METRICS_PREFIX + Name + " " + Type + "\n";
+}
+
+static void AppendPrometheusCounter(std::string& Out, const char* Name, const char* Help, uint64_t Value)
+{
+    AppendPrometheusHeader(Out, Name, Help, "counter");
+    Out += std::string(METRICS_PREFIX) + Name + " " + std::to_string(Value) + "\n";
+}
+
+/// Quantiles, sum and count of a histogram. Labels are added before the quantile, ending in a comma.
+static void AppendPrometheusSummary(std::string& Out, const char* Name, const std::string& Labels, const FHistogram& Histogram, double Scale)
+{
+    for (double Quantile : Quantiles)
+    {
+        Out += std::string(METRICS_PREFIX) + Name + "{" + Labels + "quantile=\"";
+        AppendValue(Out, Quantile);
+        Out += "\"} ";
+        AppendValue(Out, GetQuantile(Histogram, Quantile) * Scale);
+        Out += "\n";
+    }
+    std::string Braces = Labels.empty() ? "" : "{" + Labels.substr(0, Labels.size() - 1) + "}";
+    Out += std::string(METRICS_PREFIX) + Name + "_sum" + Braces + " ";
+    AppendValue(Out, Histogram.Sum * Scale);
+    Out += std::string("\n" METRICS_PREFIX) + Name + "_count" + Braces + " " + std::to_string(Histogram.Count) + "\n";
+}
+
+static void AppendJsonHistogram(std::string& Out, const char* Indent, const char* Name, const FHistogram& Histogram, const char* Separator)
+{
+    Out += std::string(Indent) + "\"" + Name + "\": { \"count\": " + std::to_string(Histogram.Count) + ", \"mean\": ";
+    AppendValue(Out, Histogram.GetMean());
+    for (size_t i = 0; i < sizeof(Quantiles) / sizeof(Quantiles[0]); i++)
+    {
+        Out += std::string(", \"") + QuantileNames[i] + "\": " + std::to_string(GetQuantile(Histogram, Quantiles[i]));
+    }
+    Out += std::string(" }") + Separator;
+}
+
+static uint64_t GetQuantile(const FHistogram& Histogram, double Quantile)
+{
+    return Quantile >= 1.0 ? Histogram.Max : Histogram.GetPercentile(Quantile);
+}
@@ -0,0 +1,87 @@
+/* Instrumentation of the games: counters and histograms of the generation, the moves and the flood fills, exported as JSON or as
+Prometheus text.
+
+A game records on an FGameMetrics only when it is given one (FMineSweeper::SetMetrics), so without it every instrumented point costs
+a null pointer check. An FGameMetrics is owned by a single thread, without locks or atomics: each thread records its games on its own
+and the owner merges them (Merge) when it wants a snapshot, as the Simulator merges the histograms of its workers.
+What is recorded:
+- Games started (Reset, Restart), won and lost, and the moves (SetCellUserBoard or SetCellUserVisitedBoard up to SetGameStatus).
+- Time of each Reset phase (Set*Init, the mines of a first click safe game) and of the whole Reset.
+- Time of each move, cells opened by each flood fill and the deepest its stack got (on one thread, BoardStrips.h is not included).
+- Bytes of board memory allocated (boards reused from the board pool cost none, check BoardPool.h) and the time from Reset to a win.
+Times are taken with steady_clock, in nanoseconds. A hibernated game keeps its start while it sleeps, so its win time includes the
+sleep; a game loaded on a game that never had a Reset has no start, and its win time is skipped.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "Histogram.h"
+
+/// Timed phases of the generation of a board
+enum class EGamePhase
+{
+    SetBoardInit,
+    SetUserBoardInit,
+    SetUserVisitedBoardInit,
+    SetNearbyMinesBoardInit,
+    PlaceMinesOnFirstClick,
+    Reset,                          // The whole Reset
+    Count
+};
+
+/// Output formats of a snapshot
+enum class EMetricsFormat
+{
+    Json,
+    Prometheus
+};
+
+/// The last game recorded, for the summary of a single game
+struct FGameRecord
+{
+    uint64_t Moves = 0;
+    uint64_t CellsOpened = 0;
+    uint64_t GenerationNanoseconds = 0;
+    uint64_t Nanoseconds = 0;       // From Reset to the end of the game, 0 while it is played or if the start is not known
+};
+
+/// Counters and histograms of the games of one thread
+struct FGameMetrics
+{
+    uint64_t Games = 0;
+    uint64_t Wins = 0;
+    uint64_t Losses = 0;
+    uint64_t Moves = 0;
+    uint64_t BytesAllocated = 0;                        // Board memory allocated by the board pool for these games
+    FHistogram PhaseNanoseconds[(int) EGamePhase::Count];
+    FHistogram MoveNanoseconds;
+    FHistogram FloodCells;                              // Cells opened by each move that opened any
+    FHistogram FloodStackPeak;                          // Largest stack of each of those flood fills
+    FHistogram WinNanoseconds;                          // From Reset to the move that won
+    FGameRecord LastGame;
+
+    void Merge(const FGameMetrics&);                    // LastGame is kept
+    void Clear();
+};
+
+/// Name of the phase, as its Set*Init function
+const char* GetGamePhaseName(EGamePhase);
+
+/// Time used by the metrics, in nanoseconds
+inline uint64_t GetMetricsTime()
+{
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Snapshot of the metrics as text. Prometheus times are in seconds, as its conventions ask; JSON times are in nanoseconds.
+std::string FormatMetrics(const FGameMetrics&, EMetricsFormat);
+
+/// Format of a file: JSON if its name ends in .json, Prometheus text otherwise
+EMetricsFormat GetMetricsFormat(const std::string&);
+
+/// Write the snapshot to a temporary file and rename it over Path, so a reader never sees half a file. Returns false on error.
+bool WriteMetrics(const FGameMetrics&, EMetricsFormat, const std::string&);
@@ -0,0 +1,410 @@
+/* Binary snapshots of a game, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "GameSnapshot.h"
+#include "BoardStrips.h"
+#include "GameJournal.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define SNAPSHOT_ALIGNMENT 8            // Every plane starts on a multiple of this, so it can be read 8 bytes at a time
+#define LOW_BITS 0x0101010101010101ULL  // Bit 0 of each byte of a 64 bit word
+
+/// Access to the private state of FMineSweeper, only for this file
+struct FSnapshotAccess
+{
+    static const uint8_t* GetCells(const FMineSweeper& Game) { return Game.Cells.GetData(); }
+    static bool GetMinesPlaced(const FMineSweeper& Game) { return Game.bMinesPlaced; }
+    static bool Load(FMineSweeper&, const FSnapshotHeader&, const uint8_t*, const uint8_t*, const uint8_t*);
+};
+
+/// Bytes of a plane of one bit per cell
+static size_t GetBitPlaneBytes(size_t BoardSize)
+{
+    return (BoardSize + 7) / 8;
+}
+
+static size_t Pad(size_t Bytes)
+{
+    return (Bytes + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+/// OR Value on the cells whose bit is set on the plane, 8 cells at a time with the bytes of each plane byte precomputed
+static void ExpandBits(const uint8_t* Plane, size_t BoardSize, uint8_t Value, uint8_t* Cells)
+{
+    static const struct FExpandTable
+    {
+        uint64_t Words[256];            // Byte k of Words[b] is bit k of b
+        FExpandTable()
+        {
+            for (int b = 0; b < 256; b++)
+            {
+                Words[b] = 0;
+                for (int k = 0; k < 8; k++)
+                {
+                    Words[b] |= (uint64_t) ((b >> k) & 1) << (8 * k);
+                }
+            }
+        }
+    } Table;
+
+    size_t i = 0;
+    for (; i + 8 <= BoardSize; i += 8)
+    {
+        uint8_t Bits = Plane[i / 8];
+        if (Bits == 0)
+        {
+            continue;
+        }
+        uint64_t Word;
+        memcpy(&Word, Cells + i, 8);
+        Word |= Table.Words[Bits] * Value;
+        memcpy(Cells + i, &Word, 8);
+    }
+    for (; i < BoardSize; i++)
+    {
+        if ((Plane[i / 8] >> (i % 8)) & 1)
+        {
+            Cells[i] |= Value;
+        }
+    }
+}
+
+/// Call OnRun with the length of each run of hidden and displayed cells, starting with a hidden one (which may be empty).
+/// Long runs are skipped 8 cells at a time.
+template <typename FOnRun>
+static void ForEachShownRun(const uint8_t* Cells, size_t BoardSize, FOnRun OnRun)
+{
+    const uint64_t ShownBits = LOW_BITS * CELL_SHOWN;
+    bool bShown = false;
+    size_t RunStart = 0;
+    size_t i = 0;
+    while (i < BoardSize)
+    {
+        if (i + 8 <= BoardSize)
+        {
+            uint64_t Word;
+            memcpy(&Word, Cells + i, 8);
+            if ((Word & ShownBits) == (bShown ? ShownBits : 0))
+            {
+                i += 8;
+                continue;
+            }
+        }
+        if (((Cells[i] & CELL_SHOWN) != 0) != bShown)
+        {
+            OnRun((uint32_t) (i - RunStart));
+            RunStart = i;
+            bShown = !bShown;
+        }
+        i++;
+    }
+    OnRun((uint32_t) (BoardSize - RunStart));
+}
+
+/// Bits set on a 64 bit word (portable population count: bits summed in pairs, nibbles and then bytes)
+static uint64_t CountWordBits(uint64_t Word)
+{
+    Word = Word - ((Word >> 1) & 0x5555555555555555ULL);
+    Word = (Word & 0x3333333333333333ULL) + ((Word >> 2) & 0x3333333333333333ULL);
+    Word = (Word + (Word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (Word * LOW_BITS) >> 56;
+}
+
+/// Bits set on a plane, 64 at a time
+static uint64_t CountBits(const uint8_t* Plane, size_t Bytes)
+{
+    uint64_t Count = 0;
+    for (size_t i = 0; i < Bytes; i += 8)
+    {
+        uint64_t Word = 0;
+        memcpy(&Word, Plane + i, Bytes - i < 8 ? Bytes - i : 8);
+        Count += CountWordBits(Word);
+    }
+    return Count;
+}
+
+/// Runs of hidden and displayed cells on the displayed cells plane, the first one hidden (so it is empty if the first cell is displayed).
+/// It is one more than the cells that differ from the previous one, counted 64 cells at a time.
+static uint64_t CountShownRuns(const uint8_t* Plane, size_t BoardSize)
+{
+    uint64_t Changes = 0;
+    uint64_t Previous = 0;              // Last cell of the previous word, the one before the board counts as hidden
+    for (size_t Cell = 0; Cell < BoardSize; Cell += 64)
+    {
+        size_t Bytes = GetBitPlaneBytes(BoardSize - Cell);
+        uint64_t Word = 0;
+        memcpy(&Word, Plane + Cell / 8, Bytes < 8 ? Bytes : 8);
+        uint64_t Different = Word ^ ((Word << 1) | Previous);
+        if (BoardSize - Cell < 64)      // The bits after the last cell are not cells
+        {
+            Different &= (1ULL << (BoardSize - Cell)) - 1;
+        }
+        Changes += CountWordBits(Different);
+        Previous = Word >> 63;
+    }
+    return Changes + 1;
+}
+
+bool SaveGameSnapshot(const FMineSweeper& Game, std::vector<uint8_t>& Out)
+{
+    const uint8_t* Cells = FSnapshotAccess::GetCells(Game);
+    if (Cells == nullptr)
+    {
+        return false;
+    }
+    size_t BoardSize = Game.GetBoardSize();
+    size_t BitBytes = GetBitPlaneBytes(BoardSize);
+    bool bMinesPlaced = FSnapshotAccess::GetMinesPlaced(Game);
+    FGameStats Stats = Game.GetResults();
+
+    FSnapshotHeader Header = {};
+    memcpy(Header.Magic, SNAPSHOT_MAGIC, sizeof(Header.Magic));
+    Header.Version = SNAPSHOT_VERSION;
+    Header.Width = Game.GetBoardWidth();
+    Header.Height = Game.GetBoardHeight();
+    Header.Mines = Game.GetNumMines();
+    Header.SpacesLeft = Stats.NumSpacesLeft;
+    Header.MinesLeft = Stats.NumMinesLeft;
+    Header.Status = (uint32_t) Game.GetGameStatus();
+    Header.Seed = Game.GetSeed();
+    Header.Flags = (uint16_t) ((Game.GetFirstClickSafe() ? SNAPSHOT_FIRST_CLICK_SAFE : 0) | (bMinesPlaced ? SNAPSHOT_MINES_PLACED : 0));
+
+    Header.MinesBytes = bMinesPlaced ? BitBytes : 0;
+    Header.ShownBytes = BitBytes;
+    size_t Start = Out.size();
+    size_t MinesAt = Start + sizeof(Header);
+    size_t ShownAt = MinesAt + Pad(Header.MinesBytes);
+    size_t FlagsAt = ShownAt + Pad(BitBytes);
+    Out.resize(FlagsAt + Pad(BitBytes), 0);
+    PackCellPlanes(Game.GetSimdLevel(), Cells, BoardSize, bMinesPlaced ? Out.data() + MinesAt : nullptr, Out.data() + ShownAt, Out.data() + FlagsAt);
+    bool bAnyFlag = CountBits(Out.data() + FlagsAt, BitBytes) != 0;
+
+    uint64_t NumRuns = CountShownRuns(Out.data() + ShownAt, BoardSize);
+    if (NumRuns * sizeof(uint32_t) < BitBytes)  // Runs take less than the bits: they replace them, and the flags plane moves down
+    {
+        Header.Flags |= SNAPSHOT_SHOWN_RUNS;
+        Header.ShownBytes = NumRuns * sizeof(uint32_t);
+        uint8_t* Runs = Out.data() + ShownAt;
+        ForEachShownRun(Cells, BoardSize, [&](uint32_t Length)      // Few runs, so they are long and mostly skipped 8 cells at a time
+        {
+            memcpy(Runs, &Length, sizeof(Length));
+            Runs += sizeof(Length);
+        });
+        size_t RunsEnd = ShownAt + Pad(Header.ShownBytes);
+        memset(Runs, 0, Out.data() + RunsEnd - Runs);
+        if (bAnyFlag)
+        {
+            memmove(Out.data() + RunsEnd, Out.data() + FlagsAt, Pad(BitBytes));
+        }
+        FlagsAt = RunsEnd;
+    }
+    Header.FlagsBytes = bAnyFlag ? BitBytes : 0;    // No flags, no plane
+    Out.resize(FlagsAt + Pad(Header.FlagsBytes));
+    memcpy(Out.data() + Start, &Header, sizeof(Header));
+    return true;
+}
+
+bool LoadGameSnapshot(FMineSweeper& Game, const uint8_t* Data, size_t Size)
+{
+    FSnapshotHeader Header;
+    if (Data == nullptr || Size < sizeof(Header))
+    {
+        return false;
+    }
+    memcpy(&Header, Data, sizeof(Header));
+    if (memcmp(Header.Magic, SNAPSHOT_MAGIC, sizeof(Header.Magic)) != 0 || Header.Version != SNAPSHOT_VERSION
+        || Header.Status > (uint32_t) EGameStatus::KeepPlaying || !FMineSweeper().SetGameParams(Header.Width, Header.Height, Header.Mines))
+    {
+        return false;
+    }
+
+    // Every size is checked before touching the game, so a bad snapshot leaves it as it was
+    size_t BoardSize = (size_t) Header.Width * Header.Height;
+    size_t BitBytes = GetBitPlaneBytes(BoardSize);
+    bool bMinesPlaced = (Header.Flags & SNAPSHOT_MINES_PLACED) != 0;
+    bool bShownRuns = (Header.Flags & SNAPSHOT_SHOWN_RUNS) != 0;
+    if (Header.MinesBytes != (bMinesPlaced ? BitBytes : 0) || (Header.FlagsBytes != 0 && Header.FlagsBytes != BitBytes)
+        || (bShownRuns ? (Header.ShownBytes % sizeof(uint32_t) != 0 || Header.ShownBytes > Size) : Header.ShownBytes != BitBytes)
+        || Header.SpacesLeft < 0 || Header.SpacesLeft > (int64_t) BoardSize - Header.Mines || Header.MinesLeft < 0)
+    {
+        return false;
+    }
+    size_t MinesAt = sizeof(Header);
+    size_t ShownAt = MinesAt + Pad(Header.MinesBytes);
+    size_t FlagsAt = ShownAt + Pad(Header.ShownBytes);
+    if (FlagsAt + Header.FlagsBytes > Size || (bMinesPlaced && CountBits(Data + MinesAt, BitBytes) != (uint64_t) Header.Mines))
+    {
+        return false;
+    }
+    if (bShownRuns)
+    {
+        uint64_t Cells = 0;
+        for (size_t i = 0; i < Header.ShownBytes; i += sizeof(uint32_t))
+        {
+            uint32_t Length;
+            memcpy(&Length, Data + ShownAt + i, sizeof(Length));
+            Cells += Length;
+        }
+        if (Cells != BoardSize)
+        {
+            return false;
+        }
+    }
+    return FSnapshotAccess::Load(Game, Header, bMinesPlaced ? Data + MinesAt : nullptr, Data + ShownAt,
+                                 Header.FlagsBytes != 0 ? Data + FlagsAt : nullptr);
+}
+
+/// Build the cells of a checked snapshot on a new board, with their nearby mines, and only then replace the game with it, so nothing
+/// can fail once the game is touched. Mines and Flags may be nullptr.
+bool FSnapshotAccess::Load(FMineSweeper& Game, const FSnapshotHeader& Header, const uint8_t* Mines, const uint8_t* Shown, const uint8_t* Flags)
+{
+    size_t BoardSize = (size_t) Header.Width * Header.Height;
+    FBoardBuffer Cells;
+    if (!Cells.Reset(BoardSize))
+    {
+        return false;
+    }
+    uint8_t* Data = Cells.GetData();
+    if (Header.Flags & SNAPSHOT_SHOWN_RUNS)         // Displayed cells were visited too
+    {
+        size_t Cell = 0;
+        for (size_t i = 0; i < Header.ShownBytes; i += sizeof(uint32_t))
+        {
+            uint32_t Length;
+            memcpy(&Length, Shown + i, sizeof(Length));
+            if (i / sizeof(uint32_t) % 2 == 1)
+            {
+                memset(Data + Cell, CELL_SHOWN | CELL_VISITED, Length);
+            }
+            Cell += Length;
+        }
+    }
+    else
+    {
+        ExpandBits(Shown, BoardSize, CELL_SHOWN | CELL_VISITED, Data);
+    }
+    if (Mines != nullptr)
+    {
+        ExpandBits(Mines, BoardSize, CELL_MINE | CELL_VISITED, Data);
+    }
+    int NumFlags = 0;
+    if (Flags != nullptr)
+    {
+        ExpandBits(Flags, BoardSize, CELL_FLAG, Data);
+        for (size_t i = 0; i < BoardSize; i++)
+        {
+            NumFlags += (Data[i] & CELL_FLAG) != 0;
+        }
+    }
+    if (Mines != nullptr)                           // Same strips as FMineSweeper::SetNearbyMinesBoardInit, one strip on small boards
+    {
+        int NumThreads = BoardSize >= STRIPS_MIN_CELLS ? Game.GenerationThreads : 1;
+        CountNearbyMinesStrips(Game.SimdLevel, Data, Header.Width, Header.Height, NumThreads);
+    }
+
+    Game.RecordPendingChecksum();
+    Game.SetGameParams(Header.Width, Header.Height, Header.Mines);
+    Game.Cells = std::move(Cells);
+    Game.Seed = Header.Seed;
+    Game.GameStatus = (EGameStatus) Header.Status;
+    Game.Results.NumSpacesLeft = Header.SpacesLeft;
+    Game.Results.NumMinesLeft = Header.MinesLeft;
+    Game.Results.NumFlags = NumFlags;
+    Game.FlagCounts.clear();                        // Counted from the flags when they are needed
+    Game.bMineShown = Header.Status == (uint32_t) EGameStatus::GameLost;    // So SetGameStatus keeps it lost
+    Game.bFirstClickSafe = (Header.Flags & SNAPSHOT_FIRST_CLICK_SAFE) != 0;
+    Game.bMinesPlaced = Mines != nullptr;
+    Game.bCountsPending = Mines == nullptr;         // Nothing to count before the first click, every row is counted after it
+    Game.bSeedBoard = false;
+    if (Game.bCountsPending)
+    {
+        Game.ColumnSums.assign(Game.BoardWidth + 2, 0);
+        Game.ZeroRow.assign(Game.BoardWidth, 0);
+        Game.CountedRows.assign(Game.BoardHeight, 0);
+    }
+    Game.ClearHistory();
+    if (Game.Journal != nullptr)
+    {
+        Game.Journal->RecordSnapshot(Game);
+    }
+    return true;
+}
+
+bool SaveGameFile(const FMineSweeper& Game, const char* Path)
+{
+    std::vector<uint8_t> Snapshot;
+    if (!SaveGameSnapshot(Game, Snapshot))
+    {
+        return false;
+    }
+    std::string Temporary = std::string(Path) + ".tmp";
+    FILE* File = fopen(Temporary.c_str(), "wb");
+    if (File == nullptr)
+    {
+        return false;
+    }
+    bool bWritten = fwrite(Snapshot.data(), 1, Snapshot.size(), File) == Snapshot.size();
+    bWritten = fclose(File) == 0 && bWritten;
+    if (!bWritten || std::rename(Temporary.c_str(), Path) != 0)
+    {
+        std::remove(Temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+#ifdef _WIN32
+/// Without mmap the file is read into memory
+bool LoadGameFile(FMineSweeper& Game, const char* Path)
+{
+    FILE* File = fopen(Path, "rb");
+    if (File == nullptr)
+    {
+        return false;
+    }
+    std::vector<uint8_t> Snapshot;
+    uint8_t Buffer[65536];
+    size_t Count = 0;
+    while ((Count = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+    {
+        Snapshot.insert(Snapshot.end(), Buffer, Buffer + Count);
+    }
+    fclose(File);
+    return LoadGameSnapshot(Game, Snapshot.data(), Snapshot.size());
+}
+#else
+bool LoadGameFile(FMineSweeper& Game, const char* Path)
+{
+    int File = open(Path, O_RDONLY | O_CLOEXEC);
+    if (File < 0)
+    {
+        return false;
+    }
+    struct stat Status;
+    if (fstat(File, &Status) != 0 || Status.st_size < (off_t) sizeof(FSnapshotHeader))
+    {
+        close(File);
+        return false;
+    }
+    void* Data = mmap(nullptr, (size_t) Status.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    close(File);                        // The mapping keeps the file
+    if (Data == MAP_FAILED)
+    {
+        return false;
+    }
+    bool bLoaded = LoadGameSnapshot(Game, (const uint8_t*) Data, (size_t) Status.st_size);
+    munmap(Data, (size_t) Status.st_size);
+    return bLoaded;
+}
+#endif
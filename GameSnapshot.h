@@ -0,0 +1,56 @@
+/* Binary snapshots of a game, to save it at any point and load it later exactly as it was (hibernated sessions of Server.cpp).
+
+A snapshot is a header followed by up to three planes, each one starting on a multiple of 8 bytes:
+1. Mines: one bit per cell. It is left out before the first click of a first click safe game, whose mines depend on that click.
+2. Displayed cells: one bit per cell or, when it is smaller, the lengths of the runs of hidden and displayed cells (32 bits each,
+   starting with a hidden one), so a game with big open areas takes a few bytes.
+3. Flags: one bit per cell, left out when there is no flag.
+The planes are expanded 8 cells at a time and the runs with memset, so a snapshot mapped from a file is loaded without parsing
+it cell by cell. The nearby mines counts are not saved: they are counted again with the kernel of BoardKernels.h.
+Numbers are stored in the byte order of the CPU (little endian on every supported one). Files are written to a temporary name and
+renamed, so a failed write never leaves half a snapshot on the path.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Minesweeper.h"
+
+#define SNAPSHOT_MAGIC "MSWS"           // First 4 bytes of every snapshot
+#define SNAPSHOT_VERSION 1              // Snapshots of another version are not loaded
+
+/// Bits of the flags of the header
+#define SNAPSHOT_FIRST_CLICK_SAFE 0x01  // The game places its mines on the first click
+#define SNAPSHOT_MINES_PLACED 0x02      // There is a mines plane
+#define SNAPSHOT_SHOWN_RUNS 0x04        // The displayed cells are saved as runs instead of bits
+
+/// Fixed part of a snapshot, read in place from the mapped file
+struct FSnapshotHeader
+{
+    char Magic[4];
+    uint16_t Version;
+    uint16_t Flags;                     // SNAPSHOT_ bits
+    int32_t Width;
+    int32_t Height;
+    int32_t Mines;
+    int32_t SpacesLeft;                 // FGameStats of the game
+    int32_t MinesLeft;
+    uint32_t Status;                    // EGameStatus
+    uint64_t Seed;
+    uint64_t MinesBytes;                // Size of each plane, without the padding to 8 bytes
+    uint64_t ShownBytes;
+    uint64_t FlagsBytes;
+};
+
+/// Append the snapshot of Game to Out. Returns false if the game has no board.
+bool SaveGameSnapshot(const FMineSweeper& Game, std::vector<uint8_t>& Out);
+
+/// Replace the game with the snapshot of Size bytes at Data. Returns false (and leaves the game as it was) if it is not a valid snapshot.
+bool LoadGameSnapshot(FMineSweeper& Game, const uint8_t* Data, size_t Size);
+
+/// Same as above, on a file. The file is mapped in memory to load it, not read (read on Windows, which has no mmap).
+bool SaveGameFile(const FMineSweeper& Game, const char* Path);
+bool LoadGameFile(FMineSweeper& Game, const char* Path);
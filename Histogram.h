@@ -0,0 +1,98 @@
+/* Log-linear histogram, used to obtain percentiles of latencies without storing every sample.
+
+Values below 16 have one bucket each. Every power of two above is split in 16 buckets, so a percentile is off by less than 6.25 %.
+Adding a value costs a few instructions and histograms of different threads can be merged at the end.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#define HISTOGRAM_SUB_BITS 4                                    // 2^4 = 16 buckets per power of two
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * (64 - HISTOGRAM_SUB_BITS + 1))
+
+/// Histogram of non negative integer values (nanoseconds, cells...)
+struct FHistogram
+{
+    uint64_t Buckets[HISTOGRAM_BUCKETS];
+    uint64_t Count = 0;
+    uint64_t Sum = 0;
+    uint64_t Max = 0;
+
+    FHistogram() { memset(Buckets, 0, sizeof(Buckets)); }
+
+    /// Bucket of a value
+    static int GetBucket(uint64_t Value)
+    {
+        if (Value < HISTOGRAM_SUB_BUCKETS)
+        {
+            return (int) Value;
+        }
+        int Exponent = 63;
+        while ((Value >> Exponent) == 0)
+        {
+            Exponent--;
+        }
+        int SubBucket = (int) ((Value >> (Exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+        return HISTOGRAM_SUB_BUCKETS * (Exponent - HISTOGRAM_SUB_BITS + 1) + SubBucket;
+    }
+
+    /// Smallest value that falls on a bucket
+    static uint64_t GetBucketStart(int Bucket)
+    {
+        if (Bucket < HISTOGRAM_SUB_BUCKETS)
+        {
+            return (uint64_t) Bucket;
+        }
+        int Exponent = Bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+        uint64_t SubBucket = (uint64_t) (Bucket % HISTOGRAM_SUB_BUCKETS);
+        return (1ULL << Exponent) + (SubBucket << (Exponent - HISTOGRAM_SUB_BITS));
+    }
+
+    void Add(uint64_t Value)
+    {
+        Buckets[GetBucket(Value)]++;
+        Count++;
+        Sum += Value;
+        Max = Value > Max ? Value : Max;
+    }
+
+    void Merge(const FHistogram& Other)
+    {
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        {
+            Buckets[i] += Other.Buckets[i];
+        }
+        Count += Other.Count;
+        Sum += Other.Sum;
+        Max = Other.Max > Max ? Other.Max : Max;
+    }
+
+    void Clear() { *this = FHistogram(); }
+
+    double GetMean() const { return Count ? (double) Sum / Count : 0.0; }
+
+    /// Value below which the given fraction (0-1) of the samples fall. Returns the start of the bucket, capped by the maximum seen.
+    uint64_t GetPercentile(double Fraction) const
+    {
+        if (Count == 0)
+        {
+            return 0;
+        }
+        uint64_t Target = (uint64_t) (Fraction * (Count - 1)) + 1;
+        uint64_t Seen = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        {
+            Seen += Buckets[i];
+            if (Seen >= Target)
+            {
+                uint64_t Start = GetBucketStart(i);
+                return Start < Max ? Start : Max;
+            }
+        }
+        return Max;
+    }
+};
@@ -0,0 +1,270 @@
+/* Board without borders, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "InfiniteBoard.h"
+#include "MineGenerator.h"
+#include "Random.h"
+
+#define PADDED_SIDE (INFINITE_TILE_SIDE + 2)        // A tile and the edges of the tiles around it
+#define TILE_MASK (INFINITE_TILE_SIDE - 1)
+
+/// Getters
+int FInfiniteBoard::GetMinesPerTile() const { return MinesPerTile; }
+uint64_t FInfiniteBoard::GetSeed() const { return Seed; }
+EGameStatus FInfiniteBoard::GetGameStatus() const { return GameStatus; }
+bool FInfiniteBoard::IsRevealComplete() const { return bRevealComplete; }
+
+FInfiniteStats FInfiniteBoard::GetStats() const
+{
+    FInfiniteStats Stats;
+    Stats.Tiles = Tiles.size();
+    Stats.CountedTiles = CountedTiles;
+    Stats.CellsShown = CellsShown;
+    Stats.Bytes = Tiles.size() * (uint64_t) INFINITE_TILE_CELLS;
+    return Stats;
+}
+
+char FInfiniteBoard::GetUserCell(int32_t X, int32_t Y) const
+{
+    const FTile* Tile = IsCellValid(X, Y) ? FindTile(X >> INFINITE_TILE_SHIFT, Y >> INFINITE_TILE_SHIFT) : nullptr;
+    if (Tile == nullptr || !Tile->bCounted)
+    {
+        return '-';
+    }
+    uint8_t Cell = Tile->Cells[(Y & TILE_MASK) * INFINITE_TILE_SIDE + (X & TILE_MASK)];
+    if ((Cell & CELL_SHOWN) == 0)
+    {
+        return (Cell & CELL_FLAG) ? 'F' : '-';
+    }
+    return (Cell & CELL_MINE) ? 'X' : '0' + (Cell >> CELL_COUNT_SHIFT);
+}
+
+bool FInfiniteBoard::IsCellValid(int64_t X, int64_t Y)
+{
+    return X > -INFINITE_MAX_COORDINATE && X < INFINITE_MAX_COORDINATE && Y > -INFINITE_MAX_COORDINATE && Y < INFINITE_MAX_COORDINATE;
+}
+
+///Setters
+bool FInfiniteBoard::SetGameParams(int Mines)
+{
+    if (Mines < 1 || Mines > INFINITE_TILE_CELLS - 9)
+    {
+        return false;
+    }
+    MinesPerTile = Mines;
+    return true;
+}
+
+bool FInfiniteBoard::SetCellFlag(int32_t X, int32_t Y, bool bFlag)
+{
+    if (!IsCellValid(X, Y))
+    {
+        return false;
+    }
+    uint8_t& Cell = GetCountedCell(X, Y);
+    if (Cell & CELL_SHOWN)
+    {
+        return false;
+    }
+    Cell = (uint8_t) (bFlag ? (Cell | CELL_FLAG) : (Cell & ~CELL_FLAG));
+    return true;
+}
+
+/// Rest of functions
+void FInfiniteBoard::Reset(uint64_t BoardSeed)
+{
+    EraseMemory();
+    Seed = BoardSeed;
+    GameStatus = EGameStatus::KeepPlaying;
+}
+
+/// Same flood fill as FMineSweeper::SetCellUserVisitedBoard, on world coordinates. Tiles are counted as the fill reaches them.
+/// The fill is breadth first, so if it opens INFINITE_MAX_REVEAL cells and stops, the area displayed is closed by a frontier of
+/// cells left hidden, around the cell revealed. They are unmarked so a later reveal on any of them goes on from there.
+const std::vector<FInfiniteCell>& FInfiniteBoard::Reveal(int32_t X, int32_t Y)
+{
+    static const int Offsets[8][2] = { {-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1} };
+
+    RevealedCells.clear();
+    FloodQueue.clear();
+    FloodNext = 0;
+    bRevealComplete = true;
+    if (GameStatus != EGameStatus::KeepPlaying || !IsCellValid(X, Y))
+    {
+        return RevealedCells;
+    }
+    uint8_t& Selected = GetCountedCell(X, Y);
+    if (Selected & (CELL_SHOWN | CELL_FLAG))
+    {
+        return RevealedCells;
+    }
+    if (Selected & CELL_MINE)
+    {
+        Selected |= CELL_SHOWN;
+        CellsShown++;
+        RevealedCells.push_back({X, Y});
+        GameStatus = EGameStatus::GameLost;
+        return RevealedCells;
+    }
+
+    Selected |= CELL_VISITED;
+    FloodQueue.push_back({X, Y});
+    while (FloodNext < FloodQueue.size())
+    {
+        FInfiniteCell Current = FloodQueue[FloodNext++];
+        uint8_t& Cell = GetCountedCell(Current.X, Current.Y);
+        Cell |= CELL_SHOWN;
+        CellsShown++;
+        RevealedCells.push_back(Current);
+        if (RevealedCells.size() >= INFINITE_MAX_REVEAL)
+        {
+            for (size_t i = FloodNext; i < FloodQueue.size(); i++)
+            {
+                GetCountedCell(FloodQueue[i].X, FloodQueue[i].Y) &= (uint8_t) ~CELL_VISITED;
+            }
+            FloodQueue.clear();
+            bRevealComplete = false;
+            break;
+        }
+        if ((Cell >> CELL_COUNT_SHIFT) != 0)
+        {
+            continue;
+        }
+        int LocalX = Current.X & TILE_MASK, LocalY = Current.Y & TILE_MASK;
+        bool bInside = LocalX > 0 && LocalX < TILE_MASK && LocalY > 0 && LocalY < TILE_MASK;
+        for (const int* Offset : Offsets)       // No mine around, so no neighbour has one
+        {
+            int32_t NX = Current.X + Offset[0], NY = Current.Y + Offset[1];
+            if (!bInside && !IsCellValid(NX, NY))
+            {
+                continue;
+            }
+            uint8_t& Neighbour = bInside ? (&Cell)[Offset[1] * INFINITE_TILE_SIDE + Offset[0]] : GetCountedCell(NX, NY);   // Same tile, no lookup
+            if ((Neighbour & (CELL_VISITED | CELL_FLAG)) == 0)
+            {
+                Neighbour |= CELL_VISITED;
+                FloodQueue.push_back({NX, NY});
+            }
+        }
+    }
+    return RevealedCells;
+}
+
+/// Return every tile to the board pool
+void FInfiniteBoard::EraseMemory()
+{
+    Tiles.clear();
+    CachedTile = nullptr;
+    CountedTiles = 0;
+    CellsShown = 0;
+}
+
+uint64_t FInfiniteBoard::GetTileKey(int32_t TileX, int32_t TileY)
+{
+    return ((uint64_t) (uint32_t) TileX << 32) | (uint32_t) TileY;
+}
+
+FInfiniteBoard::FTile* FInfiniteBoard::FindTile(int32_t TileX, int32_t TileY) const
+{
+    auto Found = Tiles.find(GetTileKey(TileX, TileY));
+    return Found != Tiles.end() ? Found->second.get() : nullptr;
+}
+
+FInfiniteBoard::FTile& FInfiniteBoard::GetTile(int32_t TileX, int32_t TileY)
+{
+    std::unique_ptr<FTile>& Tile = Tiles[GetTileKey(TileX, TileY)];
+    if (!Tile)
+    {
+        Tile.reset(new FTile());
+        GenerateMines(*Tile, TileX, TileY);
+    }
+    return *Tile;
+}
+
+uint8_t& FInfiniteBoard::GetCountedCell(int32_t X, int32_t Y)
+{
+    int32_t TileX = X >> INFINITE_TILE_SHIFT, TileY = Y >> INFINITE_TILE_SHIFT;     // Arithmetic shifts: floor on negative cells
+    uint64_t Key = GetTileKey(TileX, TileY);
+    if (CachedTile == nullptr || Key != CachedKey)
+    {
+        FTile& Tile = GetTile(TileX, TileY);
+        if (!Tile.bCounted)
+        {
+            CountTile(Tile, TileX, TileY);
+        }
+        CachedKey = Key;
+        CachedTile = &Tile;
+    }
+    return CachedTile->Cells[(Y & TILE_MASK) * INFINITE_TILE_SIDE + (X & TILE_MASK)];
+}
+
+/// MinesPerTile mines from a seed of the game seed and the tile, so a tile is the same whenever it is generated. Mines are marked
+/// as visited, as on FMineSweeper, and the cells around (0, 0) are cleared.
+void FInfiniteBoard::GenerateMines(FTile& Tile, int32_t TileX, int32_t TileY)
+{
+    Tile.Cells.Reset(INFINITE_TILE_CELLS);
+    uint8_t* Cells = Tile.Cells.GetData();
+    PlaceMines(Cells, INFINITE_TILE_CELLS, MinesPerTile, MixBits64(Seed ^ MixBits64(GetTileKey(TileX, TileY) + RNG_GOLDEN_GAMMA)), 1);
+    for (int i = 0; i < INFINITE_TILE_CELLS; i++)
+    {
+        Cells[i] |= (uint8_t) ((Cells[i] & CELL_MINE) ? CELL_VISITED : 0);
+    }
+    for (int32_t Y = -1; Y <= 1; Y++)
+    {
+        for (int32_t X = -1; X <= 1; X++)
+        {
+            if ((X >> INFINITE_TILE_SHIFT) == TileX && (Y >> INFINITE_TILE_SHIFT) == TileY)
+            {
+                Cells[(Y & TILE_MASK) * INFINITE_TILE_SIDE + (X & TILE_MASK)] = 0;
+            }
+        }
+    }
+}
+
+/// 3x3 box sum of the mine bits of the tile, with its edges read from the 8 tiles around it (generated if needed)
+void FInfiniteBoard::CountTile(FTile& Tile, int32_t TileX, int32_t TileY)
+{
+    const uint8_t* Around[3][3];
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            Around[dy + 1][dx + 1] = (dx == 0 && dy == 0) ? Tile.Cells.GetData() : GetTile(TileX + dx, TileY + dy).Cells.GetData();
+        }
+    }
+
+    uint8_t Padded[PADDED_SIDE * PADDED_SIDE];
+    for (int py = 0; py < PADDED_SIDE; py++)
+    {
+        int Row = (py == 0) ? 0 : (py == PADDED_SIDE - 1 ? 2 : 1);
+        int y = (py - 1) & TILE_MASK;
+        const uint8_t* Left = Around[Row][0] + y * INFINITE_TILE_SIDE;
+        const uint8_t* Mid = Around[Row][1] + y * INFINITE_TILE_SIDE;
+        const uint8_t* Right = Around[Row][2] + y * INFINITE_TILE_SIDE;
+        uint8_t* Out = Padded + py * PADDED_SIDE;
+        Out[0] = Left[INFINITE_TILE_SIDE - 1] & CELL_MINE;
+        for (int x = 0; x < INFINITE_TILE_SIDE; x++)
+        {
+            Out[x + 1] = Mid[x] & CELL_MINE;
+        }
+        Out[PADDED_SIDE - 1] = Right[0] & CELL_MINE;
+    }
+
+    uint8_t* Cells = Tile.Cells.GetData();
+    for (int y = 0; y < INFINITE_TILE_SIDE; y++)
+    {
+        const uint8_t* Up = Padded + y * PADDED_SIDE;
+        const uint8_t* Mid = Up + PADDED_SIDE;
+        const uint8_t* Down = Mid + PADDED_SIDE;
+        uint8_t* Row = Cells + y * INFINITE_TILE_SIDE;
+        for (int x = 0; x < INFINITE_TILE_SIDE; x++)
+        {
+            int Count = Up[x] + Up[x + 1] + Up[x + 2] + Mid[x] + Mid[x + 2] + Down[x] + Down[x + 1] + Down[x + 2];
+            Row[x] = (uint8_t) ((Row[x] & ((1 << CELL_COUNT_SHIFT) - 1)) | (Count << CELL_COUNT_SHIFT));
+        }
+    }
+    Tile.bCounted = true;
+    CountedTiles++;
+}
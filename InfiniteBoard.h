@@ -0,0 +1,98 @@
+/* Board without borders, for an infinite mode: it grows as the player explores it.
+
+The world is split into square tiles of INFINITE_TILE_SIDE cells, kept on a hash map by their tile coordinates. A tile is created
+the first time something needs it and its mines are generated from the seed of the game and its coordinates only, so the world is
+the same whatever the order it is explored in. The nearby mines of a tile are counted when one of its cells is first displayed:
+the cells on its edges need the mines of the 8 tiles around it, which are generated then (mines only, without counting them).
+So only the explored tiles and a ring of tiles around them use memory, and a tile costs INFINITE_TILE_CELLS bytes of the board pool.
+The cells use the CELL_ bits of Minesweeper.h and the flood fill works as on FMineSweeper, across the edges of the tiles.
+The 3x3 cells around (0, 0) never have a mine, so a game can always start there. There is no way to win: the game goes on until
+a mine is revealed.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Minesweeper.h"
+
+#define INFINITE_TILE_SHIFT 6                                   // Tiles of 64x64 cells
+#define INFINITE_TILE_SIDE (1 << INFINITE_TILE_SHIFT)
+#define INFINITE_TILE_CELLS (INFINITE_TILE_SIDE * INFINITE_TILE_SIDE)
+#define INFINITE_MAX_COORDINATE (1 << 30)                       // Cells are in (-MAX, MAX) on both axes
+#define INFINITE_MAX_REVEAL 1000000                             // Cells opened by one reveal at most, low densities open endless areas
+
+/// Cell of the world
+struct FInfiniteCell
+{
+    int32_t X;
+    int32_t Y;
+};
+
+/// Memory used by the board
+struct FInfiniteStats
+{
+    uint64_t Tiles = 0;                 // Tiles with their mines generated
+    uint64_t CountedTiles = 0;          // Tiles with their nearby mines counted, the explored ones
+    uint64_t CellsShown = 0;
+    uint64_t Bytes = 0;                 // Cells of every tile
+};
+
+class FInfiniteBoard
+{
+    public:
+        /// Getters
+        int GetMinesPerTile() const;
+        uint64_t GetSeed() const;
+        EGameStatus GetGameStatus() const;
+        FInfiniteStats GetStats() const;
+        char GetUserCell(int32_t, int32_t) const;      // Same chars as FBoardView of the User board. It never creates a tile.
+        bool IsRevealComplete() const;                  // false if the last reveal stopped at INFINITE_MAX_REVEAL cells
+        static bool IsCellValid(int64_t, int64_t);
+
+        ///Setters
+        bool SetGameParams(int);                        // Mines of each tile. Returns false if it is not in [1, cells - 9].
+        bool SetCellFlag(int32_t, int32_t, bool);       // Returns false if the cell is already displayed or not valid
+
+        /// Rest of functions
+        void Reset(uint64_t);                           // New world from the seed, freeing every tile
+        const std::vector<FInfiniteCell>& Reveal(int32_t, int32_t);     // Displays the cell and its area, and updates the status.
+                                                                        // Returns the cells displayed, reused on the next call.
+        void EraseMemory();
+
+    private:
+        /// Cells of a tile, and whether their nearby mines are counted
+        struct FTile
+        {
+            FBoardBuffer Cells;
+            bool bCounted = false;
+        };
+
+        std::unordered_map<uint64_t, std::unique_ptr<FTile>> Tiles;
+        int MinesPerTile = 0;
+        uint64_t Seed = 0;
+        EGameStatus GameStatus = EGameStatus::KeepPlaying;
+        uint64_t CountedTiles = 0;
+        uint64_t CellsShown = 0;
+        bool bRevealComplete = true;
+
+        /// Last tile found, most neighbours of a cell are on its own tile
+        uint64_t CachedKey = 0;
+        FTile* CachedTile = nullptr;
+
+        /// Flood fill buffers, kept between reveals. The fill reads the queue from FloodNext on, breadth first.
+        std::vector<FInfiniteCell> FloodQueue;
+        size_t FloodNext = 0;
+        std::vector<FInfiniteCell> RevealedCells;
+
+        /// Rest of functions
+        static uint64_t GetTileKey(int32_t, int32_t);
+        FTile* FindTile(int32_t, int32_t) const;
+        FTile& GetTile(int32_t, int32_t);               // Creates it with its mines if needed
+        uint8_t& GetCountedCell(int32_t, int32_t);      // Counts its tile if needed
+        void GenerateMines(FTile&, int32_t, int32_t);
+        void CountTile(FTile&, int32_t, int32_t);
+};
@@ -0,0 +1,384 @@
+/* Console executable that measures Server.cpp: many connections play random games at the same time and time every move.
+
+Each thread opens its share of the connections and drives them with its own epoll. Every connection plays its games one
+after the other, with a single command on the air: new, then reveal of random hidden cells until the game is over.
+The time from sending a reveal to receiving its reply is the move latency, and the time a new takes is the new game latency.
+
+Usage: LoadClient [--socket PATH | --port P] [--connections C] [--games G] [--threads T] [--board WxHxM] [--seed S | --seed random]
+       (--games is the number of games of each connection. With --seed random, new is sent without a seed, so the server can
+       take the board from its pipeline)
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "CommandProtocol.h"
+#include "Histogram.h"
+#include "Random.h"
+
+#define DEFAULT_SOCKET_PATH "/tmp/minesweeper.sock"
+#define CLIENT_EVENTS 256           // Events handled on each epoll_wait
+#define CLIENT_READ_BYTES 65536     // Bytes read from a connection at once
+
+typedef std::chrono::steady_clock FClock;
+
+/// Command line options
+struct FClientOptions
+{
+    std::string SocketPath = DEFAULT_SOCKET_PATH;
+    int Port = 0;                   // 0 means the Unix socket
+    int NumConnections = 100;
+    int NumGames = 100;             // Games of each connection
+    int NumThreads = 1;
+    int Width = 30;
+    int Height = 16;
+    int Mines = 99;
+    uint64_t Seed = 2019;
+    bool bRandomBoards = false;     // new without a seed, the server chooses the board
+};
+
+/// A connection playing its games
+struct FClientConnection
+{
+    int File = -1;
+    int GamesLeft = 0;
+    FCounterRng Rng = FCounterRng(0, 0);    // Seeds of the boards and cells to reveal, one stream per connection
+    std::vector<uint8_t> Known;     // Cells displayed on the current game
+    std::string Reply;              // Incomplete reply received
+    FClock::time_point SentTime;
+    bool bSentReveal = false;       // The command waiting for its reply is a reveal (else it is new)
+};
+
+/// Results of one thread, merged at the end
+struct FClientStats
+{
+    uint64_t Games = 0;
+    uint64_t Wins = 0;
+    uint64_t Moves = 0;
+    uint64_t Errors = 0;            // Replies that are not "ok"
+    FHistogram MoveLatency;         // Nanoseconds from sending a reveal to receiving its reply
+    FHistogram NewGameLatency;      // Nanoseconds from sending a new to receiving its reply
+};
+
+/// Function prototypes
+bool ParseOptions(int, char*[], FClientOptions&);
+int  Connect(const FClientOptions&);
+void RunClientThread(const FClientOptions&, int, int, FClientStats&);
+bool StartGame(const FClientOptions&, FClientConnection&);
+bool SendReveal(const FClientOptions&, FClientConnection&);
+bool HandleReply(const FClientOptions&, FClientConnection&, const char*, const char*, FClientStats&);
+bool SendCommand(FClientConnection&, const std::string&);
+
+/// Main loop
+int main(int argc, char* argv[])
+{
+    FClientOptions Options;
+    if (!ParseOptions(argc, argv, Options))
+    {
+        std::cout << "Usage: LoadClient [--socket PATH | --port P] [--connections C] [--games G] [--threads T] [--board WxHxM] [--seed S | --seed random]\n";
+        return 1;
+    }
+    rlimit Limit;
+    if (getrlimit(RLIMIT_NOFILE, &Limit) == 0 && Limit.rlim_cur < Limit.rlim_max)
+    {
+        Limit.rlim_cur = Limit.rlim_max;                    // Each connection is one file
+        setrlimit(RLIMIT_NOFILE, &Limit);
+    }
+
+    std::vector<FClientStats> ThreadStats(Options.NumThreads);
+    std::vector<std::thread> Threads;
+    auto Start = FClock::now();
+    for (int i = 0; i < Options.NumThreads; i++)
+    {
+        int First = (int) ((long long) Options.NumConnections * i / Options.NumThreads);
+        int Last = (int) ((long long) Options.NumConnections * (i + 1) / Options.NumThreads);
+        Threads.emplace_back(RunClientThread, std::cref(Options), First, Last, std::ref(ThreadStats[i]));
+    }
+    for (std::thread& Thread : Threads)
+    {
+        Thread.join();
+    }
+    double Seconds = std::chrono::duration<double>(FClock::now() - Start).count();
+
+    FClientStats Total;
+    for (const FClientStats& Stats : ThreadStats)
+    {
+        Total.Games += Stats.Games;
+        Total.Wins += Stats.Wins;
+        Total.Moves += Stats.Moves;
+        Total.Errors += Stats.Errors;
+        Total.MoveLatency.Merge(Stats.MoveLatency);
+        Total.NewGameLatency.Merge(Stats.NewGameLatency);
+    }
+    const FHistogram& Latency = Total.MoveLatency;
+    std::cout << Options.NumConnections << " connections, " << Total.Games << " games (" << Total.Wins << " won), "
+    << Total.Moves << " moves in " << Seconds << " s: " << Total.Moves / Seconds << " moves/s, " << Total.Games / Seconds << " games/s\n";
+    std::cout << "move latency (ns): mean " << Latency.GetMean() << ", p50 " << Latency.GetPercentile(0.5) << ", p90 " << Latency.GetPercentile(0.9)
+    << ", p99 " << Latency.GetPercentile(0.99) << ", p99.9 " << Latency.GetPercentile(0.999) << ", max " << Latency.Max << "\n";
+    const FHistogram& NewLatency = Total.NewGameLatency;
+    std::cout << "new game latency (ns): mean " << NewLatency.GetMean() << ", p50 " << NewLatency.GetPercentile(0.5) << ", p90 "
+    << NewLatency.GetPercentile(0.9) << ", p99 " << NewLatency.GetPercentile(0.99) << ", max " << NewLatency.Max << "\n";
+    if (Total.Errors > 0)
+    {
+        std::cout << Total.Errors << " error replies\n";
+    }
+    return Total.Errors == 0 ? 0 : 1;
+}
+
+/// Read the command line
+bool ParseOptions(int argc, char* argv[], FClientOptions& Options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const char* Value = argv[++i];
+        if (strcmp(argv[i - 1], "--socket") == 0)
+        {
+            Options.SocketPath = Value;
+        }
+        else if (strcmp(argv[i - 1], "--port") == 0)
+        {
+            Options.Port = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--connections") == 0)
+        {
+            Options.NumConnections = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--games") == 0)
+        {
+            Options.NumGames = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--threads") == 0)
+        {
+            Options.NumThreads = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--seed") == 0)
+        {
+            Options.bRandomBoards = strcmp(Value, "random") == 0;
+            Options.Seed = Options.bRandomBoards ? Options.Seed : strtoull(Value, nullptr, 10);
+        }
+        else if (strcmp(argv[i - 1], "--board") == 0)
+        {
+            if (sscanf(Value, "%dx%dx%d", &Options.Width, &Options.Height, &Options.Mines) != 3 ||
+                !FMineSweeper().SetGameParams(Options.Width, Options.Height, Options.Mines))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return Options.NumConnections > 0 && Options.NumGames > 0 && Options.NumThreads > 0 && Options.NumThreads <= Options.NumConnections;
+}
+
+/// Open a connection to the server. Returns -1 on error.
+int Connect(const FClientOptions& Options)
+{
+    int File = -1;
+    if (Options.Port > 0)
+    {
+        File = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in Address = {};
+        Address.sin_family = AF_INET;
+        Address.sin_port = htons((uint16_t) Options.Port);
+        Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (File < 0 || connect(File, (sockaddr*) &Address, sizeof(Address)) != 0)
+        {
+            if (File >= 0)
+            {
+                close(File);
+            }
+            return -1;
+        }
+        int NoDelay = 1;
+        setsockopt(File, IPPROTO_TCP, TCP_NODELAY, &NoDelay, sizeof(NoDelay));
+    }
+    else
+    {
+        sockaddr_un Address = {};
+        Address.sun_family = AF_UNIX;
+        strncpy(Address.sun_path, Options.SocketPath.c_str(), sizeof(Address.sun_path) - 1);
+        File = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (File < 0 || connect(File, (sockaddr*) &Address, sizeof(Address)) != 0)
+        {
+            if (File >= 0)
+            {
+                close(File);
+            }
+            return -1;
+        }
+    }
+    return File;
+}
+
+/// Drive the connections [First, Last) until each one has played its games
+void RunClientThread(const FClientOptions& Options, int First, int Last, FClientStats& Stats)
+{
+    std::vector<FClientConnection> Connections(Last - First);
+    int EpollFile = epoll_create1(EPOLL_CLOEXEC);
+    int NumActive = 0;
+    for (int i = 0; i < (int) Connections.size(); i++)
+    {
+        FClientConnection& Connection = Connections[i];
+        Connection.File = Connect(Options);
+        if (Connection.File < 0)
+        {
+            std::cerr << "Error connecting to the server: " << strerror(errno) << "\n";
+            Stats.Errors++;
+            continue;
+        }
+        Connection.GamesLeft = Options.NumGames;
+        Connection.Rng = FCounterRng(Options.Seed, (uint64_t) (First + i));
+        epoll_event Event = {};
+        Event.events = EPOLLIN;
+        Event.data.ptr = &Connection;
+        epoll_ctl(EpollFile, EPOLL_CTL_ADD, Connection.File, &Event);
+        NumActive += StartGame(Options, Connection) ? 1 : 0;
+    }
+
+    std::vector<char> Buffer(CLIENT_READ_BYTES);
+    epoll_event Events[CLIENT_EVENTS];
+    while (NumActive > 0)
+    {
+        int NumEvents = epoll_wait(EpollFile, Events, CLIENT_EVENTS, -1);
+        FClock::time_point Now = FClock::now();
+        for (int e = 0; e < NumEvents; e++)
+        {
+            FClientConnection& Connection = *(FClientConnection*) Events[e].data.ptr;
+            long Count = (long) read(Connection.File, Buffer.data(), Buffer.size());
+            const char* NewLine = (Count > 0) ? (const char*) memchr(Buffer.data(), '\n', Count) : nullptr;
+            if (Count > 0 && NewLine == nullptr)                        // Part of a long reply, keep it
+            {
+                Connection.Reply.append(Buffer.data(), Count);
+                continue;
+            }
+            bool bKeepPlaying = false;
+            if (Count > 0)
+            {
+                uint64_t Latency = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(Now - Connection.SentTime).count();
+                (Connection.bSentReveal ? Stats.MoveLatency : Stats.NewGameLatency).Add(Latency);
+                Connection.Reply.append(Buffer.data(), NewLine - Buffer.data());
+                bKeepPlaying = HandleReply(Options, Connection, Connection.Reply.data(), Connection.Reply.data() + Connection.Reply.size(), Stats);
+                Connection.Reply.clear();
+            }
+            else
+            {
+                Stats.Errors++;                                         // The server closed the connection
+            }
+            if (!bKeepPlaying)
+            {
+                epoll_ctl(EpollFile, EPOLL_CTL_DEL, Connection.File, nullptr);
+                close(Connection.File);
+                NumActive--;
+            }
+        }
+    }
+    close(EpollFile);
+}
+
+/// Send new for the next game, or return false if the connection has played all its games
+bool StartGame(const FClientOptions& Options, FClientConnection& Connection)
+{
+    if (Connection.GamesLeft-- <= 0)
+    {
+        return false;
+    }
+    Connection.Known.assign((size_t) Options.Width * Options.Height, 0);
+    std::string Command = "new ";
+    AppendNumber(Command, Options.Width);
+    Command += ' ';
+    AppendNumber(Command, Options.Height);
+    Command += ' ';
+    AppendNumber(Command, Options.Mines);
+    if (!Options.bRandomBoards)
+    {
+        Command += ' ';
+        AppendNumber(Command, Connection.Rng.Next());
+    }
+    Command += '\n';
+    Connection.bSentReveal = false;
+    Connection.SentTime = FClock::now();
+    return SendCommand(Connection, Command);
+}
+
+/// Reveal a random cell that is not displayed yet
+bool SendReveal(const FClientOptions& Options, FClientConnection& Connection)
+{
+    int Size = Options.Width * Options.Height;
+    int Index = (int) Connection.Rng.NextBelow((uint32_t) Size);
+    while (Connection.Known[Index])                     // Displayed cells are skipped, there is always a hidden one while playing
+    {
+        Index = (Index + 1 < Size) ? Index + 1 : 0;
+    }
+    std::string Command = "reveal ";
+    AppendNumber(Command, Index % Options.Width);
+    Command += ' ';
+    AppendNumber(Command, Index / Options.Width);
+    Command += '\n';
+    Connection.bSentReveal = true;
+    Connection.SentTime = FClock::now();
+    return SendCommand(Connection, Command);
+}
+
+/// Read the reply [Begin, End) and send the next command. Returns false when the connection is done.
+bool HandleReply(const FClientOptions& Options, FClientConnection& Connection, const char* Begin, const char* End, FClientStats& Stats)
+{
+    FCommandTokenizer Tokenizer(Begin, End);
+    const char* Word = nullptr;
+    int Length = 0;
+    if (!Tokenizer.NextWord(Word, Length) || !Tokenizer.IsWord(Word, Length, "ok"))
+    {
+        Stats.Errors++;
+        return false;
+    }
+    if (!Connection.bSentReveal)                        // Reply of new
+    {
+        return SendReveal(Options, Connection);
+    }
+
+    Stats.Moves++;
+    Tokenizer.NextWord(Word, Length);
+    bool bWon = Tokenizer.IsWord(Word, Length, "won");
+    bool bLost = Tokenizer.IsWord(Word, Length, "lost");
+    int NumCells = 0;
+    Tokenizer.NextInt(NumCells);
+    for (int i = 0; i < NumCells && Tokenizer.NextWord(Word, Length); i++)      // X,Y,C of each displayed cell
+    {
+        int X = atoi(Word);
+        int Y = atoi((const char*) memchr(Word, ',', Length) + 1);
+        Connection.Known[X + Y * Options.Width] = 1;
+    }
+    if (bWon || bLost)
+    {
+        Stats.Games++;
+        Stats.Wins += bWon ? 1 : 0;
+        return StartGame(Options, Connection);
+    }
+    return SendReveal(Options, Connection);
+}
+
+/// Send a whole command. Commands are small, so the socket always has room for them.
+bool SendCommand(FClientConnection& Connection, const std::string& Command)
+{
+    return send(Connection.File, Command.data(), Command.size(), MSG_NOSIGNAL) == (long) Command.size();
+}
@@ -0,0 +1,212 @@
+/* Mine placement for the boards, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "MineGenerator.h"
+#include "Minesweeper.h"
+#include "Random.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define SPLIT_STREAM 0              // Random stream of the chunk splits, chunk i uses stream i + 1
+#define RELOCATION_STREAM UINT64_MAX    // Random stream of the mines moved out of the safe area
+#define RELOCATION_TRIES 64         // Random cells tried for a moved mine before walking to the next free one (only on almost full boards)
+
+/// Logarithm of the binomial coefficient (N choose K)
+static double LogChoose(double N, double K)
+{
+    return std::lgamma(N + 1.0) - std::lgamma(K + 1.0) - std::lgamma(N - K + 1.0);
+}
+
+/// Number of mines that fall on the first Draws cells, when Mines mines are spread over Total cells (hypergeometric distribution).
+/// Exact inversion that starts at the most likely value and walks outwards, so it takes a few steps even on huge boards.
+static int64_t SampleHypergeometric(int64_t Total, int64_t Mines, int64_t Draws, FCounterRng& Rng)
+{
+    int64_t Lowest = Draws + Mines - Total > 0 ? Draws + Mines - Total : 0;
+    int64_t Highest = Draws < Mines ? Draws : Mines;
+    if (Lowest == Highest)
+    {
+        return Lowest;
+    }
+
+    int64_t Mode = (int64_t) (((double) Draws + 1.0) * ((double) Mines + 1.0) / ((double) Total + 2.0));
+    Mode = Mode < Lowest ? Lowest : (Mode > Highest ? Highest : Mode);
+    double ModeProbability = std::exp(LogChoose(Mines, Mode) + LogChoose(Total - Mines, Draws - Mode) - LogChoose(Total, Draws));
+    double U = Rng.NextDouble();
+    if (U < ModeProbability)
+    {
+        return Mode;
+    }
+    U -= ModeProbability;
+
+    int64_t Left = Mode, Right = Mode;
+    double LeftProbability = ModeProbability, RightProbability = ModeProbability;
+    while (Left > Lowest || Right < Highest)       // Alternate one step right and one step left
+    {
+        if (Right < Highest)
+        {
+            RightProbability *= (double) (Mines - Right) * (Draws - Right) / ((double) (Right + 1) * (Total - Mines - Draws + Right + 1));
+            Right++;
+            if (U < RightProbability)
+            {
+                return Right;
+            }
+            U -= RightProbability;
+        }
+        if (Left > Lowest)
+        {
+            LeftProbability *= (double) Left * (Total - Mines - Draws + Left) / ((double) (Mines - Left + 1) * (Draws - Left + 1));
+            Left--;
+            if (U < LeftProbability)
+            {
+                return Left;
+            }
+            U -= LeftProbability;
+        }
+    }
+    return Mode;                                   // Only reached when rounding errors leave some probability unassigned
+}
+
+/// First cell of the given chunk (BoardSize for the chunk after the last one)
+static int64_t ChunkStart(int Chunk, int BoardSize)
+{
+    int64_t Start = (int64_t) Chunk * MINE_CHUNK_CELLS;
+    return Start < BoardSize ? Start : BoardSize;
+}
+
+/// Spread Mines mines over chunks [First, Last), splitting the range in halves. Node numbers the splits as a binary heap, so each split has its own random numbers.
+static void SplitMines(std::vector<int>& ChunkMines, int First, int Last, int64_t Mines, int BoardSize, uint64_t Seed, uint64_t Node)
+{
+    if (Last - First == 1)
+    {
+        ChunkMines[First] = (int) Mines;
+        return;
+    }
+    int Middle = First + (Last - First) / 2;
+    int64_t Cells = ChunkStart(Last, BoardSize) - ChunkStart(First, BoardSize);
+    int64_t LeftCells = ChunkStart(Middle, BoardSize) - ChunkStart(First, BoardSize);
+
+    FCounterRng Rng(Seed, SPLIT_STREAM);
+    Rng.Counter = Node;                            // Each split draws a single number, the one of its node
+    int64_t LeftMines = SampleHypergeometric(Cells, Mines, LeftCells, Rng);
+    SplitMines(ChunkMines, First, Middle, LeftMines, BoardSize, Seed, 2 * Node);
+    SplitMines(ChunkMines, Middle, Last, Mines - LeftMines, BoardSize, Seed, 2 * Node + 1);
+}
+
+/// Floyd's algorithm: place exactly Mines mines on the NumCells cells, one random number per mine
+static void PlaceMinesFloyd(uint8_t* Cells, int NumCells, int Mines, FCounterRng& Rng)
+{
+    for (int j = NumCells - Mines; j < NumCells; j++)
+    {
+        int Candidate = (int) Rng.NextBelow((uint32_t) j + 1);
+        if (Cells[Candidate] & CELL_MINE)          // Already taken: the new mine goes to j, which can not have been chosen before
+        {
+            Cells[j] |= CELL_MINE;
+        }
+        else
+        {
+            Cells[Candidate] |= CELL_MINE;
+        }
+    }
+}
+
+void PlaceMines(uint8_t* Cells, int BoardSize, int NumMines, uint64_t Seed, int NumThreads)
+{
+    int NumChunks = (BoardSize + MINE_CHUNK_CELLS - 1) / MINE_CHUNK_CELLS;
+    if (NumChunks <= 1)
+    {
+        FCounterRng Rng(Seed, SPLIT_STREAM + 1);
+        PlaceMinesFloyd(Cells, BoardSize, NumMines, Rng);
+        return;
+    }
+
+    std::vector<int> ChunkMines(NumChunks, 0);
+    SplitMines(ChunkMines, 0, NumChunks, NumMines, BoardSize, Seed, 1);
+
+    auto FillChunks = [&](int FirstChunk, int LastChunk)
+    {
+        for (int Chunk = FirstChunk; Chunk < LastChunk; Chunk++)
+        {
+            int Start = Chunk * MINE_CHUNK_CELLS;
+            int NumCells = (Chunk == NumChunks - 1) ? BoardSize - Start : MINE_CHUNK_CELLS;
+            FCounterRng Rng(Seed, SPLIT_STREAM + 1 + (uint64_t) Chunk);
+            PlaceMinesFloyd(Cells + Start, NumCells, ChunkMines[Chunk], Rng);
+        }
+    };
+
+    if (NumThreads > NumChunks)
+    {
+        NumThreads = NumChunks;
+    }
+    if (NumThreads <= 1)
+    {
+        FillChunks(0, NumChunks);
+        return;
+    }
+    std::vector<std::thread> Threads;
+    for (int t = 0; t < NumThreads; t++)           // Each thread fills a contiguous block of chunks
+    {
+        Threads.emplace_back(FillChunks, (int) ((int64_t) NumChunks * t / NumThreads), (int) ((int64_t) NumChunks * (t + 1) / NumThreads));
+    }
+    for (std::thread& Thread : Threads)
+    {
+        Thread.join();
+    }
+}
+
+void PlaceMinesAround(uint8_t* Cells, int Width, int Height, int NumMines, uint64_t Seed, int SafeIndex, int NumThreads)
+{
+    int BoardSize = Width * Height;
+    int SafeX = SafeIndex % Width;
+    int SafeY = SafeIndex / Width;
+    int Left = SafeX > 0 ? SafeX - 1 : 0, Right = SafeX < Width - 1 ? SafeX + 1 : SafeX;
+    int Top = SafeY > 0 ? SafeY - 1 : 0, Bottom = SafeY < Height - 1 ? SafeY + 1 : SafeY;
+    if (BoardSize - (Right - Left + 1) * (Bottom - Top + 1) < NumMines)     // Too many mines to keep the neighbours free
+    {
+        Left = Right = SafeX;
+        Top = Bottom = SafeY;
+    }
+    auto IsTaken = [&](int Index)
+    {
+        int X = Index % Width, Y = Index / Width;
+        return (Cells[Index] & CELL_MINE) || (X >= Left && X <= Right && Y >= Top && Y <= Bottom);
+    };
+
+    PlaceMines(Cells, BoardSize, NumMines, Seed, NumThreads);
+    FCounterRng Rng(Seed, RELOCATION_STREAM);
+    for (int y = Top; y <= Bottom; y++)
+    {
+        for (int x = Left; x <= Right; x++)
+        {
+            int Index = x + y * Width;
+            if ((Cells[Index] & CELL_MINE) == 0)
+            {
+                continue;
+            }
+            Cells[Index] &= (uint8_t) ~CELL_MINE;
+            int Candidate = (int) Rng.NextBelow((uint32_t) BoardSize);
+            for (int Try = 1; Try < RELOCATION_TRIES && IsTaken(Candidate); Try++)
+            {
+                Candidate = (int) Rng.NextBelow((uint32_t) BoardSize);
+            }
+            while (IsTaken(Candidate))
+            {
+                Candidate = (Candidate + 1 < BoardSize) ? Candidate + 1 : 0;
+            }
+            Cells[Candidate] |= CELL_MINE;
+        }
+    }
+}
+
+uint64_t MakeRandomSeed()
+{
+    static const uint64_t ProcessSeed = ((uint64_t) std::random_device()() << 32) ^ std::random_device()();
+    static std::atomic<uint64_t> NumSeeds(0);
+    uint64_t Time = (uint64_t) std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    return MixBits64(ProcessSeed ^ MixBits64(Time + NumSeeds.fetch_add(1) * RNG_GOLDEN_GAMMA));
+}
@@ -0,0 +1,24 @@
+/* Mine placement for the boards.
+
+Mines are placed with Floyd's algorithm, which draws exactly one random number per mine, so the cost does not grow on dense boards.
+Big boards are split in chunks of MINE_CHUNK_CELLS cells. The number of mines of each chunk is drawn first (hypergeometric splits, so every
+layout is as likely as with a single Floyd run) and then the chunks are filled in parallel, each one with its own random stream.
+The result only depends on the seed: the same seed gives the same board whatever the number of threads.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstdint>
+
+#define MINE_CHUNK_CELLS 65536      // Cells filled by each independent Floyd run
+
+/// Place exactly NumMines mines (CELL_MINE bit) on the first BoardSize cells, which must be 0. NumThreads threads are used on big boards.
+void PlaceMines(uint8_t* Cells, int BoardSize, int NumMines, uint64_t Seed, int NumThreads);
+
+/// Same as PlaceMines, but the Width x Height board gets no mine on SafeIndex and its neighbours (only on SafeIndex when the mines
+/// do not fit otherwise). Mines that fall there are moved to random free cells, so the layout is as random as one drawn without them.
+void PlaceMinesAround(uint8_t* Cells, int Width, int Height, int NumMines, uint64_t Seed, int SafeIndex, int NumThreads);
+
+/// New seed for a game whose seed has not been chosen. Different on every call, also between threads.
+uint64_t MakeRandomSeed();
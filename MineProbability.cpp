@@ -0,0 +1,634 @@
+/* Exact mine probabilities, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "MineProbability.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#define SLOT_BITS 3                 // Bits of a state for the mines an open constraint still needs, 7 at most with one cell given
+#define SLOT_MASK 0x7ull
+#define SLOTS_PER_WORD 21
+#define KEY_WORDS 2                 // PROBABILITY_MAX_SLOTS / SLOTS_PER_WORD
+#define MIN_ODDS 1e-9               // Lowest odds of a mine on the areas weighed by mine, and lowest chance of no mine
+
+/// Constraint of an area checked when its cell at one position gets a mine or not
+struct FAreaStep
+{
+    int Constraint;
+    int Slot;                       // Place of its mines on the state
+    int Value;
+    int Left;                       // Cells of the constraint after this one, 0 on its last cell (which closes it)
+    bool bFirst;                    // First cell of the constraint, which opens it
+};
+
+/// Mines still needed by each open constraint of an area, SLOT_BITS for each slot
+struct FAreaKey
+{
+    uint64_t Words[KEY_WORDS] = {};
+    bool operator==(const FAreaKey& Other) const { return Words[0] == Other.Words[0] && Words[1] == Other.Words[1]; }
+};
+
+struct FAreaKeyHash
+{
+    size_t operator()(const FAreaKey& Key) const { return (size_t) (Key.Words[0] * 0x9E3779B97F4A7C15ull ^ Key.Words[1]); }
+};
+
+/// Function prototypes
+static bool NextState(const FAreaKey&, const FAreaStep*, int, int, FAreaKey&);
+static std::vector<double> Convolve(const std::vector<double>&, const std::vector<double>&, int);
+
+/// Getters
+const std::vector<double>& FMineProbability::GetProbabilities() const { return Probabilities; }
+double FMineProbability::GetProbability(int Index) const { return Probabilities[Index]; }
+double FMineProbability::GetInteriorProbability() const { return InteriorProbability; }
+bool FMineProbability::IsExact() const { return bExact; }
+
+int FMineProbability::GetSafestCell() const
+{
+    int Safest = -1;
+    for (int Cell : HiddenCells)
+    {
+        if (Safest < 0 || Probabilities[Cell] < Probabilities[Safest])
+        {
+            Safest = Cell;
+        }
+    }
+    return Safest;
+}
+
+/// Read the whole User board, count every frontier area and combine them with the interior
+bool FMineProbability::Compute(const FMineSweeper& Game)
+{
+    FBoardView Board = Game.GetUserBoard();
+    if (!Board)
+    {
+        return false;
+    }
+    Width = Game.GetBoardWidth();
+    Height = Game.GetBoardHeight();
+    int Size = Game.GetBoardSize();
+    Probabilities.assign(Size, 0.0);
+    HiddenCells.clear();
+    Constraints.clear();
+    Frontier.clear();
+    FrontierConstraints.clear();
+    FrontierNumConstraints.clear();
+    FrontierIndex.assign(Size, -1);
+    bExact = true;
+    WorkLeft = PROBABILITY_MAX_WORK / 2;                    // Half of the work for the areas counted for every number of mines
+
+    int MinesLeft = Game.GetNumMines();
+    int NumUnknown = 0;                                     // Hidden cells, flagged or not
+    for (int i = 0; i < Size; i++)
+    {
+        char Cell = Board[i];
+        if (Cell == 'X')
+        {
+            Probabilities[i] = 1.0;
+            MinesLeft--;
+        }
+        else if (Cell == '-' || Cell == 'F')
+        {
+            NumUnknown++;
+            if (Cell == '-')
+            {
+                HiddenCells.push_back(i);
+            }
+        }
+        else if (Cell >= '0' && Cell <= '8')
+        {
+            AddConstraint(Board, i, Cell - '0');
+        }
+    }
+    FindAreas();
+
+    // Areas too big to count for every number of mines, or past the work of a Compute, weigh each mine instead, and the mines expected
+    // on them are kept away from the rest. Their odds start as the density of mines of every hidden cell, and are refined with the
+    // mines they take.
+    std::vector<int> ExactAreas, WeighedAreas;
+    int WeighedCells = 0;
+    for (int a = 0; a < (int) Areas.size(); a++)
+    {
+        Areas[a].bExact = CountArea(Areas[a], MinesLeft, 0.0);
+        WorkLeft -= std::min(WorkLeft, Areas[a].Counts.size());     // Made even if the area could not be counted
+        (Areas[a].bExact ? ExactAreas : WeighedAreas).push_back(a);
+        WeighedCells += Areas[a].bExact ? 0 : (int) Areas[a].Cells.size();
+    }
+    double WeighedMines = 0.0;
+    WorkLeft = PROBABILITY_MAX_WORK / 2;                    // And half for the passes of the areas weighed by mine
+    double Density = (NumUnknown > 0) ? std::min(1.0, std::max(0.0, (double) MinesLeft / NumUnknown)) : 0.0;
+    for (int Pass = 0; Pass < PROBABILITY_ODDS_PASSES && !WeighedAreas.empty(); Pass++)
+    {
+        WeighedMines = 0.0;
+        for (int a : WeighedAreas)
+        {
+            FProbabilityArea& Area = Areas[a];
+            double Odds = std::max(Density / std::max(1.0 - Density, MIN_ODDS), MIN_ODDS);      // 0 would count every number of mines
+            bool bCounted = CountArea(Area, MinesLeft, Odds);
+            WorkLeft -= std::min(WorkLeft, Area.Counts.size() * PROBABILITY_STATE_WORK);
+            if (bCounted)
+            {
+                Area.Mines = SetAreaProbabilities(Area, std::vector<double>(1, 1.0));
+            }
+            else if (Pass == 0)                             // A later pass out of work keeps the probabilities of the one before
+            {
+                Area.Mines = EstimateArea(Area);
+            }
+            WeighedMines += Area.Mines;
+        }
+        if (NumUnknown > WeighedCells)
+        {
+            Density = std::min(1.0, std::max(0.0, (MinesLeft - WeighedMines) / (NumUnknown - WeighedCells)));
+        }
+        bExact = false;
+    }
+    int Mines = std::max(0, MinesLeft - (int) std::lround(WeighedMines));
+    int NumInterior = NumUnknown - (int) Frontier.size();
+
+    // Binomial weight of each number of mines on the counted frontier: the ways of placing the rest on the interior, divided by the
+    // biggest one so they fit a double
+    std::vector<double> Weights(Mines + 1, 0.0);
+    double MaxLogWeight = -HUGE_VAL;
+    for (int K = 0; K <= Mines; K++)
+    {
+        int Rest = Mines - K;
+        if (Rest <= NumInterior)
+        {
+            Weights[K] = std::lgamma(NumInterior + 1.0) - std::lgamma(Rest + 1.0) - std::lgamma(NumInterior - Rest + 1.0);
+            MaxLogWeight = std::max(MaxLogWeight, Weights[K]);
+        }
+    }
+    for (int K = 0; K <= Mines; K++)
+    {
+        Weights[K] = (Mines - K <= NumInterior) ? std::exp(Weights[K] - MaxLogWeight) : 0.0;
+    }
+
+    // Each area weighs its number of mines with every way of placing mines on the other areas and on the interior
+    int NumExact = (int) ExactAreas.size();
+    std::vector<std::vector<double>> Before(NumExact + 1), After(NumExact + 1);
+    Before[0].assign(1, 1.0);
+    After[NumExact].assign(1, 1.0);
+    for (int c = 0; c < NumExact; c++)
+    {
+        Before[c + 1] = Convolve(Before[c], Areas[ExactAreas[c]].Ways, Mines);
+        After[NumExact - c - 1] = Convolve(Areas[ExactAreas[NumExact - c - 1]].Ways, After[NumExact - c], Mines);
+    }
+    std::vector<double> AreaWeights;
+    for (int c = 0; c < NumExact; c++)
+    {
+        FProbabilityArea& Area = Areas[ExactAreas[c]];
+        std::vector<double> Others = Convolve(Before[c], After[c + 1], Mines);
+        AreaWeights.assign(Area.Ways.size(), 0.0);
+        for (int K = 0; K < (int) Area.Ways.size(); K++)
+        {
+            for (int m = 0; m < (int) Others.size() && K + m <= Mines; m++)
+            {
+                AreaWeights[K] += Others[m] * Weights[K + m];
+            }
+        }
+        SetAreaProbabilities(Area, AreaWeights);
+    }
+
+    // Every interior cell expects the same share of the mines left by the frontier
+    const std::vector<double>& Frontiers = Before[NumExact];
+    double Total = 0.0, InteriorMines = 0.0;
+    for (int K = 0; K < (int) Frontiers.size(); K++)
+    {
+        Total += Frontiers[K] * Weights[K];
+        InteriorMines += Frontiers[K] * Weights[K] * (Mines - K);
+    }
+    InteriorProbability = 0.0;
+    if (NumInterior > 0)
+    {
+        InteriorProbability = (Total > 0.0) ? InteriorMines / Total / NumInterior : std::min(1.0, (double) Mines / NumInterior);
+    }
+    for (int i = 0; i < Size; i++)
+    {
+        char Cell = Board[i];
+        if ((Cell == '-' || Cell == 'F') && FrontierIndex[i] < 0)
+        {
+            Probabilities[i] = InteriorProbability;
+        }
+    }
+    return true;
+}
+
+/// Rest of functions
+
+/// Add the constraint of a displayed number, if it has hidden cells around, and make them frontier cells
+void FMineProbability::AddConstraint(FBoardView Board, int Cell, int Number)
+{
+    FConstraint Constraint;
+    Constraint.Value = Number;
+    int X = Cell % Width, Y = Cell / Width;
+    for (int NY = std::max(0, Y - 1); NY <= std::min(Height - 1, Y + 1); NY++)
+    {
+        for (int NX = std::max(0, X - 1); NX <= std::min(Width - 1, X + 1); NX++)
+        {
+            int Neighbour = NX + NY * Width;
+            char Around = Board[Neighbour];
+            if (Around == 'X')
+            {
+                Constraint.Value--;
+            }
+            else if (Around == '-' || Around == 'F')
+            {
+                Constraint.Cells[Constraint.NumCells++] = Neighbour;
+            }
+        }
+    }
+    if (Constraint.NumCells == 0)
+    {
+        return;
+    }
+
+    int Index = (int) Constraints.size();
+    Constraints.push_back(Constraint);
+    for (int i = 0; i < Constraint.NumCells; i++)
+    {
+        int Hidden = Constraint.Cells[i];
+        if (FrontierIndex[Hidden] < 0)
+        {
+            FrontierIndex[Hidden] = (int) Frontier.size();
+            Frontier.push_back(Hidden);
+            FrontierConstraints.resize(FrontierConstraints.size() + 8);
+            FrontierNumConstraints.push_back(0);
+        }
+        int Position = FrontierIndex[Hidden];
+        FrontierConstraints[(size_t) Position * 8 + FrontierNumConstraints[Position]++] = Index;
+    }
+}
+
+/// Split the frontier in areas of cells linked by shared constraints
+void FMineProbability::FindAreas()
+{
+    AreaOf.assign(Frontier.size(), -1);
+    AreaPosition.assign(Frontier.size(), 0);
+    ConstraintOrdered.assign(Constraints.size(), 0);
+    Areas.clear();
+    for (int f = 0; f < (int) Frontier.size(); f++)
+    {
+        if (AreaOf[f] < 0)
+        {
+            Areas.push_back(FProbabilityArea());
+            OrderArea(f, (int) Areas.size() - 1);
+        }
+    }
+}
+
+/// Collect the area of a frontier cell and order it. A breadth first search finds a cell at one end of the area (the last one it
+/// reaches). From there, each cell ordered is the candidate that opens the fewest constraints minus the ones it closes, the first
+/// found on a tie, so the constraints open at once stay few.
+void FMineProbability::OrderArea(int Start, int AreaIndex)
+{
+    FProbabilityArea& Area = Areas[AreaIndex];
+    Area.Cells.assign(1, Frontier[Start]);
+    AreaOf[Start] = -2;
+    for (size_t Next = 0; Next < Area.Cells.size(); Next++)
+    {
+        int Position = FrontierIndex[Area.Cells[Next]];
+        for (int c = 0; c < FrontierNumConstraints[Position]; c++)
+        {
+            const FConstraint& Constraint = Constraints[FrontierConstraints[(size_t) Position * 8 + c]];
+            for (int i = 0; i < Constraint.NumCells; i++)
+            {
+                int Around = FrontierIndex[Constraint.Cells[i]];
+                if (AreaOf[Around] != -2)
+                {
+                    AreaOf[Around] = -2;
+                    Area.Cells.push_back(Constraint.Cells[i]);
+                }
+            }
+        }
+    }
+    int NumCells = (int) Area.Cells.size();
+    Candidates.assign(1, FrontierIndex[Area.Cells.back()]);
+    Area.Cells.clear();
+    AreaOf[Candidates[0]] = -3;                             // Candidate, -2 is a cell of the area not reached yet
+    while ((int) Area.Cells.size() < NumCells)
+    {
+        int Best = 0, BestScore = 0;
+        for (int c = 0; c < (int) Candidates.size(); c++)
+        {
+            int Position = Candidates[c], Score = 0;
+            for (int k = 0; k < FrontierNumConstraints[Position]; k++)
+            {
+                int Index = FrontierConstraints[(size_t) Position * 8 + k];
+                Score += (ConstraintOrdered[Index] == 0) ? 1 : 0;
+                Score -= (ConstraintOrdered[Index] == Constraints[Index].NumCells - 1) ? 1 : 0;
+            }
+            if (c == 0 || Score < BestScore)
+            {
+                Best = c;
+                BestScore = Score;
+            }
+        }
+        int Position = Candidates[Best];
+        Candidates.erase(Candidates.begin() + Best);
+        AreaOf[Position] = AreaIndex;
+        AreaPosition[Position] = (int) Area.Cells.size();
+        Area.Cells.push_back(Frontier[Position]);
+        for (int k = 0; k < FrontierNumConstraints[Position]; k++)
+        {
+            int Index = FrontierConstraints[(size_t) Position * 8 + k];
+            if (ConstraintOrdered[Index]++ == 0)
+            {
+                Area.Constraints.push_back(Index);
+            }
+            const FConstraint& Constraint = Constraints[Index];
+            for (int i = 0; i < Constraint.NumCells; i++)
+            {
+                int Around = FrontierIndex[Constraint.Cells[i]];
+                if (AreaOf[Around] == -2)
+                {
+                    AreaOf[Around] = -3;
+                    Candidates.push_back(Around);
+                }
+            }
+        }
+    }
+}
+
+/// Pass forward of an area: give a mine or not to each cell in order, merging the assignments with the same mines on the open
+/// constraints. With Odds at 0 the ways are counted for every number of mines, otherwise each way weighs Odds for each of its mines.
+/// Returns false if the area is too wide to count, its counts outgrow the work left, or no assignment meets every constraint.
+bool FMineProbability::CountArea(FProbabilityArea& Area, int MinesLeft, double Odds)
+{
+    int NumCells = (int) Area.Cells.size();
+    bool bWeighed = Odds > 0.0;
+    Area.Odds = Odds;
+    Area.Counts.clear();                                    // The counts made are the work of the area, none if it is too wide
+    int MaxMines = bWeighed ? 0 : std::min(NumCells, std::max(MinesLeft, 0));
+    size_t MaxCounts = std::min((size_t) PROBABILITY_MAX_TABLE, WorkLeft / (bWeighed ? PROBABILITY_STATE_WORK : 1));
+
+    // The steps of each position, with the slot of each constraint taken at its first cell and freed after its last one
+    std::vector<std::vector<FAreaStep>> Steps(NumCells);
+    std::vector<std::vector<int>> Closing(NumCells);
+    std::vector<int> Positions;
+    for (int Index : Area.Constraints)
+    {
+        const FConstraint& Constraint = Constraints[Index];
+        Positions.clear();
+        for (int i = 0; i < Constraint.NumCells; i++)
+        {
+            Positions.push_back(AreaPosition[FrontierIndex[Constraint.Cells[i]]]);
+        }
+        std::sort(Positions.begin(), Positions.end());
+        for (int i = 0; i < (int) Positions.size(); i++)
+        {
+            Steps[Positions[i]].push_back({ Index, -1, Constraint.Value, (int) Positions.size() - 1 - i, i == 0 });
+        }
+        Closing[Positions.back()].push_back(Index);
+    }
+    std::vector<int> SlotOf(Constraints.size(), -1);
+    bool bSlotUsed[PROBABILITY_MAX_SLOTS] = {};
+    for (int i = 0; i < NumCells; i++)
+    {
+        for (FAreaStep& Step : Steps[i])
+        {
+            if (SlotOf[Step.Constraint] < 0)
+            {
+                int Slot = 0;
+                while (Slot < PROBABILITY_MAX_SLOTS && bSlotUsed[Slot])
+                {
+                    Slot++;
+                }
+                if (Slot == PROBABILITY_MAX_SLOTS)
+                {
+                    return false;
+                }
+                bSlotUsed[Slot] = true;
+                SlotOf[Step.Constraint] = Slot;
+            }
+            Step.Slot = SlotOf[Step.Constraint];
+        }
+        for (int Index : Closing[i])
+        {
+            bSlotUsed[SlotOf[Index]] = false;
+        }
+    }
+
+    Area.LayerStates.assign(1, 0);
+    Area.LayerCounts.assign(1, 0);
+    Area.LayerMines.assign(1, 0);
+    Area.LayerScales.assign(1, 0.0);
+    Area.Next.clear();
+    Area.Counts.assign(1, 1.0);
+    std::vector<FAreaKey> Keys(1);
+    std::unordered_map<FAreaKey, int, FAreaKeyHash> NextIndex;
+    for (int i = 0; i < NumCells; i++)
+    {
+        size_t First = Area.LayerStates[i], Last = Keys.size();
+        int Mines = Area.LayerMines[i];
+        int NextMines = std::min(Mines + 1, MaxMines);
+        Area.LayerStates.push_back(Last);
+        Area.LayerCounts.push_back(Area.Counts.size());
+        Area.LayerMines.push_back(NextMines);
+        NextIndex.clear();
+        for (size_t s = First; s < Last; s++)
+        {
+            for (int Mine = 0; Mine <= 1; Mine++)
+            {
+                FAreaKey Key;
+                int Shift = bWeighed ? 0 : Mine;                // Counts of a state are indexed by mines, unless mines are weighed
+                double Weight = (bWeighed && Mine) ? Odds : 1.0;
+                if (Shift > NextMines || !NextState(Keys[s], Steps[i].data(), (int) Steps[i].size(), Mine, Key))
+                {
+                    Area.Next.push_back(-1);
+                    continue;
+                }
+                std::unordered_map<FAreaKey, int, FAreaKeyHash>::iterator Found = NextIndex.find(Key);
+                int Target = 0;
+                if (Found == NextIndex.end())
+                {
+                    Target = (int) (Keys.size() - Last);
+                    NextIndex.emplace(Key, Target);
+                    Keys.push_back(Key);
+                    Area.Counts.resize(Area.Counts.size() + NextMines + 1, 0.0);
+                    if (Area.Counts.size() > MaxCounts)
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    Target = Found->second;
+                }
+                Area.Next.push_back(Target);
+                const double* From = &Area.Counts[Area.LayerCounts[i] + (s - First) * (Mines + 1)];
+                double* To = &Area.Counts[Area.LayerCounts[i + 1] + (size_t) Target * (NextMines + 1)];
+                for (int m = 0; m + Shift <= NextMines && m <= Mines; m++)
+                {
+                    To[m + Shift] += From[m] * Weight;
+                }
+            }
+        }
+        // The constraints keep the mines of a layer well under its number of cells: the counts of each state are cut after the most
+        // mines any state reached, so the next layers do not carry the numbers no way reaches
+        double* Layer = &Area.Counts[Area.LayerCounts[i + 1]];
+        size_t NumStates = Keys.size() - Last;
+        int MostMines = 0;
+        double Biggest = 0.0;
+        for (size_t s = 0; s < NumStates; s++)
+        {
+            for (int m = 0; m <= NextMines; m++)
+            {
+                MostMines = (Layer[s * (NextMines + 1) + m] > 0.0) ? std::max(MostMines, m) : MostMines;
+                Biggest = std::max(Biggest, Layer[s * (NextMines + 1) + m]);
+            }
+        }
+        if (Biggest <= 0.0)
+        {
+            return false;
+        }
+        if (MostMines < NextMines)
+        {
+            for (size_t s = 1; s < NumStates; s++)          // Moved down, the first state is already in place
+            {
+                std::copy(Layer + s * (NextMines + 1), Layer + s * (NextMines + 1) + MostMines + 1, Layer + s * (MostMines + 1));
+            }
+            Area.Counts.resize(Area.LayerCounts[i + 1] + NumStates * (MostMines + 1));
+            Area.LayerMines.back() = MostMines;
+        }
+        for (size_t c = Area.LayerCounts[i + 1]; c < Area.Counts.size(); c++)
+        {
+            Area.Counts[c] /= Biggest;
+        }
+        Area.LayerScales.push_back(Area.LayerScales[i] + std::log(Biggest));
+    }
+    Area.LayerStates.push_back(Keys.size());
+    if (Area.LayerStates[NumCells + 1] - Area.LayerStates[NumCells] != 1)
+    {
+        return false;                                       // Every constraint is closed at the end, so only state 0 is left
+    }
+    Area.Ways.assign(Area.Counts.begin() + Area.LayerCounts[NumCells], Area.Counts.end());
+    return true;
+}
+
+/// Pass backwards of a counted area. Weights has the weight of each number of mines on the area (a single 1 if mines are weighed);
+/// each cell gets the weight of the ways with a mine on it, divided by the weight of all the ways. Returns the mines expected.
+double FMineProbability::SetAreaProbabilities(FProbabilityArea& Area, const std::vector<double>& Weights)
+{
+    int NumCells = (int) Area.Cells.size();
+    std::vector<double> After(Weights.begin(), Weights.begin() + Area.LayerMines[NumCells] + 1);
+    std::vector<double> Before;
+    double Total = 0.0, Expected = 0.0, AfterScale = 0.0;
+    for (int m = 0; m < (int) After.size(); m++)
+    {
+        Total += Area.Ways[m] * After[m];
+    }
+    if (Total <= 0.0)
+    {
+        bExact = false;
+        return EstimateArea(Area);                          // The mines left do not fit the constraints
+    }
+    bool bWeighed = Area.Odds > 0.0;
+
+    for (int i = NumCells - 1; i >= 0; i--)
+    {
+        size_t First = Area.LayerStates[i];
+        int NumStates = (int) (Area.LayerStates[i + 1] - First);
+        int Mines = Area.LayerMines[i], NextMines = Area.LayerMines[i + 1];
+        Before.assign((size_t) NumStates * (Mines + 1), 0.0);
+        double WithMine = 0.0;
+        for (int s = 0; s < NumStates; s++)
+        {
+            const double* Ways = &Area.Counts[Area.LayerCounts[i] + (size_t) s * (Mines + 1)];
+            for (int Mine = 0; Mine <= 1; Mine++)
+            {
+                int Target = Area.Next[(First + s) * 2 + Mine];
+                if (Target < 0)
+                {
+                    continue;
+                }
+                const double* Rest = &After[(size_t) Target * (NextMines + 1)];
+                int Shift = bWeighed ? 0 : Mine;
+                double Weight = (bWeighed && Mine) ? Area.Odds : 1.0;
+                for (int m = 0; m + Shift <= NextMines && m <= Mines; m++)
+                {
+                    Before[(size_t) s * (Mines + 1) + m] += Rest[m + Shift] * Weight;
+                    WithMine += Mine ? Ways[m] * Rest[m + Shift] * Weight : 0.0;
+                }
+            }
+        }
+        // The counts of this layer and the weights after it were divided, the ways of the last layer too
+        double Probability = WithMine / Total * std::exp(Area.LayerScales[i] + AfterScale - Area.LayerScales[NumCells]);
+        Probabilities[Area.Cells[i]] = std::min(1.0, Probability);
+        Expected += Probabilities[Area.Cells[i]];
+        double Biggest = *std::max_element(Before.begin(), Before.end());
+        if (Biggest > 0.0)
+        {
+            for (double& Value : Before)
+            {
+                Value /= Biggest;
+            }
+            AfterScale += std::log(Biggest);
+        }
+        After.swap(Before);
+    }
+    return Expected;
+}
+
+/// Give each cell of an area the mean of the mines per hidden cell of its constraints. Returns the mines expected on the area.
+double FMineProbability::EstimateArea(const FProbabilityArea& Area)
+{
+    double Expected = 0.0;
+    for (int Cell : Area.Cells)
+    {
+        int Position = FrontierIndex[Cell];
+        double Sum = 0.0;
+        for (int c = 0; c < FrontierNumConstraints[Position]; c++)
+        {
+            const FConstraint& Constraint = Constraints[FrontierConstraints[(size_t) Position * 8 + c]];
+            Sum += std::min(1.0, std::max(0.0, (double) Constraint.Value / Constraint.NumCells));
+        }
+        Probabilities[Cell] = Sum / FrontierNumConstraints[Position];
+        Expected += Probabilities[Cell];
+    }
+    return Expected;
+}
+
+/// State after giving a mine (Mine = 1) or not to the cell of the steps. Returns false if a constraint can no longer be met.
+static bool NextState(const FAreaKey& Key, const FAreaStep* Steps, int NumSteps, int Mine, FAreaKey& NextKey)
+{
+    NextKey = Key;
+    for (int i = 0; i < NumSteps; i++)
+    {
+        uint64_t& Word = NextKey.Words[Steps[i].Slot / SLOTS_PER_WORD];
+        int Shift = (Steps[i].Slot % SLOTS_PER_WORD) * SLOT_BITS;
+        int Needed = (Steps[i].bFirst ? Steps[i].Value : (int) ((Word >> Shift) & SLOT_MASK)) - Mine;
+        if (Needed < 0 || Needed > Steps[i].Left)
+        {
+            return false;
+        }
+        Word &= ~(SLOT_MASK << Shift);
+        Word |= (uint64_t) Needed << Shift;                 // 0 once the constraint is closed, which frees its slot
+    }
+    return true;
+}
+
+/// Ways of placing each number of mines on two sets of cells, up to MaxMines, divided by the biggest one so they fit a double
+static std::vector<double> Convolve(const std::vector<double>& A, const std::vector<double>& B, int MaxMines)
+{
+    std::vector<double> Result(std::min(A.size() + B.size() - 1, (size_t) MaxMines + 1), 0.0);
+    double Biggest = 0.0;
+    for (size_t i = 0; i < A.size() && i < Result.size(); i++)
+    {
+        for (size_t j = 0; j < B.size() && i + j < Result.size(); j++)
+        {
+            Result[i + j] += A[i] * B[j];
+        }
+    }
+    for (double Value : Result)
+    {
+        Biggest = std::max(Biggest, Value);
+    }
+    for (double& Value : Result)
+    {
+        Value = (Biggest > 0.0) ? Value / Biggest : 0.0;
+    }
+    return Result;
+}
@@ -0,0 +1,103 @@
+/* Exact probability of a mine on every hidden cell, from what a player can see (the User board) and the number of mines of the game.
+
+Each displayed number is a constraint on the hidden cells around it, as on the solver (Solver.h). The hidden cells that touch a number
+(the frontier) are split in areas that share no constraint, and each area is counted on its own:
+1. Its cells are ordered from a cell at one end of the area, taking each time the cell that opens the fewest new constraints (and
+   closes the most), so few constraints are open at once. Then they are given a mine or not one by one.
+2. Only the constraints with some of their cells given and some not limit the cells left, so every assignment that puts the same
+   mines on those constraints is merged into one state (backtracking memoized on those counts). Each state keeps how many ways reach
+   it with each number of mines.
+3. A pass backwards from the last cell gives, for every cell, the weight of the ways that put a mine on it.
+The hidden cells that touch no number (the interior) share the rest of the mines, so the ways of placing K mines on the whole frontier
+weigh C(interior cells, mines left - K). The areas are combined with those binomial weights, and every interior cell gets the same
+probability. Each layer of counts is divided by its biggest one (and the factor kept) so they fit a double on areas of any size.
+The work of a Compute is bounded (PROBABILITY_MAX_WORK), so its time stays a few ms on any board. An area with too many counts for
+every number of mines (more than PROBABILITY_MAX_TABLE or than the work the areas before it left) is counted with one weight per
+state instead: each mine weighs the odds of a mine on the interior, as the binomial weights do for a frontier much smaller than the
+interior. Those odds are refined PROBABILITY_ODDS_PASSES times with the mines the areas take (a pass out of work keeps the
+probabilities of the one before). An area with more than PROBABILITY_MAX_SLOTS constraints open at once, or too many states even
+weighed, is estimated from the mines and hidden cells of its constraints. In both cases IsExact returns false.
+Flags are only the guesses of the player, so flagged cells are hidden cells like the others. An exploded mine (X) is a mine for sure.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include "Minesweeper.h"
+#include <cstdint>
+#include <vector>
+
+#define PROBABILITY_MAX_SLOTS 42        // Constraints open at once on a counted area, each one takes 3 bits of a 128 bit state
+#define PROBABILITY_MAX_TABLE (1 << 18) // Counts kept by the pass forward of an area (2 MB), bigger areas weigh each mine instead
+#define PROBABILITY_MAX_WORK (1 << 18)  // Counts made by a Compute (about 6 ms), half of them for the areas weighed by mine
+#define PROBABILITY_STATE_WORK 8        // An area weighed by mine has one count per state, which takes as long as 8 other counts
+#define PROBABILITY_ODDS_PASSES 2       // Times the areas weighed by mine are counted, refining the odds of a mine
+
+/// Frontier area: hidden cells linked by shared constraints, and the counts of the pass forward
+struct FProbabilityArea
+{
+    std::vector<int> Cells;                 // In the order they are counted
+    std::vector<int> Constraints;
+    bool bExact = false;
+    double Odds = 0.0;                      // Weight of each mine, 0 if the ways are counted for every number of mines
+    double Mines = 0.0;                     // Mines expected on the area when each mine is weighed
+
+    /// Pass forward: the states after giving a mine or not to each cell, and the ways of reaching each state with each number of mines
+    std::vector<size_t> LayerStates;        // First state of each layer, and one past the last state
+    std::vector<size_t> LayerCounts;        // First count of each layer
+    std::vector<int> LayerMines;            // Most mines counted on each layer, 0 if each mine is weighed instead
+    std::vector<double> LayerScales;        // Log of the factor the counts of each layer were divided by
+    std::vector<int> Next;                  // State reached from each state without and with a mine on the next cell, -1 if not valid
+    std::vector<double> Counts;
+    std::vector<double> Ways;               // Ways of placing each number of mines on the whole area
+};
+
+/// Mine probabilities of the game being played. Call Compute after every move, it reuses its buffers.
+class FMineProbability
+{
+    public:
+        /// Getters
+        const std::vector<double>& GetProbabilities() const;    // One per cell: 0 on displayed numbers, 1 on exploded mines
+        double GetProbability(int) const;
+        double GetInteriorProbability() const;  // Of the hidden cells that touch no displayed number
+        int GetSafestCell() const;              // Hidden cell, not flagged, with the lowest probability. -1 if there is none.
+        bool IsExact() const;                   // false if some area was estimated
+
+        /// Rest of functions
+        bool Compute(const FMineSweeper&);      // Returns false if the game has no board
+
+    private:
+        /// Constraint of a displayed number: mines left around it (exploded mines are taken out) and its hidden cells
+        struct FConstraint
+        {
+            int Value = 0;
+            int NumCells = 0;
+            int Cells[8];
+        };
+
+        int Width = 0;
+        int Height = 0;
+        double InteriorProbability = 0.0;
+        bool bExact = true;
+        size_t WorkLeft = 0;                    // Of the areas counted for every number of mines, or of the passes weighed by mine
+        std::vector<double> Probabilities;
+        std::vector<int> HiddenCells;           // Hidden and not flagged, the cells a player may reveal
+        std::vector<FConstraint> Constraints;
+        std::vector<int> FrontierIndex;         // Position of each cell on Frontier, -1 for the rest
+        std::vector<int> Frontier;
+        std::vector<int> FrontierConstraints;   // Constraints of each frontier cell, 8 places for each one
+        std::vector<uint8_t> FrontierNumConstraints;
+        std::vector<int> AreaOf;                // Area of each frontier cell, -1 while it has none
+        std::vector<int> AreaPosition;          // Position of each frontier cell on its area
+        std::vector<int> ConstraintOrdered;     // Cells of each constraint already ordered on its area
+        std::vector<int> Candidates;            // Frontier cells of the open constraints, not ordered yet
+        std::vector<FProbabilityArea> Areas;
+
+        /// Rest of functions
+        void AddConstraint(FBoardView, int, int);
+        void FindAreas();
+        void OrderArea(int, int);
+        bool CountArea(FProbabilityArea&, int, double);
+        double SetAreaProbabilities(FProbabilityArea&, const std::vector<double>&);
+        double EstimateArea(const FProbabilityArea&);
+};
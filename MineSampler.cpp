@@ -0,0 +1,626 @@
+/* Monte Carlo mine probabilities, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "MineSampler.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+#define TIME_CHECK_STEPS 64         // Steps of a chain between two reads of the clock
+
+/// Placement of a block drawn by FindPlacements, among those that meet every constraint
+struct FBlockPlacements
+{
+    int Needed[SAMPLER_BLOCK_CELLS * 8];                    // Mines each constraint of the block still needs
+    int Left[SAMPLER_BLOCK_CELLS * 8];                      // Cells of the block around each constraint not given yet
+    double Weights[SAMPLER_BLOCK_CELLS + 1];                // Of each number of mines on the block
+    FCounterRng* Rng = nullptr;
+    int NodesLeft = SAMPLER_BLOCK_NODES;                    // Below 0 when the search was cut
+    double Total = 0.0;                                     // Weight of the placements found
+    uint32_t Chosen = 0;
+};
+
+/// Function prototypes
+static void FindPlacements(const FSamplerBlock&, int, uint32_t, int, FBlockPlacements&);
+static int CountBits(uint32_t);
+static void CombineChains(const std::vector<double>&, const std::vector<double>&, const std::vector<double>&, double&, double&, double&);
+
+FMineSampler::FMineSampler(int NumChains, int NumThreads)
+{
+    Chains.resize(std::max(1, NumChains));
+    if (NumThreads != 1)
+    {
+        Pool = std::unique_ptr<FThreadPool>(new FThreadPool(NumThreads));
+    }
+}
+
+/// Getters
+const std::vector<double>& FMineSampler::GetProbabilities() const { return Probabilities; }
+double FMineSampler::GetProbability(int Index) const { return Probabilities[Index]; }
+double FMineSampler::GetConfidence(int Index) const { return Confidences[Index]; }
+double FMineSampler::GetInteriorProbability() const { return InteriorProbability; }
+double FMineSampler::GetMaxRhat() const { return MaxRhat; }
+
+int FMineSampler::GetSafestCell() const
+{
+    int Safest = -1;
+    for (int Cell : HiddenCells)
+    {
+        if (Safest < 0 || Probabilities[Cell] < Probabilities[Safest])
+        {
+            Safest = Cell;
+        }
+    }
+    return Safest;
+}
+
+uint64_t FMineSampler::GetNumSamples() const
+{
+    uint64_t Samples = 0;
+    for (const FSamplerChain& Chain : Chains)
+    {
+        Samples += Chain.Samples;
+    }
+    return Samples;
+}
+
+int FMineSampler::GetNumValidChains() const
+{
+    int Valid = 0;
+    for (const FSamplerChain& Chain : Chains)
+    {
+        Valid += Chain.bValid ? 1 : 0;
+    }
+    return Valid;
+}
+
+bool FMineSampler::IsConverged() const
+{
+    if (Frontier.empty())
+    {
+        return true;
+    }
+    for (const FSamplerChain& Chain : Chains)
+    {
+        if (Chain.Samples < SAMPLER_MIN_SAMPLES)
+        {
+            return false;
+        }
+    }
+    return MaxRhat <= SAMPLER_MAX_RHAT;
+}
+
+/// Read the whole User board, build the constraints and the weights of the interior, and put every chain back at no mines
+bool FMineSampler::Start(const FMineSweeper& Game, uint64_t Seed)
+{
+    FBoardView Board = Game.GetUserBoard();
+    if (!Board)
+    {
+        return false;
+    }
+    Width = Game.GetBoardWidth();
+    Height = Game.GetBoardHeight();
+    int Size = Game.GetBoardSize();
+    Probabilities.assign(Size, 0.0);
+    Confidences.assign(Size, 0.0);
+    HiddenCells.clear();
+    InteriorCells.clear();
+    Constraints.clear();
+    Frontier.clear();
+    FrontierConstraints.clear();
+    FrontierNumConstraints.clear();
+    FrontierIndex.assign(Size, -1);
+
+    MinesLeft = Game.GetNumMines();
+    for (int i = 0; i < Size; i++)
+    {
+        char Cell = Board[i];
+        if (Cell == 'X')
+        {
+            Probabilities[i] = 1.0;
+            MinesLeft--;
+        }
+        else if (Cell == '-')
+        {
+            HiddenCells.push_back(i);
+        }
+        else if (Cell >= '0' && Cell <= '8')
+        {
+            AddConstraint(Board, i, Cell - '0');
+        }
+    }
+    for (int i = 0; i < Size; i++)
+    {
+        char Cell = Board[i];
+        if ((Cell == '-' || Cell == 'F') && FrontierIndex[i] < 0)
+        {
+            InteriorCells.push_back(i);
+        }
+    }
+    NumInterior = (int) InteriorCells.size();
+
+    // The weight of each number of mines on the frontier only matters against the one of the chain, so the logs are kept as they are
+    LogWeights.assign(Frontier.size() + 1, -HUGE_VAL);
+    for (int K = 0; K <= (int) Frontier.size(); K++)
+    {
+        int Rest = MinesLeft - K;
+        if (Rest >= 0 && Rest <= NumInterior)
+        {
+            LogWeights[K] = std::lgamma(NumInterior + 1.0) - std::lgamma(Rest + 1.0) - std::lgamma(NumInterior - Rest + 1.0);
+        }
+    }
+
+    for (int c = 0; c < (int) Chains.size(); c++)
+    {
+        FSamplerChain& Chain = Chains[c];
+        Chain.Rng = FCounterRng(Seed, c);
+        Chain.Mines.assign(Frontier.size(), 0);
+        Chain.ConstraintMines.assign(Constraints.size(), 0);
+        Chain.Violated.clear();
+        Chain.ViolatedPosition.assign(Constraints.size(), -1);
+        Chain.CellStamps.assign(Frontier.size(), 0);
+        Chain.ConstraintStamps.assign(Constraints.size(), 0);
+        Chain.BlockPosition.assign(Constraints.size(), 0);
+        Chain.Stamp = 0;
+        Chain.FrontierMines = 0;
+        for (int k = 0; k < (int) Constraints.size(); k++)
+        {
+            SetViolated(Chain, k);
+        }
+        Chain.bValid = Chain.Violated.empty() && LogWeights[0] > -HUGE_VAL;
+        Chain.Steps = 0;
+        Chain.Samples = 0;
+        Chain.MineSamples.assign(Frontier.size(), 0);
+        Chain.InteriorSum = 0.0;
+        Chain.InteriorSquares = 0.0;
+    }
+    UpdateEstimate();
+    return true;
+}
+
+/// Rounds of SAMPLER_ROUND_STEPS steps of every chain until the time is over, so with fewer threads than chains each chain still
+/// gets its share of the time
+void FMineSampler::Run(int Milliseconds)
+{
+    std::chrono::steady_clock::time_point Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(Milliseconds);
+    while (!Constraints.empty() && std::chrono::steady_clock::now() < Deadline)
+    {
+        for (FSamplerChain& Chain : Chains)
+        {
+            if (Pool)
+            {
+                FSamplerChain* ChainPointer = &Chain;       // Each task only touches its own chain, the rest is only read
+                Pool->Submit([this, ChainPointer, &Deadline](int) { RunChain(*ChainPointer, Deadline); });
+            }
+            else
+            {
+                RunChain(Chain, Deadline);
+            }
+        }
+        if (Pool)
+        {
+            Pool->Wait();
+        }
+    }
+    UpdateEstimate();
+}
+
+/// Rest of functions
+
+/// Add the constraint of a displayed number, if it has hidden cells around, and make them frontier cells
+void FMineSampler::AddConstraint(FBoardView Board, int Cell, int Number)
+{
+    FConstraint Constraint;
+    Constraint.Value = Number;
+    int X = Cell % Width, Y = Cell / Width;
+    for (int NY = std::max(0, Y - 1); NY <= std::min(Height - 1, Y + 1); NY++)
+    {
+        for (int NX = std::max(0, X - 1); NX <= std::min(Width - 1, X + 1); NX++)
+        {
+            int Neighbour = NX + NY * Width;
+            char Around = Board[Neighbour];
+            if (Around == 'X')
+            {
+                Constraint.Value--;
+            }
+            else if (Around == '-' || Around == 'F')
+            {
+                if (FrontierIndex[Neighbour] < 0)
+                {
+                    FrontierIndex[Neighbour] = (int) Frontier.size();
+                    Frontier.push_back(Neighbour);
+                    FrontierConstraints.resize(FrontierConstraints.size() + 8);
+                    FrontierNumConstraints.push_back(0);
+                }
+                Constraint.Cells[Constraint.NumCells++] = FrontierIndex[Neighbour];
+            }
+        }
+    }
+    if (Constraint.NumCells == 0)
+    {
+        return;
+    }
+
+    int Index = (int) Constraints.size();
+    Constraints.push_back(Constraint);
+    for (int i = 0; i < Constraint.NumCells; i++)
+    {
+        int Position = Constraint.Cells[i];
+        FrontierConstraints[(size_t) Position * 8 + FrontierNumConstraints[Position]++] = Index;
+    }
+}
+
+/// One round of a chain, cut short when the time is over
+void FMineSampler::RunChain(FSamplerChain& Chain, const std::chrono::steady_clock::time_point& Deadline)
+{
+    for (int s = 0; s < SAMPLER_ROUND_STEPS; s++)
+    {
+        if (s % TIME_CHECK_STEPS == 0 && std::chrono::steady_clock::now() >= Deadline)
+        {
+            return;
+        }
+        Step(Chain);
+    }
+}
+
+/// Search a placement that meets every constraint, or take a new sample of the chain once it has one
+void FMineSampler::Step(FSamplerChain& Chain)
+{
+    if (!Chain.bValid)
+    {
+        Search(Chain);
+        Chain.bValid = Chain.Violated.empty() && LogWeights[Chain.FrontierMines] > -HUGE_VAL;
+        return;
+    }
+
+    FSamplerBlock Block;
+    int MaxCells = (Chain.Rng.NextDouble() < SAMPLER_BIG_BLOCKS) ? SAMPLER_BLOCK_CELLS : SAMPLER_SMALL_BLOCK_CELLS;
+    MakeBlock(Chain, (int) Chain.Rng.NextBelow((uint32_t) Constraints.size()), MaxCells, Block);
+    int Outside = Chain.FrontierMines;                      // Mines of the frontier off the block
+    for (int i = 0; i < Block.NumCells; i++)
+    {
+        Outside -= Chain.Mines[Block.Cells[i]];
+    }
+    FBlockPlacements Found;
+    for (int m = 0; m <= Block.NumCells; m++)               // Weight of each number of mines on the block, against the one of the chain
+    {
+        double LogWeight = LogWeights[Outside + m];
+        Found.Weights[m] = (LogWeight > -HUGE_VAL) ? std::exp(LogWeight - LogWeights[Chain.FrontierMines]) : 0.0;
+    }
+    for (int k = 0; k < Block.NumConstraints; k++)
+    {
+        Found.Left[k] = CountBits(Block.Masks[k]);
+        Found.Needed[k] = Block.Needed[k];
+    }
+    Found.Rng = &Chain.Rng;
+    FindPlacements(Block, 0, 0, 0, Found);
+    // The placement of the chain is always found, unless the weights underflow. A cut search keeps it: whether a search is cut only
+    // depends on the mines off the block, so both ways keep the chance of each placement of the block.
+    if (Found.NodesLeft >= 0 && Found.Total > 0.0)
+    {
+        SetBlock(Chain, Block, Found.Chosen);
+    }
+
+    Chain.Steps++;
+    if (Chain.Steps % Constraints.size() == 0 && Chain.Steps >= (uint64_t) SAMPLER_BURN_IN_SWEEPS * Constraints.size())
+    {
+        Chain.Samples++;
+        for (size_t f = 0; f < Frontier.size(); f++)
+        {
+            Chain.MineSamples[f] += Chain.Mines[f];
+        }
+        double Interior = (NumInterior > 0) ? (double) (MinesLeft - Chain.FrontierMines) / NumInterior : 0.0;
+        Chain.InteriorSum += Interior;
+        Chain.InteriorSquares += Interior * Interior;
+    }
+}
+
+/// Take a constraint that is not met and flip the cell of it (a mine if it needs more, an empty cell if it has too many) that leaves
+/// the fewest mines missing or left over around, a random one on a tie or with SAMPLER_NOISE (WalkSAT). With every constraint met
+/// but a number of mines the interior can not take, a random cell is flipped.
+void FMineSampler::Search(FSamplerChain& Chain)
+{
+    if (Chain.Violated.empty())
+    {
+        FlipCell(Chain, (int) Chain.Rng.NextBelow((uint32_t) Frontier.size()));
+        return;
+    }
+    int Constraint = Chain.Violated[Chain.Rng.NextBelow((uint32_t) Chain.Violated.size())];
+    const FConstraint& Wrong = Constraints[Constraint];
+    uint8_t Flipped = (Chain.ConstraintMines[Constraint] < Wrong.Value) ? 0 : 1;   // Cells that may be flipped
+    bool bNoise = Chain.Rng.NextDouble() < SAMPLER_NOISE;
+    int Best = -1, BestChange = 0, Ties = 0;
+    for (int i = 0; i < Wrong.NumCells; i++)
+    {
+        int Cell = Wrong.Cells[i];
+        if (Chain.Mines[Cell] != Flipped)
+        {
+            continue;
+        }
+        int Change = 0;                                     // Mines missing or left over after the flip, minus before
+        int Mine = 1 - 2 * Flipped;
+        for (int c = 0; c < FrontierNumConstraints[Cell] && !bNoise; c++)
+        {
+            int Around = FrontierConstraints[(size_t) Cell * 8 + c];
+            int Wrongness = Chain.ConstraintMines[Around] - Constraints[Around].Value;
+            Change += std::abs(Wrongness + Mine) - std::abs(Wrongness);
+        }
+        if (Best < 0 || Change < BestChange)
+        {
+            Best = Cell;
+            BestChange = Change;
+            Ties = 1;
+        }
+        else if (Change == BestChange && Chain.Rng.NextBelow(++Ties) == 0)
+        {
+            Best = Cell;
+        }
+    }
+    FlipCell(Chain, Best);
+}
+
+/// Cells of a constraint, then of the constraints of the cells of the block, in the order the cells were added (breadth first)
+/// and only if they fit whole, so a block can move mines along a row of constraints; and every constraint around those cells
+void FMineSampler::MakeBlock(FSamplerChain& Chain, int Constraint, int MaxCells, FSamplerBlock& Block)
+{
+    if (++Chain.Stamp == 0)                                 // Wrapped around, old stamps could match again
+    {
+        std::fill(Chain.CellStamps.begin(), Chain.CellStamps.end(), 0);
+        std::fill(Chain.ConstraintStamps.begin(), Chain.ConstraintStamps.end(), 0);
+        Chain.Stamp = 1;
+    }
+    const FConstraint& First = Constraints[Constraint];
+    Block.NumCells = First.NumCells;
+    for (int i = 0; i < First.NumCells; i++)
+    {
+        Block.Cells[i] = First.Cells[i];
+        Chain.CellStamps[First.Cells[i]] = Chain.Stamp;
+    }
+    for (int Next = 0; Next < Block.NumCells && Block.NumCells < MaxCells; Next++)
+    {
+        int Shared = Block.Cells[Next];
+        int Offset = (int) Chain.Rng.NextBelow(FrontierNumConstraints[Shared]);
+        for (int c = 0; c < FrontierNumConstraints[Shared]; c++)
+        {
+            const FConstraint& Around = Constraints[FrontierConstraints[(size_t) Shared * 8 + (c + Offset) % FrontierNumConstraints[Shared]]];
+            int NumCells = Block.NumCells;
+            for (int i = 0; i < Around.NumCells; i++)
+            {
+                NumCells += (Chain.CellStamps[Around.Cells[i]] != Chain.Stamp) ? 1 : 0;
+            }
+            for (int i = 0; i < Around.NumCells && NumCells <= MaxCells; i++)
+            {
+                if (Chain.CellStamps[Around.Cells[i]] != Chain.Stamp)
+                {
+                    Chain.CellStamps[Around.Cells[i]] = Chain.Stamp;
+                    Block.Cells[Block.NumCells++] = Around.Cells[i];
+                }
+            }
+        }
+    }
+
+    Block.NumConstraints = 0;
+    for (int i = 0; i < Block.NumCells; i++)
+    {
+        int Cell = Block.Cells[i];
+        Block.NumCellConstraints[i] = FrontierNumConstraints[Cell];
+        for (int c = 0; c < FrontierNumConstraints[Cell]; c++)
+        {
+            int Around = FrontierConstraints[(size_t) Cell * 8 + c];
+            if (Chain.ConstraintStamps[Around] != Chain.Stamp)
+            {
+                Chain.ConstraintStamps[Around] = Chain.Stamp;
+                Chain.BlockPosition[Around] = Block.NumConstraints;
+                Block.Masks[Block.NumConstraints] = 0;
+                Block.Needed[Block.NumConstraints++] = Constraints[Around].Value - Chain.ConstraintMines[Around];
+            }
+            int Position = Chain.BlockPosition[Around];
+            Block.Masks[Position] |= 1u << i;
+            Block.Needed[Position] += Chain.Mines[Cell];    // The mines of the block are placed again
+            Block.CellConstraints[i][c] = Position;
+        }
+    }
+}
+
+/// Put the placement on the cells of the block (bit i for its cell i)
+void FMineSampler::SetBlock(FSamplerChain& Chain, const FSamplerBlock& Block, uint32_t Placement)
+{
+    for (int i = 0; i < Block.NumCells; i++)
+    {
+        if (((Placement >> i) & 1) != Chain.Mines[Block.Cells[i]])
+        {
+            FlipCell(Chain, Block.Cells[i]);
+        }
+    }
+}
+
+/// Put a mine on the frontier cell, or take it away, and update the mines of its constraints
+void FMineSampler::FlipCell(FSamplerChain& Chain, int Cell)
+{
+    int Change = Chain.Mines[Cell] ? -1 : 1;
+    Chain.Mines[Cell] ^= 1;
+    Chain.FrontierMines += Change;
+    for (int c = 0; c < FrontierNumConstraints[Cell]; c++)
+    {
+        int Constraint = FrontierConstraints[(size_t) Cell * 8 + c];
+        Chain.ConstraintMines[Constraint] += Change;
+        if (!Chain.bValid)
+        {
+            SetViolated(Chain, Constraint);
+        }
+    }
+}
+
+/// Keep the constraint on Violated only while its mines are not the ones it needs
+void FMineSampler::SetViolated(FSamplerChain& Chain, int Constraint)
+{
+    bool bMet = Chain.ConstraintMines[Constraint] == Constraints[Constraint].Value;
+    int Position = Chain.ViolatedPosition[Constraint];
+    if (bMet && Position >= 0)
+    {
+        int Last = Chain.Violated.back();
+        Chain.Violated[Position] = Last;
+        Chain.ViolatedPosition[Last] = Position;
+        Chain.Violated.pop_back();
+        Chain.ViolatedPosition[Constraint] = -1;
+    }
+    else if (!bMet && Position < 0)
+    {
+        Chain.ViolatedPosition[Constraint] = (int) Chain.Violated.size();
+        Chain.Violated.push_back(Constraint);
+    }
+}
+
+/// Probability, confidence and R-hat of every frontier cell and of the interior, from the chains with at least 2 samples. While there
+/// are none, frontier cells take the mean of the mines and hidden cells of their constraints, and the interior the mines left by them.
+void FMineSampler::UpdateEstimate()
+{
+    std::vector<const FSamplerChain*> Sampled;
+    for (const FSamplerChain& Chain : Chains)
+    {
+        if (Chain.Samples >= 2)
+        {
+            Sampled.push_back(&Chain);
+        }
+    }
+    int NumSampled = (int) Sampled.size();
+    std::vector<double> Means(NumSampled), Variances(NumSampled), Counts(NumSampled);
+    for (int c = 0; c < NumSampled; c++)
+    {
+        Counts[c] = (double) Sampled[c]->Samples;
+    }
+
+    MaxRhat = Frontier.empty() ? 1.0 : (NumSampled < 2 ? HUGE_VAL : 1.0);
+    double FrontierMines = 0.0;
+    for (int f = 0; f < (int) Frontier.size(); f++)
+    {
+        double Mean = 0.0, Error = 1.0, Rhat = HUGE_VAL;
+        if (NumSampled == 0)
+        {
+            for (int c = 0; c < FrontierNumConstraints[f]; c++)
+            {
+                const FConstraint& Constraint = Constraints[FrontierConstraints[(size_t) f * 8 + c]];
+                Mean += std::min(1.0, std::max(0.0, (double) Constraint.Value / Constraint.NumCells));
+            }
+            Mean /= FrontierNumConstraints[f];
+        }
+        else
+        {
+            for (int c = 0; c < NumSampled; c++)
+            {
+                Means[c] = Sampled[c]->MineSamples[f] / Counts[c];
+                Variances[c] = Means[c] * (1.0 - Means[c]) * Counts[c] / (Counts[c] - 1.0);
+            }
+            CombineChains(Means, Variances, Counts, Mean, Error, Rhat);
+            MaxRhat = std::max(MaxRhat, Rhat);
+        }
+        Probabilities[Frontier[f]] = Mean;
+        Confidences[Frontier[f]] = Error;
+        FrontierMines += Mean;
+    }
+
+    double Error = 1.0, Rhat = HUGE_VAL;
+    InteriorProbability = (NumInterior > 0) ? std::min(1.0, std::max(0.0, (MinesLeft - FrontierMines) / NumInterior)) : 0.0;
+    if (NumSampled > 0 && NumInterior > 0)
+    {
+        for (int c = 0; c < NumSampled; c++)
+        {
+            Means[c] = Sampled[c]->InteriorSum / Counts[c];
+            Variances[c] = std::max(0.0, Sampled[c]->InteriorSquares / Counts[c] - Means[c] * Means[c]) * Counts[c] / (Counts[c] - 1.0);
+        }
+        CombineChains(Means, Variances, Counts, InteriorProbability, Error, Rhat);
+    }
+    for (int Cell : InteriorCells)
+    {
+        Probabilities[Cell] = InteriorProbability;
+        Confidences[Cell] = Error;
+    }
+}
+
+/// Every placement of the cells of the block from Cell on that meets its constraints, each cell given a mine or not in turn and
+/// discarded as soon as a constraint needs more mines than cells left or fewer than none. Each placement found replaces the chosen
+/// one with the chance of its weight against all the weight found, so the one left is drawn with its weight without keeping them.
+/// The search is cut after SAMPLER_BLOCK_NODES cells given.
+static void FindPlacements(const FSamplerBlock& Block, int Cell, uint32_t Placement, int Mines, FBlockPlacements& Found)
+{
+    if (--Found.NodesLeft < 0)
+    {
+        return;
+    }
+    if (Cell == Block.NumCells)
+    {
+        if (Found.Weights[Mines] > 0.0)
+        {
+            Found.Total += Found.Weights[Mines];
+            Found.Chosen = (Found.Rng->NextDouble() * Found.Total < Found.Weights[Mines]) ? Placement : Found.Chosen;
+        }
+        return;
+    }
+    for (int Mine = 0; Mine <= 1; Mine++)
+    {
+        bool bMet = true;
+        for (int c = 0; c < Block.NumCellConstraints[Cell]; c++)
+        {
+            int k = Block.CellConstraints[Cell][c];
+            bMet = bMet && Found.Needed[k] - Mine >= 0 && Found.Needed[k] - Mine <= Found.Left[k] - 1;
+        }
+        if (!bMet)
+        {
+            continue;
+        }
+        for (int c = 0; c < Block.NumCellConstraints[Cell]; c++)
+        {
+            Found.Needed[Block.CellConstraints[Cell][c]] -= Mine;
+            Found.Left[Block.CellConstraints[Cell][c]]--;
+        }
+        FindPlacements(Block, Cell + 1, Placement | ((uint32_t) Mine << Cell), Mines + Mine, Found);
+        for (int c = 0; c < Block.NumCellConstraints[Cell]; c++)
+        {
+            Found.Needed[Block.CellConstraints[Cell][c]] += Mine;
+            Found.Left[Block.CellConstraints[Cell][c]]++;
+        }
+    }
+}
+
+static int CountBits(uint32_t Value)
+{
+    return (int) std::bitset<32>(Value).count();
+}
+
+/// Mean of every sample of the chains, half width of its 95% interval and R-hat. The variance of the mean is the larger of the spread
+/// between the chains and the one of independent samples, since samples of the same chain are not independent.
+static void CombineChains(const std::vector<double>& Means, const std::vector<double>& Variances, const std::vector<double>& Counts,
+                          double& Mean, double& Error, double& Rhat)
+{
+    int NumChains = (int) Means.size();
+    double Samples = 0.0, Weighed = 0.0, ChainsMean = 0.0, Within = 0.0;
+    for (int c = 0; c < NumChains; c++)
+    {
+        Samples += Counts[c];
+        Weighed += Means[c] * Counts[c];
+        ChainsMean += Means[c] / NumChains;
+        Within += Variances[c] / NumChains;
+    }
+    double Between = 0.0;
+    for (int c = 0; c < NumChains && NumChains > 1; c++)
+    {
+        Between += (Means[c] - ChainsMean) * (Means[c] - ChainsMean) / (NumChains - 1);
+    }
+    double PerChain = Samples / NumChains;
+    Mean = Weighed / Samples;
+    Error = SAMPLER_CONFIDENCE_Z * std::sqrt(std::max(Between, Within / PerChain) / NumChains);
+    if (NumChains < 2)
+    {
+        Rhat = HUGE_VAL;
+    }
+    else if (Within <= 0.0)
+    {
+        Rhat = (Between <= 0.0) ? 1.0 : HUGE_VAL;
+    }
+    else
+    {
+        Rhat = std::sqrt(((PerChain - 1.0) / PerChain * Within + Between) / Within);
+    }
+}
@@ -0,0 +1,139 @@
+/* Monte Carlo estimate of the probability of a mine on every hidden cell, for boards whose frontier is too big to count exactly
+(MineProbability.h). It reads the same constraints from the User board: each displayed number and its hidden cells around.
+
+Several Markov chains sample placements of mines on the frontier (the hidden cells that touch a number) that meet every constraint,
+each one with its own random stream, in parallel on a thread pool:
+1. A chain starts from no mines and searches a placement that meets every constraint: it takes a constraint that is not met and
+   flips the cell of it that leaves the fewest mines missing or left over around (WalkSAT), with some noise (SAMPLER_NOISE) so it
+   does not get stuck.
+2. Once every constraint is met, each step takes a block: the cells of a random constraint and of the constraints around them, breadth
+   first, while they fit whole on SAMPLER_SMALL_BLOCK_CELLS cells (SAMPLER_BLOCK_CELLS on a share SAMPLER_BIG_BLOCKS of the steps,
+   so long rows of constraints can shift their mines at once). Every way of placing mines on the block that keeps every constraint
+   met is found by backtracking cell by cell, and one is drawn with its weight: the ways of placing the rest of the mines on the
+   interior (the hidden cells that touch no number), C(interior, mines left). So the chain samples the placements as likely as they
+   are on the real game (block Gibbs sampling).
+3. After SAMPLER_BURN_IN_SWEEPS sweeps (as many steps as constraints, so a sample costs more on bigger frontiers), each sweep adds
+   a sample: the mines of every frontier cell, and the share of the mines left to each interior cell.
+The caller gives a time budget to Run, and can call it again to refine the estimate. Convergence is measured with the R-hat of
+Gelman and Rubin on every frontier cell (the spread of the chains against the spread inside each one), and the confidence of each
+probability with the half width of its 95% interval, from the spread of the chains. While no chain samples, each cell
+is estimated from the mines and hidden cells of its constraints.
+Flags are only the guesses of the player, so flagged cells are hidden cells like the others. An exploded mine (X) is a mine for sure.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include "Minesweeper.h"
+#include "Random.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#define SAMPLER_DEFAULT_CHAINS 4        // Chains of a sampler, at least 2 to measure the convergence
+#define SAMPLER_BLOCK_CELLS 32          // Most cells of a big block, one bit each of a placement
+#define SAMPLER_SMALL_BLOCK_CELLS 8     // Most cells of the other blocks, cheaper to draw
+#define SAMPLER_BIG_BLOCKS 0.125        // Share of the steps that draw a big block, which moves mines further
+#define SAMPLER_BLOCK_NODES 4096        // Cells given a mine or not by the search of the placements of a block before it gives up
+#define SAMPLER_ROUND_STEPS 1024        // Steps of each chain between two checks of the time budget
+#define SAMPLER_BURN_IN_SWEEPS 5        // Sweeps of a chain, after it meets every constraint, that are not sampled
+#define SAMPLER_NOISE 0.1               // Chance of flipping any cell of the constraint taken while a chain searches
+#define SAMPLER_MAX_RHAT 1.05           // Largest R-hat of a converged estimate
+#define SAMPLER_MIN_SAMPLES 100         // Fewest samples of each chain of a converged estimate
+#define SAMPLER_CONFIDENCE_Z 1.96       // Normal quantile of the 95% intervals
+
+/// Markov chain of a sampler and the samples it took
+struct FSamplerChain
+{
+    FCounterRng Rng = FCounterRng(0, 0);
+    std::vector<uint8_t> Mines;             // One per frontier cell
+    std::vector<uint8_t> ConstraintMines;   // Mines around each constraint
+    std::vector<int> Violated;              // Constraints not met, while the chain searches
+    std::vector<int> ViolatedPosition;      // Position of each constraint on Violated, -1 if it is met
+    std::vector<uint32_t> CellStamps;       // Last block of each frontier cell
+    std::vector<uint32_t> ConstraintStamps; // Last block around each constraint
+    std::vector<int> BlockPosition;         // Position of each constraint on that block
+    uint32_t Stamp = 0;
+    int FrontierMines = 0;
+    bool bValid = false;                    // Every constraint is met, the chain samples
+    uint64_t Steps = 0;                     // Since it became valid
+    uint64_t Samples = 0;
+    std::vector<uint32_t> MineSamples;      // Samples with a mine on each frontier cell
+    double InteriorSum = 0.0;               // Of the probability of a mine on each interior cell
+    double InteriorSquares = 0.0;
+};
+
+/// Block of frontier cells whose mines are drawn again at once, and the constraints around them
+struct FSamplerBlock
+{
+    int NumCells = 0;
+    int Cells[SAMPLER_BLOCK_CELLS];
+    int NumCellConstraints[SAMPLER_BLOCK_CELLS];
+    int CellConstraints[SAMPLER_BLOCK_CELLS][8];    // Position of the constraints of each cell on the block
+    int NumConstraints = 0;
+    uint32_t Masks[SAMPLER_BLOCK_CELLS * 8];        // Cells of the block around each constraint
+    int Needed[SAMPLER_BLOCK_CELLS * 8];            // Mines each constraint needs on the block
+};
+
+/// Anytime estimate of the mine probabilities of the game being played. Call Start after every move, then Run as long as wanted.
+class FMineSampler
+{
+    public:
+        explicit FMineSampler(int NumChains = SAMPLER_DEFAULT_CHAINS, int NumThreads = 0);  // 0 threads means one per core, 1 runs on the caller
+
+        /// Getters
+        const std::vector<double>& GetProbabilities() const;    // One per cell: 0 on displayed numbers, 1 on exploded mines
+        double GetProbability(int) const;
+        double GetConfidence(int) const;        // Half width of the 95% interval of the probability of a cell, 1 while no chain samples
+        double GetInteriorProbability() const;  // Of the hidden cells that touch no displayed number
+        int GetSafestCell() const;              // Hidden cell, not flagged, with the lowest probability. -1 if there is none.
+        double GetMaxRhat() const;              // Over the frontier cells, 1 when every chain agrees. Infinite with less than 2 chains sampling.
+        uint64_t GetNumSamples() const;         // Of every chain
+        int GetNumValidChains() const;          // Chains that meet every constraint
+        bool IsConverged() const;               // R-hat up to SAMPLER_MAX_RHAT and SAMPLER_MIN_SAMPLES samples on every chain
+
+        /// Rest of functions
+        bool Start(const FMineSweeper&, uint64_t Seed);     // Reads the board and restarts the chains. Returns false if the game has no board.
+        void Run(int Milliseconds);             // Advances the chains for the time given and updates the estimate
+
+    private:
+        /// Constraint of a displayed number: mines left around it (exploded mines are taken out) and its hidden cells, as positions on Frontier
+        struct FConstraint
+        {
+            int Value = 0;
+            int NumCells = 0;
+            int Cells[8];
+        };
+
+        int Width = 0;
+        int Height = 0;
+        int MinesLeft = 0;
+        int NumInterior = 0;
+        double InteriorProbability = 0.0;
+        double MaxRhat = 0.0;
+        std::unique_ptr<FThreadPool> Pool;      // nullptr with a single thread
+        std::vector<FSamplerChain> Chains;
+        std::vector<double> Probabilities;
+        std::vector<double> Confidences;
+        std::vector<int> HiddenCells;           // Hidden and not flagged, the cells a player may reveal
+        std::vector<int> InteriorCells;
+        std::vector<FConstraint> Constraints;
+        std::vector<int> FrontierIndex;         // Position of each cell on Frontier, -1 for the rest
+        std::vector<int> Frontier;
+        std::vector<int> FrontierConstraints;   // Constraints of each frontier cell, 8 places for each one
+        std::vector<uint8_t> FrontierNumConstraints;
+        std::vector<double> LogWeights;         // Log of the ways of placing the rest of the mines on the interior, for each frontier mines
+
+        /// Rest of functions
+        void AddConstraint(FBoardView, int, int);
+        void RunChain(FSamplerChain&, const std::chrono::steady_clock::time_point&);
+        void Step(FSamplerChain&);
+        void Search(FSamplerChain&);
+        void MakeBlock(FSamplerChain&, int, int, FSamplerBlock&);
+        void SetBlock(FSamplerChain&, const FSamplerBlock&, uint32_t);
+        void FlipCell(FSamplerChain&, int);
+        void SetViolated(FSamplerChain&, int);
+        void UpdateEstimate();
+};
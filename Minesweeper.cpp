@@ -5,24 +5,98 @@ Created by: Angel del Ojo Jimenez, July 2019
 
 #pragma once
 #include "Minesweeper.h"
+#include "MineGenerator.h"
+#include "BoardPipeline.h"
+#include "FixedBoardKernels.h"
+#include "BoardStrips.h"
+#include "GameJournal.h"
+#include "GameHistory.h"
+#include "Random.h"
+#include <cstring>
 #include <iostream>
 #include <map>
-#include <ctime>
 
 
 FMineSweeper::FMineSweeper() { }    // Constructor not needed at this point
 
+/// Custom board constructor. Invalid dimensions leave the game without a board: GetBoardSize() is 0 and Reset returns false, until
+/// SetGameParams sets a valid one.
+FMineSweeper::FMineSweeper(int Width, int Height, int Mines)
+{
+    SetGameParams(Width, Height, Mines);
+}
+
+FMineSweeper::~FMineSweeper()
+{
+    EraseMemory();
+}
+
 /// Getters
 int FMineSweeper::GetBoardSize() const { return BoardSize; };
-int FMineSweeper::GetBoardOrder() const { return BoardOrder; }
+int FMineSweeper::GetBoardWidth() const { return BoardWidth; }
+int FMineSweeper::GetBoardHeight() const { return BoardHeight; }
 int FMineSweeper::GetNumMines() const { return NumMines; };
-char* FMineSweeper::GetUserBoard() const { return UserBoard; };
-char* FMineSweeper::GetNearbyMinesBoard() const {return NearbyMinesBoard; };
+FBoardView FMineSweeper::GetUserBoard() const { return FBoardView(Cells.GetData(), false); };
+FBoardView FMineSweeper::GetNearbyMinesBoard() const {return FBoardView(Cells.GetData(), true); };
 EGameStatus FMineSweeper::GetGameStatus() const { return GameStatus; }
 FGameStats FMineSweeper::GetResults() const { return Results;}
+ESimdLevel FMineSweeper::GetSimdLevel() const { return SimdLevel; }
+uint64_t FMineSweeper::GetSeed() const { return Seed; }
+bool FMineSweeper::GetFirstClickSafe() const { return bFirstClickSafe; }
+
+/// Hash of what the player can see (displayed cells with their counts, flags and mines), the status and the results, to check that
+/// two games reached the same state. Internal bits, such as the visited cells or the counts of hidden cells, do not change it.
+uint64_t FMineSweeper::GetStateHash() const
+{
+    const uint64_t LowBits = 0x0101010101010101ULL;             // Bit 0 of each byte
+    const uint64_t Kept = LowBits * (CELL_MINE | CELL_SHOWN | CELL_FLAG);
+    uint64_t Hash = MixBits64(((uint64_t) BoardWidth << 32) | (uint32_t) BoardHeight);
+    Hash = MixBits64(Hash ^ (((uint64_t) NumMines << 32) | (uint32_t) Results.NumSpacesLeft));
+    Hash = MixBits64(Hash ^ (((uint64_t) Results.NumMinesLeft << 32) | (uint32_t) GameStatus));
+    const uint8_t* Data = Cells.GetData();
+    for (int i = 0; Data != nullptr && i < BoardSize; i += 8)   // 8 cells at a time, the counts kept only on displayed cells
+    {
+        uint64_t Word = 0;
+        memcpy(&Word, Data + i, BoardSize - i < 8 ? BoardSize - i : 8);
+        uint64_t Counts = ((Word >> 1) & LowBits) * (0xFF << CELL_COUNT_SHIFT & 0xFF);
+        Hash = MixBits64(Hash ^ ((Word & Kept) | (Word & Counts)));
+    }
+    return Hash;
+}
 
 /// Setters
 
+/// Record every change of the game on Journal (nullptr to stop recording). The journal must outlive the game.
+void FMineSweeper::SetJournal(FGameJournal* InJournal)
+{
+    RecordPendingChecksum();
+    Journal = InJournal;
+}
+
+/// Record the games, moves and flood fills on Metrics (nullptr to stop recording). The metrics must outlive the game, and only the
+/// thread of the game may use them while it plays.
+void FMineSweeper::SetMetrics(FGameMetrics* InMetrics)
+{
+    Metrics = InMetrics;
+    GameStartTime = 0;
+    MoveStartTime = 0;
+}
+
+/// Record what each move changes on History (nullptr to stop recording), so the moves can be undone. It starts from the current state.
+/// The history must outlive the game.
+void FMineSweeper::SetHistory(FGameHistory* InHistory)
+{
+    History = InHistory;
+    ClearHistory();
+}
+
+/// Record on a history that already holds the moves of this game, as when the game is saved and loaded again (GameSnapshot.h).
+/// The game must be in the state of the current move of the history.
+void FMineSweeper::ResumeHistory(FGameHistory* InHistory)
+{
+    History = InHistory;
+}
+
 /// Modify number of mines and size board depending on the selected difficulty
 void FMineSweeper::SetGameParams(int UserDifficulty) 
 { 
@@ -30,171 +104,419 @@ void FMineSweeper::SetGameParams(int UserDifficulty)
     switch(Difficulty)
     {
         case 1:             // 12.5 % chances of mine on first selected cell
-            NumMines = 2;
-            BoardOrder = 4;
-            BoardSize = BoardOrder * BoardOrder;
+            SetGameParams(4, 4, 2);
             break;
         case 2:             // 16 % chances of mine on first selected cell
-            NumMines = 4;
-            BoardOrder = 5;
-            BoardSize = BoardOrder * BoardOrder;
+            SetGameParams(5, 5, 4);
             break;
         case 3:             // 20.4 % chances of mine on first selected cell
-            NumMines = 10;
-            BoardOrder = 7;
-            BoardSize = BoardOrder * BoardOrder;
+            SetGameParams(7, 7, 10);
             break;
         case 4:             // 23.5 % chances of mine on first selected cell
-            NumMines = 19;
-            BoardOrder = 9;
-            BoardSize = BoardOrder * BoardOrder;
+            SetGameParams(9, 9, 19);
             break;
         case 5:             // 28.4 % chances of mine on first selected cell
-            NumMines = 23;
-            BoardOrder = 9;
-            BoardSize = BoardOrder * BoardOrder;
+            SetGameParams(9, 9, 23);
             break;
         default:            // Same as case 1
-            NumMines = 2;
-            BoardOrder = 4;
-            BoardSize = BoardOrder * BoardOrder;
+            SetGameParams(4, 4, 2);
             break;
     }
 }
 
-/// Initialize Board: it contains mines (1) and spaces (0). This is randomly generated on each game.
+/// Select the instruction set of the nearby mines kernel. Returns false (and keeps the previous one) if the CPU does not support it.
+bool FMineSweeper::SetSimdLevel(ESimdLevel Level)
+{
+    if (!IsSimdLevelSupported(Level))
+    {
+        return false;
+    }
+    SimdLevel = Level;
+    return true;
+}
+
+/// Number of threads used to place the mines and count the nearby mines on big boards. The board only depends on the seed, not on this number.
+void FMineSweeper::SetGenerationThreads(int NumThreads)
+{
+    GenerationThreads = NumThreads < 1 ? 1 : NumThreads;
+}
+
+/// Number of threads that open the areas of more than STRIPS_REVEAL_MIN_CELLS cells. The cells opened do not depend on this number,
+/// only the order of the list returned by SetCellUserVisitedBoard.
+void FMineSweeper::SetRevealThreads(int NumThreads)
+{
+    RevealThreads = NumThreads < 1 ? 1 : NumThreads;
+}
+
+/// Take the boards of Reset() from a pipeline (nullptr to generate them inline). The pipeline must outlive the game.
+void FMineSweeper::SetBoardPipeline(FBoardPipeline* InPipeline)
+{
+    Pipeline = InPipeline;
+}
+
+/// Place the mines on the first click instead of on Reset, so the first click never finds a mine. It applies from the next Reset.
+void FMineSweeper::SetFirstClickSafe(bool bSafe)
+{
+    bFirstClickSafe = bSafe;
+}
+
+/// Set a custom board of Width x Height cells with the given number of mines. Returns false (and keeps the previous parameters) if the board is not valid.
+bool FMineSweeper::SetGameParams(int Width, int Height, int Mines)
+{
+    if (Width < MIN_BOARD_SIDE || Height < MIN_BOARD_SIDE)
+    {
+        return false;
+    }
+    long long Size = (long long) Width * Height;    // Computed on 64 bits so huge dimensions can not overflow
+    if (Size > MAX_BOARD_SIZE || Mines < 0 || Mines >= Size)
+    {
+        return false;
+    }
+    RecordPendingChecksum();                        // Hashed while the cells still match the old size
+    BoardWidth = Width;
+    BoardHeight = Height;
+    BoardSize = (int) Size;
+    NumMines = Mines;
+    FixedKernels = FindFixedBoardKernels(Width, Height);
+    return true;
+}
+
+/// Initialize Board: every cell starts empty and then exactly NumMines mines are placed from the current Seed (check MineGenerator.h).
+/// The cells are taken from the board pool, so a board of an already seen size only costs a memset (check BoardPool.h).
 bool FMineSweeper::SetBoardInit()
 {   
-    int i = 0; 
-    Board = (int *) calloc (sizeof(int), BoardSize);    // calloc since we need initialization to 0
-    if (Board != nullptr)
-    {   
-        srand(time(0));
-        Results.NumMinesLeft = 0;
-        do                                              // Generate mine at random empty location
-	    {
-            do                                          // Find a random location that is empty
-            {
-                i = rand() % (BoardSize + 1) + 0;
-            } while (Board[i] !=0 ); 
-		    Board[i] = 1;                               // Place mine
-		    Results.NumMinesLeft ++; 
-	    } while (Results.NumMinesLeft < NumMines);      // Repeat until number of planted mines is reached
-        return true;
-    } 
-    else
+    if (!Cells.Reset(BoardSize))
     {
         return false;
     }
-    
+    PlaceMines(Cells.GetData(), BoardSize, NumMines, Seed, GenerationThreads);
+    return true;
 }
 
-/// Initialize User board and game parameters. Each cell contains '-' (by default) or X (mine exploded) at initialization
+/// Initialize the game parameters. The User board is a view of the cells, so every cell already shows '-' (no CELL_SHOWN bit set)
 bool FMineSweeper::SetUserBoardInit()
 {
-    UserBoard = (char *) malloc (BoardSize * sizeof(char));
-    if (UserBoard!= nullptr)
+    GameStatus = EGameStatus::KeepPlaying;
+    Results.NumMinesLeft = NumMines;
+    Results.NumSpacesLeft = BoardSize - NumMines;
+    Results.NumFlags = 0;
+    FlagCounts.clear();                 // Counted again on the first flag, most games never flag
+    bMineShown = false;
+    ClearHistory();
+    return true;
+}
+
+/// Initialize the visited cells. Set CELL_VISITED on cells with mines, so the empty areas never expand over them
+bool FMineSweeper::SetUserVisitedBoardInit()
+{
+    for (int i = 0; i < BoardSize; i++)
     {
-        for(int i = 0; i < BoardSize; i++)
+        if (Cells[i] & CELL_MINE)
         {
-            UserBoard[i] = '-';
+            Cells[i] |= CELL_VISITED;
         }
-        GameStatus = EGameStatus::KeepPlaying;
-        Results.NumMinesLeft = NumMines;
-        Results.NumSpacesLeft = BoardSize - NumMines;
+    }
+    return true;
+}
+
+/// Initialize the number of nearby mines. Calculate the number of adjacent mines of each cell on the Board and store it on the upper bits of the cell.
+/// Rows are processed by the vectorized box sum of BoardKernels.h, the rows outside the board are read from a row of zeros.
+/// The board sizes of the difficulties use their own kernel instead, check FixedBoardKernels.h, and big boards are split in strips
+/// of rows counted on GenerationThreads threads, check BoardStrips.h.
+bool FMineSweeper::SetNearbyMinesBoardInit()
+{
+    if (FixedKernels != nullptr)
+    {
+        FixedKernels->CountNearbyMines(Cells.GetData());
         return true;
     }
+    if (GenerationThreads > 1 && BoardSize >= STRIPS_MIN_CELLS)
+    {
+        CountNearbyMinesStrips(SimdLevel, Cells.GetData(), BoardWidth, BoardHeight, GenerationThreads);
+        return true;
+    }
+    ColumnSums.assign(BoardWidth + 2, 0);   // Ghost cells at both sides stay 0
+    ZeroRow.assign(BoardWidth, 0);
+    for (int y = 0; y < BoardHeight; y++)
+    {
+        SetNearbyMinesRow(y);
+    }
+    return true;
+}
+
+/// Count the nearby mines of every cell of row y. ColumnSums and ZeroRow must be ready, check SetNearbyMinesBoardInit.
+void FMineSweeper::SetNearbyMinesRow(int y)
+{
+    uint8_t* Row = Cells.GetData() + (size_t) y * BoardWidth;
+    const uint8_t* Up = (y > 0) ? Row - BoardWidth : ZeroRow.data();
+    const uint8_t* Down = (y < BoardHeight - 1) ? Row + BoardWidth : ZeroRow.data();
+    CountNearbyMinesRow(SimdLevel, Up, Row, Down, ColumnSums.data(), BoardWidth);
+}
+
+/// Same as SetNearbyMinesBoardInit, but counting the mines cell by cell with CountNearbyMines. Kept as a reference for the benchmark.
+bool FMineSweeper::SetNearbyMinesBoardInitPerCell()
+{
+    for (int Index = 0; Index < BoardSize; Index++)
+    {
+        SetCellNearbyMinesBoard(Index);
+    }
+    return true;
+}
+
+/// Initialize all the boards and game parameters, on a new random board. With a pipeline the board is taken ready from it when there is one.
+bool FMineSweeper::Reset()
+{ 
+    FReadyBoard Board;
+    if (Pipeline != nullptr && !bFirstClickSafe && Pipeline->Pop(BoardWidth, BoardHeight, NumMines, Board))
+    {
+        return Reset(Board);
+    }
+    return Reset(MakeRandomSeed());
+}
+
+/// Initialize all the boards and game parameters. The board is generated from the given seed, so it can be replayed.
+/// On a first click safe game only the cells are cleared: the board depends on the seed and on the first click.
+/// Returns false if the game has no board size yet or its memory could not be taken.
+bool FMineSweeper::Reset(uint64_t BoardSeed)
+{ 
+    if (BoardSize == 0)
+    {
+        return false;
+    }
+    RecordPendingChecksum();
+    uint64_t StartTime = (Metrics != nullptr) ? GetMetricsTime() : 0;
+    uint64_t StartBytes = (Metrics != nullptr) ? GetBoardPoolStats().AllocatedBytes : 0;
+    Seed = BoardSeed;
+    bMinesPlaced = !bFirstClickSafe;
+    bCountsPending = bFirstClickSafe;
+    bSeedBoard = !bFirstClickSafe;
+    bool bReady = false;
+    if (bFirstClickSafe)
+    {
+        ColumnSums.assign(BoardWidth + 2, 0);
+        ZeroRow.assign(BoardWidth, 0);
+        CountedRows.assign(BoardHeight, 0);
+        bReady = Cells.Reset(BoardSize) && SetUserBoardInit();
+    }
     else
+    {
+        bReady = RunPhase(EGamePhase::SetBoardInit, &FMineSweeper::SetBoardInit)
+              && RunPhase(EGamePhase::SetUserBoardInit, &FMineSweeper::SetUserBoardInit)
+              && RunPhase(EGamePhase::SetUserVisitedBoardInit, &FMineSweeper::SetUserVisitedBoardInit)
+              && RunPhase(EGamePhase::SetNearbyMinesBoardInit, &FMineSweeper::SetNearbyMinesBoardInit);
+    }
+    if (bReady && Journal != nullptr)
+    {
+        Journal->RecordStart(*this, bFirstClickSafe, -1);
+    }
+    if (bReady)
+    {
+        RecordGameStart(StartTime, StartBytes);
+    }
+    return bReady;
+}
+
+/// Initialize all the boards with the mines placed away from SafeIndex and its neighbours: the board a first click safe game
+/// gets with this seed when its first click is SafeIndex, but generated at once.
+bool FMineSweeper::Reset(uint64_t BoardSeed, int SafeIndex)
+{
+    RecordPendingChecksum();
+    uint64_t StartTime = (Metrics != nullptr) ? GetMetricsTime() : 0;
+    uint64_t StartBytes = (Metrics != nullptr) ? GetBoardPoolStats().AllocatedBytes : 0;
+    Seed = BoardSeed;
+    bMinesPlaced = true;
+    bCountsPending = false;
+    bSeedBoard = false;
+    if (SafeIndex < 0 || SafeIndex >= BoardSize || !Cells.Reset(BoardSize))
+    {
+        return false;
+    }
+    PlaceMinesAround(Cells.GetData(), BoardWidth, BoardHeight, NumMines, Seed, SafeIndex, GenerationThreads);
+    if (!SetUserBoardInit() || !SetUserVisitedBoardInit() || !SetNearbyMinesBoardInit())
     {
         return false;
     }
+    if (Journal != nullptr)
+    {
+        Journal->RecordStart(*this, false, SafeIndex);
+    }
+    RecordGameStart(StartTime, StartBytes);
+    return true;
 }
 
-/// Initialize the User Visited Board. Set 1 on cells with mines, 0 elsewhere (on initialization)
-bool FMineSweeper::SetUserVisitedBoardInit()
+/// Start a game on a board taken from another game of the same size (TakeBoard). Board is left empty.
+/// Returns false (and leaves Board as it was) if it was taken from a game of another size or number of mines.
+bool FMineSweeper::Reset(FReadyBoard& Board)
 {
-    UserVisitedBoard = (int *) calloc (sizeof(int), BoardSize);
-    if (UserVisitedBoard!= nullptr)
+    if (BoardSize == 0 || !Board.Cells || Board.Width != BoardWidth || Board.Height != BoardHeight || Board.Mines != NumMines
+        || Board.Cells.GetCapacity() < (size_t) BoardSize)
     {
-        for (int i = 0; i < BoardSize; i++)
-        {
-            if (Board[i] == 1)
-            {
-                UserVisitedBoard[i] = 1;
-            }
-        }
-        return true;
+        return false;
     }
-    else
+    RecordPendingChecksum();
+    uint64_t StartTime = (Metrics != nullptr) ? GetMetricsTime() : 0;
+    Cells = std::move(Board.Cells);
+    Seed = Board.Seed;
+    bMinesPlaced = true;
+    bCountsPending = false;
+    bSeedBoard = Board.bSeedBoard;
+    SetUserBoardInit();
+    if (Journal != nullptr && bSeedBoard)
+    {
+        Journal->RecordStart(*this, false, -1);
+    }
+    else if (Journal != nullptr)                // The seed does not give this board, the journal keeps its cells
+    {
+        Journal->RecordSnapshot(*this);
+    }
+    RecordGameStart(StartTime, (Metrics != nullptr) ? GetBoardPoolStats().AllocatedBytes : 0);     // The board was allocated elsewhere
+    return true;
+}
+
+/// Play the same board again: every cell is hidden, unflagged and not visited, but the mines and their counts stay
+bool FMineSweeper::Restart()
+{
+    if (!Cells || !bMinesPlaced || bCountsPending)
     {
         return false;
     }
+    if (Journal != nullptr)
+    {
+        Journal->RecordMove(EJournalRecord::Restart, 0);
+    }
+    for (int i = 0; i < BoardSize; i++)
+    {
+        uint8_t Cell = (uint8_t) (Cells[i] & ~(CELL_SHOWN | CELL_VISITED | CELL_FLAG));
+        Cells[i] = (uint8_t) ((Cell & CELL_MINE) ? Cell | CELL_VISITED : Cell);
+    }
+    RecordGameStart(0, 0);
+    return SetUserBoardInit();
 }
 
-/// Initialize the NearbyMinesBoard. Calculate the number of adjacent mines of each cell on the Board.
-bool FMineSweeper::SetNearbyMinesBoardInit()
+/// Move the board out of the game, as it is, to play it on another game with Reset(FReadyBoard&). The game is left without board.
+/// Returns false if there is no board, or its mines are not placed yet (first click safe game before its first click).
+bool FMineSweeper::TakeBoard(FReadyBoard& Board)
 {
-    int Index = 0; 
-    NearbyMinesBoard = (char *) malloc (BoardSize * sizeof(char)); 
-    if (NearbyMinesBoard != nullptr)
-    {   
-        for (Index = 0; Index < BoardSize; Index++)
+    if (!Cells || !bMinesPlaced || bCountsPending)
+    {
+        return false;
+    }
+    RecordPendingChecksum();
+    Board.Cells = std::move(Cells);
+    Board.Width = BoardWidth;
+    Board.Height = BoardHeight;
+    Board.Mines = NumMines;
+    Board.Seed = Seed;
+    Board.bSeedBoard = bSeedBoard;
+    return true;
+}
+
+/// Move the mine of cell From to the empty cell To, updating the counts of their neighbours. The board no longer matches its seed.
+/// Returns false (and changes nothing) if a cell is out of the board or both are the same, From has no mine, To has one, or the
+/// counts are not complete yet.
+bool FMineSweeper::MoveMine(int From, int To)
+{
+    if (From < 0 || From >= BoardSize || To < 0 || To >= BoardSize || From == To)
+    {
+        return false;
+    }
+    if (!bMinesPlaced || bCountsPending || !IsMine(From) || IsMine(To))
+    {
+        return false;
+    }
+    if (Journal != nullptr)
+    {
+        Journal->RecordMove(EJournalRecord::MoveMine, From, To);
+    }
+    bSeedBoard = false;
+    Cells[From] &= (uint8_t) ~(CELL_MINE | CELL_VISITED);
+    Cells[To] |= CELL_MINE | CELL_VISITED;
+    int Moves[2] = { From, To };
+    for (int m = 0; m < 2; m++)
+    {
+        int X = Moves[m] % BoardWidth;
+        int Y = Moves[m] / BoardWidth;
+        for (int y = (Y > 0 ? Y - 1 : 0); y <= Y + 1 && y < BoardHeight; y++)
         {
-            if(Board[Index] == 0)                   // If there is no mine on this cell, count the number of bombs next to it
-            {
-                NearbyMinesBoard[Index] = '0' + CountNearbyMines(Index);    // ASCII transformation
-            }
-            else
+            for (int x = (X > 0 ? X - 1 : 0); x <= X + 1 && x < BoardWidth; x++)
             {
-                NearbyMinesBoard[Index] = 'X';      // If there is a mine on this cell, set it to 'X'
+                int Neighbour = x + y * BoardWidth;
+                if (Neighbour != Moves[m])
+                {
+                    int Step = (m == 0) ? -(1 << CELL_COUNT_SHIFT) : (1 << CELL_COUNT_SHIFT);
+                    Cells[Neighbour] = (uint8_t) (Cells[Neighbour] + Step);
+                }
             }
         }
-        return true;
-    } 
-    else
-    {
-        return false;
     }
+    ClearHistory();                     // The moves before were played on other mines
+    return true;
 }
 
-/// Initialize all the boards and game parameters
-bool FMineSweeper::Reset()
-{ 
-    return SetBoardInit() * SetUserBoardInit() * SetUserVisitedBoardInit() * SetNearbyMinesBoardInit();
+/// First click of a first click safe game: place the mines away from it. Mines are not marked as visited (SetCellUserVisitedBoard
+/// treats them as visited anyway) and the nearby mines counts are left for the rows that get displayed, so no pass over the board is done.
+void FMineSweeper::PlaceMinesOnFirstClick(int Index)
+{
+    uint64_t StartTime = (Metrics != nullptr) ? GetMetricsTime() : 0;
+    PlaceMinesAround(Cells.GetData(), BoardWidth, BoardHeight, NumMines, Seed, Index, GenerationThreads);
+    bMinesPlaced = true;
+    if (History != nullptr)
+    {
+        History->SetMinesPlaced(Index);
+    }
+    if (FixedKernels != nullptr)                    // Counting a whole small board costs less than tracking its counted rows,
+                                                    // and lets the flood fill use its kernel (move_safe on Benchmark)
+    {
+        FixedKernels->CountNearbyMines(Cells.GetData());
+        bCountsPending = false;
+    }
+    if (Metrics != nullptr)
+    {
+        uint64_t Nanoseconds = GetMetricsTime() - StartTime;
+        Metrics->PhaseNanoseconds[(int) EGamePhase::PlaceMinesOnFirstClick].Add(Nanoseconds);
+        Metrics->LastGame.GenerationNanoseconds += Nanoseconds;
+    }
 }            
 
 /// Identify whether the cell is on one corner, on a border or elsewhere. Remember that the "boards" are implemented as arrays, so extra calculations are needed.
 ECellType FMineSweeper::CalcCellType(int Index)
 {
-    if (Index == 0)
+    int Y = Index / BoardWidth;                     // Row of the cell
+    int X = Index - Y * BoardWidth;                 // Column of the cell
+    bool bTop = (Y == 0);
+    bool bBottom = (Y == BoardHeight - 1);
+    bool bLeft = (X == 0);
+    bool bRight = (X == BoardWidth - 1);
+
+    if (bTop && bLeft)
     {
         return ECellType::UpperLeftCorner;
     }
-    else if (Index == BoardOrder - 1)
+    else if (bTop && bRight)
     {
         return ECellType::UpperRightCorner;
     }
-    else if (Index == BoardOrder * (BoardOrder - 1))
+    else if (bBottom && bLeft)
     {
         return ECellType::LowerLeftCorner;
     }
-    else if (Index == BoardOrder * (BoardOrder - 1) + BoardOrder - 1)
+    else if (bBottom && bRight)
     {
         return ECellType::LowerRightCorner;
     }
-    else if ((Index > 0) && (Index < (BoardOrder - 1)))
+    else if (bTop)
     {
         return ECellType::UpperHorizontal;
     }
-    else if ((Index > (BoardSize - BoardOrder)) && (Index < (BoardSize - 1)))
+    else if (bBottom)
     {
         return ECellType::LowerHorizontal;
     }
-    else if (Index % BoardOrder == 0)
+    else if (bLeft)
     {
         return ECellType::LeftVertical;
     }
-    else if ((Index - BoardOrder + 1) % BoardOrder == 0)
+    else if (bRight)
     {
         return ECellType::RightVertical;
     }
@@ -212,43 +534,43 @@ int FMineSweeper::CountNearbyMines(int Index)
    switch(CellType)
    {
         case ECellType::UpperLeftCorner:
-            NMines =             0             + Board[Index + 1]             + 
-                     Board[Index + BoardOrder] + Board[Index + BoardOrder + 1];
+            NMines =             0             + IsMine(Index + 1)             + 
+                     IsMine(Index + BoardWidth) + IsMine(Index + BoardWidth + 1);
             break;
         case ECellType::UpperRightCorner:
-            NMines = Board[Index - 1]              +            0             +
-                     Board[Index + BoardOrder - 1] + Board[Index + BoardOrder];
+            NMines = IsMine(Index - 1)              +            0             +
+                     IsMine(Index + BoardWidth - 1) + IsMine(Index + BoardWidth);
             break;
         case ECellType::LowerLeftCorner:
-            NMines = Board[Index - BoardOrder] + Board[Index - BoardOrder + 1] + 
-                                 0             + Board[Index + 1];
+            NMines = IsMine(Index - BoardWidth) + IsMine(Index - BoardWidth + 1) + 
+                                 0             + IsMine(Index + 1);
             break;
         case ECellType::LowerRightCorner:
-            NMines = Board[Index - BoardOrder - 1] + Board[Index - BoardOrder] + 
-                     Board[Index - 1]              +             0;
+            NMines = IsMine(Index - BoardWidth - 1) + IsMine(Index - BoardWidth) + 
+                     IsMine(Index - 1)              +             0;
             break;
         case ECellType::UpperHorizontal:
-            NMines = Board[Index - 1]              +             0             + Board[Index + 1]             +
-                     Board[Index + BoardOrder - 1] + Board[Index + BoardOrder] + Board[Index + BoardOrder + 1];
+            NMines = IsMine(Index - 1)              +             0             + IsMine(Index + 1)             +
+                     IsMine(Index + BoardWidth - 1) + IsMine(Index + BoardWidth) + IsMine(Index + BoardWidth + 1);
             break;
         case ECellType::LowerHorizontal:
-            NMines = Board[Index - BoardOrder - 1] + Board[Index - BoardOrder] + Board[Index - BoardOrder + 1] +
-                     Board[Index - 1]              +             0             + Board[Index + 1];
+            NMines = IsMine(Index - BoardWidth - 1) + IsMine(Index - BoardWidth) + IsMine(Index - BoardWidth + 1) +
+                     IsMine(Index - 1)              +             0             + IsMine(Index + 1);
             break;
         case ECellType::LeftVertical:
-            NMines = Board[Index - BoardOrder] + Board[Index - BoardOrder + 1] +
-                                   0           + Board[Index + 1]              +
-                     Board[Index + BoardOrder] + Board[Index + BoardOrder + 1];
+            NMines = IsMine(Index - BoardWidth) + IsMine(Index - BoardWidth + 1) +
+                                   0           + IsMine(Index + 1)              +
+                     IsMine(Index + BoardWidth) + IsMine(Index + BoardWidth + 1);
             break;
         case ECellType::RightVertical:
-            NMines = Board[Index - BoardOrder - 1] + Board[Index - BoardOrder] +
-                     Board[Index - 1]              +             0             +
-                     Board[Index + BoardOrder - 1] + Board[Index + BoardOrder];
+            NMines = IsMine(Index - BoardWidth - 1) + IsMine(Index - BoardWidth) +
+                     IsMine(Index - 1)              +             0             +
+                     IsMine(Index + BoardWidth - 1) + IsMine(Index + BoardWidth);
             break;
         case ECellType::Central:
-            NMines = Board[Index - BoardOrder - 1] + Board[Index - BoardOrder] + Board[Index - BoardOrder + 1] +
-                     Board[Index - 1]              +             0             + Board[Index + 1]              +
-                     Board[Index + BoardOrder - 1] + Board[Index + BoardOrder] + Board[Index + BoardOrder + 1];
+            NMines = IsMine(Index - BoardWidth - 1) + IsMine(Index - BoardWidth) + IsMine(Index - BoardWidth + 1) +
+                     IsMine(Index - 1)              +             0             + IsMine(Index + 1)              +
+                     IsMine(Index + BoardWidth - 1) + IsMine(Index + BoardWidth) + IsMine(Index + BoardWidth + 1);
             break;
         default:
             break;
@@ -256,19 +578,119 @@ int FMineSweeper::CountNearbyMines(int Index)
    return NMines;
 }
 
-/// Set "UserBoard" cell to the same as "NearbyMinesBoard" since the number of nearby mines was precalculated on this board
+/// Show the cell on the User board. It will display the number of nearby mines, which was precalculated on the cell, or X if it has a mine.
 void FMineSweeper::SetCellUserBoard(int Index)
+{
+    if (Journal != nullptr)
+    {
+        Journal->RecordMove(EJournalRecord::ShowCell, Index);
+    }
+    if (Metrics != nullptr && MoveStartTime == 0)
+    {
+        MoveStartTime = GetMetricsTime();
+    }
+    uint8_t Before = Cells[Index];
+    ShowCell(Index);
+    if (History != nullptr)
+    {
+        History->AddCell(Index, (Before ^ Cells[Index]) & HISTORY_CELL_BITS);
+    }
+}
+
+/// SetCellUserBoard without recording it, also used by the flood fill.
+/// On a first click safe game the first call places the mines, and the nearby mines of the row of the cell are counted here if they were not yet.
+void FMineSweeper::ShowCell(int Index)
 { 
-    UserBoard[Index] = NearbyMinesBoard[Index];
+    if (!bMinesPlaced)
+    {
+        PlaceMinesOnFirstClick(Index);
+    }
+    if (bCountsPending)
+    {
+        int y = Index / BoardWidth;
+        if (!CountedRows[y])
+        {
+            SetNearbyMinesRow(y);
+            CountedRows[y] = 1;
+        }
+    }
+    Cells[Index] |= CELL_SHOWN;
+}
+
+/// Store the number of mines adjacent to the cell on its upper bits
+void FMineSweeper::SetCellNearbyMinesBoard(int Index)
+{
+    Cells[Index] = (uint8_t) ((Cells[Index] & ((1 << CELL_COUNT_SHIFT) - 1)) | (CountNearbyMines(Index) << CELL_COUNT_SHIFT));
+}
+
+/// Flag or unflag a cell that is not displayed yet. Returns false (and changes nothing, not even the journal) if the cell is out of
+/// the board or already displayed, or the game is over. The flags of the results and the flags around each neighbour change only
+/// when the flag of the cell does.
+bool FMineSweeper::SetCellFlag(int Index, bool bFlag)
+{
+    if (!Cells || Index < 0 || Index >= BoardSize || (Cells[Index] & CELL_SHOWN) || GameStatus != EGameStatus::KeepPlaying)
+    {
+        return false;
+    }
+    if (Journal != nullptr)
+    {
+        Journal->RecordMove(bFlag ? EJournalRecord::Flag : EJournalRecord::Unflag, Index);
+    }
+    if (((Cells[Index] & CELL_FLAG) != 0) == bFlag)
+    {
+        return true;
+    }
+    if (FlagCounts.empty())
+    {
+        SetFlagCountsInit();
+    }
+    Cells[Index] ^= CELL_FLAG;
+    Results.NumFlags += bFlag ? 1 : -1;
+    AddFlagAround(Index, bFlag ? 1 : -1);
+    if (History != nullptr)
+    {
+        History->AddCell(Index, CELL_FLAG);
+        History->EndMove(Cells.GetData(), Results, GameStatus, bMineShown);
+    }
+    return true;
+}
+
+/// Count the flags around every cell, from the flags of the cells. Only needed once per game: SetCellFlag keeps them up to date.
+void FMineSweeper::SetFlagCountsInit()
+{
+    FlagCounts.assign(BoardSize, 0);
+    for (int i = 0; i < BoardSize; i++)
+    {
+        if (Cells[i] & CELL_FLAG)
+        {
+            AddFlagAround(i, 1);
+        }
+    }
+}
+
+/// Add Delta to the flags around each neighbour of the cell
+void FMineSweeper::AddFlagAround(int Index, int Delta)
+{
+    int x = Index % BoardWidth;
+    int y = Index / BoardWidth;
+    int FirstX = (x > 0) ? x - 1 : x, LastX = (x + 1 < BoardWidth) ? x + 1 : x;
+    int FirstY = (y > 0) ? y - 1 : y, LastY = (y + 1 < BoardHeight) ? y + 1 : y;
+    for (int Ny = FirstY; Ny <= LastY; Ny++)
+    {
+        for (int Nx = FirstX; Nx <= LastX; Nx++)
+        {
+            int Neighbour = Nx + Ny * BoardWidth;
+            FlagCounts[Neighbour] = (uint8_t) (FlagCounts[Neighbour] + (Neighbour != Index ? Delta : 0));
+        }
+    }
 }
 
 /// Check whether the selected cell is empty or has a mine on it. Last argument is modified inside this function.
 int FMineSweeper::CheckSingleCell(int InxEmptyCells, int InxToCheck, int EmptyCells[])
 {
-    if(NearbyMinesBoard[InxToCheck] != 'X')
+    if(!IsMine(InxToCheck))
     {
         EmptyCells[InxEmptyCells] = InxToCheck;
-        Results.NumMinesLeft --;
         return (InxEmptyCells+1);
     }
     else
@@ -288,31 +710,31 @@ int  FMineSweeper::CheckEmptySurroundingCells(int Index, int EmptyCells[])
         case ECellType::UpperLeftCorner:
             InxToCheck = Index + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder;
+            InxToCheck = Index + BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder + 1;
+            InxToCheck = Index + BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         case ECellType::UpperRightCorner:
             InxToCheck = Index - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder;
+            InxToCheck = Index + BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder - 1;
+            InxToCheck = Index + BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         case ECellType::LowerLeftCorner:
-            InxToCheck = Index - BoardOrder;
+            InxToCheck = Index - BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder + 1;
+            InxToCheck = Index - BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         case ECellType::LowerRightCorner:
-            InxToCheck = Index - BoardOrder - 1;
+            InxToCheck = Index - BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder;
+            InxToCheck = Index - BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
@@ -322,19 +744,19 @@ int  FMineSweeper::CheckEmptySurroundingCells(int Index, int EmptyCells[])
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder - 1;
+            InxToCheck = Index + BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder;
+            InxToCheck = Index + BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder + 1;
+            InxToCheck = Index + BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         case ECellType::LowerHorizontal:
-            InxToCheck = Index - BoardOrder - 1;
+            InxToCheck = Index - BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder;
+            InxToCheck = Index - BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder + 1;
+            InxToCheck = Index - BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
@@ -342,90 +764,222 @@ int  FMineSweeper::CheckEmptySurroundingCells(int Index, int EmptyCells[])
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         case ECellType::LeftVertical:
-            InxToCheck = Index - BoardOrder;
+            InxToCheck = Index - BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder + 1;
+            InxToCheck = Index - BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder;
+            InxToCheck = Index + BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder + 1;
+            InxToCheck = Index + BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         case ECellType::RightVertical:
-            InxToCheck = Index - BoardOrder - 1;
+            InxToCheck = Index - BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder;
+            InxToCheck = Index - BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder - 1;
+            InxToCheck = Index + BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder;
+            InxToCheck = Index + BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         case ECellType::Central:
-            InxToCheck = Index - BoardOrder - 1;
+            InxToCheck = Index - BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder;
+            InxToCheck = Index - BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index - BoardOrder + 1;
+            InxToCheck = Index - BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             InxToCheck = Index + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder - 1;
+            InxToCheck = Index + BoardWidth - 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder;
+            InxToCheck = Index + BoardWidth;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
-            InxToCheck = Index + BoardOrder + 1;
+            InxToCheck = Index + BoardWidth + 1;
             InxEmptyCells = CheckSingleCell(InxEmptyCells, InxToCheck, EmptyCells);
             break;
         default:
             break;
     }
-    return *EmptyCells;
+    return InxEmptyCells;
+}
+
+/// Reveal the given cell and, if it has no mines nearby, every empty cell connected to it. 
+/// The cells are explored with an explicit stack instead of recursion, so huge empty areas can not overflow the call stack.
+/// With RevealThreads, an area that reaches STRIPS_REVEAL_MIN_CELLS cells is finished on strips of rows, check BoardStrips.h.
+/// Returns the cells revealed by this call. The list is reused on the next call, copy it if it has to be kept.
+const std::vector<int>& FMineSweeper::SetCellUserVisitedBoard(int Index) 
+{
+    if (Journal != nullptr)
+    {
+        Journal->RecordMove(EJournalRecord::VisitCell, Index);
+    }
+    if (Metrics != nullptr && MoveStartTime == 0)
+    {
+        MoveStartTime = GetMetricsTime();
+    }
+    RevealedCells.clear();
+    VisitCell(Index);
+    return RevealedCells;
 }
 
-/// Recursive function to explore all the empty cells next to a given cell 
-void FMineSweeper::SetCellUserVisitedBoard(int Index) 
+/// SetCellUserVisitedBoard without recording it, also used by the chords. The cells revealed are added to RevealedCells.
+void FMineSweeper::VisitCell(int Index)
 {
-    int EmptyNeighbours[8] = {-1, -1, -1, -1, -1, -1, -1, -1};  // Index of the empty neighbours
-    if (UserVisitedBoard[Index] == 0)                           // If cell has not been visited before
+    int EmptyNeighbours[8];                                     // Index of the empty neighbours
+    int NumEmptyNeighbours = 0;
+    int Cell = 0;
+    size_t PeakStack = 0;                                       // Deepest the stack got, for the metrics
+    uint8_t Before = Cells[Index];                              // For the history
+    size_t FirstRevealed = RevealedCells.size();
+
+    FloodStack.clear();
+    if (!bMinesPlaced)
     {
-        UserVisitedBoard[Index] = 1;                            // Mark as visited 
+        PlaceMinesOnFirstClick(Index);
+    }
+    if (Cells[Index] & (CELL_VISITED | CELL_MINE))              // If cell was already visited (or has a mine), do not check anything
+    {
+        return;
+    }
+    if (FixedKernels != nullptr && !bCountsPending)             // Same fill, unrolled for the size of a difficulty
+    {
+        Results.NumSpacesLeft -= FixedKernels->FloodFill(Cells.GetData(), Index, RevealedCells);
+        if (Metrics != nullptr)
+        {
+            RecordFlood(0);                                     // Its stack is not seen
+        }
+        if (History != nullptr)
+        {
+            RecordVisit(Index, Before, FirstRevealed);
+        }
+        return;
+    }
+
+    Cells[Index] |= CELL_VISITED;                               // Cells are marked as visited when pushed, so each one is pushed only once
+    FloodStack.push_back(Index);
+    while (!FloodStack.empty())
+    {
+        PeakStack = FloodStack.size() > PeakStack ? FloodStack.size() : PeakStack;
+        if (RevealThreads > 1 && RevealedCells.size() == STRIPS_REVEAL_MIN_CELLS)     // A big area: the rest is opened in parallel
+        {
+            Results.NumSpacesLeft -= FloodFillStrips(SimdLevel, Cells.GetData(), BoardWidth, BoardHeight,
+                                                     bCountsPending ? CountedRows.data() : nullptr, FloodStack, RevealThreads, RevealedCells);
+            break;
+        }
+        Cell = FloodStack.back();
+        FloodStack.pop_back();
+        ShowCell(Cell);                                         // Update cell on UserBoard
         Results.NumSpacesLeft--;                                // Decrease the number of spaces left on the game
-        if (UserBoard[Index] == '0')                            // If there are no mines nearby
+        RevealedCells.push_back(Cell);
+        if ((Cells[Cell] >> CELL_COUNT_SHIFT) == 0)             // If there are no mines nearby, explore the neighbours too
         {
-            CheckEmptySurroundingCells(Index, EmptyNeighbours); // Check if there are empty neighbours. EmptyNeighbours is modified in this function
-            for (int i = 0; i < 8; i++)                         // Iterate on all the empty neighbours
+            NumEmptyNeighbours = CheckEmptySurroundingCells(Cell, EmptyNeighbours);
+            for (int i = 0; i < NumEmptyNeighbours; i++)
             {
-                if (EmptyNeighbours[i] != -1)
-                {
-                    SetCellUserBoard(EmptyNeighbours[i]);       // Update cell on UserBoard 
-                    SetCellUserVisitedBoard(EmptyNeighbours[i]);// Update cell on UserVisitedBoard
-                }
-                else
+                if ((Cells[EmptyNeighbours[i]] & (CELL_VISITED | CELL_FLAG)) == 0)    // Flagged cells are left to the player
                 {
-                    return;
+                    Cells[EmptyNeighbours[i]] |= CELL_VISITED;
+                    FloodStack.push_back(EmptyNeighbours[i]);
                 }
             }
         }
     }
-    else //If cell was already visited, do not check anything
+    if (Metrics != nullptr)
     {
-        return;
+        RecordFlood(PeakStack);
+    }
+    if (History != nullptr)
+    {
+        RecordVisit(Index, Before, FirstRevealed);
+    }
+}
+
+/// Chord on a displayed number: if as many of its neighbours are flagged as mines it has nearby, every hidden neighbour without flag
+/// is revealed, each one as SetCellUserBoard + SetCellUserVisitedBoard, so the empty ones open their areas with the same flood fill.
+/// The flags around the number are kept counted (SetCellFlag), so a chord that does not apply is found without looking at the neighbours.
+/// Returns the cells revealed, with the mines next to wrong flags (the next SetGameStatus loses the game). Reused as the list of
+/// SetCellUserVisitedBoard. Nothing is done if the cell is out of the board or the game is over, and only a chord that reveals a
+/// cell is recorded on the journal.
+const std::vector<int>& FMineSweeper::ChordCell(int Index)
+{
+    RevealedCells.clear();
+    if (!Cells || Index < 0 || Index >= BoardSize || GameStatus != EGameStatus::KeepPlaying)
+    {
+        return RevealedCells;
+    }
+    int NearbyMines = Cells[Index] >> CELL_COUNT_SHIFT;
+    if ((Cells[Index] & (CELL_SHOWN | CELL_MINE)) != CELL_SHOWN || NearbyMines == 0)
+    {
+        return RevealedCells;
+    }
+    if (FlagCounts.empty())
+    {
+        SetFlagCountsInit();
+    }
+    if (FlagCounts[Index] != NearbyMines)
+    {
+        return RevealedCells;
+    }
+    if (Metrics != nullptr && MoveStartTime == 0)
+    {
+        MoveStartTime = GetMetricsTime();
+    }
+    int x = Index % BoardWidth;
+    int y = Index / BoardWidth;
+    int FirstX = (x > 0) ? x - 1 : x, LastX = (x + 1 < BoardWidth) ? x + 1 : x;
+    int FirstY = (y > 0) ? y - 1 : y, LastY = (y + 1 < BoardHeight) ? y + 1 : y;
+    bool bRecorded = false;
+    for (int Ny = FirstY; Ny <= LastY; Ny++)
+    {
+        for (int Nx = FirstX; Nx <= LastX; Nx++)
+        {
+            int Neighbour = Nx + Ny * BoardWidth;
+            if (Cells[Neighbour] & (CELL_SHOWN | CELL_FLAG))    // The number itself, cells opened before and flags
+            {
+                continue;
+            }
+            if (Journal != nullptr && !bRecorded)               // Only a chord that reveals a cell is recorded
+            {
+                Journal->RecordMove(EJournalRecord::Chord, Index);
+                bRecorded = true;
+            }
+            uint8_t Before = Cells[Neighbour];
+            ShowCell(Neighbour);
+            if (History != nullptr)
+            {
+                History->AddCell(Neighbour, (Before ^ Cells[Neighbour]) & HISTORY_CELL_BITS);
+            }
+            if (Cells[Neighbour] & CELL_MINE)
+            {
+                bMineShown = true;
+                RevealedCells.push_back(Neighbour);
+            }
+            else
+            {
+                VisitCell(Neighbour);
+            }
+        }
     }
-    
-    
+    return RevealedCells;
 }
 
-/// Calculate game status depending on the last selected cell
+/// Calculate game status depending on the last selected cell, or on the mines a chord displayed. Flagged cells are hidden cells.
 void FMineSweeper::SetGameStatus(int Index) 
 { 
-    if (UserBoard[Index] == 'X')                    // If a mine was found, game is lost
+    EGameStatus PreviousStatus = GameStatus;
+    if (Journal != nullptr)
+    {
+        Journal->RecordMove(EJournalRecord::GameStatus, Index);
+    }
+    if (bMineShown || (Cells[Index] & (CELL_MINE | CELL_SHOWN)) == (CELL_MINE | CELL_SHOWN))   // If a mine was found, game is lost
     {
         GameStatus = EGameStatus::GameLost;
     }
@@ -437,13 +991,230 @@ void FMineSweeper::SetGameStatus(int Index)
     {
         GameStatus = EGameStatus::KeepPlaying;
     }
+    if (bCountsPending && GameStatus != EGameStatus::KeepPlaying)  // Fill the counts nobody displayed, for the final board
+    {
+        for (int y = 0; y < BoardHeight; y++)
+        {
+            if (!CountedRows[y])
+            {
+                SetNearbyMinesRow(y);
+            }
+        }
+        bCountsPending = false;
+    }
+    if (Journal != nullptr && Journal->IsChecksumDue(GameStatus != EGameStatus::KeepPlaying))
+    {
+        Journal->RecordChecksum(GetStateHash());
+    }
+    if (Metrics != nullptr)
+    {
+        RecordMoveEnd(PreviousStatus);
+    }
+    if (History != nullptr)
+    {
+        History->EndMove(Cells.GetData(), Results, GameStatus, bMineShown);
+    }
+}
+
+/// Record the hash of the state if there were moves after the last one, before the game is replaced or freed
+void FMineSweeper::RecordPendingChecksum()
+{
+    if (Journal != nullptr && Cells && Journal->IsChecksumDue(true))
+    {
+        Journal->RecordChecksum(GetStateHash());
+    }
+}
+
+/// Run a phase of Reset, timing it on the metrics if there are
+bool FMineSweeper::RunPhase(EGamePhase Phase, bool (FMineSweeper::*Init)())
+{
+    if (Metrics == nullptr)
+    {
+        return (this->*Init)();
+    }
+    uint64_t StartTime = GetMetricsTime();
+    bool bOk = (this->*Init)();
+    Metrics->PhaseNanoseconds[(int) Phase].Add(GetMetricsTime() - StartTime);
+    return bOk;
+}
+
+/// Count a new game on the metrics, if there are. StartTime is when its Reset started and StartBytes the bytes the board pool had
+/// allocated then, or 0 if no board was generated (Restart).
+void FMineSweeper::RecordGameStart(uint64_t StartTime, uint64_t StartBytes)
+{
+    if (Metrics == nullptr)
+    {
+        return;
+    }
+    uint64_t Now = GetMetricsTime();
+    Metrics->Games++;
+    Metrics->LastGame = FGameRecord();
+    if (StartTime != 0)
+    {
+        Metrics->PhaseNanoseconds[(int) EGamePhase::Reset].Add(Now - StartTime);
+        Metrics->BytesAllocated += GetBoardPoolStats().AllocatedBytes - StartBytes;
+        Metrics->LastGame.GenerationNanoseconds = Now - StartTime;
+    }
+    GameStartTime = Now;
+    MoveStartTime = 0;
+}
+
+/// Cells opened by the last SetCellUserVisitedBoard and the deepest its stack got (0 if it is not known)
+void FMineSweeper::RecordFlood(size_t PeakStack)
+{
+    if (RevealedCells.empty())
+    {
+        return;
+    }
+    Metrics->FloodCells.Add(RevealedCells.size());
+    Metrics->LastGame.CellsOpened += RevealedCells.size();
+    if (PeakStack > 0)
+    {
+        Metrics->FloodStackPeak.Add(PeakStack);
+    }
+}
+
+/// End the move started by SetCellUserBoard or SetCellUserVisitedBoard, and the game if the move ended it
+void FMineSweeper::RecordMoveEnd(EGameStatus PreviousStatus)
+{
+    uint64_t Now = GetMetricsTime();
+    if (MoveStartTime != 0)
+    {
+        Metrics->Moves++;
+        Metrics->MoveNanoseconds.Add(Now - MoveStartTime);
+        Metrics->LastGame.Moves++;
+        MoveStartTime = 0;
+    }
+    if (PreviousStatus != EGameStatus::KeepPlaying || GameStatus == EGameStatus::KeepPlaying)
+    {
+        return;
+    }
+    if (GameStatus == EGameStatus::GameWon)
+    {
+        Metrics->Wins++;
+    }
+    else
+    {
+        Metrics->Losses++;
+    }
+    if (GameStartTime != 0)
+    {
+        Metrics->LastGame.Nanoseconds = Now - GameStartTime;
+        if (GameStatus == EGameStatus::GameWon)
+        {
+            Metrics->WinNanoseconds.Add(Now - GameStartTime);
+        }
+    }
+    GameStartTime = 0;
+}
+
+/// Add the cells revealed by a fill from Index to the history. The fill only reaches hidden cells that were not visited, and gives them
+/// both bits; Index may have been displayed before by SetCellUserBoard.
+void FMineSweeper::RecordVisit(int Index, uint8_t Before, size_t FirstRevealed)
+{
+    for (size_t i = FirstRevealed; i < RevealedCells.size(); i++)
+    {
+        int Cell = RevealedCells[i];
+        History->AddCell(Cell, (Cell == Index) ? (Before ^ Cells[Index]) & HISTORY_CELL_BITS : CELL_SHOWN | CELL_VISITED);
+    }
+}
+
+/// Start the history again from the current state, if there is a history and a board
+void FMineSweeper::ClearHistory()
+{
+    if (History != nullptr && Cells)
+    {
+        History->Clear(BoardSize, Results, GameStatus, bMineShown);
+    }
+}
+
+/// Take back the last move played. Returns false if there is no history or no move to undo.
+bool FMineSweeper::UndoMove()
+{
+    return History != nullptr && GoToMove(History->GetCurrentMove() - 1);
+}
+
+/// Play again the last move undone. Returns false if there is no history or no move to redo.
+bool FMineSweeper::RedoMove()
+{
+    return History != nullptr && GoToMove(History->GetCurrentMove() + 1);
+}
+
+/// Undo or redo moves until Move moves of the game are played (0 is the start of the game), flipping back the cells each one changed.
+/// From far away, a checkpoint of the history is restored first (check GameHistory.h). With a journal the state reached is recorded
+/// as a snapshot. Returns false (and changes nothing) if there is no history or board, or the move was not recorded.
+bool FMineSweeper::GoToMove(int Move)
+{
+    if (History == nullptr || !Cells || Move < 0 || Move > History->GetNumMoves())
+    {
+        return false;
+    }
+    RecordPendingChecksum();
+    int From = History->CurrentMove;
+    int Checkpoint = History->FindCheckpoint(Move);
+    if (Checkpoint >= 0)
+    {
+        const FHistoryCheckpoint& Saved = History->Checkpoints[Checkpoint];
+        for (int i = 0; i < BoardSize; i++)
+        {
+            Cells[i] = (uint8_t) ((Cells[i] & ~HISTORY_CELL_BITS) | Saved.Cells[i]);
+        }
+        FlagCounts.clear();             // Counted again from the flags when needed
+        From = Saved.Move;
+    }
+    size_t First = History->Moves[From < Move ? From : Move].EndCell;
+    size_t End = History->Moves[From < Move ? Move : From].EndCell;
+    for (size_t i = First; i < End; i++)          // Flipping a bit back and forth is the same, so both ways are the same loop
+    {
+        int Cell = History->CellIndices[i];
+        uint8_t Mask = History->CellMasks[i];
+        Cells[Cell] ^= Mask;
+        if ((Mask & CELL_FLAG) && !FlagCounts.empty())
+        {
+            AddFlagAround(Cell, (Cells[Cell] & CELL_FLAG) ? 1 : -1);
+        }
+    }
+    if (History->MinesMove > 0 && (Move >= History->MinesMove) != bMinesPlaced)
+    {
+        SetFirstClickMines(Move >= History->MinesMove);
+    }
+    const FHistoryMove& State = History->Moves[Move];
+    Results = State.Results;
+    GameStatus = State.Status;
+    bMineShown = State.bMineShown;
+    History->CurrentMove = Move;
+    if (Journal != nullptr)
+    {
+        Journal->RecordSnapshot(*this);
+    }
+    return true;
+}
+
+/// Place again the mines of the first click recorded on the history, or remove them, when a jump crosses that click. Placed again,
+/// every count is filled at once, as the cells the jump displays may be on any row.
+void FMineSweeper::SetFirstClickMines(bool bPlaced)
+{
+    if (bPlaced)
+    {
+        PlaceMinesAround(Cells.GetData(), BoardWidth, BoardHeight, NumMines, Seed, History->MinesCell, GenerationThreads);
+        SetNearbyMinesBoardInit();
+        bCountsPending = false;
+    }
+    else
+    {
+        for (int i = 0; i < BoardSize; i++)
+        {
+            Cells[i] &= HISTORY_CELL_BITS;      // No mines or counts, as Reset left the board
+        }
+        CountedRows.assign(BoardHeight, 0);
+        bCountsPending = true;
+    }
+    bMinesPlaced = bPlaced;
 }
 
-/// Erase all the boards from memory
+/// Erase all the boards from memory, returning them to the board pool
 void FMineSweeper::EraseMemory()
 {
-    free(Board);
-    free(UserBoard);
-    free(UserVisitedBoard);
-    free(NearbyMinesBoard);
+    RecordPendingChecksum();
+    Cells.Release();
 }
@@ -1,10 +1,19 @@
 /* Minesweeper game logic.
 
-There are 4 boards:
-1. Board: contains mines (1) and spaces (0). This is randomly generated on each game.
-2. UserBoard: used for user interaction. Displays '-' by default, number of mines nearby or X (if a mine has exploded).
-3. UserVisitedBoard: contains the information of which cells have been visited (1 means visited, 0 no). Mines are marked as 1.
-4. NearbyMinesBoard: contains the number of mines adjacent to each cell. It is generated when the board is generated.
+There are 4 boards, all of them packed on a single array of one byte per cell:
+1. Board: contains mines (CELL_MINE bit). This is randomly generated on each game from a 64 bit seed, the same seed gives the same board.
+2. UserBoard: used for user interaction. Displays '-' by default, F if flagged, number of mines nearby or X (if a mine has exploded). Cells with CELL_SHOWN are displayed.
+3. UserVisitedBoard: contains the information of which cells have been visited (CELL_VISITED bit). Mines are marked as visited.
+4. NearbyMinesBoard: contains the number of mines adjacent to each cell (upper 4 bits). It is generated when the board is generated.
+UserBoard and NearbyMinesBoard are read as chars through FBoardView, which builds each char from the cell on demand.
+With a journal (SetJournal, check GameJournal.h) every call that changes the game is recorded, so the game can be replayed.
+With metrics (SetMetrics, check GameMetrics.h) the Reset phases, the moves and the flood fills are timed and counted.
+On a first click safe game (SetFirstClickSafe) the mines are placed on the first SetCellUserBoard, away from that cell and its neighbours,
+and the nearby mines of a row are counted when one of its cells is displayed. The counts of the other rows are filled when the game ends.
+Very big boards can count their nearby mines and open big areas on several threads (SetGenerationThreads, SetRevealThreads).
+Flags (SetCellFlag) are counted on the results, and around each cell, so a chord (ChordCell: reveal every hidden neighbour of a number
+whose flags are all placed) knows at once whether it applies.
+With a history (SetHistory, check GameHistory.h) the moves can be undone and redone (UndoMove, RedoMove, GoToMove).
 
 For further functionality and implementation details, check Minesweeper.cpp
 
@@ -13,12 +22,44 @@ Created by: Angel del Ojo Jimenez, July 2019
 
 #pragma once    
 #include <string>
+#include <vector>
+#include <cstdint>
+#include "BoardKernels.h"
+#include "BoardPool.h"
+#include "GameMetrics.h"
+
+class FBoardPipeline;
+class FGameJournal;
+class FGameHistory;
+struct FFixedBoardKernels;
+
+#define MIN_BOARD_SIDE 2            // Smallest width/height allowed, so every cell fits one of the ECellType cases
+#define MAX_BOARD_SIZE 2000000000   // Largest number of cells allowed, so every index fits on an int
+
+/// Bits of each packed cell
+#define CELL_MINE 0x01              // There is a mine on the cell
+#define CELL_SHOWN 0x02             // The cell is displayed on the User board
+#define CELL_VISITED 0x04           // The cell has been visited (or has a mine)
+#define CELL_FLAG 0x08              // The player marked the cell as a mine, empty areas do not open it
+#define CELL_COUNT_SHIFT 4          // The number of nearby mines (0-8) is stored on the upper 4 bits
 
 /// Game elements needed to create the boards and to check when the game is finished
 struct FGameStats
 {
     int NumSpacesLeft = 255;
     int NumMinesLeft = 255;
+    int NumFlags = 0;               // Cells flagged by the player, right or not
+};
+
+/// A generated board, moved from a game with TakeBoard and played on another with Reset: every cell of the boards, and its seed
+struct FReadyBoard
+{
+    FBoardBuffer Cells;
+    int Width = 0;                  // Size and mines of the game it was taken from, Reset only plays it on the same ones
+    int Height = 0;
+    int Mines = 0;
+    uint64_t Seed = 0;
+    bool bSeedBoard = false;        // Reset(Seed) without first click safe gives these mines, so a journal only needs the seed
 };
 
 /// Status of the current game
@@ -43,58 +84,159 @@ enum class ECellType
     Central
 };
 
-/// Class that contains all the information of the current game
+/// Read-only view of the packed cells as a board of chars, so they can be read as the old char boards
+class FBoardView
+{
+    public:
+        FBoardView(const uint8_t* InCells, bool bInShowAll) : Cells(InCells), bShowAll(bInShowAll) { }
+
+        /// Char of the cell: '-' (or F if flagged) if it is not displayed, X if it has a mine or the number of nearby mines otherwise
+        char operator[](int Index) const
+        {
+            uint8_t Cell = Cells[Index];
+            if (!bShowAll && (Cell & CELL_SHOWN) == 0)
+            {
+                return (Cell & CELL_FLAG) ? 'F' : '-';
+            }
+            return (Cell & CELL_MINE) ? 'X' : '0' + (Cell >> CELL_COUNT_SHIFT);
+        }
+        explicit operator bool() const { return Cells != nullptr; }
+
+    private:
+        const uint8_t* Cells;
+        bool bShowAll;              // false: User board (only displayed cells), true: NearbyMines board (every cell)
+};
+
+/// Class that contains all the information of the current game. Games do not share any state, so each thread can play its own games.
 class FMineSweeper
 {
     public:                 // Functions that can be accessed from the outside of the class
         FMineSweeper();     // Constructor, not needed at this point
+        FMineSweeper(int, int, int);    // Constructor for a custom board: width, height and number of mines. An invalid board
+                                        // leaves no board (GetBoardSize() is 0), and Reset fails.
+        ~FMineSweeper();                // Returns the boards to the pool if EraseMemory was not called
+        FMineSweeper(const FMineSweeper&) = delete;             // Boards are owned by a single game, they can be moved but not copied
+        FMineSweeper& operator=(const FMineSweeper&) = delete;
+        FMineSweeper(FMineSweeper&&) = default;
+        FMineSweeper& operator=(FMineSweeper&&) = default;
 
         /// Getters
         int GetBoardSize() const;
-        int GetBoardOrder() const;
+        int GetBoardWidth() const;
+        int GetBoardHeight() const;
         int GetNumMines() const;
-        char* GetUserBoard() const;
-        char* GetNearbyMinesBoard() const;
+        FBoardView GetUserBoard() const;
+        FBoardView GetNearbyMinesBoard() const;
         EGameStatus GetGameStatus() const;
         FGameStats GetResults() const;
+        ESimdLevel GetSimdLevel() const;
+        uint64_t GetSeed() const;
+        bool GetFirstClickSafe() const;
+        uint64_t GetStateHash() const;
 
         ///Setters  
         void SetGameParams(int);     
+        bool SetGameParams(int, int, int);
         void SetCellUserBoard(int);
-        void SetCellUserVisitedBoard(int);
+        bool SetCellFlag(int, bool);
+        const std::vector<int>& SetCellUserVisitedBoard(int);
+        const std::vector<int>& ChordCell(int);
         void SetCellNearbyMinesBoard(int);
         void SetGameStatus(int);
+        bool SetSimdLevel(ESimdLevel);
+        void SetGenerationThreads(int);
+        void SetRevealThreads(int);
+        void SetBoardPipeline(FBoardPipeline*);
+        void SetFirstClickSafe(bool);
+        void SetJournal(FGameJournal*);
+        void SetMetrics(FGameMetrics*);
+        void SetHistory(FGameHistory*);
+        void ResumeHistory(FGameHistory*);
 
         /// Rest of functions
         bool Reset();    
+        bool Reset(uint64_t);
+        bool Reset(uint64_t, int);
+        bool Reset(FReadyBoard&);
+        bool Restart();
+        bool TakeBoard(FReadyBoard&);
+        bool MoveMine(int, int);
+        bool UndoMove();
+        bool RedoMove();
+        bool GoToMove(int);
         void EraseMemory();
 
 
     private:                // Functions and variables that help the public ones
-        /// Boards
-        int* Board;    
-        char* UserBoard;
-        int* UserVisitedBoard;
-        char* NearbyMinesBoard;
+        /// Boards, packed on one byte per cell (see CELL_ bits). The memory comes from the board pool of BoardPool.h.
+        FBoardBuffer Cells;
 
         /// Game Parameters
         int Difficulty = 0; 
-        int BoardOrder = 0;
+        int BoardWidth = 0;
+        int BoardHeight = 0;
         int BoardSize = 0;
         int NumMines = 0;
         bool bIsGameWon = false;
         EGameStatus GameStatus;
         FGameStats Results;
+        ESimdLevel SimdLevel = GetBestSimdLevel();
+        uint64_t Seed = 0;              // Seed of the current board
+        int GenerationThreads = 1;      // Threads used to place the mines and count them on big boards, it does not change the board
+        int RevealThreads = 1;          // Threads that open big areas (check BoardStrips.h), it does not change the cells opened
+        FBoardPipeline* Pipeline = nullptr;     // Ready boards for Reset() without a seed, optional (check BoardPipeline.h)
+        bool bFirstClickSafe = false;   // Mines are placed on the first click, away from it
+        bool bMinesPlaced = true;       // false until the first click of a first click safe game
+        bool bCountsPending = false;    // Only the rows in CountedRows have their number of nearby mines
+        bool bSeedBoard = false;        // The mines are the ones Reset(Seed) places (check FReadyBoard)
+        FGameJournal* Journal = nullptr;        // Records every change of the game, optional (check GameJournal.h)
+        const FFixedBoardKernels* FixedKernels = nullptr;  // Kernels of this board size, only on the sizes of the difficulties
+        FGameMetrics* Metrics = nullptr;        // Records the games, optional (check GameMetrics.h)
+        FGameHistory* History = nullptr;        // Records what each move changes to undo it, optional (check GameHistory.h)
+        uint64_t GameStartTime = 0;             // Metrics time of the start of the game and of the current move, 0 if unknown
+        uint64_t MoveStartTime = 0;
+
+        /// Row buffers of the nearby mines kernel: column sums with a ghost cell at each side, and the zero row outside the board
+        std::vector<uint8_t> ColumnSums;
+        std::vector<uint8_t> ZeroRow;
+        std::vector<uint8_t> CountedRows;       // Rows whose nearby mines are counted, on a first click safe game
+
+        /// Flood fill buffers, kept between moves so revealing cells does not allocate once they have grown
+        std::vector<int> FloodStack;
+        std::vector<int> RevealedCells;
+
+        /// Flags around each cell, kept up to date by SetCellFlag. Empty until the first flag or chord of the game needs them.
+        std::vector<uint8_t> FlagCounts;
+        bool bMineShown = false;        // A chord displayed a mine next to a wrong flag, or a lost game was loaded
 
         /// Setters
         bool SetBoardInit();
         bool SetUserBoardInit();
         bool SetUserVisitedBoardInit();
         bool SetNearbyMinesBoardInit();
+        bool SetNearbyMinesBoardInitPerCell();
+        void SetNearbyMinesRow(int);
+        void SetFlagCountsInit();
 
         /// Rest of functions
+        void PlaceMinesOnFirstClick(int);
+        void SetFirstClickMines(bool);
+        void ShowCell(int);
+        void VisitCell(int);
+        void AddFlagAround(int, int);
+        void RecordPendingChecksum();
+        bool RunPhase(EGamePhase, bool (FMineSweeper::*)());
+        void RecordGameStart(uint64_t, uint64_t);
+        void RecordFlood(size_t);
+        void RecordMoveEnd(EGameStatus);
+        void RecordVisit(int, uint8_t, size_t);
+        void ClearHistory();
+        int  IsMine(int Index) const { return Cells[Index] & CELL_MINE; }
         ECellType CalcCellType(int);
         int  CountNearbyMines(int);
         int  CheckEmptySurroundingCells(int, int[]);
         int  CheckSingleCell(int, int, int* );
+
+        friend struct FBenchmarkAccess;     // Benchmark.cpp times the private Reset phases
+        friend struct FSnapshotAccess;      // GameSnapshot.cpp saves and loads the whole state of the game
 };
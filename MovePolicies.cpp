@@ -0,0 +1,136 @@
+/* Move policies, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "MovePolicies.h"
+#include <cstring>
+
+#define POLICY_STREAM 1             // Random stream of the policies, so they never repeat the numbers of the mine placement
+
+FRandomPolicy::FRandomPolicy(uint64_t Seed) : Rng(Seed, POLICY_STREAM) { }
+
+/// Every cell is a candidate at the beginning of the game
+void FRandomPolicy::StartGame(const FMineSweeper& Game)
+{
+    Candidates.resize(Game.GetBoardSize());
+    for (int i = 0; i < Game.GetBoardSize(); i++)
+    {
+        Candidates[i] = i;
+    }
+}
+
+/// Draw candidates until one is still hidden. Drawn cells are removed by swapping them with the last one, so each move costs O(1) on average.
+int FRandomPolicy::ChooseMove(const FMineSweeper& Game)
+{
+    FBoardView Board = Game.GetUserBoard();
+    while (!Candidates.empty())
+    {
+        int Position = (int) Rng.NextBelow((uint32_t) Candidates.size());
+        int Cell = Candidates[Position];
+        Candidates[Position] = Candidates.back();
+        Candidates.pop_back();
+        if (Board[Cell] == '-')
+        {
+            return Cell;
+        }
+    }
+    return -1;
+}
+
+void FSolverPolicy::StartGame(const FMineSweeper& Game)
+{
+    FRandomPolicy::StartGame(Game);
+    Solver.StartGame(Game);
+}
+
+/// A safe cell if the solver knows one. Otherwise a random hidden cell, drawing again while it is a known mine.
+int FSolverPolicy::ChooseMove(const FMineSweeper& Game)
+{
+    int Hint = Solver.GetHint();
+    if (Hint >= 0)
+    {
+        return Hint;
+    }
+    int Guess = FRandomPolicy::ChooseMove(Game);
+    while (Guess >= 0 && Solver.GetCell(Guess) == ESolverCell::Mine)
+    {
+        Guess = FRandomPolicy::ChooseMove(Game);
+    }
+    return Guess;
+}
+
+/// A safe cell if the solver knows one. Otherwise the safest cell, computed only then since it reads the whole board, or a guess
+/// of the solver policy if the probabilities can not be computed.
+int FProbabilityPolicy::ChooseMove(const FMineSweeper& Game)
+{
+    if (Solver.GetHint() >= 0 || !Probability.Compute(Game))
+    {
+        return FSolverPolicy::ChooseMove(Game);
+    }
+    return Probability.GetSafestCell();
+}
+
+/// Same, with the probabilities sampled for a fixed time
+int FSampledPolicy::ChooseMove(const FMineSweeper& Game)
+{
+    if (Solver.GetHint() >= 0 || !Sampler.Start(Game, Rng.Next()))
+    {
+        return FSolverPolicy::ChooseMove(Game);
+    }
+    Sampler.Run(SAMPLER_POLICY_MILLISECONDS);
+    return Sampler.GetSafestCell();
+}
+
+void FSolverPolicy::MoveDone(const FMineSweeper& Game, const std::vector<int>& Revealed)
+{
+    Solver.Update(Game, Revealed);
+}
+
+std::unique_ptr<FMovePolicy> MakeMovePolicy(EMovePolicy Policy, uint64_t Seed)
+{
+    switch (Policy)
+    {
+        case EMovePolicy::FirstClickSafe:
+            return std::unique_ptr<FMovePolicy>(new FFirstClickSafePolicy(Seed));
+        case EMovePolicy::Solver:
+            return std::unique_ptr<FMovePolicy>(new FSolverPolicy(Seed));
+        case EMovePolicy::Probability:
+            return std::unique_ptr<FMovePolicy>(new FProbabilityPolicy(Seed));
+        case EMovePolicy::Sampled:
+            return std::unique_ptr<FMovePolicy>(new FSampledPolicy(Seed));
+        default:
+            return std::unique_ptr<FMovePolicy>(new FRandomPolicy(Seed));
+    }
+}
+
+const char* GetMovePolicyName(EMovePolicy Policy)
+{
+    switch (Policy)
+    {
+        case EMovePolicy::FirstClickSafe:
+            return "safe";
+        case EMovePolicy::Solver:
+            return "solver";
+        case EMovePolicy::Probability:
+            return "probability";
+        case EMovePolicy::Sampled:
+            return "sampled";
+        default:
+            return "random";
+    }
+}
+
+bool ParseMovePolicy(const char* Name, EMovePolicy& Policy)
+{
+    EMovePolicy Policies[] = { EMovePolicy::Random, EMovePolicy::FirstClickSafe, EMovePolicy::Solver, EMovePolicy::Probability, EMovePolicy::Sampled };
+    for (EMovePolicy Candidate : Policies)
+    {
+        if (strcmp(Name, GetMovePolicyName(Candidate)) == 0)
+        {
+            Policy = Candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+/* Move policies: the automatic players used by the headless simulator.
+
+A policy only looks at what a player could see (the User board) and returns the next cell to select.
+Each simulated game gets its own policy object, so policies can keep state between moves without locks.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include "Minesweeper.h"
+#include "Random.h"
+#include "Solver.h"
+#include "MineProbability.h"
+#include "MineSampler.h"
+#include <memory>
+#include <vector>
+
+#define SAMPLER_POLICY_MILLISECONDS 20  // Time the sampled policy samples before each guess
+
+/// Available policies
+enum class EMovePolicy
+{
+    Random,                 // Any cell that has not been displayed yet
+    FirstClickSafe,         // Same as Random, but the game places its mines on the first click, away from it
+    Solver,                 // Cells proved safe by FMineSolver, a random guess (never on a known mine) when there are none
+    Probability,            // Same as Solver, but the guess is the cell with the lowest mine probability (FMineProbability)
+    Sampled                 // Same as Probability, with the probabilities sampled for SAMPLER_POLICY_MILLISECONDS (FMineSampler)
+};
+
+/// Base class of every policy
+class FMovePolicy
+{
+    public:
+        virtual ~FMovePolicy() { }
+
+        /// Called once the board of a new game is ready
+        virtual void StartGame(const FMineSweeper&) = 0;
+
+        /// Index of the next cell to select. It must not be displayed yet.
+        virtual int ChooseMove(const FMineSweeper&) = 0;
+
+        /// Called after each move with the cells it revealed
+        virtual void MoveDone(const FMineSweeper&, const std::vector<int>&) { }
+
+        /// Whether the first click of the game must be on a cell without a mine
+        virtual bool IsFirstClickSafe() const { return false; }
+};
+
+/// Select any cell that has not been displayed, uniformly at random
+class FRandomPolicy : public FMovePolicy
+{
+    public:
+        explicit FRandomPolicy(uint64_t Seed);
+        void StartGame(const FMineSweeper&) override;
+        int ChooseMove(const FMineSweeper&) override;
+
+    protected:
+        FCounterRng Rng;
+        std::vector<int> Candidates;     // Cells that may still be hidden, displayed ones are removed when drawn
+};
+
+/// Random policy that never loses on the first click
+class FFirstClickSafePolicy : public FRandomPolicy
+{
+    public:
+        explicit FFirstClickSafePolicy(uint64_t Seed) : FRandomPolicy(Seed) { }
+        bool IsFirstClickSafe() const override { return true; }
+};
+
+/// Play the safe cells found by the solver, and guess only when it does not find any. The first click is safe too.
+class FSolverPolicy : public FRandomPolicy
+{
+    public:
+        explicit FSolverPolicy(uint64_t Seed) : FRandomPolicy(Seed) { }
+        void StartGame(const FMineSweeper&) override;
+        int ChooseMove(const FMineSweeper&) override;
+        void MoveDone(const FMineSweeper&, const std::vector<int>&) override;
+        bool IsFirstClickSafe() const override { return true; }
+
+    protected:
+        FMineSolver Solver;
+};
+
+/// Play the safe cells found by the solver, and guess the cell least likely to have a mine when it does not find any
+class FProbabilityPolicy : public FSolverPolicy
+{
+    public:
+        explicit FProbabilityPolicy(uint64_t Seed) : FSolverPolicy(Seed) { }
+        int ChooseMove(const FMineSweeper&) override;
+
+    private:
+        FMineProbability Probability;
+};
+
+/// Same as the probability policy, for boards too big to count: the probabilities are sampled on the thread of the game
+class FSampledPolicy : public FSolverPolicy
+{
+    public:
+        explicit FSampledPolicy(uint64_t Seed) : FSolverPolicy(Seed), Sampler(SAMPLER_DEFAULT_CHAINS, 1) { }
+        int ChooseMove(const FMineSweeper&) override;
+
+    private:
+        FMineSampler Sampler;
+};
+
+/// Create a policy. The seed decides its random choices.
+std::unique_ptr<FMovePolicy> MakeMovePolicy(EMovePolicy, uint64_t Seed);
+
+/// Name of the policy, as written on the command line
+const char* GetMovePolicyName(EMovePolicy);
+
+/// Policy from its name. Returns false if the name is unknown.
+bool ParseMovePolicy(const char*, EMovePolicy&);
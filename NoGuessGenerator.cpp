@@ -0,0 +1,178 @@
+/* Generator of boards that can be cleared without guessing, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "NoGuessGenerator.h"
+#include "MineGenerator.h"
+#include "Random.h"
+#include "Solver.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define REPAIR_STREAM 1                 // Random stream of the repairs of a candidate, the mines use the candidate seed itself
+
+typedef std::chrono::steady_clock FClock;
+
+/// State shared by the search threads
+struct FNoGuessSearch
+{
+    int Width = 0;
+    int Height = 0;
+    int Mines = 0;
+    int FirstClick = 0;
+    ESimdLevel SimdLevel = ESimdLevel::Scalar;
+    FNoGuessOptions Options;
+    uint64_t BaseSeed = 0;
+    FClock::time_point Start;
+    std::atomic<uint64_t> NextCandidate{0};
+    std::atomic<uint64_t> Repairs{0};
+    std::atomic<bool> bFound{false};    // Set by the thread that finds the valid board, the others stop
+    FReadyBoard Board;                  // Written only by that thread
+};
+
+/// Play the candidate with the solver from the first click, revealing only the cells it proves safe.
+/// Returns true if the board gets cleared, false if the solver gets stuck or another thread already found a board.
+static bool SolveWithoutGuessing(FMineSweeper& Game, FMineSolver& Solver, int FirstClick, const std::atomic<bool>& bFound)
+{
+    Game.SetCellUserBoard(FirstClick);
+    Game.SetCellUserVisitedBoard(FirstClick);
+    Game.SetGameStatus(FirstClick);
+    Solver.StartGame(Game);
+    while (Game.GetGameStatus() == EGameStatus::KeepPlaying && !bFound.load(std::memory_order_relaxed))
+    {
+        int Cell = Solver.GetHint();
+        if (Cell < 0)
+        {
+            return false;
+        }
+        Game.SetCellUserBoard(Cell);
+        const std::vector<int>& Revealed = Game.SetCellUserVisitedBoard(Cell);
+        Game.SetGameStatus(Cell);
+        Solver.Update(Game, Revealed);
+    }
+    return Game.GetGameStatus() == EGameStatus::GameWon;
+}
+
+/// Move a mine the solver could not decide, on the frontier of the displayed cells, to a random hidden cell that does not touch any
+/// displayed cell. Returns false if there is no such mine or no such cell.
+static bool RepairCandidate(FMineSweeper& Game, const FMineSolver& Solver, FCounterRng& Rng, std::vector<int>& Stuck, std::vector<int>& Free)
+{
+    int Width = Game.GetBoardWidth();
+    int Height = Game.GetBoardHeight();
+    FBoardView User = Game.GetUserBoard();
+    FBoardView Mines = Game.GetNearbyMinesBoard();
+    Stuck.clear();
+    Free.clear();
+    for (int i = 0; i < Game.GetBoardSize(); i++)
+    {
+        if (User[i] != '-')
+        {
+            continue;
+        }
+        bool bTouchesShown = false;
+        int X = i % Width, Y = i / Width;
+        for (int y = (Y > 0 ? Y - 1 : 0); y <= Y + 1 && y < Height && !bTouchesShown; y++)
+        {
+            for (int x = (X > 0 ? X - 1 : 0); x <= X + 1 && x < Width; x++)
+            {
+                bTouchesShown = bTouchesShown || (User[x + y * Width] != '-' && User[x + y * Width] != 'F');
+            }
+        }
+        if (bTouchesShown && Mines[i] == 'X' && Solver.GetCell(i) == ESolverCell::Hidden)
+        {
+            Stuck.push_back(i);
+        }
+        else if (!bTouchesShown && Mines[i] != 'X')
+        {
+            Free.push_back(i);
+        }
+    }
+    if (Stuck.empty() || Free.empty())
+    {
+        return false;
+    }
+    return Game.MoveMine(Stuck[Rng.NextBelow((uint32_t) Stuck.size())], Free[Rng.NextBelow((uint32_t) Free.size())]);
+}
+
+/// Draw candidates until one is valid, another thread finds one or the time is over
+static void SearchBoards(FNoGuessSearch& Search)
+{
+    FMineSweeper Game;
+    FMineSolver Solver;
+    std::vector<int> Stuck, Free;
+    Game.SetGameParams(Search.Width, Search.Height, Search.Mines);
+    Game.SetSimdLevel(Search.SimdLevel);
+    while (!Search.bFound.load(std::memory_order_relaxed)
+           && std::chrono::duration<double>(FClock::now() - Search.Start).count() < Search.Options.TimeLimit)
+    {
+        uint64_t Number = Search.NextCandidate.fetch_add(1, std::memory_order_relaxed);
+        uint64_t Seed = MixBits64(Search.BaseSeed ^ MixBits64(Number + RNG_GOLDEN_GAMMA));
+        if (!Game.Reset(Seed, Search.FirstClick))
+        {
+            return;
+        }
+        bool bValid = SolveWithoutGuessing(Game, Solver, Search.FirstClick, Search.bFound);
+        FCounterRng Rng(Seed, REPAIR_STREAM);
+        for (int Repair = 0; !bValid && Search.Options.bRepair && Repair < NOGUESS_MAX_REPAIRS && !Search.bFound; Repair++)
+        {
+            if (!RepairCandidate(Game, Solver, Rng, Stuck, Free))
+            {
+                break;
+            }
+            Search.Repairs.fetch_add(1, std::memory_order_relaxed);
+            Game.Restart();
+            bValid = SolveWithoutGuessing(Game, Solver, Search.FirstClick, Search.bFound);
+        }
+        if (bValid && !Search.bFound.exchange(true))
+        {
+            Game.Restart();
+            Game.TakeBoard(Search.Board);
+            return;
+        }
+    }
+}
+
+bool GenerateNoGuessBoard(FMineSweeper& Game, int FirstClick, const FNoGuessOptions& Options, FNoGuessStats& Stats)
+{
+    if (FirstClick < 0 || FirstClick >= Game.GetBoardSize())
+    {
+        return false;
+    }
+    FNoGuessSearch Search;
+    Search.Width = Game.GetBoardWidth();
+    Search.Height = Game.GetBoardHeight();
+    Search.Mines = Game.GetNumMines();
+    Search.FirstClick = FirstClick;
+    Search.SimdLevel = Game.GetSimdLevel();
+    Search.Options = Options;
+    Search.BaseSeed = Options.Seed != 0 ? Options.Seed : MakeRandomSeed();
+    Search.Start = FClock::now();
+
+    int NumThreads = Options.NumThreads > 0 ? Options.NumThreads : (int) std::thread::hardware_concurrency();
+    if (NumThreads <= 1)
+    {
+        SearchBoards(Search);
+    }
+    else
+    {
+        std::vector<std::thread> Threads;
+        for (int t = 0; t < NumThreads; t++)
+        {
+            Threads.emplace_back(SearchBoards, std::ref(Search));
+        }
+        for (std::thread& Thread : Threads)
+        {
+            Thread.join();
+        }
+    }
+
+    Stats.Seconds = std::chrono::duration<double>(FClock::now() - Search.Start).count();
+    Stats.Candidates = Search.NextCandidate.load();
+    Stats.Repairs = Search.Repairs.load();
+    Search.Board.Seed = Search.BaseSeed;        // The seed of the search, which gives this board again when searched on a single thread
+    Stats.bFound = Search.bFound.load() && Game.Reset(Search.Board);
+    return Stats.bFound;
+}
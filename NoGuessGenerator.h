@@ -0,0 +1,38 @@
+/* Generator of boards that can be cleared without guessing.
+
+A candidate board is generated with its mines away from the first click (FMineSweeper::Reset(Seed, FirstClick)) and played by the
+solver of Solver.h, revealing only the cells it proves safe. If the solver clears it, the board is valid. If it gets stuck, the
+candidate can be repaired instead of thrown away: a mine the solver could not decide on the frontier is moved to a cell far from
+every displayed cell, and the board is played again from the first click.
+Candidates are searched on several threads at once; the first valid board stops the others.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include "Minesweeper.h"
+
+#define NOGUESS_MAX_REPAIRS 8           // Mines moved on a stuck candidate before drawing a new one
+#define NOGUESS_TIME_LIMIT 10.0         // Seconds searching before giving up, by default
+
+/// How the search is done
+struct FNoGuessOptions
+{
+    int NumThreads = 0;                 // 0 means one thread per core
+    bool bRepair = true;                // Repair stuck candidates instead of drawing new ones
+    double TimeLimit = NOGUESS_TIME_LIMIT;
+    uint64_t Seed = 0;                  // Candidates are drawn from this seed, 0 for a random one. Repeatable with a single thread.
+};
+
+/// What the search did
+struct FNoGuessStats
+{
+    bool bFound = false;
+    uint64_t Candidates = 0;            // Boards drawn
+    uint64_t Repairs = 0;               // Mines moved on stuck candidates
+    double Seconds = 0.0;               // Time to the first valid board, or to give up
+};
+
+/// Start Game (with its current size and mines) on a board that the solver clears from FirstClick without guessing.
+/// The seed of the game is the seed of the search. Returns false if none was found within the time limit, the game is not changed then.
+bool GenerateNoGuessBoard(FMineSweeper& Game, int FirstClick, const FNoGuessOptions& Options, FNoGuessStats& Stats);
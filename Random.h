@@ -0,0 +1,52 @@
+/* Counter based random number generator.
+
+The n-th number of a stream only depends on the seed, the stream and n, so several threads can draw numbers of different streams
+and still obtain exactly the same results as a single thread. Each number is the SplitMix64 finalizer applied to the counter.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <cstdint>
+
+#define RNG_GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL  // Odd constant of SplitMix64, spreads consecutive counters
+
+/// SplitMix64 finalizer: mixes the bits of the input so that close inputs give unrelated outputs
+inline uint64_t MixBits64(uint64_t Value)
+{
+    Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+    return Value ^ (Value >> 31);
+}
+
+/// Stream of random numbers identified by a seed and a stream number
+struct FCounterRng
+{
+    uint64_t Key = 0;
+    uint64_t Counter = 0;
+
+    FCounterRng(uint64_t Seed, uint64_t Stream) : Key(MixBits64(Seed ^ MixBits64(Stream + RNG_GOLDEN_GAMMA))) { }
+
+    /// Next 64 random bits
+    uint64_t Next() { return MixBits64(Key + (++Counter) * RNG_GOLDEN_GAMMA); }
+
+    /// Uniform integer in [0, Bound), without modulo bias (Lemire's multiply and reject)
+    uint32_t NextBelow(uint32_t Bound)
+    {
+        uint64_t Product = (Next() >> 32) * (uint64_t) Bound;
+        uint32_t Low = (uint32_t) Product;
+        if (Low < Bound)
+        {
+            uint32_t Threshold = (0u - Bound) % Bound;
+            while (Low < Threshold)
+            {
+                Product = (Next() >> 32) * (uint64_t) Bound;
+                Low = (uint32_t) Product;
+            }
+        }
+        return (uint32_t) (Product >> 32);
+    }
+
+    /// Uniform real number in [0, 1)
+    double NextDouble() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+};
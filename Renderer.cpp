@@ -0,0 +1,292 @@
+/* Terminal renderer of the boards, implementation details.
+
+Layout of a frame (rows and columns of the terminal start at 1):
+- Row 1: title. Rows 2 and 3: x coordinates, every 10 columns and the last digit of each column.
+- One row per board row of the viewport: the y coordinate, right aligned on LabelWidth chars, a space and then "|c" per cell and a final '|'.
+- A blank row, and the prompt of main.cpp on the next one.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "Renderer.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#define isatty _isatty
+#else
+#include <unistd.h>
+#include <sys/ioctl.h>
+#endif
+
+FBoardRenderer::FBoardRenderer(int InOutputFile) : OutputFile(InOutputFile)
+{
+#ifdef _WIN32
+    bAnsi = false;                  // Older consoles print the escape codes instead of moving the cursor
+#else
+    bAnsi = isatty(OutputFile) != 0;
+#endif
+}
+
+/// Fit the viewport to the board and to the terminal, and reserve the biggest frame it can need
+void FBoardRenderer::StartGame(const FMineSweeper& Game)
+{
+    int Columns = RENDER_DEFAULT_COLUMNS;
+    int Rows = RENDER_DEFAULT_ROWS;
+#ifndef _WIN32
+    winsize Size;
+    if (bAnsi && ioctl(OutputFile, TIOCGWINSZ, &Size) == 0 && Size.ws_col > 0 && Size.ws_row > 0)
+    {
+        Columns = Size.ws_col;
+        Rows = Size.ws_row;
+    }
+#endif
+
+    LabelWidth = 1;
+    for (int Y = Game.GetBoardHeight() - 1; Y >= 10; Y /= 10)
+    {
+        LabelWidth++;
+    }
+    ViewWidth = (Columns - LabelWidth - 2) / 2;                 // Label, space, "|c" per cell and the last '|'
+    ViewWidth = ViewWidth < 1 ? 1 : (ViewWidth > Game.GetBoardWidth() ? Game.GetBoardWidth() : ViewWidth);
+    ViewHeight = Rows - RENDER_RESERVED_LINES;
+    ViewHeight = ViewHeight < 1 ? 1 : (ViewHeight > Game.GetBoardHeight() ? Game.GetBoardHeight() : ViewHeight);
+    ViewX = 0;
+    ViewY = 0;
+    Shown.assign((size_t) ViewWidth * ViewHeight, 0);
+    bFullFrame = true;
+
+    size_t RowBytes = LabelWidth + 2 * ViewWidth + 3;
+    size_t FullBytes = 256 + (RENDER_HEADER_LINES + ViewHeight + 1) * RowBytes;
+    size_t ChangedBytes = 256 + Shown.size() * 24;                  // Cursor move plus "|c" for every cell
+    Frame.reserve(FullBytes > ChangedBytes ? FullBytes : ChangedBytes);
+}
+
+void FBoardRenderer::DrawBoard(const FMineSweeper& Game, int LastMove)
+{
+    FollowCell(Game, LastMove);
+    Draw(Game, Game.GetUserBoard(), false);
+}
+
+void FBoardRenderer::DrawFinalBoard(const FMineSweeper& Game)
+{
+    Draw(Game, Game.GetNearbyMinesBoard(), true);
+}
+
+/// Center the viewport on the (x, y) cell, as close as possible without leaving the board
+void FBoardRenderer::MoveViewport(const FMineSweeper& Game, int X, int Y)
+{
+    int MaxX = Game.GetBoardWidth() - ViewWidth;
+    int MaxY = Game.GetBoardHeight() - ViewHeight;
+    X -= ViewWidth / 2;
+    Y -= ViewHeight / 2;
+    X = X < 0 ? 0 : (X > MaxX ? MaxX : X);
+    Y = Y < 0 ? 0 : (Y > MaxY ? MaxY : Y);
+    if (X != ViewX || Y != ViewY)
+    {
+        ViewX = X;
+        ViewY = Y;
+        bFullFrame = true;
+    }
+}
+
+void FBoardRenderer::Invalidate()
+{
+    bFullFrame = true;
+}
+
+/// Build the frame, completely or only with the changes, and send it
+void FBoardRenderer::Draw(const FMineSweeper& Game, FBoardView Board, bool bFinal)
+{
+    if (!Board || Shown.empty())
+    {
+        return;
+    }
+    std::cout.flush();              // Text printed by main.cpp must reach the terminal before the frame
+    Frame.clear();
+    if (bFullFrame || !bAnsi)
+    {
+        AppendFullFrame(Game, Board, bFinal);
+    }
+    else
+    {
+        int PromptRow = RENDER_HEADER_LINES + ViewHeight + 2;
+        AppendCursorMove(1, 1);
+        AppendTitle(Game, bFinal);
+        Frame += "\x1b[K";
+        AppendChangedCells(Board, Game.GetBoardWidth());
+        AppendCursorMove(PromptRow, 1);
+        Frame += "\x1b[J";          // Clear the previous prompt and messages
+    }
+    WriteFrame();
+    bFullFrame = false;
+}
+
+/// Title, coordinates and every row of the viewport
+void FBoardRenderer::AppendFullFrame(const FMineSweeper& Game, FBoardView Board, bool bFinal)
+{
+    Frame += bAnsi ? "\x1b[H\x1b[2J" : "\n";
+    AppendTitle(Game, bFinal);
+    Frame += '\n';
+
+    Frame.append(LabelWidth + 1, ' ');                      // Coordinates multiple of 10, written over their column
+    int Written = 0;
+    for (int i = 0; i < ViewWidth; i++)
+    {
+        int Position = 2 * i + 1;
+        if ((ViewX + i) % 10 == 0 && Position >= Written)
+        {
+            Frame.append(Position - Written, ' ');
+            size_t Before = Frame.size();
+            AppendNumber(ViewX + i, 0);
+            Written = Position + (int) (Frame.size() - Before);
+        }
+    }
+    Frame += '\n';
+    Frame.append(LabelWidth + 1, ' ');                      // Last digit of every column
+    for (int i = 0; i < ViewWidth; i++)
+    {
+        Frame += ' ';
+        Frame += (char) ('0' + (ViewX + i) % 10);
+    }
+    Frame += '\n';
+
+    for (int y = 0; y < ViewHeight; y++)
+    {
+        AppendNumber(ViewY + y, LabelWidth);
+        Frame += ' ';
+        const int RowStart = (ViewY + y) * Game.GetBoardWidth() + ViewX;
+        char* ShownRow = &Shown[(size_t) y * ViewWidth];
+        for (int x = 0; x < ViewWidth; x++)
+        {
+            ShownRow[x] = Board[RowStart + x];
+            Frame += '|';
+            Frame += ShownRow[x];
+        }
+        Frame += "|\n";
+    }
+    Frame += '\n';
+}
+
+/// Only the cells that differ from the screen. Cells next to the previous one are written with its separator instead of a cursor move.
+void FBoardRenderer::AppendChangedCells(FBoardView Board, int BoardWidth)
+{
+    for (int y = 0; y < ViewHeight; y++)
+    {
+        const int RowStart = (ViewY + y) * BoardWidth + ViewX;
+        char* ShownRow = &Shown[(size_t) y * ViewWidth];
+        int LastWritten = -2;
+        for (int x = 0; x < ViewWidth; x++)
+        {
+            char Cell = Board[RowStart + x];
+            if (Cell == ShownRow[x])
+            {
+                continue;
+            }
+            if (x == LastWritten + 1)
+            {
+                Frame += '|';
+            }
+            else
+            {
+                AppendCursorMove(RENDER_HEADER_LINES + y + 1, LabelWidth + 2 * x + 3);
+            }
+            Frame += Cell;
+            ShownRow[x] = Cell;
+            LastWritten = x;
+        }
+    }
+}
+
+/// Board size and, if the board does not fit, the part of it on the viewport
+void FBoardRenderer::AppendTitle(const FMineSweeper& Game, bool bFinal)
+{
+    Frame += bFinal ? "Board with all the results " : "Board ";
+    AppendNumber(Game.GetBoardWidth(), 0);
+    Frame += 'x';
+    AppendNumber(Game.GetBoardHeight(), 0);
+    Frame += ", ";
+    AppendNumber(Game.GetNumMines(), 0);
+    Frame += " mines, seed ";
+    AppendNumber(Game.GetSeed(), 0);
+    if (ViewWidth < Game.GetBoardWidth() || ViewHeight < Game.GetBoardHeight())
+    {
+        Frame += ", showing x ";
+        AppendNumber(ViewX, 0);
+        Frame += '-';
+        AppendNumber(ViewX + ViewWidth - 1, 0);
+        Frame += " and y ";
+        AppendNumber(ViewY, 0);
+        Frame += '-';
+        AppendNumber(ViewY + ViewHeight - 1, 0);
+        if (!bFinal)
+        {
+            Frame += " (v x y moves the view)";
+        }
+    }
+}
+
+/// ANSI code that moves the cursor to a row and column of the terminal
+void FBoardRenderer::AppendCursorMove(int Row, int Column)
+{
+    Frame += "\x1b[";
+    AppendNumber(Row, 0);
+    Frame += ';';
+    AppendNumber(Column, 0);
+    Frame += 'H';
+}
+
+/// Non negative number, right aligned on Width chars (0 for no alignment)
+void FBoardRenderer::AppendNumber(uint64_t Value, int Width)
+{
+    char Digits[20];
+    int Count = 0;
+    do
+    {
+        Digits[Count++] = (char) ('0' + Value % 10);
+        Value /= 10;
+    } while (Value > 0);
+    if (Width > Count)
+    {
+        Frame.append(Width - Count, ' ');
+    }
+    while (Count > 0)
+    {
+        Frame += Digits[--Count];
+    }
+}
+
+/// Move the viewport if the cell is out of it. Returns true if it moved.
+bool FBoardRenderer::FollowCell(const FMineSweeper& Game, int Index)
+{
+    if (Index < 0 || Index >= Game.GetBoardSize())
+    {
+        return false;
+    }
+    int X = Index % Game.GetBoardWidth();
+    int Y = Index / Game.GetBoardWidth();
+    if (X >= ViewX && X < ViewX + ViewWidth && Y >= ViewY && Y < ViewY + ViewHeight)
+    {
+        return false;
+    }
+    MoveViewport(Game, X, Y);
+    return true;
+}
+
+/// Send the whole frame, on a single write unless the terminal takes it in parts
+void FBoardRenderer::WriteFrame()
+{
+    const char* Data = Frame.data();
+    size_t Left = Frame.size();
+    while (Left > 0)
+    {
+        long Written = (long) write(OutputFile, Data, (unsigned) Left);
+        if (Written <= 0)
+        {
+            return;
+        }
+        Data += Written;
+        Left -= (size_t) Written;
+    }
+}
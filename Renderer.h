@@ -0,0 +1,56 @@
+/* Terminal renderer of the boards, used by main.cpp.
+
+Each frame is built on a single buffer, allocated when a game starts, and sent to the terminal with a single write.
+Only the area of the board that fits on the terminal (the viewport) is drawn, so drawing takes the same time on any board size.
+The viewport follows the last move, and it can be moved by the player.
+After the first frame, only the cells that changed since the previous one are drawn again, moving the cursor to them with ANSI codes.
+If the output is not a terminal (a file or a pipe), every frame is written completely as plain text instead.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include "Minesweeper.h"
+
+#define RENDER_HEADER_LINES 3       // Title and the two lines with the x coordinates
+#define RENDER_RESERVED_LINES 8     // Lines of the terminal not used by board rows: header, blank line, prompt and messages
+#define RENDER_DEFAULT_COLUMNS 80   // Terminal size used when it can not be read
+#define RENDER_DEFAULT_ROWS 24
+
+/// Draws the boards of a game on a terminal
+class FBoardRenderer
+{
+    public:
+        explicit FBoardRenderer(int InOutputFile = 1);      // File descriptor of the terminal, the standard output by default
+
+        /// Rest of functions
+        void StartGame(const FMineSweeper&);                // Fits the viewport to the board and the terminal, and allocates the frame
+        void DrawBoard(const FMineSweeper&, int);           // User board, with the viewport over the last move (-1 if there is none)
+        void DrawFinalBoard(const FMineSweeper&);           // Board with all the results
+        void MoveViewport(const FMineSweeper&, int, int);   // Centers the viewport on the (x, y) cell
+        void Invalidate();                                  // Something else was printed, so the next frame is drawn completely
+
+    private:
+        int OutputFile;
+        bool bAnsi;                 // The output is a terminal that understands cursor movements
+        int ViewX = 0;              // Top left cell of the viewport
+        int ViewY = 0;
+        int ViewWidth = 0;
+        int ViewHeight = 0;
+        int LabelWidth = 0;         // Digits of the biggest y coordinate
+        bool bFullFrame = true;     // The screen does not match Shown, draw everything on the next frame
+        std::vector<char> Shown;    // Chars of the viewport as they are on the screen
+        std::string Frame;          // Frame being built, reserved on StartGame so it never grows while drawing
+
+        /// Rest of functions
+        void Draw(const FMineSweeper&, FBoardView, bool);
+        void AppendFullFrame(const FMineSweeper&, FBoardView, bool);
+        void AppendChangedCells(FBoardView, int);
+        void AppendTitle(const FMineSweeper&, bool);
+        void AppendCursorMove(int, int);
+        void AppendNumber(uint64_t, int);
+        bool FollowCell(const FMineSweeper&, int);
+        void WriteFrame();
+};
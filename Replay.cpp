@@ -0,0 +1,151 @@
+/* Console executable that replays game journals (GameJournal.h), to check them and to measure how fast moves are replayed.
+
+Every journal is read and replayed on its own task of the thread pool, so many journals are checked at once on all the cores.
+A directory is replaced by the .journal files it contains. Each game replays its moves without output and compares the hash of
+its state with the checksums of the journal; the journals with a mismatch or a record that is not valid are reported.
+
+Usage: Replay [--threads T] PATH...
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "GameJournal.h"
+#include "ThreadPool.h"
+
+#define JOURNAL_EXTENSION ".journal"    // Files replayed from a directory
+
+/// Journal file and the results of its replay
+struct FReplayJob
+{
+    std::string Path;
+    FReplayStats Stats;
+    bool bOk = false;
+};
+
+/// Function prototypes
+bool ParseOptions(int, char*[], int&, std::vector<FReplayJob>&);
+bool AddPath(const std::string&, std::vector<FReplayJob>&);
+void ReplayFile(FReplayJob&);
+
+/// Main loop
+int main(int argc, char* argv[])
+{
+    int NumThreads = 0;
+    std::vector<FReplayJob> Jobs;
+    if (!ParseOptions(argc, argv, NumThreads, Jobs) || Jobs.empty())
+    {
+        std::cout << "Usage: Replay [--threads T] PATH...\n";
+        return 1;
+    }
+
+    FThreadPool Pool(NumThreads);
+    auto Start = std::chrono::steady_clock::now();
+    for (FReplayJob& Job : Jobs)
+    {
+        FReplayJob* JobPointer = &Job;      // Each task only touches its own job, no locks needed
+        Pool.Submit([JobPointer](int) { ReplayFile(*JobPointer); });
+    }
+    Pool.Wait();
+    double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+    FReplayStats Total;
+    int Failed = 0;
+    for (const FReplayJob& Job : Jobs)
+    {
+        Total.Games += Job.Stats.Games;
+        Total.Moves += Job.Stats.Moves;
+        Total.Checksums += Job.Stats.Checksums;
+        Total.Mismatches += Job.Stats.Mismatches;
+        if (!Job.bOk)
+        {
+            std::cout << Job.Path << ": " << Job.Stats.Error << "\n";
+            Failed++;
+        }
+    }
+    printf("%zu journals on %d threads: %llu games, %llu moves in %.3f s (%.0f moves/s), %llu checksums, %llu mismatches, %d failed\n",
+           Jobs.size(), Pool.GetNumThreads(), (unsigned long long) Total.Games, (unsigned long long) Total.Moves, Seconds,
+           Seconds > 0.0 ? Total.Moves / Seconds : 0.0, (unsigned long long) Total.Checksums, (unsigned long long) Total.Mismatches, Failed);
+    return Failed == 0 ? 0 : 1;
+}
+
+/// Read the command line. Every argument that is not an option is a journal or a directory of journals.
+bool ParseOptions(int argc, char* argv[], int& NumThreads, std::vector<FReplayJob>& Jobs)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+            NumThreads = atoi(argv[++i]);
+        }
+        else if (!AddPath(argv[i], Jobs))
+        {
+            std::cout << "Error reading " << argv[i] << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Add the journal, or the journals of the directory sorted by name. Returns false if the path does not exist.
+bool AddPath(const std::string& Path, std::vector<FReplayJob>& Jobs)
+{
+    std::error_code Error;
+    if (!std::filesystem::is_directory(Path, Error))
+    {
+        if (!std::filesystem::exists(Path, Error))
+        {
+            return false;
+        }
+        Jobs.push_back(FReplayJob());
+        Jobs.back().Path = Path;
+        return true;
+    }
+    std::vector<std::string> Files;
+    for (const std::filesystem::directory_entry& Entry : std::filesystem::directory_iterator(Path, Error))
+    {
+        if (Entry.is_regular_file(Error) && Entry.path().extension() == JOURNAL_EXTENSION)
+        {
+            Files.push_back(Entry.path().string());
+        }
+    }
+    std::sort(Files.begin(), Files.end());
+    for (const std::string& File : Files)
+    {
+        Jobs.push_back(FReplayJob());
+        Jobs.back().Path = File;
+    }
+    return !Error;
+}
+
+/// Read the whole journal and replay it
+void ReplayFile(FReplayJob& Job)
+{
+    FILE* File = fopen(Job.Path.c_str(), "rb");
+    if (File == nullptr)
+    {
+        Job.Stats.Error = "can not be opened";
+        return;
+    }
+    std::vector<uint8_t> Data;
+    uint8_t Block[65536];
+    size_t Read = 0;
+    while ((Read = fread(Block, 1, sizeof(Block), File)) > 0)
+    {
+        Data.insert(Data.end(), Block, Block + Read);
+    }
+    fclose(File);
+    Job.bOk = ReplayJournal(Data.data(), Data.size(), Job.Stats);
+}
@@ -0,0 +1,570 @@
+/* Console executable that hosts many games at once, played through the command protocol of CommandProtocol.h.
+
+Each connection is a session with its own game. Sessions are split among worker threads (shards), one per core by default:
+the main thread accepts the connections and hands each one to the next shard, and from then on only that shard touches it,
+so there is no lock shared by the sessions. Each shard waits for its connections with its own epoll.
+It listens on a Unix domain socket or on a TCP port of localhost. LoadClient.cpp measures it.
+With --pregenerate, boards of that size are generated ahead on --producers background threads (BoardPipeline.h), so new without a
+seed does not wait for them. The hits, misses and depth of the pipeline are printed every PIPELINE_REPORT_SECONDS while they change.
+With --hibernate, the games of sessions idle for that many seconds are saved to files on --hibernate-dir (GameSnapshot.h) and their
+boards freed for the active sessions. The next command of the session loads its game again.
+With --journal-dir, the games of each connection are recorded on their own journal file on that directory (GameJournal.h), to
+replay them with Replay.
+With --metrics, each shard records the metrics of its games (GameMetrics.h) on its own and publishes a copy every
+METRICS_PUBLISH_MILLISECONDS. A reporter thread merges the copies and writes them to the file every METRICS_REPORT_SECONDS, as JSON
+if its name ends in .json or as Prometheus text otherwise, so a scraper can read it at any time.
+
+Usage: Server [--socket PATH | --port P] [--threads T] [--pregenerate WxHxM]... [--producers P] [--hibernate S] [--hibernate-dir DIR]
+              [--journal-dir DIR] [--metrics FILE]
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "CommandProtocol.h"
+#include "BoardPipeline.h"
+#include "GameJournal.h"
+#include "GameMetrics.h"
+
+#define DEFAULT_SOCKET_PATH "/tmp/minesweeper.sock"
+#define LISTEN_BACKLOG 4096         // Connections waiting to be accepted
+#define SHARD_EVENTS 256            // Events handled by a shard on each epoll_wait
+#define CONNECTION_READ_BYTES 4096  // Bytes read from a connection at once
+#define PIPELINE_REPORT_SECONDS 10  // Time between reports of the board pipeline
+#define DEFAULT_HIBERNATE_DIR "/tmp"
+#define HIBERNATE_CHECK_MILLISECONDS 1000   // Time between searches of idle sessions, when --hibernate is given
+#define METRICS_PUBLISH_MILLISECONDS 1000  // Time between copies of the metrics of a shard, when --metrics is given
+#define METRICS_REPORT_SECONDS 5    // Time between writes of the metrics file
+#define NOT_TRACKED SIZE_MAX        // FConnection::Slot of a connection that is not on the list of its shard
+
+typedef std::chrono::steady_clock FClock;
+
+/// Board size generated ahead by the pipeline
+struct FBoardSize
+{
+    int Width = 0;
+    int Height = 0;
+    int Mines = 0;
+};
+
+/// Command line options
+struct FServerOptions
+{
+    std::string SocketPath = DEFAULT_SOCKET_PATH;
+    int Port = 0;                   // 0 means the Unix socket
+    int NumThreads = 0;             // 0 means one shard per core
+    int NumProducers = 1;           // Threads generating the boards of --pregenerate
+    std::vector<FBoardSize> PregeneratedBoards;
+    int HibernateSeconds = 0;       // 0 means sessions are never hibernated
+    std::string HibernateDir = DEFAULT_HIBERNATE_DIR;
+    std::string JournalDir;         // Empty means games are not recorded
+    std::string MetricsPath;        // Empty means no metrics are recorded
+};
+
+/// A client and its session. Only the shard that owns it touches it.
+struct FConnection
+{
+    int File = -1;
+    std::unique_ptr<FGameJournal> Journal;      // Only with --journal-dir. Declared before the session, which records on it until it ends.
+    FCommandSession Session;
+    std::vector<char> Input;        // Incomplete line received, waiting for the rest
+    std::string Output;             // Replies not sent yet
+    size_t OutputSent = 0;
+    bool bWaitingToWrite = false;   // Registered for EPOLLOUT because the socket was full
+    bool bClosing = false;          // quit was received, close once the replies are sent
+    uint64_t Id = 0;                // Names the file of its hibernated game
+    FClock::time_point LastCommand; // Only kept with --hibernate
+    bool bHibernated = false;       // Already hibernated (or tried) since its last command
+    size_t Slot = NOT_TRACKED;      // Position on the list of its shard, only with --hibernate
+};
+
+/// Worker thread and the connections it serves
+struct FServerShard
+{
+    int EpollFile = -1;
+    std::thread Thread;
+    int HibernateSeconds = 0;
+    std::string HibernateDir;
+    std::vector<FConnection*> Connections;      // Connections that sent something, searched for idle ones. Only with --hibernate.
+    bool bMetrics = false;
+    FGameMetrics Metrics;                       // Recorded by the sessions of the shard, only its thread touches it
+    std::mutex PublishedMutex;
+    FGameMetrics PublishedMetrics;              // Last copy of Metrics, read by the reporter. Guarded by PublishedMutex.
+};
+
+/// Function prototypes
+bool ParseOptions(int, char*[], FServerOptions&);
+int  OpenListener(const FServerOptions&);
+void RaiseFileLimit();
+void RunShard(FServerShard&);
+bool ReadCommands(FConnection&);
+void RunCommands(FConnection&);
+bool SendReplies(FConnection&, int);
+void CloseConnection(FConnection*, FServerShard&);
+void ReportPipeline(const FBoardPipeline&);
+void HibernateIdleSessions(FServerShard&, FClock::time_point);
+void ReportMetrics(std::vector<FServerShard>&, const std::string&);
+
+/// Main loop: accept connections and spread them over the shards
+int main(int argc, char* argv[])
+{
+    FServerOptions Options;
+    if (!ParseOptions(argc, argv, Options))
+    {
+        std::cout << "Usage: Server [--socket PATH | --port P] [--threads T] [--pregenerate WxHxM]... [--producers P] [--hibernate S] [--hibernate-dir DIR] [--journal-dir DIR] [--metrics FILE]\n";
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);       // A client closing early is handled where the write fails
+    RaiseFileLimit();
+
+    int Listener = OpenListener(Options);
+    if (Listener < 0)
+    {
+        std::cerr << "Error opening the socket: " << strerror(errno) << "\n";
+        return 1;
+    }
+    int NumShards = Options.NumThreads > 0 ? Options.NumThreads : (int) std::thread::hardware_concurrency();
+    NumShards = NumShards < 1 ? 1 : NumShards;
+    std::vector<FServerShard> Shards(NumShards);
+    for (FServerShard& Shard : Shards)              // Before any thread starts, so a failure can just return
+    {
+        Shard.EpollFile = epoll_create1(EPOLL_CLOEXEC);
+        if (Shard.EpollFile < 0)
+        {
+            std::cerr << "Error creating the epoll instances: " << strerror(errno) << "\n";
+            return 1;
+        }
+    }
+
+    FBoardPipeline Pipeline(Options.NumProducers);
+    for (const FBoardSize& Board : Options.PregeneratedBoards)
+    {
+        Pipeline.AddBoardSize(Board.Width, Board.Height, Board.Mines);
+    }
+    Pipeline.Start();
+    if (!Options.PregeneratedBoards.empty())
+    {
+        std::thread(ReportPipeline, std::cref(Pipeline)).detach();
+    }
+
+    for (FServerShard& Shard : Shards)
+    {
+        Shard.HibernateSeconds = Options.HibernateSeconds;
+        Shard.HibernateDir = Options.HibernateDir;
+        Shard.bMetrics = !Options.MetricsPath.empty();
+        Shard.Thread = std::thread(RunShard, std::ref(Shard));
+    }
+    std::cout << "Serving on " << (Options.Port > 0 ? "port " + std::to_string(Options.Port) : Options.SocketPath)
+    << " with " << NumShards << " shards" << std::endl;
+    if (!Options.MetricsPath.empty())
+    {
+        std::thread(ReportMetrics, std::ref(Shards), Options.MetricsPath).detach();
+    }
+
+    unsigned NextShard = 0;
+    uint64_t NextId = 0;
+    while (true)
+    {
+        int File = accept4(Listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (File < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                std::cerr << "Error accepting connections: " << strerror(errno) << "\n";
+                if (errno == EMFILE || errno == ENFILE)
+                {
+                    usleep(10000);  // Out of files: give the shards time to close some
+                }
+            }
+            continue;
+        }
+        if (Options.Port > 0)
+        {
+            int NoDelay = 1;        // Replies are small and must not wait for more data
+            setsockopt(File, IPPROTO_TCP, TCP_NODELAY, &NoDelay, sizeof(NoDelay));
+        }
+
+        FServerShard& Shard = Shards[NextShard++ % Shards.size()];
+        FConnection* Connection = new FConnection();                // Owned by the shard from now on
+        Connection->File = File;
+        Connection->Id = NextId++;
+        Connection->Session.SetBoardPipeline(Options.PregeneratedBoards.empty() ? nullptr : &Pipeline);
+        if (!Options.JournalDir.empty())
+        {
+            Connection->Journal.reset(new FGameJournal());
+            std::string Path = Options.JournalDir + "/minesweeper-" + std::to_string(getpid()) + "-" + std::to_string(Connection->Id) + ".journal";
+            Connection->Session.SetJournal(Connection->Journal->Open(Path.c_str()) ? Connection->Journal.get() : nullptr);
+        }
+        if (Shard.bMetrics)
+        {
+            Connection->Session.SetMetrics(&Shard.Metrics);     // The shard has not seen the connection yet
+        }
+        epoll_event Event = {};
+        Event.events = EPOLLIN | EPOLLRDHUP;
+        Event.data.ptr = Connection;
+        if (epoll_ctl(Shard.EpollFile, EPOLL_CTL_ADD, File, &Event) != 0)
+        {
+            close(File);
+            delete Connection;
+        }
+    }
+}
+
+/// Read the command line
+bool ParseOptions(int argc, char* argv[], FServerOptions& Options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const char* Value = argv[++i];
+        if (strcmp(argv[i - 1], "--socket") == 0)
+        {
+            Options.SocketPath = Value;
+        }
+        else if (strcmp(argv[i - 1], "--port") == 0)
+        {
+            Options.Port = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--threads") == 0)
+        {
+            Options.NumThreads = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--producers") == 0)
+        {
+            Options.NumProducers = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--hibernate") == 0)
+        {
+            Options.HibernateSeconds = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--hibernate-dir") == 0)
+        {
+            Options.HibernateDir = Value;
+        }
+        else if (strcmp(argv[i - 1], "--journal-dir") == 0)
+        {
+            Options.JournalDir = Value;
+        }
+        else if (strcmp(argv[i - 1], "--metrics") == 0)
+        {
+            Options.MetricsPath = Value;
+        }
+        else if (strcmp(argv[i - 1], "--pregenerate") == 0)
+        {
+            FBoardSize Board;
+            if (sscanf(Value, "%dx%dx%d", &Board.Width, &Board.Height, &Board.Mines) != 3 || !FMineSweeper().SetGameParams(Board.Width, Board.Height, Board.Mines))
+            {
+                return false;
+            }
+            Options.PregeneratedBoards.push_back(Board);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return Options.Port >= 0 && Options.Port < 65536 && Options.NumProducers > 0 && Options.HibernateSeconds >= 0;
+}
+
+/// Listen on the Unix socket (replacing an old one) or on the TCP port of localhost. Returns -1 on error.
+int OpenListener(const FServerOptions& Options)
+{
+    int Listener = -1;
+    if (Options.Port > 0)
+    {
+        Listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int Reuse = 1;
+        setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, &Reuse, sizeof(Reuse));
+        sockaddr_in Address = {};
+        Address.sin_family = AF_INET;
+        Address.sin_port = htons((uint16_t) Options.Port);
+        Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (Listener < 0 || bind(Listener, (sockaddr*) &Address, sizeof(Address)) != 0)
+        {
+            if (Listener >= 0)
+            {
+                close(Listener);
+            }
+            return -1;
+        }
+    }
+    else
+    {
+        sockaddr_un Address = {};
+        Address.sun_family = AF_UNIX;
+        if (Options.SocketPath.size() >= sizeof(Address.sun_path))
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(Address.sun_path, Options.SocketPath.c_str());
+        unlink(Address.sun_path);
+        Listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (Listener < 0 || bind(Listener, (sockaddr*) &Address, sizeof(Address)) != 0)
+        {
+            if (Listener >= 0)
+            {
+                close(Listener);
+            }
+            return -1;
+        }
+    }
+    if (listen(Listener, LISTEN_BACKLOG) != 0)
+    {
+        close(Listener);
+        return -1;
+    }
+    return Listener;
+}
+
+/// Allow as many open files as the system lets, each session is one
+void RaiseFileLimit()
+{
+    rlimit Limit;
+    if (getrlimit(RLIMIT_NOFILE, &Limit) == 0 && Limit.rlim_cur < Limit.rlim_max)
+    {
+        Limit.rlim_cur = Limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &Limit);
+    }
+}
+
+/// Serve the connections of a shard: run the commands that arrive and send the replies.
+/// With --hibernate it also wakes up every HIBERNATE_CHECK_MILLISECONDS to hibernate the idle sessions, and with --metrics every
+/// METRICS_PUBLISH_MILLISECONDS to publish its metrics.
+void RunShard(FServerShard& Shard)
+{
+    epoll_event Events[SHARD_EVENTS];
+    bool bHibernate = Shard.HibernateSeconds > 0;
+    FClock::time_point LastCheck = FClock::now();
+    FClock::time_point LastPublish = LastCheck;
+    int Timeout = bHibernate ? HIBERNATE_CHECK_MILLISECONDS : (Shard.bMetrics ? METRICS_PUBLISH_MILLISECONDS : -1);
+    while (true)
+    {
+        int NumEvents = epoll_wait(Shard.EpollFile, Events, SHARD_EVENTS, Timeout);
+        FClock::time_point Now = (bHibernate || Shard.bMetrics) ? FClock::now() : LastCheck;
+        for (int i = 0; i < NumEvents; i++)
+        {
+            FConnection* Connection = (FConnection*) Events[i].data.ptr;
+            bool bOpen = true;
+            if (Events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                bOpen = ReadCommands(*Connection);
+                if (bHibernate)
+                {
+                    if (Connection->Slot == NOT_TRACKED)
+                    {
+                        Connection->Slot = Shard.Connections.size();
+                        Shard.Connections.push_back(Connection);
+                    }
+                    Connection->LastCommand = Now;
+                    Connection->bHibernated = false;
+                }
+            }
+            if (bOpen)
+            {
+                bOpen = SendReplies(*Connection, Shard.EpollFile);
+            }
+            if (!bOpen)
+            {
+                CloseConnection(Connection, Shard);
+            }
+        }
+        if (bHibernate && Now - LastCheck >= std::chrono::milliseconds(HIBERNATE_CHECK_MILLISECONDS))
+        {
+            HibernateIdleSessions(Shard, Now);
+            LastCheck = Now;
+        }
+        if (Shard.bMetrics && Now - LastPublish >= std::chrono::milliseconds(METRICS_PUBLISH_MILLISECONDS))
+        {
+            std::lock_guard<std::mutex> Lock(Shard.PublishedMutex);
+            Shard.PublishedMetrics = Shard.Metrics;
+            LastPublish = Now;
+        }
+    }
+}
+
+/// Read what arrived and run the complete commands. At the end of the input the connection is closed once the replies are sent.
+/// Returns false if the client is gone.
+bool ReadCommands(FConnection& Connection)
+{
+    if (Connection.bClosing || Connection.bWaitingToWrite)     // No more commands until the replies are sent
+    {
+        return true;
+    }
+    size_t Pending = Connection.Input.size();
+    Connection.Input.resize(Pending + CONNECTION_READ_BYTES);
+    long Count = (long) read(Connection.File, Connection.Input.data() + Pending, CONNECTION_READ_BYTES);
+    Connection.Input.resize(Pending + (Count > 0 ? Count : 0));
+    if (Count < 0)
+    {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    RunCommands(Connection);
+    Connection.bClosing = Connection.bClosing || Count == 0;
+    return true;
+}
+
+/// Run the complete commands received, until the replies fill a batch
+void RunCommands(FConnection& Connection)
+{
+    const char* Begin = Connection.Input.data();
+    const char* End = Begin + Connection.Input.size();
+    const char* Line = Begin;
+    bool bQuit = false;
+    while (!bQuit && Connection.Output.size() < COMMAND_WRITE_BYTES && memchr(Line, '\n', End - Line) != nullptr)
+    {
+        Line += Connection.Session.RunCommands(Line, End, Connection.Output, bQuit);
+    }
+    Connection.bClosing = bQuit;
+    if (!bQuit && End - Line > COMMAND_MAX_LINE && memchr(Line, '\n', End - Line) == nullptr)
+    {
+        Connection.Output += "err line\n";             // Never ending line: drop it and close, so it can not fill the memory
+        Connection.bClosing = true;
+        Line = End;
+    }
+    Connection.Input.erase(Connection.Input.begin(), Connection.Input.begin() + (Line - Begin));
+}
+
+/// Send the pending replies. If the socket is full, wait for EPOLLOUT and stop reading commands meanwhile.
+/// Returns false if the connection has to be closed.
+bool SendReplies(FConnection& Connection, int EpollFile)
+{
+    while (Connection.OutputSent < Connection.Output.size())
+    {
+        long Sent = (long) send(Connection.File, Connection.Output.data() + Connection.OutputSent,
+                                Connection.Output.size() - Connection.OutputSent, MSG_NOSIGNAL);
+        if (Sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (Sent < 0 && errno == EAGAIN)
+        {
+            if (!Connection.bWaitingToWrite)
+            {
+                epoll_event Event = {};
+                Event.events = EPOLLOUT | EPOLLRDHUP;
+                Event.data.ptr = &Connection;
+                epoll_ctl(EpollFile, EPOLL_CTL_MOD, Connection.File, &Event);
+                Connection.bWaitingToWrite = true;
+            }
+            return true;
+        }
+        if (Sent <= 0)
+        {
+            return false;
+        }
+        Connection.OutputSent += (size_t) Sent;
+    }
+    Connection.Output.clear();
+    Connection.OutputSent = 0;
+    if (Connection.bClosing)
+    {
+        return false;
+    }
+    if (Connection.bWaitingToWrite)
+    {
+        epoll_event Event = {};
+        Event.events = EPOLLIN | EPOLLRDHUP;
+        Event.data.ptr = &Connection;
+        epoll_ctl(EpollFile, EPOLL_CTL_MOD, Connection.File, &Event);
+        Connection.bWaitingToWrite = false;
+        if (memchr(Connection.Input.data(), '\n', Connection.Input.size()) != nullptr)
+        {
+            RunCommands(Connection);                        // Commands that were waiting for room
+            return SendReplies(Connection, EpollFile);
+        }
+    }
+    return true;
+}
+
+void CloseConnection(FConnection* Connection, FServerShard& Shard)
+{
+    if (Connection->Slot != NOT_TRACKED)       // The last connection of the list takes its place
+    {
+        FConnection* Last = Shard.Connections.back();
+        Shard.Connections[Connection->Slot] = Last;
+        Last->Slot = Connection->Slot;
+        Shard.Connections.pop_back();
+    }
+    epoll_ctl(Shard.EpollFile, EPOLL_CTL_DEL, Connection->File, nullptr);
+    close(Connection->File);
+    delete Connection;
+}
+
+/// Print the counters of each pregenerated size while they change, to choose the number of producers
+void ReportPipeline(const FBoardPipeline& Pipeline)
+{
+    std::vector<FBoardPipelineStats> Last;
+    while (true)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(PIPELINE_REPORT_SECONDS));
+        std::vector<FBoardPipelineStats> Stats = Pipeline.GetStats();
+        for (size_t i = 0; i < Stats.size(); i++)
+        {
+            const FBoardPipelineStats& Board = Stats[i];
+            if (i < Last.size() && Board.Hits == Last[i].Hits && Board.Misses == Last[i].Misses)
+            {
+                continue;
+            }
+            uint64_t Games = Board.Hits + Board.Misses;
+            std::cout << "Pipeline " << Board.Width << "x" << Board.Height << "x" << Board.Mines << ": " << Board.Hits << " hits, "
+            << Board.Misses << " misses (" << (Games > 0 ? 100.0 * Board.Hits / Games : 0.0) << " % hits), "
+            << Board.Generated << " generated, " << Board.Depth << " ready" << std::endl;
+        }
+        Last = Stats;
+    }
+}
+
+/// Save the games of the sessions without commands for --hibernate seconds, freeing their boards for the active sessions
+void HibernateIdleSessions(FServerShard& Shard, FClock::time_point Now)
+{
+    for (FConnection* Connection : Shard.Connections)
+    {
+        if (!Connection->bHibernated && Now - Connection->LastCommand >= std::chrono::seconds(Shard.HibernateSeconds))
+        {
+            std::string Path = Shard.HibernateDir + "/minesweeper-" + std::to_string(getpid()) + "-" + std::to_string(Connection->Id) + ".snap";
+            Connection->Session.Hibernate(Path);    // Sessions without game have nothing to save
+            Connection->bHibernated = true;
+        }
+    }
+}
+
+/// Merge the last copy of the metrics of every shard and write them to the file, every METRICS_REPORT_SECONDS
+void ReportMetrics(std::vector<FServerShard>& Shards, const std::string& Path)
+{
+    EMetricsFormat Format = GetMetricsFormat(Path);
+    while (true)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(METRICS_REPORT_SECONDS));
+        FGameMetrics Total;
+        for (FServerShard& Shard : Shards)
+        {
+            std::lock_guard<std::mutex> Lock(Shard.PublishedMutex);
+            Total.Merge(Shard.PublishedMetrics);
+        }
+        if (!WriteMetrics(Total, Format, Path))
+        {
+            std::cerr << "Error writing " << Path << "\n";
+        }
+    }
+}
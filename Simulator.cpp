@@ -0,0 +1,269 @@
+/* Headless console executable that plays many games automatically, to measure the engine and the move policies.
+
+Every difficulty (or a custom board) is played the requested number of games on all the cores, through a work stealing thread pool.
+Each game has its own seed, derived from the base seed and the game number, so a run can be repeated exactly whatever the number of threads.
+With --journal-dir, the games of each task are recorded on their own journal file on that directory (GameJournal.h), to replay them
+with Replay. The move latency then includes the cost of recording the moves.
+With --metrics, the metrics of every game (GameMetrics.h) are recorded by each worker on its own and written to the file at the end,
+merged, as JSON if its name ends in .json or as Prometheus text otherwise.
+
+Usage: Simulator [--games N] [--policy random|safe|solver|probability|sampled] [--threads T] [--board WxHxM] [--seed S] [--journal-dir DIR] [--metrics FILE]
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Minesweeper.h"
+#include "MovePolicies.h"
+#include "ThreadPool.h"
+#include "Histogram.h"
+#include "GameJournal.h"
+#include "GameMetrics.h"
+
+#define DEFAULT_GAMES 10000         // Games played on each board when --games is not given
+#define GAMES_PER_TASK 64           // Games played by each task of the thread pool
+#define MAX_SIMULATED_DIFFICULTY 5  // Difficulties of FMineSweeper::SetGameParams that are simulated
+
+/// Board played on a simulation
+struct FBoardConfig
+{
+    std::string Name;
+    int Difficulty = 0;             // 0 for a custom board
+    int Width = 0;
+    int Height = 0;
+    int Mines = 0;
+};
+
+/// Command line options
+struct FSimulationOptions
+{
+    int NumGames = DEFAULT_GAMES;
+    int NumThreads = 0;             // 0 means one thread per core
+    EMovePolicy Policy = EMovePolicy::Random;
+    uint64_t Seed = 2019;
+    std::vector<FBoardConfig> Boards;
+    std::string JournalDir;         // Empty means games are not recorded
+    std::string MetricsPath;        // Empty means no metrics are recorded
+};
+
+/// Results of the games played by one worker, merged at the end
+struct FSimulationStats
+{
+    uint64_t Games = 0;
+    uint64_t Wins = 0;
+    uint64_t Moves = 0;
+    FHistogram MoveLatency;         // Nanoseconds from the selection of a cell to the new game status
+    FGameMetrics Metrics;           // Only with --metrics
+};
+
+/// Function prototypes
+bool ParseOptions(int, char*[], FSimulationOptions&);
+void Simulate(const FSimulationOptions&, const FBoardConfig&, FThreadPool&, FGameMetrics&);
+void PlayGames(const FSimulationOptions&, const FBoardConfig&, int, int, FSimulationStats&);
+void PlayOneGame(FMineSweeper&, FMovePolicy&, uint64_t, FSimulationStats&);
+void PrintStats(const FBoardConfig&, const FSimulationStats&, double);
+
+/// Main loop
+int main(int argc, char* argv[])
+{
+    FSimulationOptions Options;
+    if (!ParseOptions(argc, argv, Options))
+    {
+        std::cout << "Usage: Simulator [--games N] [--policy random|safe|solver|probability|sampled] [--threads T] [--board WxHxM] [--seed S] [--journal-dir DIR] [--metrics FILE]\n";
+        return 1;
+    }
+
+    FThreadPool Pool(Options.NumThreads);
+    std::cout << "Playing " << Options.NumGames << " games per board with the " << GetMovePolicyName(Options.Policy) << " policy on "
+    << Pool.GetNumThreads() << " threads (seed " << Options.Seed << ")\n\n";
+    FGameMetrics Metrics;
+    for (const FBoardConfig& Board : Options.Boards)
+    {
+        Simulate(Options, Board, Pool, Metrics);
+    }
+    if (!Options.MetricsPath.empty() && !WriteMetrics(Metrics, GetMetricsFormat(Options.MetricsPath), Options.MetricsPath))
+    {
+        std::cerr << "Error writing " << Options.MetricsPath << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+/// Read the command line. Without --board every difficulty is simulated.
+bool ParseOptions(int argc, char* argv[], FSimulationOptions& Options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const char* Value = argv[++i];
+        if (strcmp(argv[i - 1], "--games") == 0)
+        {
+            Options.NumGames = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--threads") == 0)
+        {
+            Options.NumThreads = atoi(Value);
+        }
+        else if (strcmp(argv[i - 1], "--seed") == 0)
+        {
+            Options.Seed = strtoull(Value, nullptr, 10);
+        }
+        else if (strcmp(argv[i - 1], "--journal-dir") == 0)
+        {
+            Options.JournalDir = Value;
+        }
+        else if (strcmp(argv[i - 1], "--metrics") == 0)
+        {
+            Options.MetricsPath = Value;
+        }
+        else if (strcmp(argv[i - 1], "--policy") == 0)
+        {
+            if (!ParseMovePolicy(Value, Options.Policy))
+            {
+                return false;
+            }
+        }
+        else if (strcmp(argv[i - 1], "--board") == 0)
+        {
+            FBoardConfig Board;
+            Board.Name = Value;
+            if (sscanf(Value, "%dx%dx%d", &Board.Width, &Board.Height, &Board.Mines) != 3 || !FMineSweeper().SetGameParams(Board.Width, Board.Height, Board.Mines))
+            {
+                return false;
+            }
+            Options.Boards.push_back(Board);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (Options.Boards.empty())
+    {
+        for (int Difficulty = 1; Difficulty <= MAX_SIMULATED_DIFFICULTY; Difficulty++)
+        {
+            FBoardConfig Board;
+            Board.Name = "difficulty " + std::to_string(Difficulty);
+            Board.Difficulty = Difficulty;
+            Options.Boards.push_back(Board);
+        }
+    }
+    return Options.NumGames > 0;
+}
+
+/// Play every game of a board on the pool, in tasks of GAMES_PER_TASK games, and print the merged results
+void Simulate(const FSimulationOptions& Options, const FBoardConfig& Board, FThreadPool& Pool, FGameMetrics& Metrics)
+{
+    std::vector<FSimulationStats> WorkerStats(Pool.GetNumThreads());   // Each worker only touches its own stats, no locks needed
+
+    auto Start = std::chrono::steady_clock::now();
+    for (int First = 0; First < Options.NumGames; First += GAMES_PER_TASK)
+    {
+        int Last = First + GAMES_PER_TASK < Options.NumGames ? First + GAMES_PER_TASK : Options.NumGames;
+        Pool.Submit([&Options, &Board, &WorkerStats, First, Last](int Worker)
+        {
+            PlayGames(Options, Board, First, Last, WorkerStats[Worker]);
+        });
+    }
+    Pool.Wait();
+    double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+    FSimulationStats Total;
+    for (const FSimulationStats& Stats : WorkerStats)
+    {
+        Total.Games += Stats.Games;
+        Total.Wins += Stats.Wins;
+        Total.Moves += Stats.Moves;
+        Total.MoveLatency.Merge(Stats.MoveLatency);
+        Metrics.Merge(Stats.Metrics);
+    }
+    PrintStats(Board, Total, Seconds);
+}
+
+/// Play the games [First, Last) of a board. Each game number has its own seed, for the board and for the policy.
+void PlayGames(const FSimulationOptions& Options, const FBoardConfig& Board, int First, int Last, FSimulationStats& Stats)
+{
+    FGameJournal Journal;           // Declared before the game, which records its last checksum when it is destroyed
+    FMineSweeper Game;
+    if (!Options.JournalDir.empty())
+    {
+        std::string Name = Board.Difficulty > 0 ? "d" + std::to_string(Board.Difficulty) : Board.Name;
+        std::string Path = Options.JournalDir + "/simulator-" + Name + "-" + std::to_string(First) + ".journal";
+        if (Journal.Open(Path.c_str()))
+        {
+            Game.SetJournal(&Journal);
+        }
+    }
+    if (!Options.MetricsPath.empty())
+    {
+        Game.SetMetrics(&Stats.Metrics);
+    }
+    if (Board.Difficulty > 0)
+    {
+        Game.SetGameParams(Board.Difficulty);
+    }
+    else
+    {
+        Game.SetGameParams(Board.Width, Board.Height, Board.Mines);
+    }
+
+    for (int GameNumber = First; GameNumber < Last; GameNumber++)
+    {
+        uint64_t GameSeed = MixBits64(Options.Seed ^ MixBits64((uint64_t) GameNumber + RNG_GOLDEN_GAMMA));
+        std::unique_ptr<FMovePolicy> Policy = MakeMovePolicy(Options.Policy, GameSeed);
+        PlayOneGame(Game, *Policy, GameSeed, Stats);
+    }
+}
+
+/// Play a game until it is won or lost, measuring the time of every move
+void PlayOneGame(FMineSweeper& Game, FMovePolicy& Policy, uint64_t Seed, FSimulationStats& Stats)
+{
+    Game.SetFirstClickSafe(Policy.IsFirstClickSafe());     // The mines are placed on the first click, away from it
+    if (!Game.Reset(Seed))
+    {
+        Game.EraseMemory();
+        return;
+    }
+    Policy.StartGame(Game);
+    int Index = Policy.ChooseMove(Game);
+
+    while (Index >= 0)
+    {
+        auto MoveStart = std::chrono::steady_clock::now();
+        Game.SetCellUserBoard(Index);
+        const std::vector<int>& Revealed = Game.SetCellUserVisitedBoard(Index);
+        Game.SetGameStatus(Index);
+        auto MoveEnd = std::chrono::steady_clock::now();
+        Stats.MoveLatency.Add((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(MoveEnd - MoveStart).count());
+        Stats.Moves++;
+
+        if (Game.GetGameStatus() != EGameStatus::KeepPlaying)
+        {
+            break;
+        }
+        Policy.MoveDone(Game, Revealed);
+        Index = Policy.ChooseMove(Game);
+    }
+    Stats.Games++;
+    Stats.Wins += (Game.GetGameStatus() == EGameStatus::GameWon) ? 1 : 0;
+    Game.EraseMemory();
+}
+
+/// Print the throughput, win rate and latencies of a board
+void PrintStats(const FBoardConfig& Board, const FSimulationStats& Stats, double Seconds)
+{
+    const FHistogram& Latency = Stats.MoveLatency;
+    std::cout << Board.Name << ": " << Stats.Games << " games in " << Seconds << " s (" << Stats.Games / Seconds << " games/s)\n";
+    std::cout << "    win rate " << 100.0 * Stats.Wins / Stats.Games << " %, " << (double) Stats.Moves / Stats.Games << " moves per game";
+    std::cout << "\n    move latency (ns): mean " << Latency.GetMean() << ", p50 " << Latency.GetPercentile(0.5) << ", p90 " << Latency.GetPercentile(0.9)
+    << ", p99 " << Latency.GetPercentile(0.99) << ", p99.9 " << Latency.GetPercentile(0.999) << ", max " << Latency.Max << "\n\n";
+}
@@ -0,0 +1,481 @@
+/* Minesweeper solver, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "Solver.h"
+#include <algorithm>
+#include <cmath>
+
+#define QUEUED_SINGLE 0x01          // Flags of QueuedFlags: the constraint is waiting on each queue
+#define QUEUED_PAIR 0x02
+#define QUEUED_AREA 0x04
+#define MARK_CONSTRAINT 0x01        // Flags of AreaMarks: the cell was added to the current area as a constraint or as a hidden cell
+#define MARK_HIDDEN 0x02
+#define AREA_EPSILON 1e-9           // Tolerance of the Gaussian elimination
+
+/// Getters
+const std::vector<int>& FMineSolver::GetMineCells() const { return MineCells; }
+ESolverCell FMineSolver::GetCell(int Index) const { return Cells[Index]; }
+
+/// Safe cells the player has not revealed yet. Revealed ones are removed first.
+const std::vector<int>& FMineSolver::GetSafeCells()
+{
+    size_t Kept = 0;
+    for (size_t i = 0; i < SafeCells.size(); i++)
+    {
+        if (Cells[SafeCells[i]] == ESolverCell::Safe)
+        {
+            SafeCells[Kept++] = SafeCells[i];
+        }
+    }
+    SafeCells.resize(Kept);
+    return SafeCells;
+}
+
+int FMineSolver::GetHint()
+{
+    const std::vector<int>& Safe = GetSafeCells();
+    return Safe.empty() ? -1 : Safe.back();
+}
+
+/// Read the whole User board of a new (or resumed) game and solve it
+void FMineSolver::StartGame(const FMineSweeper& Game)
+{
+    Width = Game.GetBoardWidth();
+    Height = Game.GetBoardHeight();
+    int Size = Game.GetBoardSize();
+    Cells.assign(Size, ESolverCell::Hidden);
+    MinesLeft.assign(Size, 0);
+    HiddenLeft.assign(Size, 0);
+    QueuedFlags.assign(Size, 0);
+    AreaMarks.assign(Size, 0);
+    SafeCells.clear();
+    MineCells.clear();
+    SingleQueue.clear();
+    PairQueue.clear();
+    AreaQueue.clear();
+
+    FBoardView Board = Game.GetUserBoard();
+    for (int i = 0; i < Size; i++)
+    {
+        if (Board[i] >= '0' && Board[i] <= '8')
+        {
+            SetRevealed(i, Board[i] - '0');
+        }
+    }
+    Solve();
+}
+
+/// Add the constraints of the cells revealed by the last move, and check only what they changed
+void FMineSolver::Update(const FMineSweeper& Game, const std::vector<int>& Revealed)
+{
+    FBoardView Board = Game.GetUserBoard();
+    for (int Cell : Revealed)
+    {
+        if (Board[Cell] >= '0' && Board[Cell] <= '8')  // An exploded mine is not a constraint
+        {
+            SetRevealed(Cell, Board[Cell] - '0');
+        }
+    }
+    Solve();
+}
+
+/// Setters
+
+/// A number was displayed: it becomes a constraint, and the constraints around lose a hidden cell
+void FMineSolver::SetRevealed(int Cell, int Number)
+{
+    int Neighbours[8];
+    int NumNeighbours = GetNeighbours(Cell, Neighbours);
+    bool bWasHidden = (Cells[Cell] == ESolverCell::Hidden);
+    if (Cells[Cell] == ESolverCell::Revealed)
+    {
+        return;
+    }
+
+    Cells[Cell] = ESolverCell::Revealed;
+    MinesLeft[Cell] = (int8_t) Number;
+    HiddenLeft[Cell] = 0;
+    for (int i = 0; i < NumNeighbours; i++)
+    {
+        int Neighbour = Neighbours[i];
+        if (Cells[Neighbour] == ESolverCell::Mine)
+        {
+            MinesLeft[Cell]--;
+        }
+        else if (Cells[Neighbour] == ESolverCell::Hidden)
+        {
+            HiddenLeft[Cell]++;
+        }
+        else if (Cells[Neighbour] == ESolverCell::Revealed && bWasHidden)
+        {
+            HiddenLeft[Neighbour]--;
+            QueueConstraint(Neighbour);
+        }
+    }
+    QueueConstraint(Cell);
+}
+
+/// A hidden cell was deduced to be safe or to have a mine. The constraints around are updated and checked again.
+void FMineSolver::SetDecided(int Cell, ESolverCell State)
+{
+    if (Cells[Cell] != ESolverCell::Hidden)
+    {
+        return;
+    }
+    Cells[Cell] = State;
+    (State == ESolverCell::Mine ? MineCells : SafeCells).push_back(Cell);
+
+    int Neighbours[8];
+    int NumNeighbours = GetNeighbours(Cell, Neighbours);
+    for (int i = 0; i < NumNeighbours; i++)
+    {
+        int Neighbour = Neighbours[i];
+        if (Cells[Neighbour] == ESolverCell::Revealed)
+        {
+            HiddenLeft[Neighbour]--;
+            MinesLeft[Neighbour] -= (State == ESolverCell::Mine) ? 1 : 0;
+            QueueConstraint(Neighbour);
+        }
+    }
+}
+
+/// Rest of functions
+
+/// Run the steps from the cheapest to the most expensive, going back to the cheap ones every time something new is found
+void FMineSolver::Solve()
+{
+    while (CheckSingles() || CheckPairs() || CheckAreas())
+    {
+    }
+}
+
+/// Single cell rule on the queued constraints. Returns true if any cell was decided.
+bool FMineSolver::CheckSingles()
+{
+    int Hidden[8];
+    bool bDecided = false;
+    while (!SingleQueue.empty())
+    {
+        int Cell = SingleQueue.back();
+        SingleQueue.pop_back();
+        QueuedFlags[Cell] &= ~QUEUED_SINGLE;
+        if (HiddenLeft[Cell] == 0)
+        {
+            continue;
+        }
+
+        ESolverCell State = ESolverCell::Hidden;
+        if (MinesLeft[Cell] == 0)                           // Every mine is known, the rest are safe
+        {
+            State = ESolverCell::Safe;
+        }
+        else if (MinesLeft[Cell] == HiddenLeft[Cell])       // Every hidden cell is needed to reach the number
+        {
+            State = ESolverCell::Mine;
+        }
+        if (State != ESolverCell::Hidden)
+        {
+            int NumHidden = GetHiddenNeighbours(Cell, Hidden);
+            for (int i = 0; i < NumHidden; i++)
+            {
+                SetDecided(Hidden[i], State);
+            }
+            bDecided = true;
+        }
+    }
+    return bDecided;
+}
+
+/// Pair rule: compare each queued constraint with the constraints up to 2 cells away. Returns true if any cell was decided.
+bool FMineSolver::CheckPairs()
+{
+    int HiddenA[8], HiddenB[8], OnlyA[8], OnlyB[8];
+    bool bDecided = false;
+    std::vector<int> Queue;
+    Queue.swap(PairQueue);
+    for (int A : Queue)
+    {
+        QueuedFlags[A] &= ~QUEUED_PAIR;
+    }
+
+    for (int A : Queue)
+    {
+        if (HiddenLeft[A] == 0)
+        {
+            continue;
+        }
+        int NumHiddenA = GetHiddenNeighbours(A, HiddenA);
+        int AX = A % Width, AY = A / Width;
+        bool bChanged = false;
+        for (int Y = std::max(0, AY - 2); Y <= std::min(Height - 1, AY + 2) && !bChanged; Y++)
+        {
+            for (int X = std::max(0, AX - 2); X <= std::min(Width - 1, AX + 2) && !bChanged; X++)
+            {
+                int B = X + Y * Width;
+                if (B == A || Cells[B] != ESolverCell::Revealed || HiddenLeft[B] == 0)
+                {
+                    continue;
+                }
+                int NumHiddenB = GetHiddenNeighbours(B, HiddenB);
+                int NumOnlyA = (int) (std::set_difference(HiddenA, HiddenA + NumHiddenA, HiddenB, HiddenB + NumHiddenB, OnlyA) - OnlyA);
+                int NumOnlyB = (int) (std::set_difference(HiddenB, HiddenB + NumHiddenB, HiddenA, HiddenA + NumHiddenA, OnlyB) - OnlyB);
+                if (NumOnlyA + NumOnlyB == NumHiddenA + NumHiddenB)
+                {
+                    continue;                               // No shared cells, nothing to learn
+                }
+
+                // Mines only on B minus mines only on A is always the difference of mines left
+                int Difference = MinesLeft[B] - MinesLeft[A];
+                ESolverCell StateOnlyA = ESolverCell::Hidden, StateOnlyB = ESolverCell::Hidden;
+                if (NumOnlyB > 0 && Difference == NumOnlyB)
+                {
+                    StateOnlyB = ESolverCell::Mine;
+                    StateOnlyA = ESolverCell::Safe;
+                }
+                else if (NumOnlyA > 0 && -Difference == NumOnlyA)
+                {
+                    StateOnlyA = ESolverCell::Mine;
+                    StateOnlyB = ESolverCell::Safe;
+                }
+                else if (Difference == 0 && (NumOnlyA == 0 || NumOnlyB == 0))
+                {
+                    StateOnlyA = ESolverCell::Safe;         // One is inside the other and both have the same mines
+                    StateOnlyB = ESolverCell::Safe;
+                }
+                if (StateOnlyA == ESolverCell::Hidden || NumOnlyA + NumOnlyB == 0)
+                {
+                    continue;
+                }
+                for (int i = 0; i < NumOnlyA; i++)
+                {
+                    SetDecided(OnlyA[i], StateOnlyA);
+                }
+                for (int i = 0; i < NumOnlyB; i++)
+                {
+                    SetDecided(OnlyB[i], StateOnlyB);
+                }
+                bChanged = true;                            // A was queued again by the decisions, with its new hidden cells
+                bDecided = true;
+            }
+        }
+    }
+    return bDecided;
+}
+
+/// Linear algebra on the frontier areas of the queued constraints. Returns true if any cell was decided.
+bool FMineSolver::CheckAreas()
+{
+    bool bDecided = false;
+    std::vector<int> Queue;
+    Queue.swap(AreaQueue);
+    for (int Cell : Queue)
+    {
+        QueuedFlags[Cell] &= ~QUEUED_AREA;
+    }
+    for (int Cell : Queue)
+    {
+        if (!(AreaMarks[Cell] & MARK_CONSTRAINT))          // Areas are solved once, even if several of their constraints were queued
+        {
+            bDecided = CheckArea(Cell) || bDecided;
+        }
+    }
+    for (int Cell : MarkedCells)
+    {
+        AreaMarks[Cell] = 0;
+    }
+    MarkedCells.clear();
+    return bDecided;
+}
+
+/// Collect the area of constraints connected to Start through shared hidden cells, reduce it and decide the cells it determines
+bool FMineSolver::CheckArea(int Start)
+{
+    int Neighbours[8];
+    std::vector<int> Constraints;
+    std::vector<int> Hidden;
+    if (Cells[Start] != ESolverCell::Revealed || HiddenLeft[Start] == 0)
+    {
+        return false;
+    }
+
+    AreaMarks[Start] |= MARK_CONSTRAINT;
+    MarkedCells.push_back(Start);
+    Constraints.push_back(Start);
+    for (size_t Next = 0; Next < Constraints.size(); Next++)   // Breadth first search, alternating constraints and hidden cells
+    {
+        int NumHidden = GetHiddenNeighbours(Constraints[Next], Neighbours);
+        for (int i = 0; i < NumHidden; i++)
+        {
+            int HiddenCell = Neighbours[i];
+            if (AreaMarks[HiddenCell] & MARK_HIDDEN)
+            {
+                continue;
+            }
+            AreaMarks[HiddenCell] |= MARK_HIDDEN;
+            MarkedCells.push_back(HiddenCell);
+            Hidden.push_back(HiddenCell);
+            if (Hidden.size() > SOLVER_MAX_AREA_CELLS)
+            {
+                return false;
+            }
+
+            int AroundHidden[8];
+            int NumAround = GetNeighbours(HiddenCell, AroundHidden);
+            for (int j = 0; j < NumAround; j++)
+            {
+                int Constraint = AroundHidden[j];
+                if (Cells[Constraint] == ESolverCell::Revealed && HiddenLeft[Constraint] > 0 && !(AreaMarks[Constraint] & MARK_CONSTRAINT))
+                {
+                    AreaMarks[Constraint] |= MARK_CONSTRAINT;
+                    MarkedCells.push_back(Constraint);
+                    Constraints.push_back(Constraint);
+                }
+            }
+        }
+    }
+    if (Constraints.size() < 2)
+    {
+        return false;                                       // A single constraint was already checked by the single cell rule
+    }
+
+    // One row per constraint, one column per hidden cell and the number of mines left on the last column
+    std::sort(Hidden.begin(), Hidden.end());
+    int NumColumns = (int) Hidden.size();
+    int NumRows = (int) Constraints.size();
+    std::vector<double> Matrix((size_t) NumRows * (NumColumns + 1), 0.0);
+    for (int Row = 0; Row < NumRows; Row++)
+    {
+        int NumHidden = GetHiddenNeighbours(Constraints[Row], Neighbours);
+        for (int i = 0; i < NumHidden; i++)
+        {
+            int Column = (int) (std::lower_bound(Hidden.begin(), Hidden.end(), Neighbours[i]) - Hidden.begin());
+            Matrix[(size_t) Row * (NumColumns + 1) + Column] = 1.0;
+        }
+        Matrix[(size_t) Row * (NumColumns + 1) + NumColumns] = MinesLeft[Constraints[Row]];
+    }
+
+    // Gaussian elimination to reduced row echelon form, with partial pivoting
+    auto At = [&](int Row, int Column) -> double& { return Matrix[(size_t) Row * (NumColumns + 1) + Column]; };
+    int PivotRow = 0;
+    for (int Column = 0; Column < NumColumns && PivotRow < NumRows; Column++)
+    {
+        int Best = PivotRow;
+        for (int Row = PivotRow + 1; Row < NumRows; Row++)
+        {
+            Best = std::fabs(At(Row, Column)) > std::fabs(At(Best, Column)) ? Row : Best;
+        }
+        if (std::fabs(At(Best, Column)) < AREA_EPSILON)
+        {
+            continue;
+        }
+        for (int k = 0; k <= NumColumns; k++)
+        {
+            std::swap(At(PivotRow, k), At(Best, k));
+        }
+        double Pivot = At(PivotRow, Column);
+        for (int k = 0; k <= NumColumns; k++)
+        {
+            At(PivotRow, k) /= Pivot;
+        }
+        for (int Row = 0; Row < NumRows; Row++)
+        {
+            double Factor = At(Row, Column);
+            if (Row != PivotRow && std::fabs(Factor) > AREA_EPSILON)
+            {
+                for (int k = 0; k <= NumColumns; k++)
+                {
+                    At(Row, k) -= Factor * At(PivotRow, k);
+                }
+            }
+        }
+        PivotRow++;
+    }
+
+    // A row decides its cells when its value can only be reached with every positive cell at 1 and every negative at 0, or the opposite
+    std::vector<std::pair<int, ESolverCell>> Decisions;
+    for (int Row = 0; Row < PivotRow; Row++)
+    {
+        double Positive = 0.0, Negative = 0.0;
+        for (int Column = 0; Column < NumColumns; Column++)
+        {
+            double Value = At(Row, Column);
+            Positive += Value > AREA_EPSILON ? Value : 0.0;
+            Negative += Value < -AREA_EPSILON ? Value : 0.0;
+        }
+        double Target = At(Row, NumColumns);
+        bool bPositiveMines = std::fabs(Target - Positive) < AREA_EPSILON;
+        bool bNegativeMines = std::fabs(Target - Negative) < AREA_EPSILON;
+        if (!bPositiveMines && !bNegativeMines)
+        {
+            continue;
+        }
+        for (int Column = 0; Column < NumColumns; Column++)
+        {
+            double Value = At(Row, Column);
+            if (std::fabs(Value) > AREA_EPSILON)
+            {
+                bool bMine = bPositiveMines ? Value > 0.0 : Value < 0.0;
+                Decisions.push_back(std::make_pair(Hidden[Column], bMine ? ESolverCell::Mine : ESolverCell::Safe));
+            }
+        }
+    }
+    for (const std::pair<int, ESolverCell>& Decision : Decisions)
+    {
+        SetDecided(Decision.first, Decision.second);
+    }
+    return !Decisions.empty();
+}
+
+/// Queue a revealed cell on every step, unless it is already waiting there
+void FMineSolver::QueueConstraint(int Cell)
+{
+    if (!(QueuedFlags[Cell] & QUEUED_SINGLE))
+    {
+        SingleQueue.push_back(Cell);
+    }
+    if (!(QueuedFlags[Cell] & QUEUED_PAIR))
+    {
+        PairQueue.push_back(Cell);
+    }
+    if (!(QueuedFlags[Cell] & QUEUED_AREA))
+    {
+        AreaQueue.push_back(Cell);
+    }
+    QueuedFlags[Cell] |= QUEUED_SINGLE | QUEUED_PAIR | QUEUED_AREA;
+}
+
+/// Cells around the given one, in increasing order. Returns how many there are.
+int FMineSolver::GetNeighbours(int Cell, int Neighbours[]) const
+{
+    int X = Cell % Width, Y = Cell / Width;
+    int NumNeighbours = 0;
+    for (int NY = Y - 1; NY <= Y + 1; NY++)
+    {
+        for (int NX = X - 1; NX <= X + 1; NX++)
+        {
+            if ((NX != X || NY != Y) && NX >= 0 && NX < Width && NY >= 0 && NY < Height)
+            {
+                Neighbours[NumNeighbours++] = NX + NY * Width;
+            }
+        }
+    }
+    return NumNeighbours;
+}
+
+/// Undecided hidden cells around the given one, in increasing order. Returns how many there are.
+int FMineSolver::GetHiddenNeighbours(int Cell, int Hidden[]) const
+{
+    int Neighbours[8];
+    int NumNeighbours = GetNeighbours(Cell, Neighbours);
+    int NumHidden = 0;
+    for (int i = 0; i < NumNeighbours; i++)
+    {
+        if (Cells[Neighbours[i]] == ESolverCell::Hidden)
+        {
+            Hidden[NumHidden++] = Neighbours[i];
+        }
+    }
+    return NumHidden;
+}
@@ -0,0 +1,76 @@
+/* Minesweeper solver: finds the cells that are provably safe and the ones that provably have a mine.
+
+It only reads what a player can see (the User board). Each displayed number is a constraint: the hidden cells around it contain
+exactly that number of mines, minus the mines already deduced. Constraints are checked in three steps, from cheap to expensive:
+1. Single cell: no mines left means every hidden neighbour is safe, as many mines left as hidden neighbours means all are mines.
+2. Pairs of nearby constraints: the cells of one that are not on the other must hold the difference of mines.
+3. Linear algebra: the constraints of a frontier area are reduced with Gaussian elimination, and rows whose value can only be
+   reached one way decide their cells.
+The solver is incremental: after a move, only the constraints around the new cells (or around new deductions) are checked again.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include "Minesweeper.h"
+#include <vector>
+
+#define SOLVER_MAX_AREA_CELLS 128   // Biggest frontier area solved with linear algebra, bigger ones are skipped to keep moves fast
+
+/// What the solver knows about a cell
+enum class ESolverCell : uint8_t
+{
+    Hidden,                         // Nothing is known
+    Revealed,                       // Displayed on the User board, it holds a constraint
+    Mine,                           // Hidden, but it has a mine for sure
+    Safe                            // Hidden, but it has no mine for sure
+};
+
+/// Solver of the game being played. Call StartGame once and Update after every move.
+class FMineSolver
+{
+    public:
+        /// Getters
+        const std::vector<int>& GetSafeCells();         // Hidden cells without a mine for sure
+        const std::vector<int>& GetMineCells() const;   // Hidden cells with a mine for sure
+        ESolverCell GetCell(int) const;
+        int GetHint();                                  // A safe hidden cell, or -1 if none is known
+
+        /// Rest of functions
+        void StartGame(const FMineSweeper&);                        // Reads the whole User board
+        void Update(const FMineSweeper&, const std::vector<int>&);  // Reads only the cells revealed by the last move
+
+    private:
+        int Width = 0;
+        int Height = 0;
+        std::vector<ESolverCell> Cells;
+        std::vector<int8_t> MinesLeft;      // For revealed cells: number displayed minus neighbours known to have a mine
+        std::vector<int8_t> HiddenLeft;     // For revealed cells: neighbours still hidden and undecided
+
+        std::vector<int> SafeCells;
+        std::vector<int> MineCells;
+
+        /// Constraints to check again on each step, with a flag per cell so they are queued only once
+        std::vector<int> SingleQueue;
+        std::vector<int> PairQueue;
+        std::vector<int> AreaQueue;
+        std::vector<uint8_t> QueuedFlags;
+
+        /// Scratch of the linear algebra step: cells already added to an area, and the list of them to clear the marks afterwards
+        std::vector<uint8_t> AreaMarks;
+        std::vector<int> MarkedCells;
+
+        /// Setters
+        void SetRevealed(int, int);
+        void SetDecided(int, ESolverCell);
+
+        /// Rest of functions
+        void Solve();
+        bool CheckSingles();
+        bool CheckPairs();
+        bool CheckAreas();
+        bool CheckArea(int);
+        void QueueConstraint(int);
+        int  GetNeighbours(int, int[]) const;
+        int  GetHiddenNeighbours(int, int[]) const;
+};
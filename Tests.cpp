@@ -0,0 +1,667 @@
+/* Console executable with the consistency checks of the engine (built by CMakeLists.txt as Tests, each check is a ctest test).
+
+Each check plays seeded games, so a failure can be reproduced, and compares a fast path of the engine against a simple reference:
+- history: undo, redo and jumps of FGameHistory (GameHistory.h) against the states the game went through when it was played.
+- history_noop_keeps_redo: a move that changes nothing, played after an undo, keeps the move to redo.
+- hibernate_keeps_history: a command session hibernated (CommandProtocol.h) after an undo can still redo the move when it wakes.
+- history_safe_first_click: undoing the first click of a first click safe game removes its mines, so a click on one of them is safe
+  again, and redoing it places the same mines.
+- solver: every cell FMineSolver (Solver.h) proves safe or mined after each move matches the mines of the board.
+- infinite: the numbers that FInfiniteBoard (InfiniteBoard.h) displays on the edges of its tiles against a direct count of the mines
+  around, each one found by revealing the cell on a fresh board of the same seed. The same reveals made in the opposite order, so
+  the tiles are generated in another order, must display the same cells.
+- infinite_partial_reveal: a reveal of an endless area stops at INFINITE_MAX_REVEAL cells on a frontier around the cell, not on a
+  long path, the reply of the command says partial, and a reveal on the frontier goes on.
+- strips: nearby mines counts and reveals on 2, 3 and 7 strips (BoardStrips.h) against the same games on one thread: same counts, same
+  cells revealed (sorted, as strips list them in another order), same spaces left and same state.
+- probability: the mine probabilities of FMineProbability (MineProbability.h) on small boards against the share of every placement of
+  the mines that matches the numbers displayed, all of them enumerated.
+
+Usage: Tests [NAME]...          Runs the checks named, or every check without arguments
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Minesweeper.h"
+#include "CommandProtocol.h"
+#include "GameHistory.h"
+#include "InfiniteBoard.h"
+#include "MineProbability.h"
+#include "Solver.h"
+#include "Random.h"
+
+#define HISTORY_TEST_GAMES 200      // Games played by the history check
+#define HISTORY_TEST_STEPS 2000     // Most moves, undos and jumps of each of them
+#define FIRST_CLICK_TEST_GAMES 300  // Games of the first click undo check
+#define SOLVER_TEST_GAMES 3000      // Games played by the solver check
+#define INFINITE_TEST_WORLDS 12     // Seeds of the infinite board check
+#define INFINITE_TEST_REVEALS 40    // Reveals tried on each of them, on the edges of the tiles around the origin
+#define INFINITE_TEST_COUNTS 150    // Numbers counted directly on each of them
+#define INFINITE_TEST_RADIUS 510    // Farthest a capped reveal may open from its cell: the square of INFINITE_MAX_REVEAL cells around it
+                                    // is 1000 cells wide, a few mines make it a bit wider
+#define STRIPS_TEST_CLICKS 12       // Reveals tried on each game of the strips check
+#define PROBABILITY_TEST_POSITIONS 400  // Small games of the probability check
+#define PROBABILITY_TEST_HIDDEN 20      // Most hidden cells of a position enumerated, 2^20 placements
+
+/// Check of the engine: returns false and explains the first failure on Error
+struct FTestCase
+{
+    const char* Name;
+    bool (*Run)(std::string&);
+};
+
+/// Function prototypes
+bool TestHistory(std::string&);
+bool TestHistoryNoOpKeepsRedo(std::string&);
+bool TestHistorySafeFirstClick(std::string&);
+bool TestHibernateKeepsHistory(std::string&);
+bool TestSolver(std::string&);
+bool TestInfinite(std::string&);
+bool TestInfinitePartialReveal(std::string&);
+bool TestStrips(std::string&);
+bool TestProbability(std::string&);
+void PlayReveal(FMineSweeper&, int);
+bool IsInfiniteMine(FInfiniteBoard&, uint64_t, int32_t, int32_t);
+
+const FTestCase TestCases[] =
+{
+    { "history", TestHistory },
+    { "history_noop_keeps_redo", TestHistoryNoOpKeepsRedo },
+    { "history_safe_first_click", TestHistorySafeFirstClick },
+    { "hibernate_keeps_history", TestHibernateKeepsHistory },
+    { "solver", TestSolver },
+    { "infinite", TestInfinite },
+    { "infinite_partial_reveal", TestInfinitePartialReveal },
+    { "strips", TestStrips },
+    { "probability", TestProbability },
+};
+
+/// Main loop
+int main(int argc, char* argv[])
+{
+    int Failed = 0, Run = 0;
+    for (const FTestCase& Test : TestCases)
+    {
+        bool bSelected = argc < 2;
+        for (int i = 1; i < argc; i++)
+        {
+            bSelected = bSelected || strcmp(argv[i], Test.Name) == 0;
+        }
+        if (!bSelected)
+        {
+            continue;
+        }
+        std::string Error;
+        bool bOk = Test.Run(Error);
+        std::cout << (bOk ? "ok   " : "FAIL ") << Test.Name << (bOk ? "" : ": " + Error) << "\n";
+        Failed += !bOk;
+        Run++;
+    }
+    if (Run == 0)
+    {
+        std::cout << "Usage: Tests [NAME]...\n";
+        return 1;
+    }
+    return Failed == 0 ? 0 : 1;
+}
+
+/// A reveal as every caller plays it
+void PlayReveal(FMineSweeper& Game, int Index)
+{
+    Game.SetCellUserBoard(Index);
+    Game.SetCellUserVisitedBoard(Index);
+    Game.SetGameStatus(Index);
+}
+
+/// Whether a cell of the world of a seed has a mine: revealing it on a fresh board loses the game
+bool IsInfiniteMine(FInfiniteBoard& Probe, uint64_t Seed, int32_t X, int32_t Y)
+{
+    Probe.Reset(Seed);
+    Probe.Reveal(X, Y);
+    return Probe.GetGameStatus() == EGameStatus::GameLost;
+}
+
+/// Random reveals (rarely on a mine), flags, chords and jumps on seeded games. Every state reached by an undo, a redo or a jump must
+/// hash as the state the game had after that many moves when it was played.
+bool TestHistory(std::string& Error)
+{
+    int CheckpointJumps = 0;
+    for (int g = 0; g < HISTORY_TEST_GAMES; g++)
+    {
+        int Width = 8 + g % 25, Height = 8 + g % 13;
+        FMineSweeper Game(Width, Height, Width * Height / 6);
+        FGameHistory History;
+        FCounterRng Rng(g, 0);
+        bool bFlagGame = g % 4 >= 2;            // Mostly flags, so the log outgrows the board and checkpoints are taken
+        Game.SetFirstClickSafe(g % 2 == 1);
+        Game.SetHistory(&History);
+        Game.Reset(1000 + g);
+        FBoardView Mines = Game.GetNearbyMinesBoard();
+        FBoardView User = Game.GetUserBoard();
+        std::vector<uint64_t> Hashes = { Game.GetStateHash() };
+        for (int Step = 0; Step < HISTORY_TEST_STEPS && Game.GetGameStatus() == EGameStatus::KeepPlaying; Step++)
+        {
+            int Action = (int) Rng.NextBelow(bFlagGame ? 100 : 10);
+            int Cell = (int) Rng.NextBelow(Width * Height);
+            if (bFlagGame)
+            {
+                Action = Action == 0 ? 0 : (Action < 99 ? 4 : 8);
+            }
+            if (Action < 4 && User[Cell] == '-' && (Mines[Cell] != 'X' || Rng.NextBelow(50) == 0))
+            {
+                PlayReveal(Game, Cell);
+            }
+            else if (Action >= 4 && Action < 6)
+            {
+                Game.SetCellFlag(Cell, bFlagGame ? Rng.NextBelow(2) == 1 : Mines[Cell] == 'X');
+            }
+            else if (Action >= 6 && Action < 8)
+            {
+                Game.ChordCell(Cell);
+                Game.SetGameStatus(Cell);
+            }
+            else if (Action >= 8 && History.GetCurrentMove() > 0)
+            {
+                int Target = (int) Rng.NextBelow(History.GetCurrentMove() + 1);
+                CheckpointJumps += History.FindCheckpoint(Target) >= 0;
+                Game.GoToMove(Target);
+                Hashes.resize(Target + 1);
+                if (Game.GetStateHash() != Hashes[Target])
+                {
+                    Error = "game " + std::to_string(g) + ": jump to move " + std::to_string(Target) + " reached another state";
+                    return false;
+                }
+                continue;
+            }
+            if (History.GetCurrentMove() + 1 != (int) Hashes.size())
+            {
+                Hashes.push_back(Game.GetStateHash());
+            }
+        }
+        int NumMoves = History.GetCurrentMove();
+        for (int Move = NumMoves - 1; Move >= 0; Move--)
+        {
+            if (!Game.UndoMove() || Game.GetStateHash() != Hashes[Move])
+            {
+                Error = "game " + std::to_string(g) + ": undo to move " + std::to_string(Move) + " reached another state";
+                return false;
+            }
+        }
+        for (int Move = 1; Move <= NumMoves; Move++)
+        {
+            if (!Game.RedoMove() || Game.GetStateHash() != Hashes[Move])
+            {
+                Error = "game " + std::to_string(g) + ": redo of move " + std::to_string(Move) + " reached another state";
+                return false;
+            }
+        }
+    }
+    if (CheckpointJumps == 0)
+    {
+        Error = "no jump restored a checkpoint";
+        return false;
+    }
+    return true;
+}
+
+/// A reveal of a cell already displayed changes nothing, so after an undo it must not drop the move to redo
+bool TestHistoryNoOpKeepsRedo(std::string& Error)
+{
+    FMineSweeper Game(30, 16, 99);
+    FGameHistory History;
+    Game.SetFirstClickSafe(true);
+    Game.SetHistory(&History);
+    Game.Reset(2019);
+    int First = 15 + 8 * 30;
+    PlayReveal(Game, First);
+    FBoardView User = Game.GetUserBoard();
+    FBoardView Mines = Game.GetNearbyMinesBoard();
+    int Second = 0;
+    while (Second < Game.GetBoardSize() && (User[Second] != '-' || Mines[Second] == 'X'))
+    {
+        Second++;
+    }
+    PlayReveal(Game, Second);
+    uint64_t Hash = Game.GetStateHash();
+    if (History.GetCurrentMove() != 2 || !Game.UndoMove())
+    {
+        Error = "the two reveals were not recorded";
+        return false;
+    }
+    PlayReveal(Game, First);                    // Displayed already
+    if (History.GetNumMoves() != 2 || !Game.RedoMove() || Game.GetStateHash() != Hash)
+    {
+        Error = "the move undone could not be redone after a reveal that changed nothing";
+        return false;
+    }
+    return true;
+}
+
+/// First clicks on dense first click safe games, undone: the board must be as Reset left it, a cell that had a mine must be safe to
+/// click, and the click must be redone on the same mines
+bool TestHistorySafeFirstClick(std::string& Error)
+{
+    const int Sizes[][3] = { { 9, 9, 10 }, { 8, 8, 40 }, { 16, 16, 99 }, { 30, 16, 99 } };
+    for (int g = 0; g < FIRST_CLICK_TEST_GAMES; g++)
+    {
+        const int* Size = Sizes[g % (sizeof(Sizes) / sizeof(Sizes[0]))];
+        int BoardSize = Size[0] * Size[1];
+        FMineSweeper Game(Size[0], Size[1], Size[2]);
+        FGameHistory History;
+        FCounterRng Rng(g, 0);
+        Game.SetFirstClickSafe(true);
+        Game.SetHistory(&History);
+        Game.Reset(5000 + g);
+        int Flag = (int) Rng.NextBelow(BoardSize);
+        if (g % 3 == 0)                         // A flag before the first click stays when the click is undone
+        {
+            Game.SetCellFlag(Flag, true);
+        }
+        uint64_t StartHash = Game.GetStateHash();
+        int First = (Flag + 1 + (int) Rng.NextBelow(BoardSize - 1)) % BoardSize;
+        PlayReveal(Game, First);
+        uint64_t ClickHash = Game.GetStateHash();
+        FBoardView Mines = Game.GetNearbyMinesBoard();
+        int Mine = 0;
+        while (Mine < BoardSize && (Mines[Mine] != 'X' || Mine == Flag))
+        {
+            Mine++;
+        }
+        if (!Game.UndoMove() || Game.GetStateHash() != StartHash)
+        {
+            Error = "game " + std::to_string(g) + ": undoing the first click did not return to the start";
+            return false;
+        }
+        if (!Game.RedoMove() || Game.GetStateHash() != ClickHash)
+        {
+            Error = "game " + std::to_string(g) + ": redoing the first click reached another state";
+            return false;
+        }
+        Game.UndoMove();
+        PlayReveal(Game, Mine);
+        if (Game.GetGameStatus() == EGameStatus::GameLost)
+        {
+            Error = "game " + std::to_string(g) + ": the first click after an undo hit a mine";
+            return false;
+        }
+    }
+    return true;
+}
+
+/// The moves of a session outlive its hibernation: undone before it, a move is redone after it, to the same board
+bool TestHibernateKeepsHistory(std::string& Error)
+{
+    FCommandSession Session;
+    std::string Setup, Before, After;
+    const char* Commands[] = { "new 9 9 10 42", "reveal 4 4", "undo" };
+    for (const char* Command : Commands)
+    {
+        Session.RunCommand(Command, Command + strlen(Command), Setup);
+    }
+    const char* Redo = "redo";
+    const char* Board = "board";
+    Session.RunCommand(Redo, Redo + 4, Before);
+    Session.RunCommand(Board, Board + 5, Before);
+    Session.RunCommand(Commands[2], Commands[2] + 4, Setup);
+    if (!Session.Hibernate("Tests-hibernate.snapshot"))
+    {
+        Error = "the session could not be hibernated";
+        return false;
+    }
+    Session.RunCommand(Redo, Redo + 4, After);
+    Session.RunCommand(Board, Board + 5, After);
+    if (After.compare(0, 2, "ok") != 0 || After != Before)
+    {
+        Error = "the move undone before the hibernation was not redone after it: " + After.substr(0, After.find('\n'));
+        return false;
+    }
+    return true;
+}
+
+/// One mine on each tile, so the area around the origin is endless and the reveal stops at INFINITE_MAX_REVEAL cells
+bool TestInfinitePartialReveal(std::string& Error)
+{
+    FInfiniteBoard Board;
+    Board.SetGameParams(1);
+    Board.Reset(2019);
+    std::vector<FInfiniteCell> Revealed = Board.Reveal(0, 0);
+    if (Board.IsRevealComplete() || Revealed.size() != INFINITE_MAX_REVEAL)
+    {
+        Error = "the reveal of an endless area did not stop at INFINITE_MAX_REVEAL cells";
+        return false;
+    }
+    FInfiniteCell Edge = { 0, 0 };
+    for (const FInfiniteCell& Cell : Revealed)
+    {
+        if (std::abs(Cell.X) > INFINITE_TEST_RADIUS || std::abs(Cell.Y) > INFINITE_TEST_RADIUS)
+        {
+            Error = "the reveal opened " + std::to_string(Cell.X) + "," + std::to_string(Cell.Y) + ", far from its cell";
+            return false;
+        }
+        Edge = (Cell.X > Edge.X && Board.GetUserCell(Cell.X, Cell.Y) == '0') ? Cell : Edge;
+    }
+    if (Board.GetUserCell(Edge.X + 1, Edge.Y) != '-' || Board.Reveal(Edge.X + 1, Edge.Y).empty()
+        || Board.GetUserCell(Edge.X + 1, Edge.Y) == '-')
+    {
+        Error = "a reveal on the frontier of the area did not go on";
+        return false;
+    }
+
+    FCommandSession Session;
+    std::string Reply;
+    const char* New = "new infinite 1 2019";
+    const char* Reveal = "reveal 0 0";
+    Session.RunCommand(New, New + strlen(New), Reply);
+    Reply.clear();
+    Session.RunCommand(Reveal, Reveal + strlen(Reveal), Reply);
+    if (Reply.size() < 9 || Reply.compare(Reply.size() - 9, 9, " partial\n") != 0)
+    {
+        Error = "the reply of a capped reveal does not end with partial";
+        return false;
+    }
+    return true;
+}
+
+/// Seeded games from beginner to expert densities, each move on a hint of the solver or, when it has none, on a random cell without
+/// a mine, so the games reach their end. After every move each cell the solver decided must match the board.
+bool TestSolver(std::string& Error)
+{
+    const int Sizes[][3] = { { 9, 9, 10 }, { 16, 16, 40 }, { 30, 16, 99 }, { 9, 9, 23 }, { 20, 12, 60 } };
+    FMineSolver Solver;
+    uint64_t Decided = 0;
+    for (int g = 0; g < SOLVER_TEST_GAMES; g++)
+    {
+        const int* Size = Sizes[g % (sizeof(Sizes) / sizeof(Sizes[0]))];
+        FMineSweeper Game(Size[0], Size[1], Size[2]);
+        FCounterRng Rng(g, 0);
+        Game.SetFirstClickSafe(true);
+        Game.Reset(3000 + g);
+        Solver.StartGame(Game);
+        int Cell = Size[0] / 2 + Size[1] / 2 * Size[0];
+        while (Cell >= 0)
+        {
+            Game.SetCellUserBoard(Cell);
+            const std::vector<int>& Revealed = Game.SetCellUserVisitedBoard(Cell);
+            Game.SetGameStatus(Cell);
+            if (Game.GetGameStatus() != EGameStatus::KeepPlaying)
+            {
+                break;
+            }
+            Solver.Update(Game, Revealed);
+            FBoardView Mines = Game.GetNearbyMinesBoard();
+            FBoardView User = Game.GetUserBoard();
+            for (int i = 0; i < Game.GetBoardSize(); i++)
+            {
+                ESolverCell Known = Solver.GetCell(i);
+                if ((Known == ESolverCell::Safe && Mines[i] == 'X') || (Known == ESolverCell::Mine && Mines[i] != 'X'))
+                {
+                    Error = "game " + std::to_string(g) + ": cell " + std::to_string(i) + " deduced wrong";
+                    return false;
+                }
+                Decided += (Known == ESolverCell::Safe || Known == ESolverCell::Mine) ? 1 : 0;
+            }
+            Cell = Solver.GetHint();
+            for (int Try = 0; Cell < 0 && Try < 4 * Game.GetBoardSize(); Try++)
+            {
+                int Guess = (int) Rng.NextBelow(Game.GetBoardSize());
+                Cell = (User[Guess] == '-' && Mines[Guess] != 'X') ? Guess : -1;
+            }
+        }
+    }
+    if (Decided == 0)
+    {
+        Error = "the solver decided no cell";
+        return false;
+    }
+    return true;
+}
+
+/// Reveal cells next to the edges of the tiles (never on a mine), then count the mines around the numbers displayed on those edges
+/// one by one, and reveal the same cells on another board in the opposite order
+bool TestInfinite(std::string& Error)
+{
+    FInfiniteBoard Board, Reversed, Probe;
+    for (int s = 0; s < INFINITE_TEST_WORLDS; s++)
+    {
+        int Mines = 400 + (s * 97) % 800;                   // From 10 to 29 % of the cells
+        FCounterRng Rng(s, 0);
+        Board.SetGameParams(Mines);
+        Reversed.SetGameParams(Mines);
+        Probe.SetGameParams(Mines);
+        Board.Reset(s);
+        Reversed.Reset(s);
+        std::vector<FInfiniteCell> Reveals = { { 0, 0 } }, Shown;
+        for (int r = 0; r < INFINITE_TEST_REVEALS; r++)
+        {
+            int32_t Edge = (int32_t) Rng.NextBelow(6) * INFINITE_TILE_SIDE - 3 * INFINITE_TILE_SIDE - (int32_t) Rng.NextBelow(2);
+            int32_t Along = (int32_t) Rng.NextBelow(6 * INFINITE_TILE_SIDE) - 3 * INFINITE_TILE_SIDE;
+            FInfiniteCell Cell = (r % 2 == 0) ? FInfiniteCell{ Edge, Along } : FInfiniteCell{ Along, Edge };
+            if (Board.GetUserCell(Cell.X, Cell.Y) == '-' && !IsInfiniteMine(Probe, s, Cell.X, Cell.Y))
+            {
+                Reveals.push_back(Cell);
+            }
+        }
+        for (const FInfiniteCell& Cell : Reveals)
+        {
+            const std::vector<FInfiniteCell>& Revealed = Board.Reveal(Cell.X, Cell.Y);
+            Shown.insert(Shown.end(), Revealed.begin(), Revealed.end());
+        }
+        for (int r = (int) Reveals.size() - 1; r >= 0; r--)
+        {
+            Reversed.Reveal(Reveals[r].X, Reveals[r].Y);
+        }
+        if (Board.GetGameStatus() != EGameStatus::KeepPlaying || Board.GetStats().CellsShown != Reversed.GetStats().CellsShown)
+        {
+            Error = "seed " + std::to_string(s) + ": the reveals in the opposite order displayed other cells";
+            return false;
+        }
+
+        int Counted = 0;
+        for (const FInfiniteCell& Cell : Shown)
+        {
+            char Number = Board.GetUserCell(Cell.X, Cell.Y);
+            if (Number != Reversed.GetUserCell(Cell.X, Cell.Y))
+            {
+                Error = "seed " + std::to_string(s) + ": a cell differs when the tiles are generated in the opposite order";
+                return false;
+            }
+            int LocalX = Cell.X & (INFINITE_TILE_SIDE - 1), LocalY = Cell.Y & (INFINITE_TILE_SIDE - 1);
+            bool bOnEdge = LocalX == 0 || LocalX == INFINITE_TILE_SIDE - 1 || LocalY == 0 || LocalY == INFINITE_TILE_SIDE - 1;
+            if (!bOnEdge || Counted == INFINITE_TEST_COUNTS)
+            {
+                continue;
+            }
+            int Around = 0;
+            for (int32_t Y = Cell.Y - 1; Y <= Cell.Y + 1; Y++)
+            {
+                for (int32_t X = Cell.X - 1; X <= Cell.X + 1; X++)
+                {
+                    bool bHidden = (X != Cell.X || Y != Cell.Y) && Board.GetUserCell(X, Y) == '-';
+                    Around += (bHidden && IsInfiniteMine(Probe, s, X, Y)) ? 1 : 0;
+                }
+            }
+            if (Number - '0' != Around)
+            {
+                Error = "seed " + std::to_string(s) + ": cell (" + std::to_string(Cell.X) + ", " + std::to_string(Cell.Y) + ") shows "
+                      + Number + " with " + std::to_string(Around) + " mines around";
+                return false;
+            }
+            Counted++;
+        }
+        if (Counted == 0)
+        {
+            Error = "seed " + std::to_string(s) + ": no number displayed on the edge of a tile";
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Games played at once on one thread and on strips, with some flags, on boards big enough for strips: the biggest is counted on strips
+/// too (STRIPS_MIN_CELLS), the others only reveal on them. A density of 0 opens the whole board on the first reveal.
+bool TestStrips(std::string& Error)
+{
+    const int Sizes[][2] = { { 1000, 1100 }, { 300, 400 }, { 257, 2000 } };
+    const double Densities[] = { 0.0, 0.02, 0.08, 0.12 };
+    const int ThreadCounts[] = { 2, 3, 7 };
+    std::vector<int> Single, Strips;
+    int Played = 0;
+    for (const int* Size : Sizes)
+    {
+        for (double Density : Densities)
+        {
+            for (int Threads : ThreadCounts)
+            {
+                int Width = Size[0], Height = Size[1], BoardSize = Width * Height;
+                bool bSafe = (Played++ % 2) == 1;
+                FMineSweeper One(Width, Height, (int) (Density * BoardSize)), Many(Width, Height, (int) (Density * BoardSize));
+                FCounterRng Rng(Played, 0);
+                One.SetFirstClickSafe(bSafe);
+                Many.SetFirstClickSafe(bSafe);
+                Many.SetGenerationThreads(Threads);
+                Many.SetRevealThreads(Threads);
+                One.Reset(1234 + Played);
+                Many.Reset(1234 + Played);
+                std::string Name = std::to_string(Width) + "x" + std::to_string(Height) + " on " + std::to_string(Threads) + " strips";
+                FBoardView OneCounts = One.GetNearbyMinesBoard(), ManyCounts = Many.GetNearbyMinesBoard();
+                for (int i = 0; !bSafe && i < BoardSize; i++)       // A safe first click places the mines later
+                {
+                    if (OneCounts[i] != ManyCounts[i])
+                    {
+                        Error = Name + ": cell " + std::to_string(i) + " counted another number of mines";
+                        return false;
+                    }
+                }
+                for (int f = 1; f < BoardSize / 500; f++)
+                {
+                    int Cell = (int) Rng.NextBelow(BoardSize);
+                    One.SetCellFlag(Cell, true);
+                    Many.SetCellFlag(Cell, true);
+                }
+                for (int Click = 0; Click < STRIPS_TEST_CLICKS && One.GetGameStatus() == EGameStatus::KeepPlaying; Click++)
+                {
+                    int Cell = (int) Rng.NextBelow(BoardSize);
+                    if (One.GetUserBoard()[Cell] != '-')
+                    {
+                        continue;
+                    }
+                    One.SetCellUserBoard(Cell);
+                    Many.SetCellUserBoard(Cell);
+                    Single = One.SetCellUserVisitedBoard(Cell);
+                    Strips = Many.SetCellUserVisitedBoard(Cell);
+                    One.SetGameStatus(Cell);
+                    Many.SetGameStatus(Cell);
+                    std::sort(Single.begin(), Single.end());
+                    std::sort(Strips.begin(), Strips.end());
+                    if (Single != Strips || One.GetResults().NumSpacesLeft != Many.GetResults().NumSpacesLeft
+                        || One.GetStateHash() != Many.GetStateHash())
+                    {
+                        Error = Name + ": the reveal of cell " + std::to_string(Cell) + " ended on other cells";
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/// Small seeded games after a few reveals away from the mines and sometimes a flag (flags are only guesses, so they are hidden cells
+/// as any other). Every placement of the mines on the hidden cells is tried, and the ones that match every number give the exact share.
+bool TestProbability(std::string& Error)
+{
+    FMineProbability Probability;
+    std::vector<int> Hidden, Mines;
+    std::vector<double> Matches;
+    int Checked = 0;
+    for (int p = 0; p < PROBABILITY_TEST_POSITIONS; p++)
+    {
+        FCounterRng Rng(p, 0);
+        int Width = 4 + (int) Rng.NextBelow(4), Height = 4 + (int) Rng.NextBelow(3), NumMines = 3 + (int) Rng.NextBelow(6);
+        FMineSweeper Game(Width, Height, NumMines);
+        Game.Reset(1000 + p);
+        FBoardView Truth = Game.GetNearbyMinesBoard();
+        FBoardView User = Game.GetUserBoard();
+        for (int Reveals = 1 + (int) Rng.NextBelow(4); Reveals > 0; Reveals--)
+        {
+            int Cell = (int) Rng.NextBelow(Width * Height);
+            if (Truth[Cell] != 'X' && User[Cell] == '-')
+            {
+                PlayReveal(Game, Cell);
+            }
+        }
+        Game.SetCellFlag((int) Rng.NextBelow(Width * Height), Rng.NextBelow(3) == 0);
+        Hidden.clear();
+        for (int i = 0; i < Width * Height; i++)
+        {
+            if (User[i] == '-' || User[i] == 'F')
+            {
+                Hidden.push_back(i);
+            }
+        }
+        if (Game.GetGameStatus() != EGameStatus::KeepPlaying || (int) Hidden.size() > PROBABILITY_TEST_HIDDEN)
+        {
+            continue;
+        }
+
+        Matches.assign(Width * Height, 0.0);
+        double Total = 0.0;
+        for (uint32_t Placement = 0; Placement < (1u << Hidden.size()); Placement++)
+        {
+            Mines.assign(Width * Height, 0);
+            int Placed = 0;
+            for (int h = 0; h < (int) Hidden.size(); h++)
+            {
+                Mines[Hidden[h]] = (Placement >> h) & 1;
+                Placed += Mines[Hidden[h]];
+            }
+            bool bMatch = Placed == NumMines;
+            for (int i = 0; i < Width * Height && bMatch; i++)
+            {
+                if (User[i] < '0' || User[i] > '8')
+                {
+                    continue;
+                }
+                int X = i % Width, Y = i / Width, Around = 0;
+                for (int NY = std::max(0, Y - 1); NY <= std::min(Height - 1, Y + 1); NY++)
+                {
+                    for (int NX = std::max(0, X - 1); NX <= std::min(Width - 1, X + 1); NX++)
+                    {
+                        Around += Mines[NX + NY * Width];
+                    }
+                }
+                bMatch = Around == User[i] - '0';
+            }
+            Total += bMatch ? 1.0 : 0.0;
+            for (int h = 0; bMatch && h < (int) Hidden.size(); h++)
+            {
+                Matches[Hidden[h]] += Mines[Hidden[h]];
+            }
+        }
+
+        Probability.Compute(Game);
+        for (int Cell : Hidden)
+        {
+            if (!Probability.IsExact() || std::fabs(Probability.GetProbability(Cell) - Matches[Cell] / Total) > 1e-9)
+            {
+                Error = "position " + std::to_string(p) + ": cell " + std::to_string(Cell) + " has a mine probability of "
+                      + std::to_string(Probability.GetProbability(Cell)) + " instead of " + std::to_string(Matches[Cell] / Total);
+                return false;
+            }
+        }
+        Checked++;
+    }
+    if (Checked == 0)
+    {
+        Error = "no position was small enough to enumerate";
+        return false;
+    }
+    return true;
+}
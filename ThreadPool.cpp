@@ -0,0 +1,121 @@
+/* Work stealing thread pool, implementation details.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#include "ThreadPool.h"
+
+static thread_local const FThreadPool* CurrentPool = nullptr;   // Pool of the worker running on this thread, if any
+static thread_local int CurrentWorker = -1;
+
+FThreadPool::FThreadPool(int NumThreads) : NumQueued(0), NumPending(0), NextQueue(0)
+{
+    if (NumThreads <= 0)
+    {
+        NumThreads = (int) std::thread::hardware_concurrency();
+        NumThreads = NumThreads < 1 ? 1 : NumThreads;
+    }
+    for (int i = 0; i < NumThreads; i++)
+    {
+        Queues.emplace_back(new FWorkerQueue());
+    }
+    for (int i = 0; i < NumThreads; i++)
+    {
+        Workers.emplace_back(&FThreadPool::WorkerLoop, this, i);
+    }
+}
+
+FThreadPool::~FThreadPool()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        bStopping = true;
+    }
+    WorkAvailable.notify_all();
+    for (std::thread& Worker : Workers)
+    {
+        Worker.join();
+    }
+}
+
+int FThreadPool::GetNumThreads() const { return (int) Workers.size(); }
+
+/// Queue a task. Workers keep their own tasks, which are usually related to what they are running, and others steal them when idle.
+void FThreadPool::Submit(FTask Task)
+{
+    int Queue = (CurrentPool == this) ? CurrentWorker : (int) (NextQueue.fetch_add(1) % Queues.size());
+    NumPending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> Lock(Queues[Queue]->Mutex);
+        Queues[Queue]->Tasks.push_back(std::move(Task));
+    }
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);   // Taken so a worker can not miss the notification between its check and its wait
+        NumQueued.fetch_add(1);
+    }
+    WorkAvailable.notify_one();
+}
+
+/// Wait until every task has finished. Tasks may submit more tasks, they are waited for too.
+void FThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> Lock(SleepMutex);
+    AllDone.wait(Lock, [this]() { return NumPending.load() == 0; });
+}
+
+/// Take the newest task of the own queue or, if it is empty, the oldest task of another queue. Returns false if every queue is empty.
+bool FThreadPool::TakeTask(int Worker, FTask& Task)
+{
+    {
+        FWorkerQueue& Own = *Queues[Worker];
+        std::lock_guard<std::mutex> Lock(Own.Mutex);
+        if (!Own.Tasks.empty())
+        {
+            Task = std::move(Own.Tasks.back());
+            Own.Tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < Queues.size(); i++)     // Steal, starting by the next worker so thieves spread over the victims
+    {
+        FWorkerQueue& Victim = *Queues[(Worker + i) % Queues.size()];
+        std::lock_guard<std::mutex> Lock(Victim.Mutex);
+        if (!Victim.Tasks.empty())
+        {
+            Task = std::move(Victim.Tasks.front());
+            Victim.Tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Run tasks until the pool is destroyed, sleeping while there is nothing to do
+void FThreadPool::WorkerLoop(int Worker)
+{
+    CurrentPool = this;
+    CurrentWorker = Worker;
+    FTask Task;
+    while (true)
+    {
+        if (TakeTask(Worker, Task))
+        {
+            NumQueued.fetch_sub(1);
+            Task(Worker);
+            Task = nullptr;
+            if (NumPending.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> Lock(SleepMutex);
+                AllDone.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+        WorkAvailable.wait(Lock, [this]() { return bStopping || NumQueued.load() > 0; });
+        if (bStopping && NumQueued.load() == 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/* Work stealing thread pool.
+
+Each worker has its own queue of tasks. A worker takes the newest task of its own queue and, when it is empty, steals the oldest
+task of another worker, so work spreads over all the cores without a single queue every thread fights for.
+Tasks receive the index of the worker that runs them, so they can accumulate results on per-worker data without locks.
+
+Created by: Angel del Ojo Jimenez, July 2019
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Pool of worker threads that run tasks until it is destroyed
+class FThreadPool
+{
+    public:
+        typedef std::function<void(int)> FTask;     // Receives the index of the worker running it
+
+        explicit FThreadPool(int NumThreads);       // 0 or less means one thread per core
+        ~FThreadPool();                             // Waits for the pending tasks and stops the workers
+        FThreadPool(const FThreadPool&) = delete;
+        FThreadPool& operator=(const FThreadPool&) = delete;
+
+        /// Getters
+        int GetNumThreads() const;
+
+        /// Rest of functions
+        void Submit(FTask);                         // From a worker the task goes to its own queue, from outside they are spread round robin
+        void Wait();                                // Blocks until every submitted task has finished
+
+    private:
+        /// Tasks of a single worker
+        struct FWorkerQueue
+        {
+            std::mutex Mutex;
+            std::deque<FTask> Tasks;
+        };
+
+        std::vector<std::unique_ptr<FWorkerQueue>> Queues;
+        std::vector<std::thread> Workers;
+        std::atomic<int> NumQueued;                 // Tasks waiting on any queue
+        std::atomic<int> NumPending;                // Tasks submitted and not finished yet
+        std::atomic<unsigned> NextQueue;            // Round robin for tasks submitted from outside
+        bool bStopping = false;
+        std::mutex SleepMutex;
+        std::condition_variable WorkAvailable;
+        std::condition_variable AllDone;
+
+        void WorkerLoop(int);
+        bool TakeTask(int, FTask&);
+};
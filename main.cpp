@@ -2,11 +2,18 @@
 
 This Minesweeper version requires the user to interact via command lines.
 There are 5 possible difficulties, which vary the size of the board and the number of mines.
+A custom board of any width, height and number of mines can also be played.
 Boards are generated randomly, to increase replayability.
 When the user selects a cell with no adjacent mines, the board automatically unveils all the empty cells adjacent to it.
 Future work: include record of previous games, include time to beat the game, check if the best time has been beaten for the selected difficulty.
 
 Game logic is included on Minesweeper class.
+With --script [file], the game reads commands from the file (or the standard input) instead of asking, check CommandProtocol.h.
+With --safe, the mines are placed after the first click, so it never finds a mine nor a number.
+With --journal FILE, every game is appended to the journal file, to replay it later with Replay (check GameJournal.h).
+With --metrics FILE, the metrics of the games (check GameMetrics.h) are written to the file after each game (or at the end of a script),
+as JSON if its name ends in .json or as Prometheus text otherwise.
+With --threads T, very big boards are generated and their big areas opened on T threads (0 means one per core, check BoardStrips.h).
 
 Created by: Angel del Ojo Jimenez, July 2019
  */
@@ -16,31 +23,85 @@ Created by: Angel del Ojo Jimenez, July 2019
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <limits>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <thread>
 #include "Minesweeper.h"
+#include "Renderer.h"
+#include "CommandProtocol.h"
+#include "GameJournal.h"
+#include "GameMetrics.h"
 
 #define MAX_DIFFICULTY 5    // Check Minesweeper.cpp if this parameter has to be changed.
 #define MIN_DIFFICULTY 1
+#define CUSTOM_DIFFICULTY 0 // Lets the player choose width, height and number of mines
         
 
 /// Function prototypes
+int  RunScript(const char*);
 void PrintIntro();
 void AskForDifficulty();
 bool IsDifficultyValid(int);
+void AskForCustomBoard();
 bool PrepareMemory();
 void PrintGameParams();
 void PlayGame();
-void PrintBoard();
 int  GetValidCoordinates();
-bool AreCoordinatesValid(int, int, int);
+bool AreCoordinatesValid(int, int);
 bool ShallPlayAgain();          
-void PrintFinalBoard();
 void PrintGameSummary();
 
+FGameJournal Journal;         // Declared before the game, so it is still open when the game records its last checksum
+FGameMetrics Metrics;         // Games played, also used for the summary of each game
+std::string MetricsPath;      // File the metrics are written to, empty if they are not written
 FMineSweeper Game;            // New game instance, to be reused on each play-through
+FBoardRenderer Renderer;      // Draws the boards on the terminal, only the cells that changed after each move
 
 /// Main loop
-int main()
+int main(int argc, char* argv[])
 {   
+    bool bScript = false;
+    const char* ScriptPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--script") == 0)           // Non interactive play, the file is optional
+        {
+            bScript = true;
+            ScriptPath = (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) ? argv[++i] : nullptr;
+        }
+        else if (strcmp(argv[i], "--safe") == 0)
+        {
+            Game.SetFirstClickSafe(true);
+        }
+        else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc)
+        {
+            if (!Journal.Open(argv[++i]))
+            {
+                std::cerr << "Error opening " << argv[i] << "\n";
+                return 1;
+            }
+            Game.SetJournal(&Journal);
+        }
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+        {
+            MetricsPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            int NumThreads = atoi(argv[++i]);
+            NumThreads = NumThreads > 0 ? NumThreads : (int) std::thread::hardware_concurrency();
+            Game.SetGenerationThreads(NumThreads);
+            Game.SetRevealThreads(NumThreads);
+        }
+    }
+    if (bScript)
+    {
+        return RunScript(ScriptPath);
+    }
+    Game.SetMetrics(&Metrics);
+
     bool bPlayAgain = false;
     do              
     {
@@ -63,6 +124,27 @@ int main()
     return 0;                               // Exit the game
 }
 
+/// Play the commands of a file, or of the standard input if there is no file. Returns the exit code of the application.
+int RunScript(const char* Path)
+{
+    FILE* Script = (Path != nullptr) ? fopen(Path, "rb") : stdin;
+    if (Script == nullptr)
+    {
+        std::cerr << "Error opening " << Path << "\n";
+        return 1;
+    }
+    bool bOk = RunCommandStream(fileno(Script), fileno(stdout), Journal.IsOpen() ? &Journal : nullptr, MetricsPath.empty() ? nullptr : &Metrics);
+    if (Path != nullptr)
+    {
+        fclose(Script);
+    }
+    if (!MetricsPath.empty() && !WriteMetrics(Metrics, GetMetricsFormat(MetricsPath), MetricsPath))
+    {
+        std::cerr << "Error writing " << MetricsPath << "\n";
+    }
+    return bOk ? 0 : 1;
+}
+
 /// Print introductory messages    
 void PrintIntro()
 {
@@ -81,20 +163,53 @@ void AskForDifficulty()
 {
     int Difficulty;
     do{                                             // Loop to ensure the player input is acceptable
-        std::cout << "Introduce desired difficulty (" << MIN_DIFFICULTY << "-" << MAX_DIFFICULTY << "): ";
+        std::cout << "Introduce desired difficulty (" << MIN_DIFFICULTY << "-" << MAX_DIFFICULTY << ", or " << CUSTOM_DIFFICULTY << " for a custom board): ";
         std::cin >> Difficulty;                     // Get difficulty from user input and discard the rest of the buffer
         std::cin.clear();
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     } while (!IsDifficultyValid(Difficulty));
     std::cout << std::endl;
     
-    Game.SetGameParams(Difficulty);
+    if (Difficulty == CUSTOM_DIFFICULTY)
+    {
+        AskForCustomBoard();
+    }
+    else
+    {
+        Game.SetGameParams(Difficulty);
+    }
+}
+
+/// Ask the player for the width, height and number of mines of the board until they are valid
+void AskForCustomBoard()
+{
+    int Width, Height, Mines;
+    bool bValidBoard = false;
+    do{                                             // Loop to ensure the board can be built
+        std::cout << "Introduce board width, height and number of mines separated by spaces: ";
+        std::cin >> Width;
+        std::cin >> Height;
+        std::cin >> Mines;
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        bValidBoard = Game.SetGameParams(Width, Height, Mines);
+        if (!bValidBoard)
+        {
+            std::cout << "\nIncorrect board, sides must be at least " << MIN_BOARD_SIDE 
+            << " and there must be at least one cell without a mine\n\n\n";
+        }
+    } while (!bValidBoard);
+    std::cout << std::endl;
 }
 
 /// Check that the selected difficulty is on the desired range
 bool IsDifficultyValid(int Difficulty)
 {
-    if(Difficulty < MIN_DIFFICULTY || Difficulty > MAX_DIFFICULTY)
+    if (Difficulty == CUSTOM_DIFFICULTY)
+    {
+        return true;
+    }
+    else if(Difficulty < MIN_DIFFICULTY || Difficulty > MAX_DIFFICULTY)
     {
         std::cout << "Incorrect difficulty, please try again\n\n\n";
         return false;
@@ -124,7 +239,7 @@ bool PrepareMemory()
 /// Let the player know how many mines are on this board
 void PrintGameParams()
 {
-    std::cout << Game.GetNumMines() << " mines on this board\n\n";
+    std::cout << Game.GetNumMines() << " mines on this board (seed " << Game.GetSeed() << ")\n\n";
 }
 
 /// Single game playthrough, 
@@ -132,86 +247,75 @@ void PlayGame()
 {   
     int Input = 0;
 
-    PrintBoard();                               // Print the user board for the first time so the player has some guidance
+    Renderer.StartGame(Game);
+    Renderer.DrawBoard(Game, -1);               // Print the user board for the first time so the player has some guidance
     do                                          // Iterate on the game until it is over (either victory or defeat)
     {
         Input = GetValidCoordinates();
         Game.SetCellUserBoard(Input);
         Game.SetCellUserVisitedBoard(Input); 
         Game.SetGameStatus(Input);
-        PrintBoard();
+        Renderer.DrawBoard(Game, Input);        // Only the cells that changed are drawn again
     } while (Game.GetGameStatus() == EGameStatus::KeepPlaying);
-    PrintFinalBoard();                          // Print board with all the mines
+    Renderer.DrawFinalBoard(Game);              // Print board with all the mines
     Game.EraseMemory();                         // Delete all boards from memory
 }
 
-/// Print current user board
-void PrintBoard()
-{
-    char *Board = Game.GetUserBoard();
-    int Size = Game.GetBoardSize();
-    int InxNextLine = Game.GetBoardOrder();
-    int RowNum = 0;
-    
-    if (Board)                      // Print the user board on a clean and stylish way, indicating (x, y) index      
-    {
-        std::cout << "\n   (x)";
-        for (int i = 0; i < InxNextLine; i++) { std::cout << ' ' << i ;}
-        std::cout << std::endl;
-        std::cout << "(y)   \n";
-        std::cout << " 0    " ;
-        for (int i = 1; i <= Size; i++)
-        {
-            RowNum = i / InxNextLine;
-            std::cout << '|' << Board[i-1] ;
-             if ((i) % InxNextLine  == 0)
-            {
-                std::cout << '|' << std::endl;
-                if (RowNum < InxNextLine)
-                {
-                std::cout << ' ' << RowNum << "    ";
-                }
-            }
-        }
-        std::cout << std::endl << std::endl;
-    }
-    else                            // The board should always be obtained since it was correctly created before
-    {
-        std::cout << "Error obtaining user board, please exit\n\n";
-    }
-}
-
 /// Continuous loop until valid input is detected
 int GetValidCoordinates() 
 {
     int XIn, YIn;
-    int Index;
+    std::string First;
+    bool bValid = false;
 
     do{             // Loop to ensure the coordinates entered are within the board range and not repeated
         std::cout << "Introduce desired point's coordinates x and y separated by a space: ";
-        std::cin >> XIn;
+        std::cin >> First;
+        bool bMoveView = (First == "v" || First == "V");    // "v x y" moves the view of big boards instead of playing
+        if (bMoveView)
+        {
+            std::cin >> XIn;
+        }
+        else
+        {
+            char* End = nullptr;
+            XIn = (int) strtol(First.c_str(), &End, 10);
+            XIn = (End != First.c_str() && *End == '\0') ? XIn : -1;
+        }
         std::cin >> YIn;
         std::cin.clear();
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        Index = XIn + Game.GetBoardOrder() * YIn; // Boards are defined as arrays, so it is needed to transform from matrix to array index
-    } while(!AreCoordinatesValid(XIn, YIn, Index)); 
+
+        if (bMoveView)
+        {
+            Renderer.MoveViewport(Game, XIn, YIn);
+            Renderer.Invalidate();
+            Renderer.DrawBoard(Game, -1);
+        }
+        else
+        {
+            bValid = AreCoordinatesValid(XIn, YIn);
+        }
+    } while(!bValid); 
     
-    return Index;
+    return XIn + Game.GetBoardWidth() * YIn;    // Boards are defined as arrays, so it is needed to transform from matrix to array index
 }
 
 /// Check that the input coordinates are on the valid range and not repeated from previous game turns
-bool AreCoordinatesValid(int XIn, int YIn, int Index)
+bool AreCoordinatesValid(int XIn, int YIn)
 {
-    char* Board = Game.GetUserBoard();
-    if (XIn < 0 || XIn > Game.GetBoardOrder() || YIn < 0 || YIn > Game.GetBoardOrder())         // Index out of range
+    FBoardView Board = Game.GetUserBoard();
+    if (XIn < 0 || XIn >= Game.GetBoardWidth() || YIn < 0 || YIn >= Game.GetBoardHeight())      // Index out of range
     {
-        std::cout << "\nPlease introduce coordinates in range [0, " 
-        << Game.GetBoardOrder() - 1 << "]" << std::endl << std::endl << std::endl;
+        std::cout << "\nPlease introduce x in range [0, " << Game.GetBoardWidth() - 1 
+        << "] and y in range [0, " << Game.GetBoardHeight() - 1 << "]" << std::endl << std::endl << std::endl;
+        Renderer.Invalidate();                                                                  // The message may scroll the board
         return false;
     }
-    else if (Board[Index] != '-')                                                               // Cell already visited
+    else if (Board[XIn + Game.GetBoardWidth() * YIn] != '-')                                   // Cell already visited
     {
         std::cout << "\nPlease introduce an element that is not repeated\n\n\n";
+        Renderer.Invalidate();
         return false;
     }
     else
@@ -254,54 +358,22 @@ bool ShallPlayAgain()
     return bReplay;
 }
 
-/// Print board with all the mines and all the results 
-void PrintFinalBoard()
-{
-    char *Board = Game.GetNearbyMinesBoard();
-    int Size = Game.GetBoardSize();
-    int InxNextLine = Game.GetBoardOrder();
-    int RowNum = 0;
-    
-    if (Board)      // If the board was obtained, display it on a clean and stylish way
-    {
-        std::cout << "Board with all the results\n\n";
-        std::cout << "   (x)";
-        for (int i = 0; i < InxNextLine; i++) { std::cout << ' ' << i ;}
-        std::cout << std::endl;
-        std::cout << "(y)   \n";
-        std::cout << " 0    " ;
-        for (int i = 1; i <= Size; i++)
-        {
-            RowNum = i / InxNextLine;
-            std::cout << '|' << Board[i-1] ;
-             if ((i) % InxNextLine  == 0)
-            {
-                std::cout << '|' << std::endl;
-                if (RowNum < InxNextLine)
-                {
-                std::cout << ' ' << RowNum << "    ";
-                }
-            }
-        }
-        std::cout << std::endl;
-    }
-    else
-    {   // The board should always be obtained since it was correctly created before
-        std::cout << "Error obtaining user board, please exit\n\n";
-    }
-    
-}
-
 /// Print game results. To be expanded on the future with more items such as play time or game statistics.
 void PrintGameSummary()
 {   
+    const FGameRecord& Record = Metrics.LastGame;
     if(Game.GetGameStatus() == EGameStatus::GameLost)
     {
-        std::cout << "You Lost! \n\n\n";
+        std::cout << "You Lost! ";
     }
     else
     {
-        std::cout << "You Won! \n\n\n";
+        std::cout << "You Won! ";
+    }
+    std::cout << "(" << Record.Nanoseconds / 1e9 << " s, " << Record.Moves << " moves, " << Record.CellsOpened << " cells opened)\n";
+    std::cout << "Games: " << Metrics.Games << ", won: " << Metrics.Wins << ", lost: " << Metrics.Losses << "\n\n\n";
+    if (!MetricsPath.empty() && !WriteMetrics(Metrics, GetMetricsFormat(MetricsPath), MetricsPath))
+    {
+        std::cout << "Error writing " << MetricsPath << "\n";
     }
-
 }